@@ -7,7 +7,9 @@ WolfMainWindow::WolfMainWindow( QWidget* parent )
 	: QMainWindow( parent ) {
 	m_ui.setupUi( this );
 
-	// Attach the FPS widgets to the status bar.
+	// Attach the culling and FPS widgets to the status bar.
+	statusBar()->addPermanentWidget( m_ui.culledLbl );
+	statusBar()->addPermanentWidget( m_ui.culledVal );
 	statusBar()->addPermanentWidget( m_ui.fpsLbl );
 	statusBar()->addPermanentWidget( m_ui.fpsVal );
 	statusBar()->setStyleSheet( "QStatusBar::item { border: none; }" );
@@ -20,12 +22,14 @@ WolfMainWindow::WolfMainWindow( QWidget* parent )
 	m_ui.renderModeSwitch->setStyleSheet( m_ui.renderModeSwitch->styleSheet() + switchStyle );
 	m_ui.randomColorsRTSwitch->setStyleSheet( m_ui.randomColorsRTSwitch->styleSheet() + switchStyle );
 	m_ui.showBackfacesSwitch->setStyleSheet( m_ui.showBackfacesSwitch->styleSheet() + switchStyle );
+	m_ui.occlusionCullingSwitch->setStyleSheet( m_ui.occlusionCullingSwitch->styleSheet() + switchStyle );
 	m_ui.renderEdgesRasterSwitch->setStyleSheet( m_ui.renderEdgesRasterSwitch->styleSheet() + switchStyle );
 	m_ui.randomColorsRasterSwitch->setStyleSheet( m_ui.randomColorsRasterSwitch->styleSheet() + switchStyle );
 	m_ui.discoModeRasterSwitch->setStyleSheet( m_ui.discoModeRasterSwitch->styleSheet() + switchStyle );
 	m_ui.renderFacesRasterSwitch->setStyleSheet( m_ui.renderFacesRasterSwitch->styleSheet() + switchStyle );
 	m_ui.renderVertsRasterSwitch->setStyleSheet( m_ui.renderVertsRasterSwitch->styleSheet() + switchStyle );
 	m_ui.matchRTCamSwitch->setStyleSheet( m_ui.matchRTCamSwitch->styleSheet() + switchStyle );
+	m_ui.progressiveRTSwitch->setStyleSheet( m_ui.progressiveRTSwitch->styleSheet() + switchStyle );
 
 	// Connect the menu action to the render mode switch.
 	connect( m_ui.actionToggleRenderMode, &QAction::triggered, [this]() {
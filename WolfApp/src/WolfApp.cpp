@@ -69,6 +69,11 @@ void WolfApp::OnRenderModeChanged( bool rayTracingOn ) {
 void WolfApp::UpdateRenderStats() {
 	m_ui->fpsVal->setText( QString::number( m_frameIdxAtLastFPSCalc ) );
 	m_frameIdxAtLastFPSCalc = 0;
+
+	const Raster::CullingStats& culling{ m_renderer.GetCullingStats() };
+	const Raster::OcclusionStats& occlusion{ m_renderer.GetOcclusionStats() };
+	m_ui->culledVal->setText( QString( "%1 + %2 occluded / %3" )
+		.arg( culling.culled ).arg( occlusion.occluded ).arg( culling.tested ) );
 }
 
 void WolfApp::SetRenderMode( Core::RenderMode renderMode ) {
@@ -82,6 +87,7 @@ void WolfApp::SetInitialValues() {
 	MouseSensitivityRTChanged();
 	VerticalFoVRTChanged();
 	m_renderer.dataRT.randomColors = m_ui->randomColorsRTSwitch->isChecked();
+	m_renderer.dataRT.progressive = m_ui->progressiveRTSwitch->isChecked();
 
 	m_renderer.dataRaster.camera.offsetZ = m_ui->zoomRasterSpin->value();
 	m_renderer.dataRaster.camera.offsetZSens = m_ui->zoomSensRasterSpin->value();
@@ -95,7 +101,9 @@ void WolfApp::SetInitialValues() {
 	m_renderer.dataRaster.camera.farZ = m_ui->farZRasterSpin->value();
 	m_renderer.dataRaster.camera.aspectRatio = m_ui->aspectRatioRasterSpin->value();
 	m_renderer.dataRaster.showBackfaces = m_ui->showBackfacesSwitch->isChecked();
+	m_renderer.dataRaster.occlusionCulling = m_ui->occlusionCullingSwitch->isChecked();
 	m_renderer.dataRaster.renderEdges = m_ui->renderEdgesRasterSwitch->isChecked();
+	m_renderer.dataRaster.edgeMode = static_cast<Raster::EdgeMode>( m_ui->edgeModeRasterCombo->currentIndex() );
 	m_renderer.dataRaster.sceneData.useRandomColors = m_ui->randomColorsRasterSwitch->isChecked();
 	m_renderer.dataRaster.sceneData.disco = m_ui->discoModeRasterSwitch->isChecked();
 	m_renderer.dataRaster.sceneData.discoSpeed = m_ui->discoModeSpeedSpin->value();
@@ -119,6 +127,8 @@ void WolfApp::HideIrrelevantWidgets() {
 	m_ui->FOVRTSpin->setVisible( isRTMode );
 	m_ui->randomColorsRTLbl->setVisible( isRTMode );
 	m_ui->randomColorsRTSwitch->setVisible( isRTMode );
+	m_ui->progressiveRTLbl->setVisible( isRTMode );
+	m_ui->progressiveRTSwitch->setVisible( isRTMode );
 
 	m_ui->zoomRasterLbl->setHidden( isRTMode );
 	m_ui->zoomRasterSpin->setHidden( isRTMode );
@@ -144,9 +154,15 @@ void WolfApp::HideIrrelevantWidgets() {
 	m_ui->aspectRatioRasterSpin->setHidden( isRTMode );
 	m_ui->showBackfacesLbl->setHidden( isRTMode );
 	m_ui->showBackfacesSwitch->setHidden( isRTMode );
+	m_ui->culledLbl->setHidden( isRTMode );
+	m_ui->culledVal->setHidden( isRTMode );
+	m_ui->occlusionCullingLbl->setHidden( isRTMode );
+	m_ui->occlusionCullingSwitch->setHidden( isRTMode );
 	m_ui->computeAspectRatioBtn->setHidden( isRTMode );
 	m_ui->renderEdgesRasterLbl->setHidden( isRTMode );
 	m_ui->renderEdgesRasterSwitch->setHidden( isRTMode );
+	m_ui->edgeModeRasterLbl->setHidden( isRTMode );
+	m_ui->edgeModeRasterCombo->setHidden( isRTMode );
 	m_ui->randomColorsRasterLbl->setHidden( isRTMode );
 	m_ui->randomColorsRasterSwitch->setHidden( isRTMode );
 	m_ui->discoModeRasterLbl->setHidden( isRTMode );
@@ -294,6 +310,9 @@ void WolfApp::ConnectUIEvents() {
 	connect( m_ui->randomColorsRTSwitch, &QCheckBox::toggled,
 		this, [this]( bool value ) { m_renderer.dataRT.randomColors = value; }
 	);
+	connect( m_ui->progressiveRTSwitch, &QCheckBox::toggled,
+		this, [this]( bool value ) { m_renderer.dataRT.progressive = value; }
+	);
 	connect( &m_ui->viewport->inputUpdateTimer, &QTimer::timeout,
 		this, &WolfApp::OnPositionChangedRT
 	);
@@ -383,6 +402,9 @@ void WolfApp::ConnectUIEvents() {
 	connect( m_ui->showBackfacesSwitch, &QCheckBox::toggled,
 		this, [this]( bool value ) { m_renderer.dataRaster.showBackfaces = value; }
 	);
+	connect( m_ui->occlusionCullingSwitch, &QCheckBox::toggled,
+		this, [this]( bool value ) { m_renderer.dataRaster.occlusionCulling = value; }
+	);
 	connect( m_ui->computeAspectRatioBtn, &QPushButton::clicked,
 		this, [this](){ OnResize( m_ui->viewport->width(), m_ui->viewport->height()); }
 	);
@@ -550,6 +572,9 @@ void WolfApp::ConnectUIEvents() {
 		this, [this]( int value ) { m_renderer.dataRaster.sceneData.shadeMode = value;
 		}
 	);
+	connect( m_ui->edgeModeRasterCombo, &QComboBox::currentIndexChanged,
+		this, [this]( int value ) { m_renderer.dataRaster.edgeMode = static_cast<Raster::EdgeMode>(value); }
+	);
 }
 
 uint32_t WolfApp::PackColor( const QColor& color ) {
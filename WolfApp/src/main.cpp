@@ -1,9 +1,14 @@
 #include "AppGUI.h"
+#include "Benchmark.hpp"
 #include "Renderer.hpp"
 #include "WolfApp.h"
 #include <QtWidgets/QApplication>
 
 int main( int argc, char* argv[] ) {
+    // Headless CPU benchmarks run without creating a window.
+    if ( CPU::Bench::RunFromCommandLine( argc, argv ) )
+        return 0;
+
     QApplication app( argc, argv );
     Core::App appData{};
     WolfApp wolfApp{};
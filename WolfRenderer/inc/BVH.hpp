@@ -0,0 +1,270 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <algorithm> // min, max
+#include <cfloat> // FLT_MAX
+#include <cmath> // abs
+#include <cstdint> // uint32_t
+#include <DirectXMath.h> // XMFLOAT3
+#include <filesystem> // path
+#include <memory> // unique_ptr
+#include <span> // span
+#include <vector> // vector
+
+#include "Geometry.hpp" // Mesh
+#include "MappedFile.hpp" // MappedFile
+#include "RayPacket.hpp" // RayPacket, PacketStats, NoHit
+
+namespace CPU {
+	/// Axis-aligned bounding box.
+	struct AABB {
+		DirectX::XMFLOAT3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		DirectX::XMFLOAT3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow( const DirectX::XMFLOAT3& point ) {
+			min = { std::min( min.x, point.x ), std::min( min.y, point.y ), std::min( min.z, point.z ) };
+			max = { std::max( max.x, point.x ), std::max( max.y, point.y ), std::max( max.z, point.z ) };
+		}
+
+		/// Grows to include another box. Growing by an empty box leaves this one unchanged.
+		void Grow( const AABB& other ) {
+			min = { std::min( min.x, other.min.x ), std::min( min.y, other.min.y ), std::min( min.z, other.min.z ) };
+			max = { std::max( max.x, other.max.x ), std::max( max.y, other.max.y ), std::max( max.z, other.max.z ) };
+		}
+
+		/// Half of the surface area. Only ratios are used by the SAH, so the factor 2 is dropped.
+		float HalfArea() const {
+			const float ex{ max.x - min.x };
+			const float ey{ max.y - min.y };
+			const float ez{ max.z - min.z };
+			if ( ex < 0.f || ey < 0.f || ez < 0.f )
+				return 0.f;
+			return ex * ey + ey * ez + ez * ex;
+		}
+
+		bool IsEmpty() const {
+			return min.x > max.x;
+		}
+	};
+
+	/// A single ray. Defaults match the TMin/TMax used by the DXR ray generation shader.
+	struct Ray {
+		DirectX::XMFLOAT3 origin{};
+		float tMin{ 0.001f };
+		DirectX::XMFLOAT3 direction{};
+		float tMax{ 100000.f };
+	};
+
+	/// Closest hit record. Mirrors the data DXR exposes to the closest hit shader.
+	struct Hit {
+		float t{ FLT_MAX };
+		float u{}; ///< Barycentric weight of the triangle's second vertex.
+		float v{}; ///< Barycentric weight of the triangle's third vertex.
+		uint32_t primIdx{ NoHit }; ///< PrimitiveIndex() equivalent.
+		uint32_t instanceIdx{ NoHit }; ///< InstanceID() equivalent (one instance per mesh).
+
+		bool IsValid() const {
+			return primIdx != NoHit;
+		}
+	};
+
+	/// Triangle data precomputed for Moller-Trumbore intersection.
+	struct Triangle {
+		DirectX::XMFLOAT3 v0;
+		DirectX::XMFLOAT3 edge1; ///< v1 - v0
+		DirectX::XMFLOAT3 edge2; ///< v2 - v0
+		uint32_t primIdx;
+		uint32_t instanceIdx;
+	};
+
+	/// 32 bytes, two nodes per cache line. Children of a node are always stored next to each other.
+	struct BVHNode {
+		AABB bounds;
+		uint32_t leftFirst{}; ///< Left child index for inner nodes, first triangle index for leaves.
+		uint32_t triCount{}; ///< Number of triangles in a leaf. Zero for inner nodes.
+
+		bool IsLeaf() const {
+			return triCount > 0;
+		}
+	};
+
+	/// Levels of the deepest hierarchy the builders emit, the root being the first. Nodes on the last level become
+	/// leaves whatever their triangle count, so the traversal stacks can be fixed-size arrays of this many entries.
+	constexpr uint32_t MaxBVHDepth{ 64 };
+
+	/// Settings for the binned SAH builder.
+	struct BVHBuildSettings {
+		uint32_t maxLeafSize{ 4 }; ///< Leaves are forced to split above this triangle count.
+		uint32_t binCount{ 16 }; ///< SAH candidate planes per axis.
+		float traversalCost{ 1.f }; ///< Relative cost of visiting an inner node.
+		float intersectionCost{ 1.f }; ///< Relative cost of a ray-triangle test.
+
+		/// SBVH: also consider spatial splits, which clip triangles at the split plane and
+		/// reference them from both children.
+		bool spatialSplits{ false };
+		/// Spatial splits are only tried where the children of the best object split overlap by
+		/// more than this fraction of the scene's surface area.
+		float spatialSplitAlpha{ 1e-5f };
+		/// Pre-pass that splits triangles whose bounding box is much larger than the triangle itself,
+		/// like long diagonal slivers, into several tighter references before the build.
+		bool preSplit{ false };
+		/// A triangle is pre-split when its box half area exceeds this multiple of its own area.
+		float preSplitRatio{ 16.f };
+		/// Memory budget of both passes: at most triangleCount * referenceBudget leaf references.
+		float referenceBudget{ 1.5f };
+	};
+
+	/// Binary bounding volume hierarchy over all triangles of a scene, used by the CPU tracer.
+	class BVH {
+	public:
+		/// Builds the hierarchy over all meshes. Instance index of a triangle is its mesh index.
+		/// With spatial splits or pre-splitting, a triangle may be referenced from several leaves.
+		/// @param[in] meshes    The meshes to build the hierarchy for.
+		/// @param[in] settings  SAH builder settings.
+		void Build( const std::vector<Mesh>&, const BVHBuildSettings& = {} );
+
+		/// Finds the closest hit along the ray.
+		/// @param[in] ray  The ray to trace.
+		/// @param[out] hit  Updated only when a closer hit than hit.t is found.
+		/// @return  Whether a hit was found.
+		bool Intersect( const Ray&, Hit& ) const;
+
+		/// Finds any hit along the ray and stops there. Enough for shadow rays, which only ask
+		/// whether something is in the way.
+		/// @param[in] ray   The ray to trace.
+		/// @param[out] hit  Set to the first hit found, which is not necessarily the closest.
+		/// @return  Whether a hit was found.
+		bool IntersectAny( const Ray&, Hit& ) const;
+
+		/// Finds the closest hit for every lane of a packet, sharing node tests between lanes.
+		/// Falls back to single-ray traversal when the packet is or becomes incoherent.
+		/// @param[in,out] packet  The rays to trace. Hit records are updated in place.
+		/// @param[in,out] stats   Optional traversal statistics.
+		template <unsigned N>
+		void IntersectPacket( RayPacket<N>&, PacketStats* = nullptr ) const;
+
+		/// Hashes everything the built hierarchy depends on: vertex positions, indices and mesh
+		/// boundaries of all meshes, every builder setting and the cache format version.
+		/// @param[in] meshes    The meshes the hierarchy is built for.
+		/// @param[in] settings  SAH builder settings.
+		/// @return  Key identifying cache files of this scene and settings.
+		static uint64_t ComputeCacheKey( const std::vector<Mesh>&, const BVHBuildSettings& );
+
+		/// Writes nodes, leaf triangles and their scene indices to a cache file. All references
+		/// in the file are indices, so it can be mapped at any address. A temporary file is
+		/// renamed over the target, so readers never see a partial file.
+		/// @param[in] path  The cache file to write.
+		/// @param[in] key   Key from ComputeCacheKey for the meshes this hierarchy was built from.
+		/// @return  Whether the file was written.
+		bool SaveCache( const std::filesystem::path&, uint64_t ) const;
+
+		/// Maps a cache file written by SaveCache and traverses it in place, without copying or
+		/// fixing up anything. The hierarchy is left empty if the file is missing, stale or invalid:
+		/// node references outside the file, a tree deeper than MaxBVHDepth, or triangles that
+		/// are not triangles of the meshes.
+		/// @param[in] path    The cache file to map.
+		/// @param[in] key     Key from ComputeCacheKey for the current meshes and settings.
+		/// @param[in] meshes  The meshes the key was computed from. Hits index them.
+		/// @return  Whether the hierarchy was loaded.
+		bool LoadCache( const std::filesystem::path&, uint64_t, const std::vector<Mesh>& );
+
+		/// Whether the hierarchy is mapped from a cache file rather than built.
+		bool IsFromCache() const;
+
+		std::span<const BVHNode> GetNodes() const;
+
+		/// Leaf triangles in leaf order. Triangles split by the SBVH appear once per reference.
+		std::span<const Triangle> GetTriangles() const;
+
+		/// Bounds of the whole scene. Empty if nothing was built.
+		AABB GetBounds() const;
+
+		/// Memory used by nodes and triangles, in bytes.
+		size_t GetMemoryUsage() const;
+	private:
+		/// Single-ray traversal of the sub-tree starting at the given node.
+		/// AnyHit returns at the first hit instead of searching for the closest one.
+		template <bool AnyHit>
+		bool IntersectFromNode( uint32_t, const Ray&, Hit& ) const;
+
+		/// Recomputes the bounds of a node from the triangles it references.
+		void UpdateNodeBounds( uint32_t, const std::vector<AABB>& );
+
+		/// Splits the node with the binned SAH. Returns false if the node should stay a leaf.
+		/// Nodes on level MaxBVHDepth, counted from 1 at the root, always stay leaves.
+		bool Subdivide( uint32_t, uint32_t, const std::vector<AABB>&, const std::vector<DirectX::XMFLOAT3>&,
+			const BVHBuildSettings& );
+
+		/// SBVH build over triangle references. Each reference has its own, possibly clipped, box.
+		/// Leaves are emitted depth-first, so the references of every sub-tree stay contiguous.
+		/// @param[in] triangles         All scene triangles.
+		/// @param[in,out] boxes         Box of every reference. Split references are appended.
+		/// @param[in,out] centroids     Centroid of every reference.
+		/// @param[in,out] refTriangles  Triangle of every reference.
+		/// @param[in] settings          Builder settings.
+		void BuildSpatial( const std::vector<Triangle>&, std::vector<AABB>&, std::vector<DirectX::XMFLOAT3>&,
+			std::vector<uint32_t>&, const BVHBuildSettings& );
+
+		/// Drops the built data and the cache mapping.
+		void Clear();
+
+		// Built data. Empty when the hierarchy is loaded from a cache file.
+		std::vector<BVHNode> m_nodes;
+		std::vector<Triangle> m_triangles; ///< Stored in leaf order.
+		std::vector<uint32_t> m_triIndices; ///< Scene-wide triangle index for every leaf slot.
+
+		// Traversal reads through these views, which point either to the vectors above or into m_cacheFile.
+		std::span<const BVHNode> m_nodeView;
+		std::span<const Triangle> m_triangleView;
+		std::span<const uint32_t> m_triIndexView;
+		std::unique_ptr<MappedFile> m_cacheFile;
+	};
+
+	/// Moller-Trumbore ray-triangle test. Both faces are reported, like an opaque DXR geometry.
+	/// @return  Whether the ray hits the triangle between tMin and the current hit.t.
+	inline bool IntersectTriangle( const Ray& ray, const Triangle& tri, Hit& hit ) {
+		const DirectX::XMFLOAT3& d{ ray.direction };
+		const DirectX::XMFLOAT3& e1{ tri.edge1 };
+		const DirectX::XMFLOAT3& e2{ tri.edge2 };
+
+		// pvec = d x e2
+		const float px{ d.y * e2.z - d.z * e2.y };
+		const float py{ d.z * e2.x - d.x * e2.z };
+		const float pz{ d.x * e2.y - d.y * e2.x };
+
+		const float det{ e1.x * px + e1.y * py + e1.z * pz };
+		if ( std::abs( det ) < 1e-12f )
+			return false;
+		const float invDet{ 1.f / det };
+
+		const float tx{ ray.origin.x - tri.v0.x };
+		const float ty{ ray.origin.y - tri.v0.y };
+		const float tz{ ray.origin.z - tri.v0.z };
+
+		const float u{ (tx * px + ty * py + tz * pz) * invDet };
+		if ( u < 0.f || u > 1.f )
+			return false;
+
+		// qvec = tvec x e1
+		const float qx{ ty * e1.z - tz * e1.y };
+		const float qy{ tz * e1.x - tx * e1.z };
+		const float qz{ tx * e1.y - ty * e1.x };
+
+		const float v{ (d.x * qx + d.y * qy + d.z * qz) * invDet };
+		if ( v < 0.f || u + v > 1.f )
+			return false;
+
+		const float t{ (e2.x * qx + e2.y * qy + e2.z * qz) * invDet };
+		if ( t <= ray.tMin || t >= hit.t )
+			return false;
+
+		hit.t = t;
+		hit.u = u;
+		hit.v = v;
+		hit.primIdx = tri.primIdx;
+		hit.instanceIdx = tri.instanceIdx;
+		return true;
+	}
+}
+
+#endif // BVH_HPP
@@ -0,0 +1,182 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <cstdint> // uint32_t
+#include <string> // string
+#include <vector> // vector
+
+#include "BVH.hpp" // AABB
+#include "Camera.hpp" // CameraCB
+
+/// Headless CPU benchmarks, runnable from the command line without a window or a D3D12 device.
+namespace CPU::Bench {
+	/// Creates an RT camera that looks down -Z and frames the given bounds.
+	/// @param[in] bounds       The bounds to frame.
+	/// @param[in] aspectRatio  Render width / height.
+	RT::CameraCB FramingCamera( const AABB&, float );
+
+	/// Renders every scene with single-ray and 4/8/16-wide packet traversal and logs
+	/// the throughput of each mode, the speedup over single rays and mismatching pixels.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per mode. The best frame is reported.
+	void PacketTraversal( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Renders every scene with single rays through the binary BVH, the BVH4 and the BVH8,
+	/// and logs node count, memory and throughput of each layout.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per layout. The best frame is reported.
+	void WideTraversal( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Renders every scene with the fp32 wide BVH and the quantized one, and logs the node
+	/// memory saved against the change in frame time.
+	/// @param[in] scenePaths          crtscene files to benchmark.
+	/// @param[in] syntheticTriangles  Size of an extra generated terrain scene. 0 skips it.
+	/// @param[in] iterations          Timed frames per layout. The best frame is reported.
+	void QuantizedTraversal( const std::vector<std::string>&, uint32_t syntheticTriangles = 0, unsigned iterations = 5 );
+
+	/// Builds every scene with plain SAH, triangle pre-splitting, spatial splits (SBVH) and both,
+	/// and logs references, build time and the traversal speedup over plain SAH.
+	/// @param[in] scenePaths          crtscene files to benchmark.
+	/// @param[in] syntheticTriangles  Size of an extra generated scene of long, thin triangles. 0 skips it.
+	/// @param[in] iterations          Timed frames per builder. The best frame is reported.
+	void SpatialSplits( const std::vector<std::string>&, uint32_t syntheticTriangles = 0, unsigned iterations = 5 );
+
+	/// Renders every scene with scanline, Hilbert and spiral bucket order, with the scene's bucket
+	/// size, fixed sizes and the auto-tuned one, and logs throughput, steals and load imbalance.
+	/// Also checks that a cropped frame matches the full frame inside the crop region.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best frame is reported.
+	void BucketScheduling( const std::vector<std::string>&, unsigned iterations = 3 );
+
+	/// Renders primary hits of every scene at 3840x2160 into the row-major and the tiled frame buffer with 8 and 32
+	/// pixel buckets and doubling thread counts. Logs the frame times, the speedup over one thread, the time spent
+	/// linearizing the tiled frame and the pixels that differ.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best frame is reported.
+	void FrameBufferLayout( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Measures the time from loaded meshes to the first finished frame, once with an empty BVH
+	/// cache and then with the BVH mapped from the cache file written by the first run.
+	/// @param[in] scenePaths          crtscene files to benchmark.
+	/// @param[in] syntheticTriangles  Size of an extra generated terrain scene. 0 skips it.
+	/// @param[in] iterations          Warm runs, each with a new tracer. The best run is reported.
+	void BVHCache( const std::vector<std::string>&, uint32_t syntheticTriangles = 0, unsigned iterations = 3 );
+
+	/// Renders every scene's materials with the recursive megakernel integrator and with the wavefront
+	/// integrator, unsorted and sorted, with single rays, packets and the wide BVH. Logs rays per second,
+	/// the speedup over the megakernel, the wavefront stage times and pixels differing from the megakernel.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best frame is reported.
+	void Integrators( const std::vector<std::string>&, unsigned iterations = 3 );
+
+	/// Path traces every scene with several bounce budgets, with and without Russian roulette, and logs
+	/// frame time, rays per path and the frame's mean intensity, which roulette should leave unchanged.
+	/// @param[in] scenePaths       crtscene files to benchmark.
+	/// @param[in] samplesPerPixel  Paths per pixel and frame.
+	/// @param[in] iterations       Timed frames per configuration. The best frame is reported.
+	void PathTracing( const std::vector<std::string>&, unsigned samplesPerPixel = 4, unsigned iterations = 2 );
+
+	/// Traces shadow rays from random surface points to the lights of every scene through the binary and
+	/// the wide BVH, searching the closest hit and stopping at any hit, and logs their cost against closest-hit
+	/// rays in the same directions. Then path traces the scene with and without the occluder cache.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed passes per configuration. The best pass is reported.
+	void ShadowRays( const std::vector<std::string>&, unsigned iterations = 3 );
+
+	/// Lights every scene with 16 to 1024 generated point lights and renders direct light with all lights,
+	/// and with lights sampled uniformly and through the light tree. Logs frame time, shadow rays per pixel
+	/// and the error of the sampled frames against the frame lit by all lights.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best frame is reported.
+	void ManyLights( const std::vector<std::string>&, unsigned iterations = 1 );
+
+	/// Path traces every scene with 1 to 32 samples per pixel from each sampler and logs the error against
+	/// a reference frame, and its reduction against white noise.
+	/// @param[in] scenePaths        crtscene files to benchmark.
+	/// @param[in] referenceSamples  Paths per pixel of the reference frame.
+	void Samplers( const std::vector<std::string>&, unsigned referenceSamples = 512 );
+
+	/// Path traces every scene with uniform samples per pixel and with adaptive sampling at several error
+	/// thresholds, and logs frame time, average samples per pixel and the error against a reference frame.
+	/// Then logs the samples spent on every tile.
+	/// @param[in] scenePaths        crtscene files to benchmark.
+	/// @param[in] referenceSamples  Paths per pixel of the reference frame.
+	void AdaptiveSampling( const std::vector<std::string>&, unsigned referenceSamples = 512 );
+
+	/// Path traces every scene with 1, 2 and 4 samples per pixel and logs the error against a reference frame
+	/// with and without the denoiser. Then times the filter at the scene's resolution, scalar, with SSE and with AVX.
+	/// @param[in] scenePaths        crtscene files to benchmark.
+	/// @param[in] referenceSamples  Paths per pixel of the reference frame.
+	/// @param[in] iterations        Timed filter runs per configuration. The best run is reported.
+	void Denoising( const std::vector<std::string>&, unsigned referenceSamples = 512, unsigned iterations = 3 );
+
+	/// Renders every scene with the primary integrator, then changes only its colors. Logs the frame time of a
+	/// full retrace against re-shading the visibility buffer, and the pixels where both differ.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best frame is reported.
+	void Reshading( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Rasterizes every scene on the CPU, framed like the raster mode camera, with several tile sizes and SIMD widths.
+	/// Logs frame time, stage times, triangles and pixels per second, then the frame with backface culling off
+	/// and the frame with the edge and vertex overlays.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best frame is reported.
+	void SoftwareRasterizer( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Renders every scene with the CPU rasterizer shading each fragment, and through its visibility buffer.
+	/// Logs both frame times, the fragments and pixels shaded and the pixels that differ. Then times shade mode,
+	/// color, light and background edits rendered again against only shading the visibility buffer again.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best one is reported.
+	void RasterVisibilityBuffer( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Renders every scene with the CPU rasterizer's visibility buffer, then hybrid: shadow rays of the directional
+	/// light and reflection rays traced against the CPU tracer's BVH from it. Logs frame and pass times and rays,
+	/// and the CPU tracer's frame tracing the primary rays the hybrid frames rasterize.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per configuration. The best one is reported.
+	void HybridRendering( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Resolves the CPU rasterizer's visibility buffer of every scene with random colors, the mesh color and disco,
+	/// lit and unlit, through the shading kernel specialized for the frame and through the generic one.
+	/// Logs the resolve times, the time per pixel shaded and the pixels that differ.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed frames per kernel. The best one is reported.
+	void ShadingKernels( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Extracts the unique edges of every scene's meshes with one thread and with all threads.
+	/// Logs the edge counts against three edges per triangle, the build times and whether both results match.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed builds per thread count. The best one is reported.
+	void EdgeExtraction( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Culls triangle clusters of every scene against orbiting views, with 1, 4 and 8 boxes tested at once.
+	/// Logs the cull time per frame, boxes per second, the visible share and whether all widths keep the same boxes.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed runs over all views per width. The best one is reported.
+	void FrustumCulling( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Occlusion culls every scene's meshes after frustum culling, then a synthetic wall hiding a grid of cubes, with
+	/// 4 and 8 pixels rasterized at once. Logs the occluders, the meshes occluded and the culling times, then the CPU
+	/// rasterizer's frame time with and without the occluded meshes and the pixels where both frames differ.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed runs per configuration. The best one is reported.
+	void OcclusionCulling( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Builds the clusters of every scene and of a synthetic terrain, then culls them from orbiting close-up views.
+	/// Logs the clusters outside the frustum and back facing, the index ranges and triangles left, the cull time and
+	/// the front facing triangles inside the frustum that were dropped, which has to be none.
+	/// @param[in] scenePaths  crtscene files to benchmark.
+	/// @param[in] iterations  Timed culls per view. The best one is reported.
+	void ClusterCulling( const std::vector<std::string>&, unsigned iterations = 5 );
+
+	/// Runs the benchmark requested on the command line, if any.
+	/// Usage: --bench-packets | --bench-wide | --bench-buckets | --bench-framebuffer | --bench-wavefront | --bench-path | --bench-shadows | --bench-lights | --bench-samplers | --bench-adaptive | --bench-denoise | --bench-reshade | --bench-raster | --bench-raster-vbuffer | --bench-hybrid | --bench-shading | --bench-edges | --bench-culling | --bench-occlusion | --bench-clusters <scene.crtscene>...
+	///        --bench-quantized | --bench-sbvh | --bench-bvh-cache [--synthetic <triangles>] [<scene.crtscene>...]
+	/// @param[in] argc  Argument count, as passed to main.
+	/// @param[in] argv  Argument values, as passed to main.
+	/// @return  Whether a benchmark was run.
+	bool RunFromCommandLine( int, char*[] );
+}
+
+#endif // BENCHMARK_HPP
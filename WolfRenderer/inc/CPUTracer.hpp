@@ -0,0 +1,514 @@
+#ifndef CPU_TRACER_HPP
+#define CPU_TRACER_HPP
+
+#include <algorithm> // min, max
+#include <cfloat> // FLT_MAX
+#include <cstdint> // uint32_t, uint64_t
+#include <iostream> // cout
+#include <memory> // unique_ptr
+#include <span> // span
+#include <string> // string
+#include <vector> // vector
+#include <windows.h> // BOOL
+
+#include "BVH.hpp" // BVH, Ray, Hit
+#include "Camera.hpp" // CameraCB
+#include "Denoiser.hpp" // Denoiser, MissDepth
+#include "Geometry.hpp" // Mesh, Material, Light
+#include "LightTree.hpp" // LightTree
+#include "Logger.hpp" // Logger
+#include "QuantizedBVH.hpp" // QuantizedBVH
+#include "RayPacket.hpp" // RayPacket, PacketStats
+#include "Sampler.hpp" // Sampler, SamplerType
+#include "ThreadPool.hpp" // ThreadPool
+#include "TiledFrameBuffer.hpp" // TiledFrameBuffer
+#include "WideBVH.hpp" // WideBVH
+
+namespace CPU {
+	/// How primary rays are traversed through the BVH.
+	enum class TraversalMode {
+		SingleRay,
+		Packet4, ///< 2x2 pixel packets.
+		Packet8, ///< 4x2 pixel packets.
+		Packet16, ///< 4x4 pixel packets.
+		WideBVH, ///< Single rays through the BVH4/BVH8, SIMD tests all children of a node at once.
+		QuantizedBVH ///< Same as WideBVH with 8-bit quantized child bounds. Falls back to WideBVH if a leaf cannot be quantized.
+	};
+
+	/// Human readable name of a traversal mode, used for logging.
+	const char* ToString( TraversalMode );
+
+	/// Order in which the buckets of a frame are handed out to the render threads.
+	enum class BucketOrder {
+		Scanline, ///< Row by row.
+		Hilbert, ///< Along a Hilbert curve, so consecutive buckets are always neighbours.
+		Spiral ///< Outwards from the center of the region, so the center is done first.
+	};
+
+	/// Human readable name of a bucket order, used for logging.
+	const char* ToString( BucketOrder );
+
+	/// How the color of a pixel is computed.
+	enum class Integrator {
+		Primary, ///< Primary hits only, colored like the DXR shaders.
+		Megakernel, ///< Scene materials with reflected and refracted rays. Every pixel traces its whole ray tree recursively.
+		Wavefront, ///< Same as Megakernel, traced bounce by bounce as sorted streams of rays.
+		PathTracer ///< Scene materials sampled stochastically, one path per sample with Russian roulette.
+	};
+
+	/// Human readable name of an integrator, used for logging.
+	const char* ToString( Integrator );
+
+	/// How the lights lighting a shading point are chosen.
+	enum class LightSampling {
+		All, ///< Every light, one shadow ray each.
+		Uniform, ///< Tracer::lightSamples lights picked with equal probability.
+		Tree ///< Tracer::lightSamples lights picked through the light tree by their estimated contribution.
+	};
+
+	/// Human readable name of a light sampling mode, used for logging.
+	const char* ToString( LightSampling );
+
+	/// Rectangle of pixels. Zero width or height means the whole frame.
+	struct RenderRegion {
+		unsigned x{};
+		unsigned y{};
+		unsigned width{};
+		unsigned height{};
+	};
+
+	/// Per-frame inputs. Same data the DXR pipeline receives through its root constants and camera CB.
+	struct FrameParams {
+		RT::CameraCB camera{};
+		uint32_t bgColorPacked{ 0xFF2D2D2D }; ///< 0xAABBGGRR, same as RT::Data.
+		BOOL randomColors{ true };
+		/// Index of the frame's first sample, same as the rayGen root constant. Seeds the path tracer's
+		/// random numbers, so frames rendered with increasing indices can be averaged.
+		uint32_t sampleIndex{};
+	};
+
+	/// Statistics of the last rendered frame.
+	struct FrameStats {
+		double renderMs{}; ///< Wall time spent rendering, in milliseconds.
+		bool reshaded{}; ///< Shaded from the visibility buffer of an earlier frame, without tracing rays.
+		uint64_t rays{}; ///< Number of traced rays, without shadow rays.
+		uint64_t shadowRays{};
+		uint64_t occludedShadowRays{};
+		uint64_t occluderCacheHits{}; ///< Occluded shadow rays blocked by the cached occluder, without traversing the BVH.
+		PacketStats packetStats{};
+		unsigned bucketSize{}; ///< Bucket side used for the frame.
+		uint32_t buckets{}; ///< Number of rendered buckets.
+		uint64_t steals{}; ///< Bucket ranges moved between threads by work stealing.
+		double loadImbalance{}; ///< Render time of the busiest thread over the average. 1 is perfectly balanced.
+		unsigned bounces{}; ///< Deepest bounce that still had rays to trace (wavefront only). 0 for primary rays only.
+		// Wavefront stage times, summed over all bounces and batches.
+		double sortMs{};
+		double traceMs{};
+		double shadeMs{}; ///< Material sort, shading and compaction.
+		uint64_t samples{}; ///< Paths traced by the path tracer.
+		double denoiseMs{}; ///< Part of renderMs spent in the denoiser.
+		double linearizeMs{}; ///< Part of renderMs spent copying the tiled frame buffer to the row-major one.
+		unsigned adaptivePasses{}; ///< Adaptive sampling passes after the base pass.
+		unsigned tileColumns{}; ///< Columns of tileSamples.
+		/// Samples per pixel of every adaptive sampling tile, row by row. Empty without adaptive sampling.
+		std::vector<uint32_t> tileSamples;
+	};
+
+	/// CPU ray tracer mirroring the DXR ray tracing shaders. Runs headless, without a D3D12 device.
+	class Tracer {
+	public:
+		TraversalMode traversalMode{ TraversalMode::Packet8 };
+		Integrator integrator{ Integrator::Primary };
+		/// Primary integrator: keep the closest hit of every pixel in a visibility buffer. Frames with the same
+		/// camera, frame size, crop and meshes only re-shade it, so color and background changes trace no rays.
+		bool visibilityBuffer{ true };
+		/// Materials indexed by Mesh::materialIdx, used by the material integrators.
+		/// Meshes without a matching material shade as white diffuse.
+		std::vector<Material> materials{};
+		/// Point lights of the material integrators. Diffuse surfaces are lit by them through shadow rays.
+		/// Without lights, the megakernel and wavefront integrators light diffuse surfaces from the viewer.
+		std::vector<Light> lights{};
+		LightSampling lightSampling{ LightSampling::Tree };
+		/// Lights sampled per shading point, stratified over the sampling distribution.
+		/// Scenes with no more lights than this light every point with all of them.
+		unsigned lightSamples{ 2 };
+		/// Test shadow rays against the triangle that last blocked the same light first, before the BVH.
+		bool occluderCache{ true };
+		/// Stop shadow rays at the first hit. Off searches for the closest hit, only useful to measure the difference.
+		bool anyHitShadows{ true };
+		/// Reflection and refraction bounces after the primary hit. Deeper rays contribute nothing.
+		unsigned maxBounces{ 8 };
+		/// Paths traced per pixel and frame by the path tracer, averaged into the pixel.
+		unsigned samplesPerPixel{ 1 };
+		/// Sequence of the pixel jitter, light picks and bounce directions of the path tracer.
+		SamplerType samplerType{ SamplerType::Sobol };
+		/// Selects independent sequences, e.g. for a reference frame.
+		uint32_t samplerSeed{};
+		/// Bounces after which Russian roulette may end a path, with a chance that falls with its throughput.
+		/// Surviving paths are weighted up to stay unbiased. maxBounces or more disables it.
+		unsigned russianRouletteDepth{ 3 };
+		/// Path tracer: after a base pass of samplesPerPixel (at least 2) samples, tiles whose error estimate is
+		/// above adaptiveErrorThreshold double their samples, until adaptiveMaxSamples or the time budget.
+		bool adaptiveSampling{ false };
+		/// Root mean square of the standard errors of the pixel luminances of a tile, in display units [0, 1].
+		float adaptiveErrorThreshold{ 0.005f };
+		unsigned adaptiveMaxSamples{ 256 };
+		/// Frame time after which no more tiles are refined, in milliseconds. 0 for no limit.
+		double adaptiveTimeBudgetMs{};
+		unsigned adaptiveTileSize{ 16 };
+		/// Filters path traced frames with denoiser, guided by the albedo, normal and depth of the primary hits.
+		bool denoise{ false };
+		Denoiser denoiser;
+		/// Pixels whose rays the wavefront integrator keeps in flight at once. Bounds its ray buffers.
+		uint32_t wavefrontBatchSize{ 1u << 18 };
+		/// Sort the rays of every bounce after the first by direction octant and origin cell.
+		bool wavefrontSorting{ true };
+		unsigned threadCount{}; ///< Worker threads. 0 uses all hardware threads.
+		/// Side of the square buckets a frame is split into, like crtscene's bucket_size.
+		/// 0 auto-tunes it: the first frames try several sizes and the fastest is kept.
+		unsigned bucketSize{};
+		BucketOrder bucketOrder{ BucketOrder::Hilbert };
+		/// Render into a TiledFrameBuffer, linearized into the row-major frame buffer at the end of the frame.
+		/// Off writes the row-major frame buffer directly.
+		bool tiledFrameBuffer{ true };
+		/// Only pixels inside the region are rendered. The rest of the frame keeps the background color.
+		RenderRegion crop{};
+		/// 4 (SSE) or 8 (AVX). 0 picks the width from the CPU's ISA. The next wide frame rebuilds the wide BVH when it changes.
+		unsigned wideBVHWidth{};
+		BVHBuildSettings bvhSettings{}; ///< Used by the next BuildAccelerationStructure() call.
+		/// Built BVHs are stored here, one file per scene and builder settings, and mapped
+		/// instead of rebuilt on the next run. Empty disables the cache.
+		std::string bvhCacheDirectory{};
+		Logger log{ std::cout };
+
+		/// Builds the binary BVH over all scene meshes, or maps it from the BVH cache.
+		/// The wide and quantized BVHs are built from it by the first frame that traverses them.
+		/// The material integrators read normals and materials from the meshes, so they have to
+		/// outlive the frames rendered with them.
+		/// @param[in] meshes  The meshes to render.
+		void BuildAccelerationStructure( const std::vector<Mesh>& );
+
+		/// Renders a frame into the internal frame buffer.
+		/// @param[in] params  Camera and shading parameters.
+		/// @param[in] width   Render resolution width.
+		/// @param[in] height  Render resolution height.
+		void RenderFrame( const FrameParams&, unsigned, unsigned );
+
+		/// Writes the frame buffer to a PPM file, same format as WolfRenderer::WriteImageToFile.
+		/// @param[in] fileName  Path to the output file.
+		void WriteImageToFile( const char* fileName = "output_cpu.ppm" );
+
+		/// Pixels of the last frame, packed as 0xAABBGGRR (R8G8B8A8 in memory).
+		const std::vector<uint32_t>& GetFrameBuffer() const;
+
+		const FrameStats& GetStats() const;
+
+		const BVH& GetBVH() const;
+
+		/// Empty until a frame has been rendered in a wide or quantized traversal mode.
+		const WideBVH& GetWideBVH() const;
+
+		/// Empty until a frame has been rendered in a wide or quantized traversal mode.
+		const QuantizedBVH& GetQuantizedBVH() const;
+
+		unsigned GetWidth() const;
+
+		unsigned GetHeight() const;
+	private:
+		/// Collapses the binary BVH into the wide BVH and quantizes that.
+		void BuildWideBVH();
+
+		/// Bucket side for a frame of the given region: bucketSize, or the auto-tuned size.
+		unsigned SelectBucketSize( const RenderRegion& );
+
+		/// Feeds the time of a frame rendered with an auto-tuning candidate back into the tuning.
+		void UpdateBucketTuning( unsigned, double );
+
+		/// Shadow ray state of one render thread. Neighbouring shadow rays are usually blocked by the same
+		/// triangle, so the last occluder of every light is kept and tested before traversing the BVH.
+		struct ShadowContext {
+			/// Two per light, for primary hits and for deeper ones, whose shadow rays are much less coherent.
+			/// primIdx is NoHit while nothing is cached.
+			std::vector<Triangle> occluders;
+			uint64_t rays{};
+			uint64_t occluded{};
+			uint64_t cacheHits{};
+
+			/// Empties the cache, sized for the given number of lights, and the counts.
+			void Reset( size_t lightCount ) {
+				Triangle empty{};
+				empty.primIdx = NoHit;
+				occluders.assign( lightCount * 2, empty );
+				rays = 0;
+				occluded = 0;
+				cacheHits = 0;
+			}
+		};
+
+		/// Renders one rectangle of pixels with the current integrator and traversal mode.
+		/// @param[in] x0, y0        Top-left pixel of the bucket.
+		/// @param[in] xEnd, yEnd    One past the bottom-right pixel of the bucket.
+		/// @param[out] stats        Packet statistics of the bucket.
+		/// @param[out] rays         Incremented by the number of traced rays.
+		/// @param[in,out] shadows   Occluder cache and shadow ray counts of the render thread.
+		void RenderBlock( unsigned, unsigned, unsigned, unsigned, PacketStats&, uint64_t&, ShadowContext& );
+
+		/// Traces the bucket with packets of N rays, laid out as packetW x (N / packetW) pixels.
+		template <unsigned N>
+		void RenderBlockPackets( unsigned, unsigned, unsigned, unsigned, PacketStats& );
+
+		/// Generates the primary ray of a pixel, same as the rayGen shader.
+		/// @param[in] pixelX, pixelY      The pixel.
+		/// @param[in] subpixelX, subpixelY  Position of the ray inside the pixel, in [0, 1).
+		Ray GeneratePrimaryRay( unsigned, unsigned, float = 0.5f, float = 0.5f ) const;
+
+		/// Returns the packed color of a hit or miss, same as the closestHit and miss shaders.
+		uint32_t Shade( uint32_t primIdx, uint32_t instanceIdx ) const;
+
+		/// Whether m_visibility holds the primary hits of the current frame's camera, size and region.
+		bool VisibilityMatches( const RenderRegion& ) const;
+
+		/// Shades the render region from m_visibility, without tracing rays.
+		void ReshadeRegion( const RenderRegion& );
+
+		/// The color of a pixel of the frame being rendered, in m_tiledFrame with tiledFrameBuffer on.
+		uint32_t& FramePixel( unsigned x, unsigned y ) {
+			return tiledFrameBuffer ? m_tiledFrame.At( x, y ) : m_frameBuffer[static_cast<size_t>(y) * m_width + x];
+		}
+
+		/// Copies the render region of m_tiledFrame to m_frameBuffer with tiledFrameBuffer on.
+		void LinearizeFrame( const RenderRegion& );
+
+		/// A ray of the material integrators, with the weight of its color in its pixel.
+		struct PathRay {
+			Ray ray;
+			DirectX::XMFLOAT3 throughput;
+			uint32_t pixel; ///< Index of the pixel in the render region.
+		};
+
+		/// Color a shaded ray adds to its pixel.
+		struct PixelColor {
+			DirectX::XMFLOAT3 color;
+			uint32_t pixel;
+		};
+
+		/// Outcome of shading one hit or miss with its material.
+		struct Scatter {
+			DirectX::XMFLOAT3 color{}; ///< Color added to the pixel, already weighted by the throughput.
+			uint32_t rayCount{};
+			PathRay rays[2]; ///< Reflected and refracted rays. Their pixel is left to the caller.
+		};
+
+		/// Material and shading frame of a hit.
+		struct SurfaceHit {
+			const Material* material;
+			DirectX::XMFLOAT3 position;
+			DirectX::XMFLOAT3 geometricNormal; ///< Faces the side the ray came from.
+			DirectX::XMFLOAT3 normal; ///< Interpolated if the material is smooth shaded. Faces the same side.
+			bool entering; ///< Whether the ray hit the front face.
+		};
+
+		/// Traversal mode single rays actually use: WideBVH in place of QuantizedBVH when the quantized nodes failed to build.
+		TraversalMode RayTraversalMode() const;
+
+		/// Closest hit through the BVH layout of the traversal mode. Packet modes use the binary BVH.
+		void IntersectClosest( const Ray&, Hit& ) const;
+
+		/// Looks up the material and shading frame of a valid hit.
+		SurfaceHit GetSurface( const Ray&, const Hit& ) const;
+
+		/// Shadow ray test. Stops at the first hit unless anyHitShadows is off.
+		/// @param[in] ray           Ray towards the light, ending at it.
+		/// @param[in,out] occluder  Cached occluder of the light. Tested first and replaced by a new occluder.
+		/// @param[in,out] shadows   Shadow ray counts.
+		bool Occluded( const Ray&, Triangle&, ShadowContext& ) const;
+
+		/// Light arriving at a surface from one point light if it is not occluded, weighted by the cosine at the surface.
+		/// Multiplied by the albedo, it is the color of a diffuse surface (crtscene convention).
+		/// @param[in] surface      The lit surface.
+		/// @param[in] light        Index of the light.
+		/// @param[in] primary      Whether the surface was hit by a primary ray. Selects the occluder cache slot.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		float LightIrradiance( const SurfaceHit&, uint32_t, bool, ShadowContext& ) const;
+
+		/// Light arriving at a surface from all point lights, summed or estimated from lightSamples sampled ones.
+		/// @param[in] surface      The lit surface.
+		/// @param[in] primary      Whether the surface was hit by a primary ray. Selects the occluder cache slots.
+		/// @param[in] u            Uniform random number in [0, 1) for picking the lights.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		float DirectLight( const SurfaceHit&, bool, float, ShadowContext& ) const;
+
+		/// Shades a hit or miss with the material of the hit mesh and spawns its secondary rays.
+		/// Rays whose throughput is too small to change the 8-bit result are not spawned.
+		/// @param[in] path         The ray that was traced.
+		/// @param[in] hit          Its closest hit, invalid on miss.
+		/// @param[in] bounce       Bounces taken before the ray. Secondary rays are spawned below maxBounces.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		Scatter ShadeMaterial( const PathRay&, const Hit&, unsigned, ShadowContext& ) const;
+
+		/// Megakernel integrator: traces the ray tree of a path depth first.
+		/// @param[in] path         The ray to trace.
+		/// @param[in] bounce       Bounces already taken by the path.
+		/// @param[out] rays        Incremented by the number of traced rays.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		/// @return  Color of the whole tree, weighted by the throughput of the path.
+		DirectX::XMFLOAT3 TraceRadiance( const PathRay&, unsigned, uint64_t&, ShadowContext& ) const;
+
+		/// Denoiser inputs of a path's primary hit.
+		struct PrimaryAOVs {
+			DirectX::XMFLOAT3 albedo{}; ///< Background color for misses.
+			DirectX::XMFLOAT3 normal{}; ///< Zero for misses.
+			float depth{ MissDepth };
+		};
+
+		/// Samples of a pixel summed by the path tracer. The luminances are clamped to the displayed range.
+		struct PixelSamples {
+			DirectX::XMFLOAT3 color{};
+			float luminance{};
+			float luminanceSq{};
+			PrimaryAOVs aovs{ {}, {}, 0.f };
+			uint32_t count{};
+		};
+
+		/// Traces samples of a pixel's sequence and adds them to its sums.
+		/// @param[in] x, y         The pixel.
+		/// @param[in] first        Index of the first sample in the pixel's sequence.
+		/// @param[in] count        Number of samples.
+		/// @param[in,out] sums     Sums of the pixel's samples.
+		/// @param[out] rays        Incremented by the number of traced rays.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		void TracePixel( unsigned, unsigned, uint32_t, unsigned, PixelSamples&, uint64_t&, ShadowContext& ) const;
+
+		/// Path tracer: renders a bucket with samplesPerPixel jittered paths per pixel.
+		/// @param[in] x0, y0       Top-left pixel of the bucket.
+		/// @param[in] xEnd, yEnd   One past the bottom-right pixel of the bucket.
+		/// @param[out] rays        Incremented by the number of traced rays.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		void RenderBlockPaths( unsigned, unsigned, unsigned, unsigned, uint64_t&, ShadowContext& );
+
+		/// Traces one path. Diffuse surfaces add the direct light of the point lights, then scatter
+		/// cosine-weighted. Glass picks reflection or refraction by its Fresnel reflectance, so a path never branches.
+		/// @param[in] ray          The primary ray.
+		/// @param[in,out] sampler  Random numbers of the path's sample, past the pixel jitter.
+		/// @param[out] rays        Incremented by the number of traced rays.
+		/// @param[in,out] shadows  Occluder cache and shadow ray counts.
+		/// @param[out] aovs        Denoiser inputs of the primary hit.
+		/// @return  Color carried by the path.
+		DirectX::XMFLOAT3 TracePath( Ray, Sampler&, uint64_t&, ShadowContext&, PrimaryAOVs& ) const;
+
+		/// Hands the averaged samples of a pixel of the render region to the denoiser.
+		void SetDenoiserPixel( uint32_t, const PixelSamples& );
+
+		/// Denoises the render region and writes it to the frame buffer.
+		void ApplyDenoiser();
+
+		/// Path tracer with adaptive sampling: renders the region in tiles of adaptiveTileSize, refining
+		/// tiles in passes that double their samples. See adaptiveSampling.
+		void RenderAdaptive( const RenderRegion& );
+
+		/// Wavefront integrator: renders the region in batches of pixels. Every bounce sorts the rays,
+		/// traces them as a stream, shades them sorted by material and compacts the spawned rays.
+		void RenderWavefront( const RenderRegion& );
+
+		/// Sorts the rays of the bounce by direction octant, then by the Morton code of the origin's cell in the scene bounds.
+		void SortRays();
+
+		/// Traces the rays of the bounce into m_hits, in packets if the traversal mode uses them.
+		/// @param[out] stats  Packet statistics.
+		void TraceRays( PacketStats& );
+
+		/// Shades the rays of the bounce in material order, adds their colors to m_radiance
+		/// and compacts the spawned rays into the rays of the next bounce.
+		/// @param[in] bounce  Bounces taken before the rays.
+		void ShadeRays( unsigned );
+
+		BVH m_bvh;
+		WideBVH m_wideBVH;
+		QuantizedBVH m_quantizedBVH; ///< Shares the triangle blocks of m_wideBVH.
+		bool m_wideBVHBuilt{ false }; ///< Whether m_wideBVH and m_quantizedBVH match m_bvh.
+		unsigned m_wideBVHBuiltWidth{}; ///< wideBVHWidth m_wideBVH was built with. Another value rebuilds it.
+		bool m_quantizedBVHBuilt{ false }; ///< Whether m_quantizedBVH could compress m_wideBVH.
+		std::unique_ptr<ThreadPool> m_pool; ///< Recreated when threadCount changes.
+
+		/// Bucket size auto-tuning. Restarts when the region size, thread count or traversal mode changes.
+		struct BucketTuning {
+			unsigned regionWidth{};
+			unsigned regionHeight{};
+			unsigned threads{};
+			TraversalMode mode{};
+			Integrator integrator{};
+			unsigned step{}; ///< Candidate rendered next. Tuning is done when all were tried.
+			unsigned bestSize{};
+			double bestMs{ FLT_MAX };
+		};
+		BucketTuning m_tuning{};
+		FrameParams m_params{};
+		FrameStats m_stats{};
+		float m_tanHalfFOV{};
+		RenderRegion m_region{}; ///< Render region of the current frame, clamped to the frame.
+		unsigned m_width{};
+		unsigned m_height{};
+		std::vector<uint32_t> m_frameBuffer;
+		TiledFrameBuffer m_tiledFrame; ///< Pixels of the render region while a frame renders, with tiledFrameBuffer on.
+
+		/// Inputs the hits in m_visibility were traced with. Any other camera, size or region traces again.
+		struct VisibilityKey {
+			RT::CameraCB camera{};
+			unsigned width{};
+			unsigned height{};
+			RenderRegion region{};
+			bool valid{ false }; ///< Cleared when the meshes change.
+		};
+		VisibilityKey m_visibilityKey{};
+		/// Closest primary hit of every pixel of the frame: mesh (the instance and its only geometry), triangle,
+		/// barycentrics and distance. Pixels outside the key's region are stale.
+		std::vector<Hit> m_visibility;
+		LightTree m_lightTree;
+		std::vector<Light> m_lightTreeLights; ///< Lights m_lightTree was built from.
+
+		std::span<const Mesh> m_meshes; ///< Meshes of the last BuildAccelerationStructure() call.
+		// Wavefront buffers. They only grow, so they are not reallocated between bounces and frames.
+		uint32_t m_rayCount{}; ///< Rays of the current bounce, at the front of m_rays.
+		std::vector<PathRay> m_rays;
+		std::vector<PathRay> m_raysScratch; ///< Sort and compaction target, swapped with m_rays.
+		std::vector<Hit> m_hits;
+		std::vector<PixelColor> m_pixelColors; ///< In shading order.
+		std::vector<PathRay> m_spawnedRays; ///< Two slots per ray, in shading order.
+		std::vector<uint8_t> m_spawnCounts;
+		std::vector<uint32_t> m_sortKeys;
+		std::vector<uint32_t> m_order;
+		std::vector<uint32_t> m_orderScratch;
+		std::vector<uint32_t> m_chunkOffsets;
+		std::vector<DirectX::XMFLOAT3> m_radiance; ///< Color of every pixel of the render region.
+		std::vector<ShadowContext> m_wavefrontShadows; ///< One per worker thread, kept over all bounces of a frame.
+		std::vector<PixelSamples> m_pixelSamples; ///< Adaptive sampling sums of every pixel of the render region.
+	};
+
+	/// Hash used by the closest hit shader to color each primitive.
+	inline uint32_t HashUint( uint32_t value ) {
+		value ^= value >> 16;
+		value *= 0x7feb352d;
+		value ^= value >> 15;
+		value *= 0x846ca68b;
+		value ^= value >> 16;
+		return value;
+	}
+
+	/// Unpacks an 0xAABBGGRR color to [0, 1] RGB, same as UnpackColor() in the shaders.
+	inline DirectX::XMFLOAT3 UnpackColor( uint32_t packed ) {
+		return {
+			(packed & 0xFF) / 255.f,
+			((packed >> 8) & 0xFF) / 255.f,
+			((packed >> 16) & 0xFF) / 255.f };
+	}
+
+	/// Packs an RGB color to 0xAABBGGRR with opaque alpha, like a write to an R8G8B8A8_UNORM target.
+	inline uint32_t PackColor( const DirectX::XMFLOAT3& color ) {
+		const auto toByte = []( float value ) {
+			return static_cast<uint32_t>(std::min( std::max( value, 0.f ), 1.f ) * 255.f + 0.5f);
+		};
+		return 0xFF000000 | (toByte( color.z ) << 16) | (toByte( color.y ) << 8) | toByte( color.x );
+	}
+}
+
+#endif // CPU_TRACER_HPP
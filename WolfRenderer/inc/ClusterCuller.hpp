@@ -0,0 +1,64 @@
+#ifndef CLUSTER_CULLER_HPP
+#define CLUSTER_CULLER_HPP
+
+#include <cstdint> // uint8_t, uint32_t, uint64_t
+#include <span> // span
+#include <vector> // vector
+
+#include "Camera.hpp" // Transformation
+#include "FrustumCuller.hpp" // FrustumCuller
+#include "Geometry.hpp" // Mesh, MeshCluster
+
+namespace Raster {
+	/// Statistics of the last ClusterCuller::Cull() call.
+	struct ClusterStats {
+		uint32_t tested{}; ///< Clusters of the meshes culled.
+		uint32_t outside{}; ///< Clusters outside the frustum.
+		uint32_t backfacing{}; ///< Clusters whose triangles all face away from the camera.
+		uint32_t ranges{}; ///< Index ranges left, one draw each.
+		uint64_t triangles{}; ///< Triangles in the ranges.
+		double cullMs{};
+	};
+
+	/// A range of a mesh's index buffer, counted in indices.
+	struct IndexRange {
+		uint32_t first;
+		uint32_t count;
+	};
+
+	/// Culls the clusters of the meshes drawn in raster mode (Mesh::clusters). Cluster boxes are culled against the
+	/// frustum by a FrustumCuller over the clusters of all meshes. A cluster is back facing when the camera sees the
+	/// whole bounding sphere from behind every normal of its cone: the angle between the axis and the direction from
+	/// the camera to the sphere is smaller than 90 degrees minus the cone's angle, with the sphere's radius as margin.
+	/// Consecutive clusters left are merged into one index range.
+	class ClusterCuller {
+	public:
+		/// Computes the cluster bounds of the meshes. The meshes have to outlive the Cull() calls using them.
+		/// @param[in] meshes  The scene's meshes with their clusters built, in draw order.
+		void SetMeshes( const std::vector<Mesh>& );
+
+		/// Culls the clusters of some meshes and collects the index ranges left for every mesh.
+		/// @param[in] transform      World-view and reverse-Z projection of the frame, as sent to the GPU.
+		/// @param[in] meshes         Indices of the meshes to cull, ascending, e.g. the frustum culler's visible list.
+		///                           Meshes not in the list get no ranges.
+		/// @param[in] mask           Meshes of the list whose bit isn't set get no ranges either. Empty keeps them all.
+		/// @param[in] showBackfaces  Whether back faces are drawn, which turns the normal cone test off.
+		void Cull( const Transformation::TransformDataCB&, const std::vector<uint32_t>&, std::span<const uint64_t>, bool );
+
+		/// Index ranges of a mesh left by the last Cull() call, ascending.
+		/// @param[in] mesh  Index of the mesh.
+		std::span<const IndexRange> GetRanges( uint32_t ) const;
+
+		const ClusterStats& GetStats() const;
+	private:
+		std::span<const Mesh> m_meshes; ///< Meshes of the last SetMeshes() call.
+		FrustumCuller m_frustumCuller; ///< Holds the cluster boxes of all meshes, mesh after mesh.
+		std::vector<uint32_t> m_clusterOffsets; ///< First cluster of every mesh in m_frustumCuller, and the total.
+		std::vector<uint8_t> m_inFrustum; ///< Per cluster of all meshes, of the last Cull() call.
+		std::vector<IndexRange> m_ranges;
+		std::vector<uint32_t> m_rangeOffsets; ///< First range of every mesh in m_ranges, and the total.
+		ClusterStats m_stats{};
+	};
+}
+
+#endif // CLUSTER_CULLER_HPP
@@ -0,0 +1,70 @@
+#ifndef DENOISER_HPP
+#define DENOISER_HPP
+
+#include <array> // array
+#include <cstdint> // uint32_t
+#include <DirectXMath.h> // XMFLOAT3
+#include <vector> // vector
+
+#include "ThreadPool.hpp" // ThreadPool
+
+namespace CPU {
+	/// Depth of pixels whose primary ray hit nothing. Far enough that no surface is filtered with them.
+	constexpr float MissDepth{ 1e30f };
+
+	/// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010). Every iteration applies a 5x5 B3 spline
+	/// kernel whose taps are twice as far apart as in the previous one. Taps are weighted down by their
+	/// difference to the center pixel in color, albedo, normal and depth, so edges stay sharp.
+	class Denoiser {
+	public:
+		/// Filter iterations. Five reach 2 * (1 + 2 + 4 + 8 + 16) = 62 pixels from the center.
+		unsigned iterations{ 5 };
+		/// Color difference that weights a tap down to about 1/e in the first iteration. Halved every iteration,
+		/// since every iteration leaves less noise.
+		float colorSigma{ 1.f };
+		float albedoSigma{ 0.1f };
+		/// Normal difference, as the length of the difference vector.
+		float normalSigma{ 0.2f };
+		/// Depth difference relative to the center pixel's depth, per pixel of tap distance.
+		float depthSigma{ 0.02f };
+		/// 1 (scalar), 4 (SSE) or 8 (AVX) pixels of a row filtered at once. 0 picks the width from the CPU's ISA.
+		unsigned simdWidth{};
+
+		/// Sizes the inputs for a frame. Pixels not set afterwards are black background.
+		void Resize( unsigned, unsigned );
+
+		/// Sets the noisy color, clamped to [0, 1], and the auxiliary buffers of a pixel. May be called from several threads for different pixels.
+		/// @param[in] index   Pixel index, row by row.
+		/// @param[in] color   Noisy color.
+		/// @param[in] albedo  Albedo of the primary hit, averaged over the pixel's samples. Background color for misses.
+		/// @param[in] normal  Shading normal of the primary hit, averaged over the pixel's samples. Zero for misses.
+		/// @param[in] depth   Distance to the primary hit, averaged over the pixel's samples. MissDepth for misses.
+		void SetPixel( uint32_t, const DirectX::XMFLOAT3&, const DirectX::XMFLOAT3&, const DirectX::XMFLOAT3&, float );
+
+		/// Filters the color. Rows are spread over the pool's threads, every iteration waits for the previous one.
+		/// @param[in] pool  Threads to filter with.
+		/// @return  Filter time in milliseconds.
+		double Filter( ThreadPool& );
+
+		/// Filtered color of a pixel, after Filter().
+		DirectX::XMFLOAT3 GetPixel( uint32_t ) const;
+	private:
+		/// Filters one row of an iteration from m_color[source] into the other color planes.
+		/// @param[in] row        The row.
+		/// @param[in] iteration  Index of the iteration, selecting the tap distance.
+		/// @param[in] source     Color planes the iteration reads.
+		template <unsigned W>
+		void FilterRow( unsigned, unsigned, unsigned );
+
+		unsigned m_width{};
+		unsigned m_height{};
+		// One plane per channel, so W neighbouring pixels of a row are one SIMD load.
+		std::array<std::vector<float>, 3> m_color[2];
+		std::array<std::vector<float>, 3> m_albedo;
+		std::array<std::vector<float>, 3> m_normal;
+		std::vector<float> m_depth;
+		unsigned m_result{}; ///< Color planes holding the filtered color.
+	};
+}
+
+#endif // DENOISER_HPP
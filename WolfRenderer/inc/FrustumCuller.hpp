@@ -0,0 +1,66 @@
+#ifndef FRUSTUM_CULLER_HPP
+#define FRUSTUM_CULLER_HPP
+
+#include <cstdint> // uint32_t
+#include <vector> // vector
+
+#include "BVH.hpp" // AABB
+#include "Camera.hpp" // Transformation
+#include "Geometry.hpp" // Mesh
+
+namespace Raster {
+	/// Statistics of the last Cull() call.
+	struct CullingStats {
+		uint32_t tested{}; ///< Boxes tested, empty ones excluded.
+		uint32_t visible{};
+		uint32_t culled{};
+		double cullMs{};
+	};
+
+	/// Culls object space bounding boxes against the view frustum of raster mode.
+	/// Boxes are stored as SoA arrays of centers and half extents, so 8 (AVX) or 4 (SSE) boxes are tested
+	/// against a frustum plane at once. A box is culled when it lies entirely outside one of the six planes.
+	/// Boxes crossing several planes near a frustum corner can be kept although outside, never the other way round.
+	class FrustumCuller {
+	public:
+		/// 1 (scalar), 4 (SSE) or 8 (AVX) boxes tested at once. 0 picks the width from the CPU's ISA.
+		unsigned simdWidth{};
+
+		/// Computes the bounds of every mesh. Call whenever the meshes change.
+		/// @param[in] meshes  The scene's meshes, in draw order.
+		void SetMeshes( const std::vector<Mesh>& );
+
+		/// Sets the boxes to cull. Empty boxes are never visible.
+		/// @param[in] bounds  Object space boxes, in draw order.
+		void SetBounds( const std::vector<CPU::AABB>& );
+
+		/// Culls the boxes against the frustum of a transform.
+		/// @param[in] transform  World-view and reverse-Z projection of the frame, as sent to the GPU.
+		/// @return  Indices of the boxes at least partly inside the frustum, ascending.
+		const std::vector<uint32_t>& Cull( const Transformation::TransformDataCB& );
+
+		/// Result of the last Cull() call.
+		const std::vector<uint32_t>& GetVisible() const;
+
+		const CullingStats& GetStats() const;
+	private:
+		/// Tests all boxes against the planes, W at a time, and appends the visible ones to m_visible.
+		/// @param[in] planes  Object space planes (a, b, c, d), inside where a * x + b * y + c * z + d >= 0.
+		template <unsigned W>
+		void CullBoxes( const float ( & )[6][4] );
+
+		// Non-empty boxes, padded to a multiple of 8.
+		std::vector<float> m_centerX;
+		std::vector<float> m_centerY;
+		std::vector<float> m_centerZ;
+		std::vector<float> m_extentX;
+		std::vector<float> m_extentY;
+		std::vector<float> m_extentZ;
+		std::vector<uint32_t> m_indices; ///< Index of every stored box in the SetBounds() input.
+		uint32_t m_count{}; ///< Non-empty boxes.
+		std::vector<uint32_t> m_visible;
+		CullingStats m_stats{};
+	};
+}
+
+#endif // FRUSTUM_CULLER_HPP
@@ -5,6 +5,8 @@
 
 #include <DirectXMath.h>
 #include <iostream>
+#include <string>
+#include <vector>
 
 struct Vertex {
 	DirectX::XMFLOAT3 position;
@@ -14,12 +16,50 @@ struct Vertex {
 };
 
 
+/// Surface type of a crtscene material.
+enum class MaterialType {
+	Diffuse, ///< Lit surface colored by its albedo.
+	Reflective, ///< Perfect mirror tinted by its albedo.
+	Refractive, ///< Clear dielectric, splits into reflection and refraction by Fresnel.
+	Constant ///< Shows its albedo regardless of lighting.
+};
+
+struct Material {
+	MaterialType type{ MaterialType::Diffuse };
+	DirectX::XMFLOAT3 albedo{ 1.f, 1.f, 1.f };
+	float ior{ 1.f }; ///< Index of refraction of refractive materials.
+	bool smoothShading{ false }; ///< Interpolate vertex normals instead of using the face normal.
+};
+
+/// Point light of a crtscene.
+struct Light {
+	DirectX::XMFLOAT3 position{};
+	float intensity{}; ///< Emitted over the whole sphere, falls off with the squared distance.
+};
+
+/// A run of consecutive triangles of a mesh, with the bounds and normal cone used to cull it.
+struct MeshCluster {
+	uint32_t firstTriangle{};
+	uint32_t triangleCount{};
+	DirectX::XMFLOAT3 boundsMin{};
+	DirectX::XMFLOAT3 boundsMax{};
+	DirectX::XMFLOAT3 center{}; ///< Center of the bounding sphere, the box's center.
+	float radius{};
+	DirectX::XMFLOAT3 coneAxis{}; ///< Average direction of the triangles' normals, unit length.
+	/// Sine of the angle between the axis and the farthest normal. 1 when they spread 90 degrees or more.
+	float coneSin{ 1.f };
+};
+
 struct Mesh {
 	std::string name;
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices; ///< Triangle indices (triplets).
-	// Material material;
-	// uint32_t materialId{};
+	/// Every edge of the triangles once, as index pairs (line list): boundary edges, then creases, then the rest.
+	std::vector<uint32_t> edgeIndices;
+	uint32_t boundaryEdgeCount{}; ///< Edges of a single triangle.
+	uint32_t creaseEdgeCount{}; ///< Edges of triangles meeting at a sharp angle, or of more than two triangles.
+	std::vector<MeshCluster> clusters; ///< Consecutive runs of the triangles, in triangle order.
+	uint32_t materialIdx{}; ///< Index into the scene's materials.
 	// DirectX::XMFLOAT4x4 transform; ///< Row-major.
 
 	void BuildSmoothNormals( float epsilon = 1e-6f ) {
@@ -0,0 +1,61 @@
+#ifndef LIGHT_TREE_HPP
+#define LIGHT_TREE_HPP
+
+#include <cstdint> // uint32_t
+#include <DirectXMath.h> // XMFLOAT3
+#include <span> // span
+#include <vector> // vector
+
+#include "BVH.hpp" // AABB
+#include "Geometry.hpp" // Light
+
+namespace CPU {
+	/// Returned by LightTree::Sample when no light can reach the shading point.
+	constexpr uint32_t NoLight{ 0xFFFFFFFF };
+
+	/// 32 bytes, like BVHNode. Children of a node are always stored next to each other.
+	struct LightNode {
+		static constexpr uint32_t LeafFlag{ 0x80000000 };
+
+		AABB bounds; ///< Bounds of the light positions below the node.
+		float intensity{}; ///< Summed intensity of the lights below the node.
+		uint32_t index{}; ///< Left child index for inner nodes. Leaves have LeafFlag set and store a light index.
+
+		bool IsLeaf() const {
+			return (index & LeafFlag) != 0;
+		}
+
+		uint32_t GetLightIndex() const {
+			return index & ~LeafFlag;
+		}
+	};
+
+	/// Bounding volume hierarchy over point lights, used to pick lights by their estimated
+	/// contribution instead of sampling all of them. Point lights emit in all directions,
+	/// so unlike emitter cones of area lights, nodes only bound positions and intensity.
+	class LightTree {
+	public:
+		/// Builds the hierarchy, one light per leaf. Splits minimize the summed intensity times
+		/// the extent of both children, so bright lights end up in small nodes.
+		/// @param[in] lights  The lights to build the hierarchy for.
+		void Build( const std::vector<Light>& );
+
+		/// Picks a light for a shading point by walking down the tree. Each step picks a child with
+		/// a probability proportional to its importance: intensity over squared distance, times an
+		/// upper bound of the cosine at the surface. Lights behind the surface are never picked.
+		/// @param[in] position  The shading point.
+		/// @param[in] normal    Normalized surface normal at the shading point.
+		/// @param[in] u         Uniform random number in [0, 1), reused at every level.
+		/// @param[out] pdf      Probability of the picked light.
+		/// @return  Index into the lights passed to Build(), or NoLight.
+		uint32_t Sample( const DirectX::XMFLOAT3&, const DirectX::XMFLOAT3&, float, float& ) const;
+
+		bool IsEmpty() const;
+
+		std::span<const LightNode> GetNodes() const;
+	private:
+		std::vector<LightNode> m_nodes;
+	};
+}
+
+#endif // LIGHT_TREE_HPP
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef> // byte, size_t
+#include <filesystem> // path
+#include <span> // span
+#include <windows.h> // HANDLE
+
+namespace CPU {
+	/// Read-only memory mapping of a whole file. Pages are loaded by the OS on first access.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile( const MappedFile& ) = delete;
+		MappedFile& operator=( const MappedFile& ) = delete;
+
+		/// Maps the file, closing any previous mapping first.
+		/// @param[in] path  The file to map.
+		/// @return  Whether the file exists, is not empty and could be mapped.
+		bool Open( const std::filesystem::path& );
+
+		/// Unmaps the file. Spans returned by GetData() become invalid.
+		void Close();
+
+		/// The mapped bytes. Empty if no file is mapped.
+		std::span<const std::byte> GetData() const;
+	private:
+		HANDLE m_file{ INVALID_HANDLE_VALUE };
+		HANDLE m_mapping{ nullptr };
+		const std::byte* m_data{ nullptr };
+		size_t m_size{};
+	};
+}
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,22 @@
+#ifndef MESH_CLUSTERS_HPP
+#define MESH_CLUSTERS_HPP
+
+#include <cstdint> // uint32_t
+
+#include "Geometry.hpp" // Mesh, MeshCluster
+#include "ThreadPool.hpp" // ThreadPool
+
+namespace Raster {
+	/// Triangles per cluster. Small enough for tight normal cones, large enough to keep the draws per mesh low.
+	constexpr uint32_t ClusterTriangles{ 128 };
+
+	/// Builds Mesh::clusters, runs of consecutive triangles. Triangles keep their order, so SV_PrimitiveID and the
+	/// index buffer are unchanged and neighbouring visible clusters merge into one index range.
+	/// Degenerate triangles are left out of the normal cones, they are never drawn.
+	/// @param[in,out] mesh              Mesh with its vertices and triangle indices loaded.
+	/// @param[in] pool                  Threads to build with.
+	/// @param[in] trianglesPerCluster   Triangles of every cluster but the last.
+	void BuildClusters( Mesh&, CPU::ThreadPool&, uint32_t trianglesPerCluster = ClusterTriangles );
+}
+
+#endif // MESH_CLUSTERS_HPP
@@ -0,0 +1,38 @@
+#ifndef MESH_EDGES_HPP
+#define MESH_EDGES_HPP
+
+#include <cstdint> // uint32_t
+#include <DirectXMath.h> // XM_PI
+
+#include "Geometry.hpp" // Mesh
+#include "RenderParams.hpp" // EdgeMode
+#include "ThreadPool.hpp" // ThreadPool
+
+namespace Raster {
+	/// Angle between the normals of two triangles above which their shared edge is a crease, in radians.
+	constexpr float DefaultCreaseAngle{ DirectX::XM_PI / 6.f };
+
+	/// Edges of a mesh's edge list drawn in an EdgeMode, counted in edges (two indices each).
+	struct EdgeRange {
+		uint32_t first;
+		uint32_t count;
+	};
+
+	/// Builds Mesh::edgeIndices, every edge of the mesh's triangles once, and classifies the edges.
+	/// The three edges of every triangle are keyed by their sorted vertex pair and grouped by the lower vertex
+	/// into buckets. Buckets are sorted and walked in parallel, equal keys being the triangles of one edge.
+	/// The result doesn't depend on the thread count.
+	/// @param[in,out] mesh      Mesh with its vertices and triangle indices loaded.
+	/// @param[in] pool          Threads to build with.
+	/// @param[in] creaseAngle   Angle between triangle normals above which an edge is a crease, in radians.
+	void BuildEdges( Mesh&, CPU::ThreadPool&, float creaseAngle = DefaultCreaseAngle );
+
+	/// Selects the edges drawn in a mode.
+	/// @param[in] mode           The edge mode.
+	/// @param[in] edgeCount      Edges of the mesh, half the size of Mesh::edgeIndices.
+	/// @param[in] boundaryCount  Mesh::boundaryEdgeCount.
+	/// @param[in] creaseCount    Mesh::creaseEdgeCount.
+	EdgeRange SelectEdges( EdgeMode, uint32_t, uint32_t, uint32_t );
+}
+
+#endif // MESH_EDGES_HPP
@@ -0,0 +1,111 @@
+#ifndef OCCLUSION_CULLER_HPP
+#define OCCLUSION_CULLER_HPP
+
+#include <cstdint> // uint32_t, uint64_t
+#include <DirectXMath.h> // XMFLOAT4
+#include <span> // span
+#include <vector> // vector
+
+#include "BVH.hpp" // AABB
+#include "Camera.hpp" // Transformation
+#include "Geometry.hpp" // Mesh
+
+namespace Raster {
+	/// Statistics of the last OcclusionCuller::Cull() call.
+	struct OcclusionStats {
+		uint32_t occluders{};
+		uint64_t occluderTriangles{}; ///< Triangles of the occluders, before clipping and culling.
+		uint32_t tested{}; ///< Candidates tested against the depth pyramid.
+		uint32_t occluded{}; ///< Candidates hidden behind the occluders or off screen.
+		double rasterMs{}; ///< Occluder selection, transform and rasterization.
+		double testMs{}; ///< Pyramid build and box tests.
+	};
+
+	/// Whether a mesh's bit is set in a visibility mask, 64 meshes per word.
+	/// @param[in] mask   Visibility mask, as returned by OcclusionCuller::Cull().
+	/// @param[in] index  Index of the mesh.
+	inline bool IsVisible( std::span<const uint64_t> mask, uint32_t index ) {
+		return (mask[index >> 6] >> (index & 63) & 1) != 0;
+	}
+
+	/// Culls meshes hidden behind other meshes in raster mode, after frustum culling.
+	/// The candidates with the largest projected bounds are the occluders. Their triangles are rasterized with SIMD into
+	/// a low resolution reverse-Z depth buffer, which is reduced into a pyramid keeping the farthest depth of every
+	/// 2x2 texels. A candidate is occluded when the nearest corner of its box is farther than the pyramid texels its
+	/// projected box overlaps. Occluders only write pixels they fully cover, at the farthest depth they reach within
+	/// the pixel, so the result is conservative: nothing visible is ever culled.
+	class OcclusionCuller {
+	public:
+		bool enabled{ true }; ///< When off, Cull() marks every candidate visible.
+		unsigned width{ 256 }; ///< Depth buffer width. Its height follows the projection's aspect ratio.
+		unsigned maxOccluders{ 8 };
+		uint32_t occluderTriangleBudget{ 1u << 16 }; ///< Occluders with more triangles than left are skipped.
+		/// 4 (SSE) or 8 (AVX) pixels of a row rasterized at once. 0 picks the width from the CPU's ISA.
+		unsigned simdWidth{};
+
+		/// Computes the bounds of every mesh. The meshes have to outlive the Cull() calls using them.
+		/// @param[in] meshes  The scene's meshes, in draw order.
+		void SetMeshes( const std::vector<Mesh>& );
+
+		/// Rasterizes the occluders chosen among the candidates and tests every candidate against them.
+		/// @param[in] transform      World-view and reverse-Z projection of the frame, as sent to the GPU.
+		/// @param[in] candidates     Indices of the meshes to test, e.g. the frustum culler's visible list.
+		/// @param[in] showBackfaces  Whether back faces are drawn, and thus occlude.
+		/// @return  One bit per mesh, set for the candidates left visible.
+		const std::vector<uint64_t>& Cull( const Transformation::TransformDataCB&, const std::vector<uint32_t>&, bool );
+
+		/// Result of the last Cull() call.
+		const std::vector<uint64_t>& GetMask() const;
+
+		const OcclusionStats& GetStats() const;
+	private:
+		/// A box projected to the depth buffer.
+		struct ScreenBounds {
+			float minX;
+			float minY;
+			float maxX;
+			float maxY;
+			float nearest; ///< Largest reverse-Z depth of the corners.
+			bool crossesNear; ///< A corner is in front of the near plane, the box covers the camera.
+		};
+
+		/// Projects the corners of a box with m_clipMatrix.
+		ScreenBounds Project( const CPU::AABB& ) const;
+
+		/// Transforms, clips and rasterizes the triangles of a mesh.
+		/// @param[in] mesh  Index of the occluder.
+		template <unsigned W>
+		void RasterizeOccluder( uint32_t );
+
+		/// Rasterizes a triangle in front of the near plane, writing the farthest depth of every fully covered pixel.
+		/// @param[in] vertices  Clip space positions.
+		template <unsigned W>
+		void RasterizeTriangle( const DirectX::XMFLOAT4( & )[3] );
+
+		/// Reduces the depth buffer into m_pyramid.
+		void BuildPyramid();
+
+		/// Whether a projected box is hidden behind the occluders or off screen.
+		bool IsOccluded( const ScreenBounds& ) const;
+
+		std::span<const Mesh> m_meshes; ///< Meshes of the last SetMeshes() call.
+		std::vector<CPU::AABB> m_bounds; ///< Object space bounds of every mesh.
+		float m_clipMatrix[4][4]{}; ///< Projection times world-view, rows multiplying column vectors.
+		bool m_showBackfaces{};
+
+		unsigned m_width{};
+		unsigned m_height{};
+		unsigned m_stride{}; ///< Floats per row of m_depth, padded so the last SIMD store of a row stays inside.
+		std::vector<float> m_depth;
+		/// Level 0 is the depth buffer without padding, every next level is half the size, down to 1x1.
+		std::vector<std::vector<float>> m_pyramid;
+		std::vector<unsigned> m_levelWidths;
+		std::vector<unsigned> m_levelHeights;
+		std::vector<DirectX::XMFLOAT4> m_clipVertices; ///< Clip space positions of the current occluder.
+
+		std::vector<uint64_t> m_mask;
+		OcclusionStats m_stats{};
+	};
+}
+
+#endif // OCCLUSION_CULLER_HPP
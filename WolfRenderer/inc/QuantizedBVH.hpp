@@ -0,0 +1,75 @@
+#ifndef QUANTIZED_BVH_HPP
+#define QUANTIZED_BVH_HPP
+
+#include <cstdint> // uint8_t, int8_t, uint32_t
+#include <vector> // vector
+
+#include "BVH.hpp" // Ray, Hit, MaxBVHDepth
+#include "WideBVH.hpp" // WideBVH, TriangleBlock
+
+namespace CPU {
+	/// Compressed wide BVH node in the style of CWBVH. Child boxes are quantized to 8 bits per
+	/// plane, on a grid that starts at the node's minimum corner and has a power-of-two cell size
+	/// per axis. Lower planes are rounded down and upper planes up, so decoded boxes always
+	/// contain the exact ones. 80 bytes for W = 8, 64 for W = 4.
+	template <unsigned W>
+	struct alignas(16) QuantizedNode {
+		float originX;
+		float originY;
+		float originZ;
+		int8_t exponentX; ///< Grid cell size on X is 2^exponentX.
+		int8_t exponentY;
+		int8_t exponentZ;
+		uint8_t _pad0;
+		uint32_t childBase; ///< Index of the first inner child. Inner children are stored next to each other.
+		uint32_t blockBase; ///< Index of the first triangle block of the leaf children.
+		/// Per child: 0 for an empty slot, 0x80 | offset from childBase for an inner child,
+		/// (blockCount << 5) | offset from blockBase for a leaf with 1 to 3 blocks.
+		uint8_t meta[W];
+		uint8_t qloX[W];
+		uint8_t qloY[W];
+		uint8_t qloZ[W];
+		uint8_t qhiX[W];
+		uint8_t qhiY[W];
+		uint8_t qhiZ[W];
+	};
+
+	/// Wide BVH with quantized nodes. Reuses the triangle blocks of the WideBVH it was built from.
+	class QuantizedBVH {
+	public:
+		/// Compresses the nodes of a wide BVH, keeping its width.
+		/// The wide BVH owns the triangle blocks, so it must outlive this one, and Build()
+		/// must be called again whenever the wide BVH is rebuilt.
+		/// @param[in] wideBVH  The built wide BVH.
+		/// @return  False if a leaf has more triangle blocks than the node format can address.
+		bool Build( const WideBVH& );
+
+		/// Finds the closest hit along the ray.
+		/// @param[in] ray   The ray to trace.
+		/// @param[out] hit  Updated only when a closer hit than hit.t is found.
+		/// @return  Whether a hit was found.
+		bool Intersect( const Ray&, Hit& ) const;
+
+		/// Finds any hit along the ray and stops there, for shadow rays.
+		/// @param[in] ray   The ray to trace.
+		/// @param[out] hit  Set to the first hit found, which is not necessarily the closest.
+		/// @return  Whether a hit was found.
+		bool IntersectAny( const Ray&, Hit& ) const;
+
+		/// Width of the source wide BVH, 0 if nothing was built.
+		unsigned GetWidth() const;
+
+		size_t GetNodeCount() const;
+
+		/// Memory used by the quantized nodes, in bytes. Triangle blocks are not included.
+		size_t GetNodeMemoryUsage() const;
+	private:
+		std::vector<QuantizedNode<4>> m_nodes4;
+		std::vector<QuantizedNode<8>> m_nodes8;
+		const std::vector<TriangleBlock<4>>* m_blocks4{ nullptr };
+		const std::vector<TriangleBlock<8>>* m_blocks8{ nullptr };
+		unsigned m_width{};
+	};
+}
+
+#endif // QUANTIZED_BVH_HPP
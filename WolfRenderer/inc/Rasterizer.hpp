@@ -0,0 +1,392 @@
+#ifndef RASTERIZER_HPP
+#define RASTERIZER_HPP
+
+#include <array> // array
+#include <cstdint> // uint32_t, uint64_t
+#include <DirectXMath.h> // XMFLOAT3, XMFLOAT4
+#include <iostream> // cout
+#include <memory> // unique_ptr
+#include <span> // span
+#include <utility> // integer_sequence, make_integer_sequence
+#include <vector> // vector
+
+#include "BVH.hpp" // BVH, Ray, Hit
+#include "Geometry.hpp" // Mesh, Material
+#include "Logger.hpp" // Logger
+#include "MeshEdges.hpp" // EdgeRange
+#include "OcclusionCuller.hpp" // IsVisible
+#include "RenderParams.hpp" // Raster::Data
+#include "ThreadPool.hpp" // ThreadPool
+
+namespace CPU {
+	/// Statistics of the last rasterized frame.
+	struct RasterStats {
+		double renderMs{}; ///< Wall time spent rendering, in milliseconds.
+		bool reshaded{}; ///< Shaded from the visibility buffer of an earlier frame, without rasterizing.
+		// Stage times. Every stage waits for the previous one.
+		double vertexMs{};
+		double binMs{}; ///< Clipping, culling, triangle and line setup and binning.
+		double rasterMs{}; ///< Edge functions, depth test and shading or visibility ids of all tiles, then their overlays.
+		double resolveMs{}; ///< Shading of the visibility buffer.
+		uint64_t triangles{}; ///< Triangles of all meshes.
+		uint32_t maskedMeshes{}; ///< Meshes left out by the mesh mask.
+		uint64_t culledTriangles{}; ///< Back-facing, degenerate, outside the view or between pixel centers.
+		uint64_t setupTriangles{}; ///< Triangles binned after near plane clipping, which splits some in two.
+		uint64_t binnedReferences{}; ///< Triangles summed over the tiles whose bins they were added to.
+		uint64_t pixels{}; ///< Fragments that passed the depth test. Shaded right away without the visibility buffer.
+		uint64_t shadedPixels{}; ///< Pixels of triangles shaded from the visibility buffer, each once.
+		uint64_t shadowRays{}; ///< Hybrid rendering: shadow rays of the directional light.
+		uint64_t occludedShadowRays{};
+		uint64_t reflectionRays{}; ///< Hybrid rendering: reflection rays of all bounces.
+		uint64_t setupLines{}; ///< Wireframe edges left after clipping, each edge of the meshes once.
+		uint64_t setupPoints{}; ///< Vertex points in front of the camera.
+		uint64_t overlayPixels{}; ///< Edge and vertex point fragments that passed the depth test.
+		uint32_t tiles{};
+		double trianglesPerSecond{}; ///< triangles over renderMs.
+		double pixelsPerSecond{}; ///< pixels over renderMs.
+	};
+
+	/// CPU rasterizer mirroring the passes of raster mode: faces (ConstColorVS.hlsl and ConstColor.hlsl), then the
+	/// wireframe and vertex point overlays. Runs headless, without a D3D12 device. Triangles, edges and points are
+	/// binned to square screen tiles, then the tiles are rasterized in parallel with SIMD edge functions and a
+	/// reverse-Z depth test (GREATER, cleared to 0). Overlays are drawn into the tile after its faces.
+	/// With the visibility buffer, tiles only keep depth and the id of the triangle or overlay of every pixel, and
+	/// a second pass shades each pixel once, rebuilding the triangle's attributes from its shaded vertices.
+	class Rasterizer {
+	public:
+		unsigned threadCount{}; ///< Worker threads. 0 uses all hardware threads.
+		/// Rasterize ids into a visibility buffer, then shade it. Frames with the same transform, frame size, passes,
+		/// edge mode, vertex size, culling and mesh mask only shade it again, so shade mode, color, light, background
+		/// and overlay color changes rasterize nothing. Without it every fragment passing the depth test is shaded.
+		bool visibilityBuffer{ true };
+		/// Hybrid rendering, with a BVH set by SetRayTracing(): shade the visibility buffer with the directional
+		/// light occluded by shadow rays. Without it, surfaces facing the light are lit like in PSMain.
+		bool tracedShadows{ true };
+		/// Hybrid rendering: share of the reflected color mixed into surfaces without a reflective material.
+		/// Reflective materials mirror fully, tinted by their albedo. Other materials shade like PSMain.
+		float reflectivity{};
+		/// Hybrid rendering: reflection bounces traced after the rasterized surface. Deeper ones see the background.
+		unsigned reflectionBounces{ 1 };
+		/// Shade with the kernel compiled for the frame's random colors and shade mode, picked once per frame.
+		/// Off shades every pixel with the kernel branching on them like PSMain, only useful to measure the difference.
+		bool specializedShading{ true };
+		/// Side of the screen tiles in pixels, rounded up to a multiple of 8.
+		unsigned tileSize{ 64 };
+		/// 4 (SSE) or 8 (AVX) pixels of a row tested at once. 0 picks the width from the CPU's ISA.
+		unsigned simdWidth{};
+		Logger log{ std::cout };
+
+		/// Sets the meshes to draw, in draw order. They have to outlive the frames rendered with them.
+		/// @param[in] meshes  The scene's meshes.
+		void SetMeshes( const std::vector<Mesh>& );
+
+		/// Turns hybrid rendering on: primary visibility is rasterized into the visibility buffer, then its pixels
+		/// trace shadow and reflection rays against the BVH. Needs visibilityBuffer. Rays are traced in the meshes'
+		/// space, the rasterized surfaces are moved there by the inverse of the world-view matrix.
+		/// @param[in] bvh        BVH over the meshes of SetMeshes(), in the same order, e.g. Tracer::GetBVH().
+		///                       nullptr turns hybrid rendering off. It has to outlive the frames rendered with it.
+		/// @param[in] materials  Indexed by Mesh::materialIdx. Only reflective materials are told apart.
+		void SetRayTracing( const BVH*, std::span<const Material> = {} );
+
+		/// Limits the meshes drawn to the ones whose bit is set, e.g. by OcclusionCuller::Cull(). An empty mask draws all.
+		/// @param[in] mask  One bit per mesh, 64 meshes per word. It has to outlive the frames rendered with it.
+		void SetMeshMask( std::span<const uint64_t> );
+
+		/// Renders a frame into the internal frame and depth buffers.
+		/// @param[in] data      Transform, scene, light and background data, same as the GPU passes receive.
+		///                      showBackfaces disables backface culling. renderFaces, renderEdges and renderVerts
+		///                      select the passes, edgeColor, vertexColor and vertexSize style the overlays.
+		/// @param[in] frameIdx  Frame counter of the disco colors, same as the b1 root constant.
+		/// @param[in] width     Render resolution width.
+		/// @param[in] height    Render resolution height.
+		void RenderFrame( const Raster::Data&, uint32_t, unsigned, unsigned );
+
+		/// Visibility buffer of the last frame: the triangle of every pixel numbered over all meshes in draw order,
+		/// or one of the overlay and background ids above the triangles. Empty without the visibility buffer.
+		const std::vector<uint32_t>& GetVisibilityBuffer() const;
+
+		/// Pixels of the last frame, packed as 0xAABBGGRR (R8G8B8A8 in memory).
+		const std::vector<uint32_t>& GetFrameBuffer() const;
+
+		/// Reverse-Z depth of the last frame: 1 at the near plane, 0 at the far plane and where nothing was drawn.
+		const std::vector<float>& GetDepthBuffer() const;
+
+		const RasterStats& GetStats() const;
+
+		unsigned GetWidth() const;
+
+		unsigned GetHeight() const;
+	private:
+		/// Output of the vertex shader.
+		struct ShadedVertex {
+			DirectX::XMFLOAT4 position; ///< Clip space.
+			DirectX::XMFLOAT3 viewPosition;
+			DirectX::XMFLOAT3 normal; ///< View space, normalized.
+		};
+
+		/// A screen space triangle ready for rasterization. Edge i is opposite vertex i. Its function
+		/// A * (x - refX) + B * (y - refY) is positive inside the triangle and is the barycentric of vertex i
+		/// times twice the triangle's area. The reference point is the edge's first endpoint in (y, x) order, so the
+		/// two triangles sharing an edge compute exactly opposite values and no pixel is drawn twice or missed.
+		struct TriangleSetup {
+			float edgeA[3];
+			float edgeB[3];
+			float edgeRefX[3];
+			float edgeRefY[3];
+			bool topLeft[3]; ///< Pixel centers exactly on a top or left edge are inside.
+			float invArea; ///< Turns edge function values into barycentrics.
+			// Depth plane: depth = depth0 + depthA * (x - x0) + depthB * (y - y0), (x0, y0) being vertex 0.
+			float depthA;
+			float depthB;
+			float depth0;
+			float x0;
+			float y0;
+			// Per vertex attributes. Barycentrics are weighted by 1 / w for perspective-correct interpolation.
+			float invW[3];
+			DirectX::XMFLOAT3 viewPosition[3];
+			DirectX::XMFLOAT3 normal[3];
+			uint32_t primID; ///< SV_PrimitiveID: index of the triangle in its mesh.
+			uint32_t triangleId; ///< Index of the triangle over all meshes, its visibility buffer id.
+			int minX;
+			int minY;
+			int maxX; ///< Inclusive.
+			int maxY; ///< Inclusive.
+		};
+
+		/// A screen space wireframe edge, clipped to the near plane. Without anti-aliasing, one pixel is drawn per
+		/// column, or per row when steeper than 45 degrees: the one the line crosses at the pixel centers' coordinate.
+		/// The pixel centers drawn are the ones between the endpoints along that major axis, the last one excluded.
+		struct LineSetup {
+			int first; ///< First pixel along the major axis, clamped to the screen.
+			int last; ///< Last pixel along the major axis, inclusive, clamped to the screen.
+			// The endpoint with the lower major coordinate, and the change of minor and depth per pixel along major.
+			float major0;
+			float minor0;
+			float depth0;
+			float slope;
+			float depthSlope;
+			bool steep; ///< Y is the major axis.
+
+			/// Minor coordinate of the line at a pixel center along the major axis. Binning and drawing agree on it.
+			float MinorAt( int major ) const { return minor0 + slope * (major + 0.5f - major0); }
+		};
+
+		/// A vertex point, drawn as a circle of vertexSize pixels around the vertex like GeometryShader.hlsl.
+		struct PointSetup {
+			float x;
+			float y;
+			float depth;
+			int minX;
+			int minY;
+			int maxX; ///< Inclusive.
+			int maxY; ///< Inclusive.
+		};
+
+		/// Triangles of a chunk of consecutive input triangles, with the tiles they overlap.
+		/// Chunks are binned in parallel and rasterized in order, so overlapping triangles keep the draw order.
+		struct Bin {
+			std::vector<TriangleSetup> triangles;
+			std::vector<std::vector<uint32_t>> tiles; ///< Indices into triangles, per tile.
+			uint64_t culled{};
+			uint64_t references{};
+		};
+
+		/// Wireframe edges of a chunk of the meshes' edge lists, with the tiles they cross.
+		/// Edges all have the same color, so their order doesn't matter.
+		struct LineBin {
+			std::vector<LineSetup> lines;
+			std::vector<std::vector<uint32_t>> tiles; ///< Indices into lines, per tile.
+		};
+
+		/// Vertex points of a chunk of the vertex stage, with the tiles they overlap.
+		struct PointBin {
+			std::vector<PointSetup> points;
+			std::vector<std::vector<uint32_t>> tiles; ///< Indices into points, per tile.
+		};
+
+		/// Color or visibility ids, and depth of the tile a worker rasterizes, tileSize x tileSize.
+		struct alignas(64) TileTarget {
+			std::vector<uint32_t> color; ///< Colors, or visibility ids with the visibility buffer.
+			std::vector<float> depth;
+			uint64_t pixels{};
+			uint64_t overlayPixels{};
+			uint64_t shadedPixels{}; ///< Triangle pixels the worker shaded from the visibility buffer.
+			uint64_t shadowRays{};
+			uint64_t occludedShadowRays{};
+			uint64_t reflectionRays{};
+		};
+
+		/// Inputs the ids in m_visibility were rasterized with. Any other one rasterizes again.
+		struct VisibilityKey {
+			Raster::Transformation::TransformDataCB transform{};
+			unsigned width{};
+			unsigned height{};
+			bool showBackfaces{};
+			bool renderFaces{};
+			bool renderEdges{};
+			Raster::EdgeMode edgeMode{};
+			bool renderVerts{};
+			float vertexSize{};
+			std::vector<uint64_t> meshMask;
+			bool valid{ false }; ///< Cleared when the meshes change.
+		};
+
+		/// Runs the vertex shader on one vertex, same as VSMain.
+		ShadedVertex ShadeVertex( const Vertex& ) const;
+
+		/// Clips a triangle against the near plane, culls it and adds the remaining triangles to a bin.
+		/// @param[in] vertices    Vertex shader outputs of the triangle.
+		/// @param[in] primID      Index of the triangle in its mesh.
+		/// @param[in] triangleId  Index of the triangle over all meshes.
+		/// @param[in,out] bin     Bin of the triangle's chunk.
+		void SetupTriangle( const ShadedVertex( & )[3], uint32_t, uint32_t, Bin& ) const;
+
+		/// Sets up and bins one chunk of the edges drawn in the frame's edge mode.
+		/// @param[in] chunk  Index of the chunk, and of its line bin.
+		void BinEdges( uint32_t );
+
+		/// Clips a wireframe edge against the near plane and adds it to the tiles it crosses.
+		/// @param[in] a        Vertex shader output of the first endpoint.
+		/// @param[in] b        Vertex shader output of the second endpoint.
+		/// @param[in,out] bin  Bin of the edge's chunk.
+		void SetupLine( const ShadedVertex&, const ShadedVertex&, LineBin& ) const;
+
+		/// Adds a vertex point in front of the camera to the tiles its circle overlaps.
+		/// @param[in] vertex   Vertex shader output.
+		/// @param[in,out] bin  Bin of the vertex's chunk.
+		void SetupPoint( const ShadedVertex&, PointBin& ) const;
+
+		// Shading kernels. PSMain's flags are template parameters, so their branches are resolved at compile time.
+		// Disco and packedColor both give every pixel the same albedo, computed once per frame.
+		static constexpr unsigned RandomColorsKernel{ 1 }; ///< Albedo picked by primID.
+		static constexpr unsigned UnlitKernel{ 2 };
+		static constexpr unsigned GenericKernel{ 4 }; ///< Branches on the flags per pixel.
+		static constexpr unsigned KernelCount{ 5 };
+
+		/// A pass over a tile or a row, instantiated once per shading kernel.
+		using PassKernel = void (Rasterizer::*)( uint32_t, TileTarget& );
+
+		/// Lookup table of RasterizeTile() per shading kernel.
+		template <unsigned W, unsigned... Kernels>
+		static constexpr std::array<PassKernel, sizeof...(Kernels)> MakeTileKernels( std::integer_sequence<unsigned, Kernels...> ) {
+			return { &Rasterizer::RasterizeTile<W, Kernels>... };
+		}
+
+		/// Lookup table of ResolveRow() per shading kernel.
+		template <unsigned... Kernels>
+		static constexpr std::array<PassKernel, sizeof...(Kernels)> MakeRowKernels( std::integer_sequence<unsigned, Kernels...> ) {
+			return { &Rasterizer::ResolveRow<Kernels>... };
+		}
+
+		/// Shading kernel of the frame's flags.
+		unsigned SelectKernel() const;
+
+		/// Rasterizes and shades all triangles of one tile into a worker's tile target, draws the overlays on top,
+		/// then copies it to the frame.
+		template <unsigned W, unsigned Kernel>
+		void RasterizeTile( uint32_t, TileTarget& );
+
+		/// Draws the wireframe edges binned to a tile, depth tested against its faces.
+		/// @param[in] tile        Tile index.
+		/// @param[in,out] target  Tile target holding the tile's faces.
+		void DrawLines( uint32_t, TileTarget& ) const;
+
+		/// Draws the vertex points binned to a tile, depth tested against its faces and edges without writing depth.
+		/// @param[in] tile        Tile index.
+		/// @param[in,out] target  Tile target holding the tile's faces and edges.
+		void DrawPoints( uint32_t, TileTarget& ) const;
+
+		/// Sets the inputs of the shading, which don't need rasterizing again with the visibility buffer.
+		/// @param[in] data      Scene, light, background and overlay color data of the frame.
+		/// @param[in] frameIdx  Frame counter of the disco colors.
+		void SetShadingInputs( const Raster::Data&, uint32_t );
+
+		/// Whether m_visibility holds the ids of the current frame's inputs.
+		bool VisibilityMatches( const VisibilityKey& ) const;
+
+		/// Shades every pixel of m_visibility once into the frame buffer, row by row in parallel.
+		void ResolveVisibility();
+
+		/// Shades one row of m_visibility. Triangles are shaded like PSMain, with the perspective-correct
+		/// barycentrics of the pixel center in the triangle's clip space vertices.
+		/// @param[in] y           The row.
+		/// @param[in,out] target  Tile target of the worker, counting its pixels and rays.
+		template <unsigned Kernel>
+		void ResolveRow( uint32_t, TileTarget& );
+
+		/// Shades a point of a mesh with its shadow ray and, on reflective surfaces, its reflection ray. Reflected
+		/// surfaces are shaded like rasterized ones, their highlights as seen from the camera.
+		/// @param[in] mesh            Index of the mesh.
+		/// @param[in] primID          Index of the triangle in the mesh.
+		/// @param[in] objectPosition  Position in the meshes' space, where rays are traced.
+		/// @param[in] direction       Normalized direction of the camera or reflection ray that found the point.
+		/// @param[in] viewPosition    Same position in view space, where it is shaded.
+		/// @param[in] normal          Interpolated view space normal, not normalized.
+		/// @param[in] bounce          0 for rasterized surfaces, then one more per reflection.
+		/// @param[in,out] target      Tile target of the worker, counting its rays.
+		template <unsigned Kernel>
+		DirectX::XMFLOAT3 ShadeHybrid( uint32_t, uint32_t, const DirectX::XMFLOAT3&, const DirectX::XMFLOAT3&,
+			const DirectX::XMFLOAT3&, const DirectX::XMFLOAT3&, unsigned, TileTarget& ) const;
+
+		/// Returns the color of a fragment, same as PSMain.
+		/// @param[in] primID          SV_PrimitiveID of the triangle.
+		/// @param[in] viewPosition    Interpolated view space position.
+		/// @param[in] normal          Interpolated normal, not normalized.
+		/// @param[in] lightVisibility Scales the directional light, 0 where a shadow ray was blocked.
+		template <unsigned Kernel>
+		DirectX::XMFLOAT3 ShadeSurface( uint32_t, const DirectX::XMFLOAT3&, const DirectX::XMFLOAT3&, float = 1.f ) const;
+
+		std::span<const Mesh> m_meshes; ///< Meshes of the last SetMeshes() call.
+		std::span<const uint64_t> m_meshMask; ///< Mask of the last SetMeshMask() call.
+		const BVH* m_bvh{}; ///< BVH of the last SetRayTracing() call.
+		std::span<const Material> m_materials; ///< Materials of the last SetRayTracing() call.
+		std::vector<uint32_t> m_vertexOffsets; ///< First vertex of every mesh in m_vertices, and the total.
+		std::vector<uint32_t> m_triangleOffsets; ///< First triangle of every mesh, and the total.
+		std::vector<Raster::EdgeRange> m_edgeRanges; ///< Edges of every mesh drawn in the frame's edge mode.
+		std::vector<uint32_t> m_edgeOffsets; ///< First drawn edge of every mesh, and the total.
+		std::unique_ptr<ThreadPool> m_pool; ///< Recreated when threadCount changes.
+
+		// Inputs of the current frame.
+		Raster::Transformation::TransformDataCB m_transform{};
+		Raster::SceneDataCB m_sceneData{};
+		Raster::DirectionalLight::CB m_light{};
+		DirectX::XMFLOAT3 m_lightDirection{}; ///< From the surface to the light, view space, normalized.
+		DirectX::XMFLOAT3 m_lightColor{};
+		DirectX::XMFLOAT3 m_bgColor{};
+		DirectX::XMFLOAT3 m_uniformAlbedo{}; ///< Albedo of every pixel without random colors: disco or packedColor.
+		// Hybrid rendering: the view and the meshes' space, the light and the camera in the meshes' space.
+		DirectX::XMFLOAT4X4 m_worldView{}; ///< Row vector convention, untransposed.
+		DirectX::XMFLOAT4X4 m_viewToObject{}; ///< Inverse of m_worldView.
+		DirectX::XMFLOAT3 m_objectLightDirection{}; ///< From the surface to the light, normalized.
+		DirectX::XMFLOAT3 m_objectCamera{};
+		uint32_t m_frameIdx{};
+		bool m_writeVisibility{}; ///< The frame rasterizes ids into m_visibility and shades them afterwards.
+		bool m_showBackfaces{};
+		bool m_renderFaces{};
+		bool m_renderEdges{};
+		Raster::EdgeMode m_edgeMode{};
+		bool m_renderVerts{};
+		uint32_t m_edgeColor{};
+		uint32_t m_vertexColor{};
+		float m_vertexSize{};
+		uint32_t m_bgColorPacked{};
+
+		unsigned m_width{};
+		unsigned m_height{};
+		unsigned m_tileSize{};
+		unsigned m_tilesX{};
+		unsigned m_tilesY{};
+		std::vector<ShadedVertex> m_vertices; ///< Vertex shader outputs of all meshes.
+		std::vector<Bin> m_bins;
+		std::vector<LineBin> m_lineBins;
+		std::vector<PointBin> m_pointBins; ///< One per chunk of the vertex stage.
+		std::vector<TileTarget> m_tileTargets; ///< One per worker thread.
+		std::vector<uint32_t> m_frameBuffer;
+		std::vector<float> m_depthBuffer;
+		VisibilityKey m_visibilityKey{};
+		std::vector<uint32_t> m_visibility;
+		RasterStats m_stats{};
+	};
+}
+
+#endif // RASTERIZER_HPP
@@ -0,0 +1,68 @@
+#ifndef RAY_PACKET_HPP
+#define RAY_PACKET_HPP
+
+#include <cfloat> // FLT_MAX
+#include <cstdint> // uint32_t
+
+namespace CPU {
+	/// Marks a lane (or a single ray) that did not hit any triangle.
+	constexpr uint32_t NoHit{ 0xFFFFFFFF };
+
+	/// A bundle of N coherent rays stored SoA, so 4 lanes fit one SSE register.
+	/// Every lane carries its own closest-hit record, updated in place by traversal.
+	template <unsigned N>
+	struct alignas(64) RayPacket {
+		static_assert(N == 4 || N == 8 || N == 16, "Ray packets must be 4, 8 or 16 rays wide.");
+		static constexpr unsigned size{ N };
+
+		// Ray origins.
+		float ox[N];
+		float oy[N];
+		float oz[N];
+
+		// Ray directions (not required to be normalized).
+		float dx[N];
+		float dy[N];
+		float dz[N];
+
+		float tMax[N]; ///< Closest hit distance so far, initialize to the ray's TMax.
+
+		// Hit record. Barycentrics are relative to vertex 1 and 2 of the triangle.
+		float u[N];
+		float v[N];
+		uint32_t primIdx[N]; ///< Triangle index in its mesh, NoHit on miss.
+		uint32_t instanceIdx[N]; ///< Index of the mesh the hit triangle belongs to.
+
+		// Kept after the arrays so every array stays 16-byte aligned for SSE loads.
+		float tMin{ 0.001f }; ///< Shared by all lanes, same as the TMin used in rayGen.
+
+		/// Resets the hit record of every lane.
+		/// @param[in] rayTMax  The maximum distance a ray is allowed to travel.
+		void ResetHits( float rayTMax = 100000.f ) {
+			for ( unsigned i{}; i < N; ++i ) {
+				tMax[i] = rayTMax;
+				u[i] = 0.f;
+				v[i] = 0.f;
+				primIdx[i] = NoHit;
+				instanceIdx[i] = NoHit;
+			}
+		}
+	};
+
+	/// Statistics about how packets were traversed. Accumulated by the caller.
+	struct PacketStats {
+		uint64_t packets{};         ///< Packets passed to the packet traversal.
+		uint64_t incoherent{};      ///< Packets traced ray by ray from the start.
+		uint64_t frustumCulled{};   ///< Nodes rejected by the packet frustum test.
+		uint64_t laneFallbacks{};   ///< Sub-trees finished with single-ray traversal.
+
+		void operator+=( const PacketStats& other ) {
+			packets += other.packets;
+			incoherent += other.incoherent;
+			frustumCulled += other.frustumCulled;
+			laneFallbacks += other.laneFallbacks;
+		}
+	};
+}
+
+#endif // RAY_PACKET_HPP
@@ -24,6 +24,11 @@ namespace RT {
 
 		BOOL randomColors{ true }; ///< Whether to color each triangle in a random color.
 		uint32_t bgColorPacked{ 0xFF2D2D2D }; ///< Scene background color.
+		/// Accumulate jittered samples while the camera and scene data stay the same,
+		/// converging to an anti-aliased image instead of re-rendering identical frames.
+		bool progressive{ false };
+		/// Dispatching stops once this many samples are accumulated. The last result is presented.
+		uint32_t maxAccumulatedSamples{ 4096 };
 
 		void SetMatchRTCameraToRaster( bool match ) {
 			m_matchRTCamToRaster = 1 - (2 * match);
@@ -51,14 +56,24 @@ namespace RT {
 }
 
 namespace Raster {
+	/// Edges drawn by the edge pass. Mesh::edgeIndices is ordered so each mode is one range of it.
+	enum class EdgeMode {
+		All,
+		Feature, ///< Boundaries and creases.
+		Boundary, ///< Edges of a single triangle, outlining open surfaces.
+		Crease ///< Edges of triangles meeting at a sharp angle.
+	};
+
 	struct Data {
 		Transformation camera{}; ///< Camera/object transformation data.
 		ScreenConstantsCB screenData{};
 		SceneDataCB sceneData{}; ///< Scene data for Raster mode.
 		bool renderFaces{ true }; ///< Whether to render faces.
 		bool renderEdges{ false }; ///< Whether to render edges.
+		EdgeMode edgeMode{ EdgeMode::All }; ///< Which edges to render.
 		bool renderVerts{ false }; ///< Whether to render vertices.
 		bool showBackfaces{ false }; ///< Whether to render backfaces.
+		bool occlusionCulling{ true }; ///< Whether to skip meshes hidden behind the largest ones.
 		float vertexSize{ 2.5f }; ///< Size in pixels of the displayed vertices.
 		uint32_t edgeColor{}; ///< Default color for rendered edges.
 		uint32_t vertexColor{ 0xFFFF7224 }; ///< Default color for rendered vertices.
@@ -73,6 +88,10 @@ namespace Raster {
 		D3D12_INDEX_BUFFER_VIEW ibView{};
 		UINT indexCount{};
 		UINT vertexCount{};
+		// The mesh's edge list follows the triangle indices in the index buffer.
+		UINT edgeCount{};
+		UINT boundaryEdgeCount{};
+		UINT creaseEdgeCount{};
 	};
 }
 
@@ -14,6 +14,9 @@
 // #pragma comment(lib, "dxgi.lib d3d12.lib dxcompiler.lib") is also valid
 
 #include "Camera.hpp"
+#include "ClusterCuller.hpp"
+#include "FrustumCuller.hpp"
+#include "OcclusionCuller.hpp"
 #include "Logger.hpp"
 #include "RenderParams.hpp"
 #include "Scene.hpp"
@@ -111,6 +114,12 @@ namespace Core {
 		/// @param[in] scenePath  Path to the new scene file.
 		/// @param[in] winId      Handle to the application window.
 		void ReloadScene( std::string& scenePath, HWND winId );
+
+		/// Frustum culling statistics of the last rasterized frame.
+		const Raster::CullingStats& GetCullingStats() const;
+
+		/// Occlusion culling statistics of the last rasterized frame.
+		const Raster::OcclusionStats& GetOcclusionStats() const;
 	private: // Functions
 
 		//! Ray Tracing specific functions.
@@ -127,6 +136,10 @@ namespace Core {
 		/// Finalizes the frame rendering for ray tracing.
 		void FrameEndRayTracing();
 
+		/// Restarts progressive accumulation if the camera or scene data changed since the last frame.
+		/// @return  Whether a new sample has to be traced. False once the image has converged.
+		bool UpdateAccumulation();
+
 		/// Creates a global root signature for the ray tracing pipeline.
 		void CreateGlobalRootSignature();
 
@@ -397,6 +410,17 @@ namespace Core {
 		/// Handle to the output texture for ray tracing.
 		ComPtr<ID3D12Resource> m_raytracingOutput{ nullptr };
 
+		/// fp32 sum of the progressive samples since the last reset (u1).
+		ComPtr<ID3D12Resource> m_accumulationBuffer{ nullptr };
+
+		/// Number of samples in m_accumulationBuffer. 0 restarts the accumulation.
+		uint32_t m_accumulatedSamples{};
+
+		// Inputs of the accumulated samples. Any change restarts the accumulation.
+		RT::CameraCB m_accumulatedCamera{};
+		uint32_t m_accumulatedBgColor{};
+		BOOL m_accumulatedRandomColors{};
+
 		/// Handle to the descriptor heap of the output texture.
 		ComPtr<ID3D12DescriptorHeap> m_uavsrvHeap{ nullptr };
 
@@ -448,6 +472,9 @@ namespace Core {
 		UINT8* m_lightingDataCBMappedPtr = nullptr;
 
 		std::vector<Raster::GPUMesh> m_gpuMeshesRaster;
+		Raster::FrustumCuller m_frustumCuller; ///< Culls m_gpuMeshesRaster, which are in mesh order.
+		Raster::OcclusionCuller m_occlusionCuller; ///< Culls the meshes left by m_frustumCuller.
+		Raster::ClusterCuller m_clusterCuller; ///< Culls the clusters of the meshes left by m_occlusionCuller.
 		std::vector<RT::GPUMesh> m_gpuMeshesRT;
 		std::vector<RT::BLAS> m_BLASes;
 
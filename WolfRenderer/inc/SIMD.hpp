@@ -0,0 +1,117 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <bit> // bit_cast
+#include <cmath> // abs
+#include <cstdint> // uint8_t, uint32_t
+#include <cstring> // memcpy
+#include <immintrin.h> // SSE, AVX intrinsics
+
+namespace CPU {
+	/// Thin wrappers so the traversal is written once for SSE (4 lanes) and AVX (8 lanes).
+	/// Simd<1> runs the same code on one float, for remainders and kernels without a SIMD path.
+	template <unsigned W>
+	struct Simd;
+
+	template <>
+	struct Simd<1> {
+		using Reg = float;
+		static Reg Load( const float* ptr ) { return *ptr; }
+		static void Store( float* ptr, Reg a ) { *ptr = a; }
+		static Reg LoadU( const float* ptr ) { return *ptr; }
+		static void StoreU( float* ptr, Reg a ) { *ptr = a; }
+		static Reg Set1( float value ) { return value; }
+		static Reg Add( Reg a, Reg b ) { return a + b; }
+		static Reg Sub( Reg a, Reg b ) { return a - b; }
+		static Reg Mul( Reg a, Reg b ) { return a * b; }
+		static Reg Div( Reg a, Reg b ) { return a / b; }
+		/// Same operand order as _mm_min_ps and _mm_max_ps, which return b when either is NaN.
+		static Reg Min( Reg a, Reg b ) { return a < b ? a : b; }
+		static Reg Max( Reg a, Reg b ) { return a > b ? a : b; }
+		static Reg And( Reg a, Reg b ) { return std::bit_cast<float>( std::bit_cast<uint32_t>( a ) & std::bit_cast<uint32_t>( b ) ); }
+		static Reg Select( Reg a, Reg b, Reg mask ) { return std::bit_cast<uint32_t>( mask ) != 0 ? b : a; }
+		static Reg Abs( Reg a ) { return std::abs( a ); }
+		/// Comparisons return all ones or all zeros, like the SIMD ones, so And, Select and Mask work the same.
+		static Reg Le( Reg a, Reg b ) { return FromBool( a <= b ); }
+		static Reg Lt( Reg a, Reg b ) { return FromBool( a < b ); }
+		static Reg Ge( Reg a, Reg b ) { return FromBool( a >= b ); }
+		static Reg Gt( Reg a, Reg b ) { return FromBool( a > b ); }
+		static int Mask( Reg a ) { return static_cast<int>(std::bit_cast<uint32_t>( a ) >> 31); }
+		static Reg LoadBytes( const uint8_t* ptr ) { return static_cast<float>(*ptr); }
+	private:
+		static Reg FromBool( bool value ) { return std::bit_cast<float>( value ? ~0u : 0u ); }
+	};
+
+	template <>
+	struct Simd<4> {
+		using Reg = __m128;
+		static Reg Load( const float* ptr ) { return _mm_load_ps( ptr ); }
+		static void Store( float* ptr, Reg a ) { _mm_store_ps( ptr, a ); }
+		static Reg LoadU( const float* ptr ) { return _mm_loadu_ps( ptr ); }
+		static void StoreU( float* ptr, Reg a ) { _mm_storeu_ps( ptr, a ); }
+		static Reg Set1( float value ) { return _mm_set1_ps( value ); }
+		static Reg Add( Reg a, Reg b ) { return _mm_add_ps( a, b ); }
+		static Reg Sub( Reg a, Reg b ) { return _mm_sub_ps( a, b ); }
+		static Reg Mul( Reg a, Reg b ) { return _mm_mul_ps( a, b ); }
+		static Reg Div( Reg a, Reg b ) { return _mm_div_ps( a, b ); }
+		static Reg Min( Reg a, Reg b ) { return _mm_min_ps( a, b ); }
+		static Reg Max( Reg a, Reg b ) { return _mm_max_ps( a, b ); }
+		static Reg And( Reg a, Reg b ) { return _mm_and_ps( a, b ); }
+		/// Lanes of b where mask is set, of a elsewhere. Every lane of mask must be all ones or all zeros, like a
+		/// comparison result. SSE2 only, so the 4-lane kernels run on every x64 CPU.
+		static Reg Select( Reg a, Reg b, Reg mask ) { return _mm_or_ps( _mm_and_ps( mask, b ), _mm_andnot_ps( mask, a ) ); }
+		static Reg Abs( Reg a ) { return _mm_andnot_ps( _mm_set1_ps( -0.f ), a ); }
+		static Reg Le( Reg a, Reg b ) { return _mm_cmple_ps( a, b ); }
+		static Reg Lt( Reg a, Reg b ) { return _mm_cmplt_ps( a, b ); }
+		static Reg Ge( Reg a, Reg b ) { return _mm_cmpge_ps( a, b ); }
+		static Reg Gt( Reg a, Reg b ) { return _mm_cmpgt_ps( a, b ); }
+		static int Mask( Reg a ) { return _mm_movemask_ps( a ); }
+		/// Loads 4 bytes and widens them to floats, interleaving them with zero bytes (SSE2).
+		static Reg LoadBytes( const uint8_t* ptr ) {
+			int packed;
+			std::memcpy( &packed, ptr, sizeof( packed ) );
+			const __m128i zero{ _mm_setzero_si128() };
+			const __m128i words{ _mm_unpacklo_epi8( _mm_cvtsi32_si128( packed ), zero ) };
+			return _mm_cvtepi32_ps( _mm_unpacklo_epi16( words, zero ) );
+		}
+	};
+
+	template <>
+	struct Simd<8> {
+		using Reg = __m256;
+		static Reg Load( const float* ptr ) { return _mm256_load_ps( ptr ); }
+		static void Store( float* ptr, Reg a ) { _mm256_store_ps( ptr, a ); }
+		static Reg LoadU( const float* ptr ) { return _mm256_loadu_ps( ptr ); }
+		static void StoreU( float* ptr, Reg a ) { _mm256_storeu_ps( ptr, a ); }
+		static Reg Set1( float value ) { return _mm256_set1_ps( value ); }
+		static Reg Add( Reg a, Reg b ) { return _mm256_add_ps( a, b ); }
+		static Reg Sub( Reg a, Reg b ) { return _mm256_sub_ps( a, b ); }
+		static Reg Mul( Reg a, Reg b ) { return _mm256_mul_ps( a, b ); }
+		static Reg Div( Reg a, Reg b ) { return _mm256_div_ps( a, b ); }
+		static Reg Min( Reg a, Reg b ) { return _mm256_min_ps( a, b ); }
+		static Reg Max( Reg a, Reg b ) { return _mm256_max_ps( a, b ); }
+		static Reg And( Reg a, Reg b ) { return _mm256_and_ps( a, b ); }
+		static Reg Select( Reg a, Reg b, Reg mask ) { return _mm256_blendv_ps( a, b, mask ); }
+		static Reg Abs( Reg a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.f ), a ); }
+		static Reg Le( Reg a, Reg b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ); }
+		static Reg Lt( Reg a, Reg b ) { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+		static Reg Ge( Reg a, Reg b ) { return _mm256_cmp_ps( a, b, _CMP_GE_OQ ); }
+		static Reg Gt( Reg a, Reg b ) { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+		static int Mask( Reg a ) { return _mm256_movemask_ps( a ); }
+		/// Loads 8 bytes and widens them to floats. Widened per half, so AVX2 is not required.
+		static Reg LoadBytes( const uint8_t* ptr ) {
+			return _mm256_insertf128_ps( _mm256_castps128_ps256( Simd<4>::LoadBytes( ptr ) ),
+				Simd<4>::LoadBytes( ptr + 4 ), 1 );
+		}
+	};
+
+	/// Reciprocal that never produces inf/NaN in the slab tests.
+	inline float SafeRcp( float value ) {
+		constexpr float eps{ 1e-20f };
+		if ( std::abs( value ) < eps )
+			value = value < 0.f ? -eps : eps;
+		return 1.f / value;
+	}
+}
+
+#endif // SIMD_HPP
@@ -0,0 +1,72 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <array> // array
+#include <cstdint> // uint32_t
+#include <DirectXMath.h> // XMFLOAT2
+#include <span> // span
+
+namespace CPU {
+	/// Sequence the random numbers of a sample are drawn from.
+	enum class SamplerType {
+		White, ///< Independent random numbers from Philox4x32-10.
+		Sobol, ///< Owen-scrambled Sobol points, scrambled separately for every pixel.
+		BlueNoise ///< Owen-scrambled Sobol points shared by all pixels, shifted per pixel by a blue noise tile.
+	};
+
+	/// Human readable name of a sampler, used for logging.
+	const char* ToString( SamplerType );
+
+	/// Side of the blue noise tile in pixels. The tile repeats over the frame.
+	constexpr uint32_t BlueNoiseSize{ 64 };
+
+	/// Philox4x32-10 counter-based random numbers (Salmon et al. 2011). The output only depends on
+	/// the counter and the key, so a sample gets the same numbers on any thread and in any order.
+	/// @param[in] counter  Four words identifying the numbers, e.g. pixel, sample and dimension.
+	/// @param[in] key      Two words selecting an independent stream.
+	/// @return  Four uniformly distributed words.
+	std::array<uint32_t, 4> Philox( std::array<uint32_t, 4>, std::array<uint32_t, 2> );
+
+	/// Nested uniform (Owen) scrambling of the bits of a value in [0, 1) fixed point,
+	/// with the hash of Burley 2020, "Practical Hash-based Owen Scrambling".
+	/// @param[in] value  32-bit fixed point value.
+	/// @param[in] seed   Selects the scramble.
+	uint32_t OwenScramble( uint32_t, uint32_t );
+
+	/// Blue noise tile of BlueNoiseSize x BlueNoiseSize values, each of (i + 0.5) / size^2 once.
+	/// Generated with void-and-cluster (Ulichney 1993) on first use, then shared by all samplers.
+	std::span<const float> GetBlueNoiseTile();
+
+	/// Random numbers of one sample of one pixel. Every call to Get1D() or Get2D() uses the next dimension
+	/// of the sequence. Constructing the sampler again for the same pixel and sample repeats the numbers.
+	class Sampler {
+	public:
+		/// @param[in] type         Sequence to draw from.
+		/// @param[in] x, y         The pixel.
+		/// @param[in] sampleIndex  Index of the sample in the pixel's sequence, over all frames.
+		/// @param[in] seed         Selects an independent set of sequences.
+		Sampler( SamplerType, uint32_t, uint32_t, uint32_t, uint32_t = 0 );
+
+		/// Uniform number in [0, 1).
+		float Get1D();
+
+		/// Uniform point in [0, 1)^2, stratified over the samples of the pixel for the Sobol samplers.
+		DirectX::XMFLOAT2 Get2D();
+
+		/// Continues at the given dimension, so decisions use the same dimension in every sample of a pixel.
+		void SetDimension( uint32_t );
+	private:
+		/// Fixed point values of the two coordinates of the current dimension.
+		std::array<uint32_t, 2> Next();
+
+		SamplerType m_type;
+		uint32_t m_x;
+		uint32_t m_y;
+		uint32_t m_sampleIndex;
+		uint32_t m_seed;
+		uint32_t m_pixelSeed;
+		uint32_t m_dimension{};
+	};
+}
+
+#endif // SAMPLER_HPP
@@ -3,14 +3,16 @@
 
 #include <DirectXMath.h>
 #include <iostream> // cout
+#include <memory> // unique_ptr
 #include <string> // string
 #include <vector> // vector
 
 #include "rapidjson/document.h" // Document, Value, Value::ConstArray
 
-#include "Geometry.hpp" // Vertex
+#include "Geometry.hpp" // Vertex, Mesh, Material, Light
 #include "Logger.hpp" // Logger, LogLevel
 #include "Settings.hpp" // Settings
+#include "ThreadPool.hpp" // ThreadPool
 
 using rapidjson::Value;
 
@@ -31,6 +33,14 @@ public:
 	/// @return  A collection of meshes, ready to iterate.
 	const std::vector<Mesh>& GetMeshes() const;
 
+	/// Gets all materials of the scene. Mesh::materialIdx indexes into them.
+	/// @return  The parsed materials, or a single default diffuse one if the scene has none.
+	const std::vector<Material>& GetMaterials() const;
+
+	/// Gets all point lights of the scene.
+	/// @return  The parsed lights. Empty if the scene has none.
+	const std::vector<Light>& GetLights() const;
+
 	/// Set the name of the scene file to be processed and rendered.
 	/// @param[in] filePath  The path to the scene file.
 	void SetRenderScene( const std::string& );
@@ -43,6 +53,10 @@ public:
 private:
 	std::string m_filePath{ "../rsc/scene1.crtscene" };
 	std::vector<Mesh> m_meshes;
+	std::vector<Material> m_materials;
+	std::vector<Light> m_lights;
+	/// Builds mesh edges and clusters. Created by the first parse and kept across reloads.
+	std::unique_ptr<CPU::ThreadPool> m_pool;
 
 // crtscene file parsing (json)
 private:
@@ -54,6 +68,15 @@ private:
 	/// @param[in] doc  A rapidjson document object with the parsed json file.
 	void ParseObjectsTag( const rapidjson::Document& );
 
+	/// Internal function for parsing the materials tag of a crtscene file.
+	/// Albedos referencing the textures tag are resolved to a flat color.
+	/// @param[in] doc  A rapidjson document object with the parsed json file.
+	void ParseMaterialsTag( const rapidjson::Document& );
+
+	/// Internal function for parsing the lights tag of a crtscene file.
+	/// @param[in] doc  A rapidjson document object with the parsed json file.
+	void ParseLightsTag( const rapidjson::Document& );
+
 	/// Loads all vertices and triangle indices of a given mesh.
 	/// @param[in] vertArr  The vertex array to traverse.
 	/// @param[in] indArr  The triangle index array to traverse.
@@ -6,6 +6,7 @@
 struct Settings {
 	unsigned renderWidth{};
 	unsigned renderHeight{};
+	unsigned bucketSize{}; ///< Side of the square render buckets in pixels. 0 if the scene doesn't specify it.
 };
 
 #endif // SETTINGS_HPP
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic> // atomic
+#include <condition_variable> // condition_variable
+#include <cstdint> // uint32_t, uint64_t
+#include <functional> // function
+#include <memory> // unique_ptr
+#include <mutex> // mutex
+#include <thread> // thread
+#include <vector> // vector
+
+namespace CPU {
+	/// Persistent worker threads with work-stealing scheduling of index ranges.
+	class ThreadPool {
+	public:
+		/// @param[in] threadCount  Workers, including the thread calling ParallelFor. 0 uses all hardware threads.
+		explicit ThreadPool( unsigned = 0 );
+		~ThreadPool();
+
+		ThreadPool( const ThreadPool& ) = delete;
+		ThreadPool& operator=( const ThreadPool& ) = delete;
+
+		/// Calls task( index, worker ) for every index in [0, count) and returns when all calls are done.
+		/// Each worker starts on its own contiguous share of the indices and works through it in order,
+		/// so neighbouring indices stay on one thread. A worker that runs out of work steals the back
+		/// half of the largest remaining share.
+		/// @param[in] count  Number of indices.
+		/// @param[in] task   Called once per index. worker is in [0, GetThreadCount()).
+		/// @return  Number of steals.
+		uint64_t ParallelFor( uint32_t, const std::function<void( uint32_t, unsigned )>& );
+
+		unsigned GetThreadCount() const;
+	private:
+		/// Range [begin, end) packed as begin | end << 32, so owner and thieves update it with one CAS.
+		struct alignas(64) Share {
+			std::atomic<uint64_t> range{};
+		};
+
+		void WorkerLoop( unsigned );
+
+		/// Runs indices of the worker's share, then steals until no work is left.
+		void Work( unsigned );
+
+		/// Takes the front index of the worker's own share.
+		bool Pop( unsigned, uint32_t& );
+
+		/// Moves the back half of the largest other share into the thief's share.
+		bool Steal( unsigned );
+
+		unsigned m_threadCount{};
+		std::unique_ptr<Share[]> m_shares;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		const std::function<void( uint32_t, unsigned )>* m_task{ nullptr };
+		uint64_t m_generation{}; ///< Incremented for every ParallelFor call.
+		unsigned m_running{}; ///< Helper threads still working on the current call.
+		bool m_stop{ false };
+		std::atomic<uint64_t> m_steals{};
+	};
+}
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,46 @@
+#ifndef TILED_FRAME_BUFFER_HPP
+#define TILED_FRAME_BUFFER_HPP
+
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uint32_t
+#include <vector> // vector
+
+#include "ThreadPool.hpp" // ThreadPool
+
+namespace CPU {
+	/// Packed colors of a frame stored in 8x8 pixel tiles, each tile's rows one after the other. A tile is 256 bytes,
+	/// four whole cache lines, so threads writing buckets whose edges lie on the tile grid never write the same
+	/// cache line. Row-major rows are shared by the buckets on both sides of every bucket edge not on a 16 pixel
+	/// boundary. Linearize() writes the pixels out row by row for display and file output.
+	class TiledFrameBuffer {
+	public:
+		static constexpr unsigned TileSide{ 8 };
+
+		/// Sizes the tiles for a frame. Pixels are undefined until written.
+		/// @param[in] width   Frame width in pixels.
+		/// @param[in] height  Frame height in pixels.
+		void Resize( unsigned, unsigned );
+
+		uint32_t& At( unsigned x, unsigned y ) {
+			return m_tiles[static_cast<size_t>(y / TileSide) * m_tilesX + x / TileSide].pixels[y % TileSide][x % TileSide];
+		}
+
+		/// Copies a rectangle of pixels into a row-major image, 16 bytes at a time where a tile row lies inside it.
+		/// The image can have padded rows, like the readback footprint WolfRenderer::WriteImageToFile() reads.
+		/// @param[out] image     First byte of the image's top row, 0xAABBGGRR per pixel (R8G8B8A8 in memory).
+		/// @param[in] rowPitch   Bytes from one row of the image to the next, at least its width * 4.
+		/// @param[in] x, y       Top-left pixel of the rectangle, the same in the frame and the image.
+		/// @param[in] width, height  Size of the rectangle.
+		/// @param[in] pool       Threads to copy with, one row of tiles per task.
+		void Linearize( uint8_t*, size_t, unsigned, unsigned, unsigned, unsigned, ThreadPool& ) const;
+	private:
+		struct alignas(64) Tile {
+			uint32_t pixels[TileSide][TileSide];
+		};
+
+		std::vector<Tile> m_tiles;
+		unsigned m_tilesX{}; ///< Tiles per row of tiles.
+	};
+}
+
+#endif // TILED_FRAME_BUFFER_HPP
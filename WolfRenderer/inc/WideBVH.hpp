@@ -0,0 +1,172 @@
+#ifndef WIDE_BVH_HPP
+#define WIDE_BVH_HPP
+
+#include <cstdint> // uint32_t
+#include <vector> // vector
+
+#include "BVH.hpp" // BVH, Ray, Hit, MaxBVHDepth
+#include "SIMD.hpp" // Simd
+
+namespace CPU {
+	/// Marks an unused child slot of a wide node.
+	constexpr uint32_t EmptyChild{ 0xFFFFFFFF };
+
+	/// Node of a W-wide BVH. Child bounds are stored SoA, so all children are tested with one
+	/// SSE (W = 4) or AVX (W = 8) instruction sequence. Unused slots hold a box at +FLT_MAX,
+	/// which no ray can hit.
+	template <unsigned W>
+	struct alignas(32) WideNode {
+		float minX[W];
+		float minY[W];
+		float minZ[W];
+		float maxX[W];
+		float maxY[W];
+		float maxZ[W];
+		uint32_t child[W]; ///< Wide node index for inner children, first TriangleBlock index for leaves.
+		uint32_t blockCount[W]; ///< Number of triangle blocks of a leaf child. Zero for inner children.
+	};
+
+	/// W triangles of a leaf, stored SoA with precomputed Moller-Trumbore edges.
+	/// Unused lanes have zero edges, so their determinant always rejects the hit.
+	template <unsigned W>
+	struct alignas(32) TriangleBlock {
+		float v0x[W];
+		float v0y[W];
+		float v0z[W];
+		float e1x[W];
+		float e1y[W];
+		float e1z[W];
+		float e2x[W];
+		float e2y[W];
+		float e2z[W];
+		uint32_t primIdx[W];
+		uint32_t instanceIdx[W];
+	};
+
+	/// Nodes and leaf triangles of a W-wide BVH. The inner children of a node are stored next
+	/// to each other, and so are the triangle blocks of all its leaf children.
+	template <unsigned W>
+	struct WideStorage {
+		std::vector<WideNode<W>> nodes;
+		std::vector<TriangleBlock<W>> blocks;
+	};
+
+	/// Moller-Trumbore test of W triangles against one ray. Same arithmetic as IntersectTriangle.
+	template <unsigned W>
+	inline bool IntersectBlock( const TriangleBlock<W>& block, const Ray& ray, Hit& hit ) {
+		using S = Simd<W>;
+		using Reg = typename S::Reg;
+
+		const Reg dx{ S::Set1( ray.direction.x ) };
+		const Reg dy{ S::Set1( ray.direction.y ) };
+		const Reg dz{ S::Set1( ray.direction.z ) };
+		const Reg e1x{ S::Load( block.e1x ) };
+		const Reg e1y{ S::Load( block.e1y ) };
+		const Reg e1z{ S::Load( block.e1z ) };
+		const Reg e2x{ S::Load( block.e2x ) };
+		const Reg e2y{ S::Load( block.e2y ) };
+		const Reg e2z{ S::Load( block.e2z ) };
+
+		// pvec = d x e2
+		const Reg px{ S::Sub( S::Mul( dy, e2z ), S::Mul( dz, e2y ) ) };
+		const Reg py{ S::Sub( S::Mul( dz, e2x ), S::Mul( dx, e2z ) ) };
+		const Reg pz{ S::Sub( S::Mul( dx, e2y ), S::Mul( dy, e2x ) ) };
+
+		const Reg det{ S::Add( S::Add( S::Mul( e1x, px ), S::Mul( e1y, py ) ), S::Mul( e1z, pz ) ) };
+		Reg valid{ S::Ge( S::Abs( det ), S::Set1( 1e-12f ) ) };
+		const Reg invDet{ S::Div( S::Set1( 1.f ), det ) };
+
+		const Reg tx{ S::Sub( S::Set1( ray.origin.x ), S::Load( block.v0x ) ) };
+		const Reg ty{ S::Sub( S::Set1( ray.origin.y ), S::Load( block.v0y ) ) };
+		const Reg tz{ S::Sub( S::Set1( ray.origin.z ), S::Load( block.v0z ) ) };
+
+		const Reg u{ S::Mul( S::Add( S::Add( S::Mul( tx, px ), S::Mul( ty, py ) ), S::Mul( tz, pz ) ), invDet ) };
+		valid = S::And( valid, S::Ge( u, S::Set1( 0.f ) ) );
+		valid = S::And( valid, S::Le( u, S::Set1( 1.f ) ) );
+		if ( S::Mask( valid ) == 0 )
+			return false;
+
+		// qvec = tvec x e1
+		const Reg qx{ S::Sub( S::Mul( ty, e1z ), S::Mul( tz, e1y ) ) };
+		const Reg qy{ S::Sub( S::Mul( tz, e1x ), S::Mul( tx, e1z ) ) };
+		const Reg qz{ S::Sub( S::Mul( tx, e1y ), S::Mul( ty, e1x ) ) };
+
+		const Reg v{ S::Mul( S::Add( S::Add( S::Mul( dx, qx ), S::Mul( dy, qy ) ), S::Mul( dz, qz ) ), invDet ) };
+		valid = S::And( valid, S::Ge( v, S::Set1( 0.f ) ) );
+		valid = S::And( valid, S::Le( S::Add( u, v ), S::Set1( 1.f ) ) );
+
+		const Reg t{ S::Mul( S::Add( S::Add( S::Mul( e2x, qx ), S::Mul( e2y, qy ) ), S::Mul( e2z, qz ) ), invDet ) };
+		valid = S::And( valid, S::Gt( t, S::Set1( ray.tMin ) ) );
+		valid = S::And( valid, S::Lt( t, S::Set1( hit.t ) ) );
+		int mask{ S::Mask( valid ) };
+		if ( mask == 0 )
+			return false;
+
+		alignas(32) float ts[W];
+		alignas(32) float us[W];
+		alignas(32) float vs[W];
+		S::Store( ts, t );
+		S::Store( us, u );
+		S::Store( vs, v );
+
+		// Closest valid lane. Ties keep the lowest lane, like the sequential single-ray loop.
+		int bestLane{ -1 };
+		for ( unsigned lane{}; lane < W; ++lane )
+			if ( (mask >> lane) & 1 && (bestLane < 0 || ts[lane] < ts[bestLane]) )
+				bestLane = static_cast<int>(lane);
+
+		hit.t = ts[bestLane];
+		hit.u = us[bestLane];
+		hit.v = vs[bestLane];
+		hit.primIdx = block.primIdx[bestLane];
+		hit.instanceIdx = block.instanceIdx[bestLane];
+		return true;
+	}
+
+	/// Returns the widest BVH width the CPU and OS support: 8 with AVX, 4 otherwise (SSE2, on every x64 CPU).
+	unsigned DetectSIMDWidth();
+
+	/// BVH4/BVH8 collapsed from the binary BVH, for single-ray traversal with SIMD node tests.
+	class WideBVH {
+	public:
+		/// Collapses a binary BVH into a wide one.
+		/// @param[in] bvh    The built binary BVH.
+		/// @param[in] width  4 or 8. 0 picks the width from the CPU's ISA.
+		void Build( const BVH&, unsigned width = 0 );
+
+		/// Finds the closest hit along the ray.
+		/// @param[in] ray   The ray to trace.
+		/// @param[out] hit  Updated only when a closer hit than hit.t is found.
+		/// @return  Whether a hit was found.
+		bool Intersect( const Ray&, Hit& ) const;
+
+		/// Finds any hit along the ray and stops there, for shadow rays.
+		/// @param[in] ray   The ray to trace.
+		/// @param[out] hit  Set to the first hit found, which is not necessarily the closest.
+		/// @return  Whether a hit was found.
+		bool IntersectAny( const Ray&, Hit& ) const;
+
+		/// The width chosen by Build(), 0 if nothing was built.
+		unsigned GetWidth() const;
+
+		size_t GetNodeCount() const;
+
+		/// Memory used by nodes only, in bytes.
+		size_t GetNodeMemoryUsage() const;
+
+		/// Memory used by nodes and triangle blocks, in bytes.
+		size_t GetMemoryUsage() const;
+
+		/// Storage of the BVH4. Empty unless the width is 4.
+		const WideStorage<4>& GetBVH4() const;
+
+		/// Storage of the BVH8. Empty unless the width is 8.
+		const WideStorage<8>& GetBVH8() const;
+	private:
+		WideStorage<4> m_bvh4;
+		WideStorage<8> m_bvh8;
+		unsigned m_width{};
+	};
+}
+
+#endif // WIDE_BVH_HPP
@@ -2,6 +2,7 @@
 
 cbuffer RootConstants : register( b1 ) {
     int frameIdx;
+    uint primitiveOffset; // Index of the draw's first triangle in its mesh.
 };
 
 cbuffer SceneData : register( b2 ) {
@@ -58,7 +59,7 @@ float3 GetAlbedoColor( uint primID ) {
 }
 
 float4 PSMain( VSOutput_Faces input, uint primID : SV_PrimitiveID ) : SV_TARGET {
-    float3 albedo = GetAlbedoColor( primID );
+    float3 albedo = GetAlbedoColor( primID + primitiveOffset );
 
     // Don't calculate lighting in "Unlit" shade mode.
     if ( shadeMode == 1 ) {
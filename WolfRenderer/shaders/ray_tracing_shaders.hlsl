@@ -1,5 +1,6 @@
 RaytracingAccelerationStructure sceneBVHAccStruct : register( t0 );
 RWTexture2D<float4> frameTexture : register( u0 );
+RWTexture2D<float4> accumulationTexture : register( u1 ); // Sum of the progressive samples.
 
 StructuredBuffer<float3> vertices : register( t1 ); // Vertex positions.
 StructuredBuffer<uint> indices : register( t2 ); // Triangle indices.
@@ -12,6 +13,8 @@ struct RayPayload {
 cbuffer SceneData : register( b0 ) {
     uint bgColorPacked;
     bool useRandomColors;
+    uint sampleIndex; // Progressive sample of this frame. 0 restarts the accumulation.
+    bool progressive;
 };
 
 cbuffer RTCameraCB : register( b1 ) {
@@ -68,6 +71,14 @@ float3 HashToColor( uint hashValue ) {
     return float3( rBits, gBits, bBits ) * ( 1.0 / 255.0 );
 }
 
+/// Subpixel position of a progressive sample in [0, 1). Follows the R2 low-discrepancy
+/// sequence, shifted per pixel by a hash so neighbouring pixels don't share a pattern.
+float2 SampleJitter( uint2 pixel, uint index ) {
+    uint seed = HashUint( pixel.x ^ HashUint( pixel.y ) );
+    float2 shift = float2( seed & 0xFFFFu, seed >> 16 ) / 65536.0f;
+    return frac( shift + float( index ) * float2( 0.7548776662f, 0.5698402910f ) );
+}
+
 float3 RandomColorPerPrimitive() {
     uint primitiveId = ComputePrimitiveId();
     uint hashValue = HashUint( primitiveId );
@@ -101,9 +112,10 @@ void rayGen() {
     // cameraRay.Direction = float3( rasterR, rasterG, 0.f );
     // frameTexture[pixelRasterCoords] = float4( cameraRay.Direction, 1.f );
 
-    // Center the coordinates to the pixel.
-    x += 0.5f;
-    y += 0.5f;
+    // Center the coordinates to the pixel, or jitter them inside it when accumulating.
+    float2 subpixel = progressive ? SampleJitter( pixelRasterCoords, sampleIndex ) : float2( 0.5f, 0.5f );
+    x += subpixel.x;
+    y += subpixel.y;
 
     // Normalize to NDC [0, 1].
     x /= width;
@@ -176,7 +188,16 @@ void rayGen() {
         rayPayload
     );
 
-    frameTexture[pixelRasterCoords] = rayPayload.pixelColor;
+    if ( progressive ) {
+        float4 sum = rayPayload.pixelColor;
+        if ( sampleIndex > 0 ) {
+            sum += accumulationTexture[pixelRasterCoords];
+        }
+        accumulationTexture[pixelRasterCoords] = sum;
+        frameTexture[pixelRasterCoords] = sum / float( sampleIndex + 1 );
+    } else {
+        frameTexture[pixelRasterCoords] = rayPayload.pixelColor;
+    }
 }
 
 [shader("miss")]
@@ -0,0 +1,1012 @@
+#include "BVH.hpp" // BVH, BVHNode, Triangle, AABB, Ray, Hit
+
+#include <cmath> // ceil, log2, sqrt
+#include <immintrin.h> // SSE intrinsics
+#include <numeric> // iota
+#include <utility> // swap, move, pair
+
+#include "SIMD.hpp" // SafeRcp
+
+
+namespace CPU {
+	namespace {
+		float Component( const DirectX::XMFLOAT3& vec, int axis ) {
+			return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+		}
+
+		void SetComponent( DirectX::XMFLOAT3& vec, int axis, float value ) {
+			(axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z)) = value;
+		}
+
+		DirectX::XMFLOAT3 Center( const AABB& box ) {
+			return { (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+		}
+
+		uint32_t BinIndex( float value, float binMin, float scale, uint32_t binCount ) {
+			return std::min( binCount - 1, static_cast<uint32_t>(std::max( 0.f, (value - binMin) * scale )) );
+		}
+
+		/// Largest number of leaf references the spatial builder may create.
+		size_t MaxReferences( size_t triangleCount, const BVHBuildSettings& settings ) {
+			return static_cast<size_t>(triangleCount * std::max( settings.referenceBudget, 1.f ));
+		}
+
+		/// Best binned SAH object split of a set of references.
+		struct ObjectSplit {
+			int axis{ -1 };
+			uint32_t bin{}; ///< References binned below this index go left.
+			float cost{ FLT_MAX }; ///< Child area * child count, summed over both children.
+			AABB centroidBounds;
+			AABB leftBounds;
+			AABB rightBounds;
+		};
+
+		ObjectSplit FindObjectSplit( const uint32_t* refs, uint32_t count, const std::vector<AABB>& boxes,
+			const std::vector<DirectX::XMFLOAT3>& centroids, uint32_t binCount ) {
+			ObjectSplit best{};
+			for ( uint32_t i{}; i < count; ++i )
+				best.centroidBounds.Grow( centroids[refs[i]] );
+
+			struct Bin {
+				AABB bounds;
+				uint32_t count{};
+			};
+
+			std::vector<Bin> bins( binCount );
+			std::vector<AABB> leftBoxes( binCount - 1 );
+			std::vector<uint32_t> leftCount( binCount - 1 );
+
+			for ( int axis{}; axis < 3; ++axis ) {
+				const float bMin{ Component( best.centroidBounds.min, axis ) };
+				const float bMax{ Component( best.centroidBounds.max, axis ) };
+				if ( bMax <= bMin )
+					continue;
+
+				std::fill( bins.begin(), bins.end(), Bin{} );
+				const float scale{ binCount / (bMax - bMin) };
+				for ( uint32_t i{}; i < count; ++i ) {
+					const uint32_t ref{ refs[i] };
+					const uint32_t binIdx{ BinIndex( Component( centroids[ref], axis ), bMin, scale, binCount ) };
+					bins[binIdx].count++;
+					bins[binIdx].bounds.Grow( boxes[ref] );
+				}
+
+				// Sweep from the left, then evaluate each plane sweeping from the right.
+				AABB leftBox{};
+				uint32_t leftSum{};
+				for ( uint32_t i{}; i < binCount - 1; ++i ) {
+					leftSum += bins[i].count;
+					leftCount[i] = leftSum;
+					leftBox.Grow( bins[i].bounds );
+					leftBoxes[i] = leftBox;
+				}
+
+				AABB rightBox{};
+				uint32_t rightSum{};
+				for ( uint32_t i{ binCount - 1 }; i > 0; --i ) {
+					rightSum += bins[i].count;
+					rightBox.Grow( bins[i].bounds );
+					const float cost{ leftCount[i - 1] * leftBoxes[i - 1].HalfArea() + rightSum * rightBox.HalfArea() };
+					if ( leftCount[i - 1] > 0 && rightSum > 0 && cost < best.cost ) {
+						best.cost = cost;
+						best.axis = axis;
+						best.bin = i;
+						best.leftBounds = leftBoxes[i - 1];
+						best.rightBounds = rightBox;
+					}
+				}
+			}
+			return best;
+		}
+
+		/// Moves the references of the left child of an object split to the front. Returns their count.
+		uint32_t PartitionObjectSplit( uint32_t* refs, uint32_t count,
+			const std::vector<DirectX::XMFLOAT3>& centroids, const ObjectSplit& split, uint32_t binCount ) {
+			const float bMin{ Component( split.centroidBounds.min, split.axis ) };
+			const float scale{ binCount / (Component( split.centroidBounds.max, split.axis ) - bMin) };
+			uint32_t i{};
+			uint32_t j{ count };
+			while ( i < j ) {
+				if ( BinIndex( Component( centroids[refs[i]], split.axis ), bMin, scale, binCount ) < split.bin )
+					++i;
+				else
+					std::swap( refs[i], refs[--j] );
+			}
+			return i;
+		}
+
+		/// Bounds of the part of a triangle inside a box. The triangle is clipped against all
+		/// six planes, and the result is clamped to the box to absorb rounding.
+		AABB ClipTriangle( const Triangle& tri, const AABB& box ) {
+			constexpr int MaxVertices{ 16 };
+			DirectX::XMFLOAT3 polygon[MaxVertices]{
+				tri.v0,
+				{ tri.v0.x + tri.edge1.x, tri.v0.y + tri.edge1.y, tri.v0.z + tri.edge1.z },
+				{ tri.v0.x + tri.edge2.x, tri.v0.y + tri.edge2.y, tri.v0.z + tri.edge2.z } };
+			int vertexCount{ 3 };
+
+			DirectX::XMFLOAT3 clipped[MaxVertices];
+			for ( int plane{}; plane < 6 && vertexCount > 0; ++plane ) {
+				const int axis{ plane / 2 };
+				const bool keepAbove{ plane % 2 == 0 };
+				const float position{ keepAbove ? Component( box.min, axis ) : Component( box.max, axis ) };
+
+				int clippedCount{};
+				for ( int i{}; i < vertexCount && clippedCount < MaxVertices - 1; ++i ) {
+					const DirectX::XMFLOAT3& a{ polygon[i] };
+					const DirectX::XMFLOAT3& b{ polygon[(i + 1) % vertexCount] };
+					const float da{ keepAbove ? Component( a, axis ) - position : position - Component( a, axis ) };
+					const float db{ keepAbove ? Component( b, axis ) - position : position - Component( b, axis ) };
+					if ( da >= 0.f )
+						clipped[clippedCount++] = a;
+					if ( (da > 0.f && db < 0.f) || (da < 0.f && db > 0.f) ) {
+						const float t{ da / (da - db) };
+						DirectX::XMFLOAT3 point{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t };
+						SetComponent( point, axis, position );
+						clipped[clippedCount++] = point;
+					}
+				}
+				vertexCount = clippedCount;
+				std::copy( clipped, clipped + clippedCount, polygon );
+			}
+
+			AABB result{};
+			for ( int i{}; i < vertexCount; ++i )
+				result.Grow( polygon[i] );
+			if ( result.IsEmpty() )
+				return result;
+
+			result.min = { std::max( result.min.x, box.min.x ), std::max( result.min.y, box.min.y ),
+				std::max( result.min.z, box.min.z ) };
+			result.max = { std::min( result.max.x, box.max.x ), std::min( result.max.y, box.max.y ),
+				std::min( result.max.z, box.max.z ) };
+			return result;
+		}
+
+		/// Best binned spatial split: references are chopped into every bin they span.
+		struct SpatialSplit {
+			int axis{ -1 };
+			float position{};
+			float cost{ FLT_MAX }; ///< Child area * child count, summed over both children.
+			uint32_t leftCount{};
+			uint32_t rightCount{}; ///< Straddling references are counted on both sides.
+		};
+
+		SpatialSplit FindSpatialSplit( const std::vector<uint32_t>& refs, const AABB& nodeBounds,
+			const std::vector<Triangle>& triangles, const std::vector<AABB>& boxes,
+			const std::vector<uint32_t>& refTriangles, uint32_t binCount ) {
+			struct Bin {
+				AABB bounds;
+				uint32_t entries{}; ///< References starting in this bin.
+				uint32_t exits{}; ///< References ending in this bin.
+			};
+
+			const uint32_t count{ static_cast<uint32_t>(refs.size()) };
+			std::vector<Bin> bins( binCount );
+			std::vector<AABB> leftBoxes( binCount - 1 );
+			std::vector<uint32_t> leftCount( binCount - 1 );
+
+			SpatialSplit best{};
+			for ( int axis{}; axis < 3; ++axis ) {
+				const float lo{ Component( nodeBounds.min, axis ) };
+				const float hi{ Component( nodeBounds.max, axis ) };
+				if ( hi <= lo )
+					continue;
+
+				std::fill( bins.begin(), bins.end(), Bin{} );
+				const float binWidth{ (hi - lo) / binCount };
+				const float scale{ binCount / (hi - lo) };
+				for ( uint32_t ref : refs ) {
+					const AABB& box{ boxes[ref] };
+					const uint32_t firstBin{ BinIndex( Component( box.min, axis ), lo, scale, binCount ) };
+					const uint32_t lastBin{ std::max( firstBin, BinIndex( Component( box.max, axis ), lo, scale, binCount ) ) };
+					bins[firstBin].entries++;
+					bins[lastBin].exits++;
+					if ( firstBin == lastBin ) {
+						bins[firstBin].bounds.Grow( box );
+						continue;
+					}
+
+					for ( uint32_t b{ firstBin }; b <= lastBin; ++b ) {
+						AABB slab{ box };
+						if ( b > firstBin )
+							SetComponent( slab.min, axis, lo + b * binWidth );
+						if ( b < lastBin )
+							SetComponent( slab.max, axis, lo + (b + 1) * binWidth );
+						bins[b].bounds.Grow( ClipTriangle( triangles[refTriangles[ref]], slab ) );
+					}
+				}
+
+				AABB leftBox{};
+				uint32_t leftSum{};
+				for ( uint32_t i{}; i < binCount - 1; ++i ) {
+					leftSum += bins[i].entries;
+					leftCount[i] = leftSum;
+					leftBox.Grow( bins[i].bounds );
+					leftBoxes[i] = leftBox;
+				}
+
+				// Only splits that shrink both sides are kept, so the build always terminates.
+				AABB rightBox{};
+				uint32_t rightSum{};
+				for ( uint32_t i{ binCount - 1 }; i > 0; --i ) {
+					rightSum += bins[i].exits;
+					rightBox.Grow( bins[i].bounds );
+					const uint32_t leftN{ leftCount[i - 1] };
+					if ( leftN == 0 || rightSum == 0 || leftN == count || rightSum == count )
+						continue;
+
+					const float cost{ leftN * leftBoxes[i - 1].HalfArea() + rightSum * rightBox.HalfArea() };
+					if ( cost < best.cost )
+						best = { axis, lo + i * binWidth, cost, leftN, rightSum };
+				}
+			}
+			return best;
+		}
+
+		/// Splits triangles whose box is much larger than the triangle into tighter references, by
+		/// halving the box along its longest axis. The worst triangles are split first, within the budget.
+		void PreSplit( const std::vector<Triangle>& triangles, std::vector<AABB>& boxes,
+			std::vector<DirectX::XMFLOAT3>& centroids, std::vector<uint32_t>& refTriangles,
+			const BVHBuildSettings& settings ) {
+			constexpr uint32_t MaxDepth{ 6 }; ///< At most 64 pieces per triangle.
+			const size_t maxReferences{ MaxReferences( triangles.size(), settings ) };
+
+			struct Candidate {
+				uint32_t triIdx;
+				float ratio;
+			};
+			std::vector<Candidate> candidates;
+			for ( uint32_t i{}; i < triangles.size(); ++i ) {
+				const Triangle& tri{ triangles[i] };
+				const float cx{ tri.edge1.y * tri.edge2.z - tri.edge1.z * tri.edge2.y };
+				const float cy{ tri.edge1.z * tri.edge2.x - tri.edge1.x * tri.edge2.z };
+				const float cz{ tri.edge1.x * tri.edge2.y - tri.edge1.y * tri.edge2.x };
+				const float area{ 0.5f * std::sqrt( cx * cx + cy * cy + cz * cz ) };
+				if ( area <= 0.f )
+					continue;
+
+				const float ratio{ boxes[i].HalfArea() / area };
+				if ( ratio > settings.preSplitRatio )
+					candidates.push_back( { i, ratio } );
+			}
+			std::sort( candidates.begin(), candidates.end(),
+				[]( const Candidate& a, const Candidate& b ) { return a.ratio > b.ratio; } );
+
+			std::vector<AABB> pieces;
+			std::vector<AABB> nextPieces;
+			for ( const Candidate& candidate : candidates ) {
+				uint32_t depth{ std::min( MaxDepth,
+					static_cast<uint32_t>(std::ceil( std::log2( candidate.ratio / settings.preSplitRatio ) )) ) };
+				depth = std::max( depth, 1u );
+				while ( depth > 0 && boxes.size() + (size_t{ 1 } << depth) - 1 > maxReferences )
+					--depth;
+				if ( depth == 0 )
+					break;
+
+				const Triangle& tri{ triangles[candidate.triIdx] };
+				pieces.assign( 1, boxes[candidate.triIdx] );
+				for ( uint32_t level{}; level < depth; ++level ) {
+					nextPieces.clear();
+					for ( const AABB& piece : pieces ) {
+						const DirectX::XMFLOAT3 extent{
+							piece.max.x - piece.min.x, piece.max.y - piece.min.y, piece.max.z - piece.min.z };
+						const int axis{ extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2) };
+						const float middle{ (Component( piece.min, axis ) + Component( piece.max, axis )) * 0.5f };
+
+						AABB lower{ piece };
+						AABB upper{ piece };
+						SetComponent( lower.max, axis, middle );
+						SetComponent( upper.min, axis, middle );
+						for ( const AABB& half : { ClipTriangle( tri, lower ), ClipTriangle( tri, upper ) } )
+							if ( !half.IsEmpty() )
+								nextPieces.push_back( half );
+					}
+					if ( nextPieces.empty() )
+						break;
+					pieces.swap( nextPieces );
+				}
+
+				boxes[candidate.triIdx] = pieces[0];
+				centroids[candidate.triIdx] = Center( pieces[0] );
+				for ( size_t i{ 1 }; i < pieces.size(); ++i ) {
+					boxes.push_back( pieces[i] );
+					centroids.push_back( Center( pieces[i] ) );
+					refTriangles.push_back( candidate.triIdx );
+				}
+			}
+		}
+
+		/// Returns the entry distance of the ray into the box, or FLT_MAX on a miss.
+		float IntersectAABB( const AABB& box, const DirectX::XMFLOAT3& origin,
+			const DirectX::XMFLOAT3& rcpDir, float tMin, float tMax ) {
+			const float tx1{ (box.min.x - origin.x) * rcpDir.x };
+			const float tx2{ (box.max.x - origin.x) * rcpDir.x };
+			const float ty1{ (box.min.y - origin.y) * rcpDir.y };
+			const float ty2{ (box.max.y - origin.y) * rcpDir.y };
+			const float tz1{ (box.min.z - origin.z) * rcpDir.z };
+			const float tz2{ (box.max.z - origin.z) * rcpDir.z };
+
+			const float tNear{ std::max( { std::min( tx1, tx2 ), std::min( ty1, ty2 ), std::min( tz1, tz2 ), tMin } ) };
+			const float tFar{ std::min( { std::max( tx1, tx2 ), std::max( ty1, ty2 ), std::max( tz1, tz2 ), tMax } ) };
+			return tNear <= tFar ? tNear : FLT_MAX;
+		}
+
+		/// mask ? a : b, SSE2 only.
+		__m128 Select( __m128 mask, __m128 a, __m128 b ) {
+			return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+		}
+
+		__m128i Select( __m128 mask, __m128i a, __m128i b ) {
+			const __m128i maskI{ _mm_castps_si128( mask ) };
+			return _mm_or_si128( _mm_and_si128( maskI, a ), _mm_andnot_si128( maskI, b ) );
+		}
+
+		/// Per-packet data derived once before traversal.
+		template <unsigned N>
+		struct PacketContext {
+			static constexpr unsigned groups{ N / 4 };
+
+			alignas(16) float rdx[N];
+			alignas(16) float rdy[N];
+			alignas(16) float rdz[N];
+
+			// Interval bounds of origins and reciprocal directions over the packet.
+			DirectX::XMFLOAT3 originMin{ FLT_MAX, FLT_MAX, FLT_MAX };
+			DirectX::XMFLOAT3 originMax{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			DirectX::XMFLOAT3 rcpMin{ FLT_MAX, FLT_MAX, FLT_MAX };
+			DirectX::XMFLOAT3 rcpMax{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+			bool dirNegative[3]{}; ///< Shared direction sign per axis, valid for coherent packets.
+			bool coherent{ true };
+		};
+
+		/// Builds the packet context. A packet is coherent if all lanes share direction signs.
+		template <unsigned N>
+		void SetupPacket( const RayPacket<N>& packet, PacketContext<N>& ctx ) {
+			constexpr float minComponent{ 1e-8f };
+			const float* dirs[3]{ packet.dx, packet.dy, packet.dz };
+			for ( int axis{}; axis < 3; ++axis ) {
+				ctx.dirNegative[axis] = dirs[axis][0] < 0.f;
+				for ( unsigned i{}; i < N; ++i ) {
+					const float d{ dirs[axis][i] };
+					if ( (d < 0.f) != ctx.dirNegative[axis] || std::abs( d ) < minComponent )
+						ctx.coherent = false;
+				}
+			}
+
+			for ( unsigned i{}; i < N; ++i ) {
+				ctx.rdx[i] = SafeRcp( packet.dx[i] );
+				ctx.rdy[i] = SafeRcp( packet.dy[i] );
+				ctx.rdz[i] = SafeRcp( packet.dz[i] );
+
+				ctx.originMin = { std::min( ctx.originMin.x, packet.ox[i] ),
+					std::min( ctx.originMin.y, packet.oy[i] ), std::min( ctx.originMin.z, packet.oz[i] ) };
+				ctx.originMax = { std::max( ctx.originMax.x, packet.ox[i] ),
+					std::max( ctx.originMax.y, packet.oy[i] ), std::max( ctx.originMax.z, packet.oz[i] ) };
+				ctx.rcpMin = { std::min( ctx.rcpMin.x, ctx.rdx[i] ),
+					std::min( ctx.rcpMin.y, ctx.rdy[i] ), std::min( ctx.rcpMin.z, ctx.rdz[i] ) };
+				ctx.rcpMax = { std::max( ctx.rcpMax.x, ctx.rdx[i] ),
+					std::max( ctx.rcpMax.y, ctx.rdy[i] ), std::max( ctx.rcpMax.z, ctx.rdz[i] ) };
+			}
+		}
+
+		/// Interval arithmetic range of (plane - origin) * rcpDir over all rays of the packet.
+		void SlabInterval( float plane, float oMin, float oMax, float rMin, float rMax,
+			float& outMin, float& outMax ) {
+			const float a{ plane - oMax };
+			const float b{ plane - oMin };
+			const float p0{ a * rMin };
+			const float p1{ a * rMax };
+			const float p2{ b * rMin };
+			const float p3{ b * rMax };
+			outMin = std::min( { p0, p1, p2, p3 } );
+			outMax = std::max( { p0, p1, p2, p3 } );
+		}
+
+		/// Conservative packet frustum test. Returns false only if no ray of the packet can hit the box.
+		template <unsigned N>
+		bool FrustumOverlaps( const AABB& box, const PacketContext<N>& ctx, float tMin, float maxTMax ) {
+			float tNear{ tMin };
+			float tFar{ maxTMax };
+			const float boxMin[3]{ box.min.x, box.min.y, box.min.z };
+			const float boxMax[3]{ box.max.x, box.max.y, box.max.z };
+			const float oMin[3]{ ctx.originMin.x, ctx.originMin.y, ctx.originMin.z };
+			const float oMax[3]{ ctx.originMax.x, ctx.originMax.y, ctx.originMax.z };
+			const float rMin[3]{ ctx.rcpMin.x, ctx.rcpMin.y, ctx.rcpMin.z };
+			const float rMax[3]{ ctx.rcpMax.x, ctx.rcpMax.y, ctx.rcpMax.z };
+
+			for ( int axis{}; axis < 3; ++axis ) {
+				// With coherent signs every ray enters through the same slab plane.
+				const float nearPlane{ ctx.dirNegative[axis] ? boxMax[axis] : boxMin[axis] };
+				const float farPlane{ ctx.dirNegative[axis] ? boxMin[axis] : boxMax[axis] };
+				float nearLo, nearHi, farLo, farHi;
+				SlabInterval( nearPlane, oMin[axis], oMax[axis], rMin[axis], rMax[axis], nearLo, nearHi );
+				SlabInterval( farPlane, oMin[axis], oMax[axis], rMin[axis], rMax[axis], farLo, farHi );
+				tNear = std::max( tNear, nearLo );
+				tFar = std::min( tFar, farHi );
+			}
+			return tNear <= tFar;
+		}
+
+		/// Slab test of 4 lanes (one group) against a box. Returns the lane hit mask.
+		template <unsigned N>
+		int IntersectAABB4( const AABB& box, const RayPacket<N>& packet, const PacketContext<N>& ctx,
+			unsigned group ) {
+			const unsigned o{ group * 4 };
+			const __m128 rdx{ _mm_load_ps( ctx.rdx + o ) };
+			const __m128 rdy{ _mm_load_ps( ctx.rdy + o ) };
+			const __m128 rdz{ _mm_load_ps( ctx.rdz + o ) };
+			const __m128 ox{ _mm_load_ps( packet.ox + o ) };
+			const __m128 oy{ _mm_load_ps( packet.oy + o ) };
+			const __m128 oz{ _mm_load_ps( packet.oz + o ) };
+
+			const __m128 tx1{ _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( box.min.x ), ox ), rdx ) };
+			const __m128 tx2{ _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( box.max.x ), ox ), rdx ) };
+			const __m128 ty1{ _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( box.min.y ), oy ), rdy ) };
+			const __m128 ty2{ _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( box.max.y ), oy ), rdy ) };
+			const __m128 tz1{ _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( box.min.z ), oz ), rdz ) };
+			const __m128 tz2{ _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( box.max.z ), oz ), rdz ) };
+
+			__m128 tNear{ _mm_max_ps( _mm_min_ps( tx1, tx2 ), _mm_set1_ps( packet.tMin ) ) };
+			tNear = _mm_max_ps( tNear, _mm_min_ps( ty1, ty2 ) );
+			tNear = _mm_max_ps( tNear, _mm_min_ps( tz1, tz2 ) );
+			__m128 tFar{ _mm_min_ps( _mm_max_ps( tx1, tx2 ), _mm_load_ps( packet.tMax + o ) ) };
+			tFar = _mm_min_ps( tFar, _mm_max_ps( ty1, ty2 ) );
+			tFar = _mm_min_ps( tFar, _mm_max_ps( tz1, tz2 ) );
+
+			return _mm_movemask_ps( _mm_cmple_ps( tNear, tFar ) );
+		}
+
+		/// Moller-Trumbore test of one triangle against 4 lanes, same arithmetic as IntersectTriangle.
+		template <unsigned N>
+		void IntersectTriangle4( const Triangle& tri, RayPacket<N>& packet, unsigned group ) {
+			const unsigned o{ group * 4 };
+			const __m128 dx{ _mm_load_ps( packet.dx + o ) };
+			const __m128 dy{ _mm_load_ps( packet.dy + o ) };
+			const __m128 dz{ _mm_load_ps( packet.dz + o ) };
+			const __m128 e1x{ _mm_set1_ps( tri.edge1.x ) };
+			const __m128 e1y{ _mm_set1_ps( tri.edge1.y ) };
+			const __m128 e1z{ _mm_set1_ps( tri.edge1.z ) };
+			const __m128 e2x{ _mm_set1_ps( tri.edge2.x ) };
+			const __m128 e2y{ _mm_set1_ps( tri.edge2.y ) };
+			const __m128 e2z{ _mm_set1_ps( tri.edge2.z ) };
+
+			// pvec = d x e2
+			const __m128 px{ _mm_sub_ps( _mm_mul_ps( dy, e2z ), _mm_mul_ps( dz, e2y ) ) };
+			const __m128 py{ _mm_sub_ps( _mm_mul_ps( dz, e2x ), _mm_mul_ps( dx, e2z ) ) };
+			const __m128 pz{ _mm_sub_ps( _mm_mul_ps( dx, e2y ), _mm_mul_ps( dy, e2x ) ) };
+
+			const __m128 det{ _mm_add_ps( _mm_add_ps( _mm_mul_ps( e1x, px ), _mm_mul_ps( e1y, py ) ),
+				_mm_mul_ps( e1z, pz ) ) };
+			const __m128 absDet{ _mm_andnot_ps( _mm_set1_ps( -0.f ), det ) };
+			__m128 valid{ _mm_cmpge_ps( absDet, _mm_set1_ps( 1e-12f ) ) };
+			const __m128 invDet{ _mm_div_ps( _mm_set1_ps( 1.f ), det ) };
+
+			const __m128 tx{ _mm_sub_ps( _mm_load_ps( packet.ox + o ), _mm_set1_ps( tri.v0.x ) ) };
+			const __m128 ty{ _mm_sub_ps( _mm_load_ps( packet.oy + o ), _mm_set1_ps( tri.v0.y ) ) };
+			const __m128 tz{ _mm_sub_ps( _mm_load_ps( packet.oz + o ), _mm_set1_ps( tri.v0.z ) ) };
+
+			const __m128 u{ _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( tx, px ), _mm_mul_ps( ty, py ) ),
+				_mm_mul_ps( tz, pz ) ), invDet ) };
+			valid = _mm_and_ps( valid, _mm_cmpge_ps( u, _mm_setzero_ps() ) );
+			valid = _mm_and_ps( valid, _mm_cmple_ps( u, _mm_set1_ps( 1.f ) ) );
+			if ( _mm_movemask_ps( valid ) == 0 )
+				return;
+
+			// qvec = tvec x e1
+			const __m128 qx{ _mm_sub_ps( _mm_mul_ps( ty, e1z ), _mm_mul_ps( tz, e1y ) ) };
+			const __m128 qy{ _mm_sub_ps( _mm_mul_ps( tz, e1x ), _mm_mul_ps( tx, e1z ) ) };
+			const __m128 qz{ _mm_sub_ps( _mm_mul_ps( tx, e1y ), _mm_mul_ps( ty, e1x ) ) };
+
+			const __m128 v{ _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, qx ), _mm_mul_ps( dy, qy ) ),
+				_mm_mul_ps( dz, qz ) ), invDet ) };
+			valid = _mm_and_ps( valid, _mm_cmpge_ps( v, _mm_setzero_ps() ) );
+			valid = _mm_and_ps( valid, _mm_cmple_ps( _mm_add_ps( u, v ), _mm_set1_ps( 1.f ) ) );
+
+			const __m128 t{ _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( e2x, qx ), _mm_mul_ps( e2y, qy ) ),
+				_mm_mul_ps( e2z, qz ) ), invDet ) };
+			const __m128 tMax{ _mm_load_ps( packet.tMax + o ) };
+			valid = _mm_and_ps( valid, _mm_cmpgt_ps( t, _mm_set1_ps( packet.tMin ) ) );
+			valid = _mm_and_ps( valid, _mm_cmplt_ps( t, tMax ) );
+			if ( _mm_movemask_ps( valid ) == 0 )
+				return;
+
+			_mm_store_ps( packet.tMax + o, Select( valid, t, tMax ) );
+			_mm_store_ps( packet.u + o, Select( valid, u, _mm_load_ps( packet.u + o ) ) );
+			_mm_store_ps( packet.v + o, Select( valid, v, _mm_load_ps( packet.v + o ) ) );
+			__m128i* primPtr{ reinterpret_cast<__m128i*>(packet.primIdx + o) };
+			__m128i* instPtr{ reinterpret_cast<__m128i*>(packet.instanceIdx + o) };
+			_mm_store_si128( primPtr, Select( valid, _mm_set1_epi32( static_cast<int>(tri.primIdx) ),
+				_mm_load_si128( primPtr ) ) );
+			_mm_store_si128( instPtr, Select( valid, _mm_set1_epi32( static_cast<int>(tri.instanceIdx) ),
+				_mm_load_si128( instPtr ) ) );
+		}
+
+		template <unsigned N>
+		Ray LaneToRay( const RayPacket<N>& packet, unsigned lane ) {
+			return Ray{ { packet.ox[lane], packet.oy[lane], packet.oz[lane] }, packet.tMin,
+				{ packet.dx[lane], packet.dy[lane], packet.dz[lane] }, packet.tMax[lane] };
+		}
+
+		template <unsigned N>
+		void StoreLaneHit( RayPacket<N>& packet, unsigned lane, const Hit& hit ) {
+			packet.tMax[lane] = hit.t;
+			packet.u[lane] = hit.u;
+			packet.v[lane] = hit.v;
+			packet.primIdx[lane] = hit.primIdx;
+			packet.instanceIdx[lane] = hit.instanceIdx;
+		}
+
+		int PopCount4( int mask ) {
+			return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+		}
+
+		int LowestBit4( int mask ) {
+			return (mask & 1) ? 0 : ((mask & 2) ? 1 : ((mask & 4) ? 2 : 3));
+		}
+	}
+
+	void BVH::Build( const std::vector<Mesh>& meshes, const BVHBuildSettings& settings ) {
+		Clear();
+
+		// Gather all triangles in scene order first, then reorder them to match the leaves.
+		std::vector<Triangle> sceneTriangles;
+		std::vector<AABB> boxes;
+		std::vector<DirectX::XMFLOAT3> centroids;
+		for ( uint32_t meshIdx{}; meshIdx < meshes.size(); ++meshIdx ) {
+			const Mesh& mesh{ meshes[meshIdx] };
+			for ( size_t i{}; i + 2 < mesh.indices.size(); i += 3 ) {
+				const DirectX::XMFLOAT3& p0{ mesh.vertices[mesh.indices[i]].position };
+				const DirectX::XMFLOAT3& p1{ mesh.vertices[mesh.indices[i + 1]].position };
+				const DirectX::XMFLOAT3& p2{ mesh.vertices[mesh.indices[i + 2]].position };
+
+				sceneTriangles.push_back( {
+					p0,
+					{ p1.x - p0.x, p1.y - p0.y, p1.z - p0.z },
+					{ p2.x - p0.x, p2.y - p0.y, p2.z - p0.z },
+					static_cast<uint32_t>(i / 3),
+					meshIdx
+				} );
+
+				AABB box{};
+				box.Grow( p0 );
+				box.Grow( p1 );
+				box.Grow( p2 );
+				boxes.push_back( box );
+				centroids.push_back( {
+					(p0.x + p1.x + p2.x) / 3.f, (p0.y + p1.y + p2.y) / 3.f, (p0.z + p1.z + p2.z) / 3.f } );
+			}
+		}
+
+		const uint32_t triCount{ static_cast<uint32_t>(sceneTriangles.size()) };
+		if ( triCount == 0 )
+			return;
+
+		if ( settings.spatialSplits || settings.preSplit ) {
+			std::vector<uint32_t> refTriangles( triCount );
+			std::iota( refTriangles.begin(), refTriangles.end(), 0u );
+			if ( settings.preSplit )
+				PreSplit( sceneTriangles, boxes, centroids, refTriangles, settings );
+			BuildSpatial( sceneTriangles, boxes, centroids, refTriangles, settings );
+
+			// Leaf slots hold references, map them back to their triangles.
+			for ( uint32_t& idx : m_triIndices )
+				idx = refTriangles[idx];
+		} else {
+			m_triIndices.resize( triCount );
+			for ( uint32_t i{}; i < triCount; ++i )
+				m_triIndices[i] = i;
+
+			// A binary tree with N leaves has at most 2N - 1 nodes. Reserving keeps node references valid.
+			m_nodes.reserve( static_cast<size_t>(triCount) * 2 );
+			m_nodes.push_back( { {}, 0, triCount } );
+
+			// Nodes with their level.
+			std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0, 1 } };
+			while ( !stack.empty() ) {
+				const auto [nodeIdx, depth] { stack.back() };
+				stack.pop_back();
+				UpdateNodeBounds( nodeIdx, boxes );
+				if ( Subdivide( nodeIdx, depth, boxes, centroids, settings ) ) {
+					stack.push_back( { m_nodes[nodeIdx].leftFirst + 1, depth + 1 } );
+					stack.push_back( { m_nodes[nodeIdx].leftFirst, depth + 1 } );
+				}
+			}
+		}
+
+		m_triangles.reserve( m_triIndices.size() );
+		for ( uint32_t idx : m_triIndices )
+			m_triangles.push_back( sceneTriangles[idx] );
+
+		m_nodeView = m_nodes;
+		m_triangleView = m_triangles;
+		m_triIndexView = m_triIndices;
+	}
+
+	void BVH::Clear() {
+		m_nodes.clear();
+		m_triangles.clear();
+		m_triIndices.clear();
+		m_nodeView = {};
+		m_triangleView = {};
+		m_triIndexView = {};
+		m_cacheFile.reset();
+	}
+
+	void BVH::UpdateNodeBounds( uint32_t nodeIdx, const std::vector<AABB>& boxes ) {
+		BVHNode& node{ m_nodes[nodeIdx] };
+		node.bounds = {};
+		for ( uint32_t i{}; i < node.triCount; ++i )
+			node.bounds.Grow( boxes[m_triIndices[node.leftFirst + i]] );
+	}
+
+	bool BVH::Subdivide(
+		uint32_t nodeIdx,
+		uint32_t depth,
+		const std::vector<AABB>& boxes,
+		const std::vector<DirectX::XMFLOAT3>& centroids,
+		const BVHBuildSettings& settings
+	) {
+		BVHNode& node{ m_nodes[nodeIdx] };
+		if ( node.triCount <= 1 || depth >= MaxBVHDepth )
+			return false;
+
+		const uint32_t first{ node.leftFirst };
+		const uint32_t count{ node.triCount };
+		const uint32_t binCount{ std::max( settings.binCount, 2u ) };
+		const ObjectSplit split{ FindObjectSplit( &m_triIndices[first], count, boxes, centroids, binCount ) };
+
+		const float nodeArea{ node.bounds.HalfArea() };
+		const float leafCost{ settings.intersectionCost * count };
+		const float splitCost{ split.axis < 0 ? FLT_MAX :
+			settings.traversalCost + settings.intersectionCost * split.cost / std::max( nodeArea, FLT_MIN ) };
+		if ( splitCost >= leafCost && count <= settings.maxLeafSize )
+			return false;
+
+		uint32_t leftN{};
+		if ( split.axis >= 0 )
+			leftN = PartitionObjectSplit( &m_triIndices[first], count, centroids, split, binCount );
+
+		// All centroids coincide, but the leaf is too large. Split in the middle of the range.
+		if ( leftN == 0 || leftN == count )
+			leftN = count / 2;
+
+		const uint32_t leftIdx{ static_cast<uint32_t>(m_nodes.size()) };
+		m_nodes.push_back( { {}, first, leftN } );
+		m_nodes.push_back( { {}, first + leftN, count - leftN } );
+		node.leftFirst = leftIdx;
+		node.triCount = 0;
+		return true;
+	}
+
+	void BVH::BuildSpatial( const std::vector<Triangle>& triangles, std::vector<AABB>& boxes,
+		std::vector<DirectX::XMFLOAT3>& centroids, std::vector<uint32_t>& refTriangles,
+		const BVHBuildSettings& settings ) {
+		const uint32_t binCount{ std::max( settings.binCount, 2u ) };
+
+		// Every task owns its references, as spatial splits may send one reference to both children.
+		// The reference budget is shared out in proportion to the child sizes, so the first splits
+		// near the root cannot use it all up.
+		struct Task {
+			uint32_t node;
+			std::vector<uint32_t> refs;
+			size_t budget; ///< Duplicates this sub-tree may still create.
+			uint32_t depth; ///< Level of the node, 1 at the root.
+		};
+		const size_t maxReferences{ MaxReferences( triangles.size(), settings ) };
+		std::vector<Task> stack( 1 );
+		stack[0].budget = maxReferences - std::min( boxes.size(), maxReferences );
+		stack[0].depth = 1;
+		stack[0].refs.resize( boxes.size() );
+		std::iota( stack[0].refs.begin(), stack[0].refs.end(), 0u );
+		m_nodes.push_back( {} );
+		m_triIndices.reserve( boxes.size() );
+
+		float rootArea{};
+		while ( !stack.empty() ) {
+			Task task{ std::move( stack.back() ) };
+			stack.pop_back();
+			std::vector<uint32_t>& refs{ task.refs };
+			const uint32_t count{ static_cast<uint32_t>(refs.size()) };
+
+			AABB bounds{};
+			for ( uint32_t ref : refs )
+				bounds.Grow( boxes[ref] );
+			m_nodes[task.node].bounds = bounds;
+			if ( task.node == 0 )
+				rootArea = bounds.HalfArea();
+
+			ObjectSplit objectSplit{};
+			SpatialSplit spatialSplit{};
+			float bestCost{ FLT_MAX };
+			if ( count > 1 ) {
+				objectSplit = FindObjectSplit( refs.data(), count, boxes, centroids, binCount );
+				bestCost = objectSplit.cost;
+
+				// Spatial splits only pay off where the object split children overlap.
+				AABB overlap{ objectSplit.leftBounds };
+				overlap.min = { std::max( overlap.min.x, objectSplit.rightBounds.min.x ),
+					std::max( overlap.min.y, objectSplit.rightBounds.min.y ),
+					std::max( overlap.min.z, objectSplit.rightBounds.min.z ) };
+				overlap.max = { std::min( overlap.max.x, objectSplit.rightBounds.max.x ),
+					std::min( overlap.max.y, objectSplit.rightBounds.max.y ),
+					std::min( overlap.max.z, objectSplit.rightBounds.max.z ) };
+				const float overlapArea{ objectSplit.axis < 0 ? rootArea : overlap.HalfArea() };
+
+				if ( settings.spatialSplits && overlapArea > settings.spatialSplitAlpha * rootArea ) {
+					spatialSplit = FindSpatialSplit( refs, bounds, triangles, boxes, refTriangles, binCount );
+					const size_t duplicates{ spatialSplit.leftCount + spatialSplit.rightCount - size_t{ count } };
+					if ( spatialSplit.axis >= 0 && spatialSplit.cost < bestCost && duplicates <= task.budget )
+						bestCost = spatialSplit.cost;
+					else
+						spatialSplit.axis = -1;
+				}
+			}
+
+			const float leafCost{ settings.intersectionCost * count };
+			const float splitCost{ bestCost == FLT_MAX ? FLT_MAX :
+				settings.traversalCost + settings.intersectionCost * bestCost / std::max( bounds.HalfArea(), FLT_MIN ) };
+			if ( count <= 1 || task.depth >= MaxBVHDepth || (splitCost >= leafCost && count <= settings.maxLeafSize) ) {
+				m_nodes[task.node].leftFirst = static_cast<uint32_t>(m_triIndices.size());
+				m_nodes[task.node].triCount = count;
+				m_triIndices.insert( m_triIndices.end(), refs.begin(), refs.end() );
+				continue;
+			}
+
+			std::vector<uint32_t> left;
+			std::vector<uint32_t> right;
+			if ( spatialSplit.axis >= 0 ) {
+				const int axis{ spatialSplit.axis };
+				const float position{ spatialSplit.position };
+				for ( uint32_t ref : refs ) {
+					const AABB box{ boxes[ref] };
+					if ( Component( box.max, axis ) <= position ) {
+						left.push_back( ref );
+						continue;
+					}
+					if ( Component( box.min, axis ) >= position ) {
+						right.push_back( ref );
+						continue;
+					}
+
+					// Straddling reference: clip it to both sides and duplicate it.
+					AABB leftBox{ box };
+					AABB rightBox{ box };
+					SetComponent( leftBox.max, axis, position );
+					SetComponent( rightBox.min, axis, position );
+					const Triangle& tri{ triangles[refTriangles[ref]] };
+					const AABB leftPiece{ ClipTriangle( tri, leftBox ) };
+					const AABB rightPiece{ ClipTriangle( tri, rightBox ) };
+					if ( leftPiece.IsEmpty() || rightPiece.IsEmpty() ) {
+						(leftPiece.IsEmpty() ? right : left).push_back( ref );
+						continue;
+					}
+
+					boxes[ref] = leftPiece;
+					centroids[ref] = Center( leftPiece );
+					left.push_back( ref );
+					right.push_back( static_cast<uint32_t>(boxes.size()) );
+					boxes.push_back( rightPiece );
+					centroids.push_back( Center( rightPiece ) );
+					refTriangles.push_back( refTriangles[ref] );
+				}
+			}
+
+			// Object split, also when rounding left one side of the spatial split empty.
+			if ( left.empty() || right.empty() ) {
+				uint32_t leftN{ objectSplit.axis >= 0 ?
+					PartitionObjectSplit( refs.data(), count, centroids, objectSplit, binCount ) : 0 };
+				if ( leftN == 0 || leftN == count )
+					leftN = count / 2;
+				left.assign( refs.begin(), refs.begin() + leftN );
+				right.assign( refs.begin() + leftN, refs.end() );
+			}
+
+			const uint32_t leftIdx{ static_cast<uint32_t>(m_nodes.size()) };
+			m_nodes.push_back( {} );
+			m_nodes.push_back( {} );
+			m_nodes[task.node].leftFirst = leftIdx;
+			m_nodes[task.node].triCount = 0;
+
+			const size_t duplicates{ left.size() + right.size() - count };
+			const size_t budget{ task.budget - std::min( task.budget, duplicates ) };
+			const size_t leftBudget{ budget * left.size() / (left.size() + right.size()) };
+
+			// Left is popped first, so leaves are emitted depth-first.
+			stack.push_back( { leftIdx + 1, std::move( right ), budget - leftBudget, task.depth + 1 } );
+			stack.push_back( { leftIdx, std::move( left ), leftBudget, task.depth + 1 } );
+		}
+	}
+
+	bool BVH::Intersect( const Ray& ray, Hit& hit ) const {
+		if ( m_nodeView.empty() )
+			return false;
+		return IntersectFromNode<false>( 0, ray, hit );
+	}
+
+	bool BVH::IntersectAny( const Ray& ray, Hit& hit ) const {
+		if ( m_nodeView.empty() )
+			return false;
+		return IntersectFromNode<true>( 0, ray, hit );
+	}
+
+	template <bool AnyHit>
+	bool BVH::IntersectFromNode( uint32_t startNode, const Ray& ray, Hit& hit ) const {
+		const DirectX::XMFLOAT3 rcpDir{
+			SafeRcp( ray.direction.x ), SafeRcp( ray.direction.y ), SafeRcp( ray.direction.z ) };
+		hit.t = std::min( hit.t, ray.tMax );
+
+		// At most one far child per level above the current node.
+		uint32_t stack[MaxBVHDepth];
+		uint32_t stackSize{};
+		const BVHNode* node{ &m_nodeView[startNode] };
+		if ( IntersectAABB( node->bounds, ray.origin, rcpDir, ray.tMin, hit.t ) == FLT_MAX )
+			return false;
+
+		bool found{ false };
+		while ( true ) {
+			if ( node->IsLeaf() ) {
+				for ( uint32_t i{}; i < node->triCount; ++i ) {
+					if ( IntersectTriangle( ray, m_triangleView[node->leftFirst + i], hit ) ) {
+						if constexpr ( AnyHit )
+							return true;
+						found = true;
+					}
+				}
+
+				if ( stackSize == 0 )
+					break;
+				node = &m_nodeView[stack[--stackSize]];
+				continue;
+			}
+
+			uint32_t nearIdx{ node->leftFirst };
+			uint32_t farIdx{ node->leftFirst + 1 };
+			float nearDist{ IntersectAABB( m_nodeView[nearIdx].bounds, ray.origin, rcpDir, ray.tMin, hit.t ) };
+			float farDist{ IntersectAABB( m_nodeView[farIdx].bounds, ray.origin, rcpDir, ray.tMin, hit.t ) };
+			if ( nearDist > farDist ) {
+				std::swap( nearDist, farDist );
+				std::swap( nearIdx, farIdx );
+			}
+
+			if ( nearDist == FLT_MAX ) {
+				if ( stackSize == 0 )
+					break;
+				node = &m_nodeView[stack[--stackSize]];
+				continue;
+			}
+
+			node = &m_nodeView[nearIdx];
+			if ( farDist != FLT_MAX )
+				stack[stackSize++] = farIdx;
+		}
+		return found;
+	}
+
+	template <unsigned N>
+	void BVH::IntersectPacket( RayPacket<N>& packet, PacketStats* stats ) const {
+		if ( m_nodeView.empty() )
+			return;
+
+		PacketContext<N> ctx{};
+		SetupPacket( packet, ctx );
+		PacketStats localStats{};
+		localStats.packets = 1;
+
+		// Incoherent packets gain nothing from shared node tests.
+		if ( !ctx.coherent ) {
+			localStats.incoherent = 1;
+			for ( unsigned lane{}; lane < N; ++lane ) {
+				Hit hit{ packet.tMax[lane] };
+				if ( IntersectFromNode<false>( 0, LaneToRay( packet, lane ), hit ) )
+					StoreLaneHit( packet, lane, hit );
+			}
+			if ( stats )
+				*stats += localStats;
+			return;
+		}
+
+		// Every entry keeps the first lane group that may still hit the node (Wald's first-active method).
+		struct StackEntry {
+			uint32_t node;
+			uint32_t firstGroup;
+		};
+		// Popping a node leaves at most one entry per level above it, its children make one more than its level.
+		StackEntry stack[MaxBVHDepth];
+		uint32_t stackSize{};
+		stack[stackSize++] = { 0, 0 };
+
+		while ( stackSize > 0 ) {
+			const StackEntry entry{ stack[--stackSize] };
+			const BVHNode& node{ m_nodeView[entry.node] };
+
+			float maxTMax{};
+			for ( unsigned lane{ entry.firstGroup * 4 }; lane < N; ++lane )
+				maxTMax = std::max( maxTMax, packet.tMax[lane] );
+
+			if ( !FrustumOverlaps( node.bounds, ctx, packet.tMin, maxTMax ) ) {
+				localStats.frustumCulled++;
+				continue;
+			}
+
+			uint32_t group{ entry.firstGroup };
+			int mask{};
+			for ( ; group < ctx.groups; ++group ) {
+				mask = IntersectAABB4( node.bounds, packet, ctx, group );
+				if ( mask )
+					break;
+			}
+			if ( group == ctx.groups )
+				continue;
+
+			// A single active lane left: finish the sub-tree with the cheaper single-ray traversal.
+			if ( group == ctx.groups - 1 && PopCount4( mask ) == 1 ) {
+				const unsigned lane{ group * 4 + LowestBit4( mask ) };
+				Hit hit{ packet.tMax[lane] };
+				if ( IntersectFromNode<false>( entry.node, LaneToRay( packet, lane ), hit ) )
+					StoreLaneHit( packet, lane, hit );
+				localStats.laneFallbacks++;
+				continue;
+			}
+
+			if ( node.IsLeaf() ) {
+				for ( uint32_t i{}; i < node.triCount; ++i ) {
+					const Triangle& tri{ m_triangleView[node.leftFirst + i] };
+					for ( unsigned g{ group }; g < ctx.groups; ++g )
+						IntersectTriangle4( tri, packet, g );
+				}
+				continue;
+			}
+
+			// Order children along the axis that separates them the most, using the shared direction sign.
+			const BVHNode& left{ m_nodeView[node.leftFirst] };
+			const BVHNode& right{ m_nodeView[node.leftFirst + 1] };
+			int axis{};
+			float bestSeparation{ -1.f };
+			for ( int a{}; a < 3; ++a ) {
+				const float separation{ std::abs(
+					(Component( right.bounds.min, a ) + Component( right.bounds.max, a )) -
+					(Component( left.bounds.min, a ) + Component( left.bounds.max, a )) ) };
+				if ( separation > bestSeparation ) {
+					bestSeparation = separation;
+					axis = a;
+				}
+			}
+			const bool rightIsAhead{
+				Component( right.bounds.min, axis ) + Component( right.bounds.max, axis ) >=
+				Component( left.bounds.min, axis ) + Component( left.bounds.max, axis ) };
+			const bool leftFirst{ rightIsAhead != ctx.dirNegative[axis] };
+
+			// Far child is pushed first so the near child is popped next.
+			const uint32_t nearIdx{ leftFirst ? node.leftFirst : node.leftFirst + 1 };
+			const uint32_t farIdx{ leftFirst ? node.leftFirst + 1 : node.leftFirst };
+			stack[stackSize++] = { farIdx, group };
+			stack[stackSize++] = { nearIdx, group };
+		}
+
+		if ( stats )
+			*stats += localStats;
+	}
+
+	template void BVH::IntersectPacket<4>( RayPacket<4>&, PacketStats* ) const;
+	template void BVH::IntersectPacket<8>( RayPacket<8>&, PacketStats* ) const;
+	template void BVH::IntersectPacket<16>( RayPacket<16>&, PacketStats* ) const;
+
+	std::span<const BVHNode> BVH::GetNodes() const {
+		return m_nodeView;
+	}
+
+	std::span<const Triangle> BVH::GetTriangles() const {
+		return m_triangleView;
+	}
+
+	AABB BVH::GetBounds() const {
+		return m_nodeView.empty() ? AABB{} : m_nodeView[0].bounds;
+	}
+
+	size_t BVH::GetMemoryUsage() const {
+		return m_nodeView.size() * sizeof( BVHNode ) + m_triangleView.size() * sizeof( Triangle ) +
+			m_triIndexView.size() * sizeof( uint32_t );
+	}
+}
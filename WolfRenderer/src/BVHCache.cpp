@@ -0,0 +1,261 @@
+#include "BVH.hpp" // BVH, BVHNode, Triangle, BVHBuildSettings, MaxBVHDepth
+
+#include <algorithm> // max
+#include <bit> // rotl
+#include <cstring> // memcpy, memcmp
+#include <fstream> // ofstream
+#include <system_error> // error_code
+
+
+namespace CPU {
+	namespace {
+		/// Bump whenever the file layout or the builder output changes.
+		constexpr uint32_t CacheVersion{ 2 };
+		constexpr char CacheMagic[8]{ 'W', 'O', 'L', 'F', 'B', 'V', 'H', '\0' };
+		/// Sections start on cache line boundaries, which also satisfies the alignment of every stored type.
+		constexpr uint64_t SectionAlignment{ 64 };
+
+		/// Byte range of one array in the file. Offsets are relative to the start of the file.
+		struct CacheSection {
+			uint64_t offset;
+			uint64_t count;
+		};
+
+		/// Start of every cache file. All fields are little-endian, like every platform the renderer runs on.
+		struct CacheHeader {
+			char magic[8];
+			uint32_t version;
+			uint32_t headerSize; ///< sizeof( CacheHeader ), catches layout changes without a version bump.
+			uint64_t key; ///< BVH::ComputeCacheKey of the scene and settings the file was built from.
+			uint32_t nodeSize; ///< sizeof( BVHNode ) of the writer.
+			uint32_t triangleSize; ///< sizeof( Triangle ) of the writer.
+			uint32_t depth; ///< Levels of the hierarchy, the root being the first. At most MaxBVHDepth.
+			uint32_t padding;
+			CacheSection nodes;
+			CacheSection triangles;
+			CacheSection triIndices; ///< Scene-wide triangle of every leaf slot, checked against the triangles on load.
+		};
+
+		uint64_t AlignUp( uint64_t value ) {
+			return (value + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+		}
+
+		/// Word-at-a-time 64-bit hash, finalized with the MurmurHash3 mixer.
+		/// Not cryptographic, it only has to tell scenes apart.
+		class Hasher {
+		public:
+			void Add( uint64_t word ) {
+				m_state = std::rotl( m_state ^ (word * 0x87C37B91114253D5ull), 31 ) * 0x4CF5AD432745937Full;
+			}
+
+			void Add( float value ) {
+				uint32_t bits;
+				std::memcpy( &bits, &value, sizeof( bits ) );
+				Add( static_cast<uint64_t>(bits) );
+			}
+
+			/// Hashes pairs of 32-bit values as one word.
+			void Add( const uint32_t* values, size_t count ) {
+				size_t i{};
+				for ( ; i + 1 < count; i += 2 )
+					Add( static_cast<uint64_t>(values[i]) | (static_cast<uint64_t>(values[i + 1]) << 32) );
+				if ( i < count )
+					Add( static_cast<uint64_t>(values[i]) );
+			}
+
+			uint64_t Finish() const {
+				uint64_t h{ m_state };
+				h ^= h >> 33;
+				h *= 0xFF51AFD7ED558CCDull;
+				h ^= h >> 33;
+				h *= 0xC4CEB9FE1A85EC53ull;
+				h ^= h >> 33;
+				return h;
+			}
+		private:
+			uint64_t m_state{ 0x9E3779B97F4A7C15ull };
+		};
+
+		/// Whether the section lies inside the file, is aligned and holds count elements of the given size.
+		bool IsValidSection( const CacheSection& section, uint64_t elementSize, uint64_t fileSize ) {
+			if ( section.offset % SectionAlignment != 0 || section.offset > fileSize )
+				return false;
+			return section.count <= (fileSize - section.offset) / elementSize;
+		}
+
+		/// Levels of the hierarchy, the root being the first. Children have to be stored after their parents.
+		/// A node referenced from several parents counts at its deepest.
+		uint32_t TreeDepth( std::span<const BVHNode> nodes ) {
+			std::vector<uint32_t> levels( nodes.size() );
+			levels[0] = 1;
+			uint32_t depth{ 1 };
+			for ( size_t i{}; i < nodes.size(); ++i ) {
+				if ( levels[i] == 0 || nodes[i].IsLeaf() )
+					continue;
+				for ( uint32_t child{ nodes[i].leftFirst }; child < nodes[i].leftFirst + 2; ++child )
+					levels[child] = std::max( levels[child], levels[i] + 1 );
+				depth = std::max( depth, levels[i] + 1 );
+			}
+			return depth;
+		}
+
+		template <typename T>
+		std::span<const T> SectionView( std::span<const std::byte> data, const CacheSection& section ) {
+			return { reinterpret_cast<const T*>(data.data() + section.offset), static_cast<size_t>(section.count) };
+		}
+
+		template <typename T>
+		bool WriteSection( std::ofstream& file, std::span<const T> values, uint64_t offset ) {
+			const std::streamoff position{ file.tellp() };
+			if ( position < 0 || static_cast<uint64_t>(position) > offset )
+				return false;
+			const char zeros[SectionAlignment]{};
+			file.write( zeros, static_cast<std::streamsize>(offset - static_cast<uint64_t>(position)) );
+			file.write( reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()) );
+			return file.good();
+		}
+	}
+
+	uint64_t BVH::ComputeCacheKey( const std::vector<Mesh>& meshes, const BVHBuildSettings& settings ) {
+		Hasher hasher{};
+		hasher.Add( static_cast<uint64_t>(CacheVersion) );
+		hasher.Add( static_cast<uint64_t>(settings.maxLeafSize) );
+		hasher.Add( static_cast<uint64_t>(settings.binCount) );
+		hasher.Add( settings.traversalCost );
+		hasher.Add( settings.intersectionCost );
+		hasher.Add( static_cast<uint64_t>(settings.spatialSplits) );
+		hasher.Add( settings.spatialSplitAlpha );
+		hasher.Add( static_cast<uint64_t>(settings.preSplit) );
+		hasher.Add( settings.preSplitRatio );
+		hasher.Add( settings.referenceBudget );
+
+		// Sizes separate the meshes, so moving a triangle from one mesh to the next changes the key.
+		hasher.Add( static_cast<uint64_t>(meshes.size()) );
+		for ( const Mesh& mesh : meshes ) {
+			hasher.Add( static_cast<uint64_t>(mesh.vertices.size()) );
+			for ( const Vertex& vertex : mesh.vertices ) {
+				uint32_t bits[3];
+				std::memcpy( bits, &vertex.position, sizeof( bits ) );
+				hasher.Add( bits, 3 );
+			}
+			hasher.Add( static_cast<uint64_t>(mesh.indices.size()) );
+			hasher.Add( mesh.indices.data(), mesh.indices.size() );
+		}
+		return hasher.Finish();
+	}
+
+	bool BVH::SaveCache( const std::filesystem::path& path, uint64_t key ) const {
+		if ( m_nodeView.empty() )
+			return false;
+
+		CacheHeader header{};
+		std::memcpy( header.magic, CacheMagic, sizeof( CacheMagic ) );
+		header.version = CacheVersion;
+		header.headerSize = sizeof( CacheHeader );
+		header.key = key;
+		header.nodeSize = sizeof( BVHNode );
+		header.triangleSize = sizeof( Triangle );
+		header.depth = TreeDepth( m_nodeView );
+		header.nodes = { AlignUp( sizeof( CacheHeader ) ), m_nodeView.size() };
+		header.triangles = { AlignUp( header.nodes.offset + m_nodeView.size_bytes() ), m_triangleView.size() };
+		header.triIndices = { AlignUp( header.triangles.offset + m_triangleView.size_bytes() ), m_triIndexView.size() };
+
+		std::error_code error{};
+		if ( path.has_parent_path() )
+			std::filesystem::create_directories( path.parent_path(), error );
+
+		std::filesystem::path tempPath{ path };
+		tempPath += ".tmp";
+		{
+			std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+			if ( !file.is_open() )
+				return false;
+			file.write( reinterpret_cast<const char*>(&header), sizeof( header ) );
+			const bool written{
+				WriteSection( file, m_nodeView, header.nodes.offset ) &&
+				WriteSection( file, m_triangleView, header.triangles.offset ) &&
+				WriteSection( file, m_triIndexView, header.triIndices.offset ) };
+			file.close();
+			if ( !written || file.fail() ) {
+				std::filesystem::remove( tempPath, error );
+				return false;
+			}
+		}
+
+		// Fails on Windows while another process still maps the old file. The cache is then just not updated.
+		std::filesystem::rename( tempPath, path, error );
+		if ( error ) {
+			std::filesystem::remove( tempPath, error );
+			return false;
+		}
+		return true;
+	}
+
+	bool BVH::LoadCache( const std::filesystem::path& path, uint64_t key, const std::vector<Mesh>& meshes ) {
+		Clear();
+
+		std::unique_ptr<MappedFile> file{ std::make_unique<MappedFile>() };
+		if ( !file->Open( path ) )
+			return false;
+
+		const std::span<const std::byte> data{ file->GetData() };
+		if ( data.size() < sizeof( CacheHeader ) )
+			return false;
+
+		CacheHeader header;
+		std::memcpy( &header, data.data(), sizeof( header ) );
+		if ( std::memcmp( header.magic, CacheMagic, sizeof( CacheMagic ) ) != 0 ||
+			header.version != CacheVersion || header.headerSize != sizeof( CacheHeader ) ||
+			header.key != key || header.nodeSize != sizeof( BVHNode ) || header.triangleSize != sizeof( Triangle ) ||
+			header.depth > MaxBVHDepth )
+			return false;
+
+		const uint64_t fileSize{ data.size() };
+		if ( !IsValidSection( header.nodes, sizeof( BVHNode ), fileSize ) ||
+			!IsValidSection( header.triangles, sizeof( Triangle ), fileSize ) ||
+			!IsValidSection( header.triIndices, sizeof( uint32_t ), fileSize ) ||
+			header.nodes.count == 0 || header.triangles.count != header.triIndices.count )
+			return false;
+
+		const std::span<const BVHNode> nodes{ SectionView<BVHNode>( data, header.nodes ) };
+
+		// A matching key does not protect against a truncated or damaged file. Children are always
+		// stored after their parent, so these checks also rule out cycles. Traversal never leaves the mapping.
+		for ( size_t i{}; i < nodes.size(); ++i ) {
+			const BVHNode& node{ nodes[i] };
+			const bool valid{ node.IsLeaf() ?
+				static_cast<uint64_t>(node.leftFirst) + node.triCount <= header.triangles.count :
+				node.leftFirst > i && static_cast<uint64_t>(node.leftFirst) + 1 < nodes.size() };
+			if ( !valid )
+				return false;
+		}
+		// Deeper trees would overflow the fixed-size traversal stacks.
+		if ( TreeDepth( nodes ) != header.depth )
+			return false;
+
+		// Hits index the meshes with the triangles' instance and primitive indices. Every leaf slot has to name a
+		// triangle of the scene, the same one its scene-wide index does.
+		std::vector<uint64_t> firstTriangles( meshes.size() + 1 );
+		for ( size_t mesh{}; mesh < meshes.size(); ++mesh )
+			firstTriangles[mesh + 1] = firstTriangles[mesh] + meshes[mesh].indices.size() / 3;
+		const std::span<const Triangle> triangles{ SectionView<Triangle>( data, header.triangles ) };
+		const std::span<const uint32_t> triIndices{ SectionView<uint32_t>( data, header.triIndices ) };
+		for ( size_t i{}; i < triangles.size(); ++i ) {
+			const Triangle& triangle{ triangles[i] };
+			if ( triangle.instanceIdx >= meshes.size() ||
+				triangle.primIdx >= firstTriangles[triangle.instanceIdx + 1] - firstTriangles[triangle.instanceIdx] ||
+				triIndices[i] != firstTriangles[triangle.instanceIdx] + triangle.primIdx )
+				return false;
+		}
+
+		m_nodeView = nodes;
+		m_triangleView = triangles;
+		m_triIndexView = triIndices;
+		m_cacheFile = std::move( file );
+		return true;
+	}
+
+	bool BVH::IsFromCache() const {
+		return m_cacheFile != nullptr;
+	}
+}
@@ -0,0 +1,1915 @@
+#include "Benchmark.hpp"
+
+#include <algorithm> // max, min, find
+#include <bit> // bit_width
+#include <cfloat> // FLT_MAX, DBL_MAX
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // tanf, sinf, cosf, sqrt, pow
+#include <cstdlib> // strtoul
+#include <cstring> // strcmp
+#include <filesystem> // path, temp_directory_path, remove_all, directory_iterator
+#include <format> // format
+#include <iostream> // cout
+#include <random> // mt19937, uniform_real_distribution
+#include <thread> // hardware_concurrency
+
+#include "ClusterCuller.hpp" // ClusterCuller, ClusterStats, IndexRange
+#include "CPUTracer.hpp" // Tracer, TraversalMode, BucketOrder, Integrator, LightSampling, FrameParams
+#include "FrustumCuller.hpp" // FrustumCuller
+#include "Geometry.hpp" // Mesh, Vertex, Light
+#include "Logger.hpp" // Logger, LogLevel
+#include "MeshClusters.hpp" // BuildClusters
+#include "MeshEdges.hpp" // BuildEdges
+#include "OcclusionCuller.hpp" // OcclusionCuller, OcclusionStats
+#include "QuantizedBVH.hpp" // QuantizedBVH
+#include "Rasterizer.hpp" // Rasterizer, RasterStats
+#include "RenderParams.hpp" // Raster::Data
+#include "Sampler.hpp" // SamplerType
+#include "Scene.hpp" // Scene
+#include "ThreadPool.hpp" // ThreadPool
+#include "WideBVH.hpp" // WideBVH, DetectSIMDWidth
+
+
+namespace CPU::Bench {
+	namespace {
+		/// Parses a scene with scene logging limited to errors.
+		void LoadScene( Scene& scene ) {
+			scene.log.SetMinLevel( LogLevel::Error );
+			scene.ParseSceneFile();
+		}
+
+		unsigned RenderWidth( const Scene& scene ) {
+			return scene.settings.renderWidth ? scene.settings.renderWidth : 800;
+		}
+
+		unsigned RenderHeight( const Scene& scene ) {
+			return scene.settings.renderHeight ? scene.settings.renderHeight : 800;
+		}
+
+		/// Renders one warm-up frame and returns the fastest of the timed frames.
+		double BestFrameMs( Tracer& tracer, const FrameParams& params,
+			unsigned width, unsigned height, unsigned iterations ) {
+			tracer.RenderFrame( params, width, height );
+			double bestMs{ tracer.GetStats().renderMs };
+			for ( unsigned i{}; i < iterations; ++i ) {
+				tracer.RenderFrame( params, width, height );
+				bestMs = std::min( bestMs, tracer.GetStats().renderMs );
+			}
+			return bestMs;
+		}
+
+		/// Builds a displaced grid in the XY plane with about the requested number of triangles.
+		/// Dense, mostly flat geometry stresses the precision of quantized child bounds.
+		Mesh SyntheticTerrain( uint32_t triangleCount ) {
+			const uint32_t cells{ std::max( 1u, static_cast<uint32_t>(std::sqrt( triangleCount / 2.0 )) ) };
+			const uint32_t side{ cells + 1 };
+			constexpr float extent{ 100.f };
+			const float step{ extent / cells };
+
+			Mesh mesh{};
+			mesh.name = "SyntheticTerrain";
+			mesh.vertices.reserve( static_cast<size_t>(side) * side );
+			for ( uint32_t y{}; y < side; ++y ) {
+				for ( uint32_t x{}; x < side; ++x ) {
+					const float px{ x * step - extent * 0.5f };
+					const float py{ y * step - extent * 0.5f };
+					const float pz{ 3.f * std::sinf( px * 0.37f ) * std::cosf( py * 0.23f ) + 0.5f * std::sinf( px * py * 0.01f ) };
+					mesh.vertices.push_back( { { px, py, pz }, { 0.f, 0.f, 1.f } } );
+				}
+			}
+
+			mesh.indices.reserve( static_cast<size_t>(cells) * cells * 6 );
+			for ( uint32_t y{}; y < cells; ++y ) {
+				for ( uint32_t x{}; x < cells; ++x ) {
+					const uint32_t i0{ y * side + x };
+					mesh.indices.insert( mesh.indices.end(), { i0, i0 + 1, i0 + side, i0 + 1, i0 + side + 1, i0 + side } );
+				}
+			}
+			return mesh;
+		}
+
+		/// Builds small random triangles in a cube, crossed by long, thin slivers spanning it along X.
+		/// The sliver boxes inflate every node they end up in, the worst case for object splits.
+		Mesh SyntheticSlivers( uint32_t triangleCount ) {
+			std::mt19937 rng{ 1234 };
+			std::uniform_real_distribution<float> position{ -50.f, 50.f };
+			std::uniform_real_distribution<float> offset{ -1.f, 1.f };
+			const uint32_t sliverCount{ std::min( triangleCount, std::max( 16u, triangleCount / 100 ) ) };
+
+			Mesh mesh{};
+			mesh.name = "SyntheticSlivers";
+			auto addTriangle = [&mesh]( const DirectX::XMFLOAT3& p0, const DirectX::XMFLOAT3& p1,
+				const DirectX::XMFLOAT3& p2 ) {
+				const uint32_t base{ static_cast<uint32_t>(mesh.vertices.size()) };
+				for ( const DirectX::XMFLOAT3& p : { p0, p1, p2 } )
+					mesh.vertices.push_back( { p, { 0.f, 0.f, 1.f } } );
+				mesh.indices.insert( mesh.indices.end(), { base, base + 1, base + 2 } );
+			};
+
+			for ( uint32_t i{ sliverCount }; i < triangleCount; ++i ) {
+				const DirectX::XMFLOAT3 p{ position( rng ), position( rng ), position( rng ) };
+				addTriangle( p, { p.x + offset( rng ), p.y + offset( rng ), p.z + offset( rng ) },
+					{ p.x + offset( rng ), p.y + offset( rng ), p.z + offset( rng ) } );
+			}
+
+			for ( uint32_t i{}; i < sliverCount; ++i ) {
+				const DirectX::XMFLOAT3 start{ -50.f, position( rng ), position( rng ) };
+				const DirectX::XMFLOAT3 end{ 50.f, position( rng ), position( rng ) };
+				addTriangle( start, end, { start.x, start.y + 0.1f, start.z } );
+			}
+			return mesh;
+		}
+
+		/// Builds a wall facing -Z in front of a grid of cubes, every cube its own mesh. The grid is wider than the wall,
+		/// so the cubes around it stay visible. An interior in miniature for occlusion culling.
+		std::vector<Mesh> SyntheticOccluders( uint32_t cubesPerSide ) {
+			std::vector<Mesh> meshes;
+			const auto addQuad = []( Mesh& mesh, const DirectX::XMFLOAT3 ( &corners )[4], const DirectX::XMFLOAT3& normal ) {
+				const uint32_t base{ static_cast<uint32_t>(mesh.vertices.size()) };
+				for ( const DirectX::XMFLOAT3& corner : corners )
+					mesh.vertices.push_back( { corner, normal } );
+				// Front faces are clockwise seen from outside, cross( p1 - p0, p2 - p0 ) pointing along the normal.
+				const DirectX::XMFLOAT3& p0{ corners[0] };
+				const DirectX::XMFLOAT3& p1{ corners[1] };
+				const DirectX::XMFLOAT3& p2{ corners[2] };
+				const DirectX::XMFLOAT3 e1{ p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+				const DirectX::XMFLOAT3 e2{ p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+				const DirectX::XMFLOAT3 cross{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+				if ( cross.x * normal.x + cross.y * normal.y + cross.z * normal.z > 0.f )
+					mesh.indices.insert( mesh.indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 } );
+				else
+					mesh.indices.insert( mesh.indices.end(), { base, base + 2, base + 1, base, base + 3, base + 2 } );
+			};
+
+			Mesh& wall{ meshes.emplace_back() };
+			wall.name = "Wall";
+			addQuad( wall, { { -10.f, -10.f, 0.f }, { -10.f, 10.f, 0.f }, { 10.f, 10.f, 0.f }, { 10.f, -10.f, 0.f } }, { 0.f, 0.f, -1.f } );
+
+			const float spacing{ 30.f / std::max( cubesPerSide, 1u ) };
+			for ( uint32_t y{}; y < cubesPerSide; ++y )
+				for ( uint32_t x{}; x < cubesPerSide; ++x ) {
+					const DirectX::XMFLOAT3 center{ -15.f + (x + 0.5f) * spacing, -15.f + (y + 0.5f) * spacing, 5.f + (x + y) % 4 * 3.f };
+					const float half{ spacing * 0.3f };
+					Mesh& cube{ meshes.emplace_back() };
+					cube.name = "Cube";
+					for ( int axis{}; axis < 3; ++axis )
+						for ( const float side : { -1.f, 1.f } ) {
+							// The two other axes span the face.
+							const int u{ (axis + 1) % 3 };
+							const int v{ (axis + 2) % 3 };
+							DirectX::XMFLOAT3 corners[4];
+							for ( int corner{}; corner < 4; ++corner ) {
+								float p[3]{ center.x, center.y, center.z };
+								p[axis] += side * half;
+								p[u] += (corner == 1 || corner == 2 ? half : -half);
+								p[v] += (corner >= 2 ? half : -half);
+								corners[corner] = { p[0], p[1], p[2] };
+							}
+							float n[3]{};
+							n[axis] = side;
+							addQuad( cube, corners, { n[0], n[1], n[2] } );
+						}
+				}
+			return meshes;
+		}
+
+		size_t CountMismatches( const std::vector<uint32_t>& frame, const std::vector<uint32_t>& reference ) {
+			if ( frame.size() != reference.size() )
+				return frame.size();
+
+			size_t mismatches{};
+			for ( size_t i{}; i < frame.size(); ++i )
+				mismatches += frame[i] != reference[i];
+			return mismatches;
+		}
+
+		/// Pixels with a channel differing from the reference by more than a tolerance, for frames shaded from the same
+		/// attributes interpolated differently.
+		size_t CountMismatches( const std::vector<uint32_t>& frame, const std::vector<uint32_t>& reference, unsigned tolerance ) {
+			if ( frame.size() != reference.size() )
+				return frame.size();
+
+			size_t mismatches{};
+			for ( size_t i{}; i < frame.size(); ++i ) {
+				bool mismatch{ false };
+				for ( unsigned shift{}; shift < 32; shift += 8 ) {
+					const int difference{ static_cast<int>((frame[i] >> shift) & 0xFF) - static_cast<int>((reference[i] >> shift) & 0xFF) };
+					mismatch |= static_cast<unsigned>(std::abs( difference )) > tolerance;
+				}
+				mismatches += mismatch;
+			}
+			return mismatches;
+		}
+
+		/// Average of all channels of a frame, in [0, 1].
+		double MeanIntensity( const std::vector<uint32_t>& frame ) {
+			double sum{};
+			for ( const uint32_t pixel : frame )
+				sum += (pixel & 0xFF) + ((pixel >> 8) & 0xFF) + ((pixel >> 16) & 0xFF);
+			return frame.empty() ? 0.0 : sum / (frame.size() * 3.0 * 255.0);
+		}
+
+		/// Root mean square difference of all channels of two frames, in [0, 1].
+		double RootMeanSquareError( const std::vector<uint32_t>& frame, const std::vector<uint32_t>& reference ) {
+			if ( frame.size() != reference.size() || frame.empty() )
+				return 1.0;
+
+			double sum{};
+			for ( size_t i{}; i < frame.size(); ++i )
+				for ( unsigned shift{}; shift < 24; shift += 8 ) {
+					const double difference{ static_cast<double>((frame[i] >> shift) & 0xFF) - ((reference[i] >> shift) & 0xFF) };
+					sum += difference * difference;
+				}
+			return std::sqrt( sum / (frame.size() * 3.0) ) / 255.0;
+		}
+
+		/// Raster mode data looking at the scene bounds like the GUI camera: from -Z, through a reverse-Z projection.
+		Raster::Data FramingRasterData( const std::vector<Mesh>& meshes, float aspectRatio ) {
+			AABB bounds{};
+			for ( const Mesh& mesh : meshes )
+				for ( const Vertex& vertex : mesh.vertices )
+					bounds.Grow( vertex.position );
+
+			Raster::Data data{};
+			Raster::Transformation& tr{ data.camera };
+			tr.aspectRatio = aspectRatio;
+			DirectX::XMMATRIX world{ DirectX::XMMatrixTranslation( 0.f, 0.f, tr.offsetZ ) };
+			if ( !bounds.IsEmpty() ) {
+				const float halfX{ (bounds.max.x - bounds.min.x) * 0.5f };
+				const float halfY{ (bounds.max.y - bounds.min.y) * 0.5f };
+				const float halfZ{ (bounds.max.z - bounds.min.z) * 0.5f };
+				const float tanHalfFOV{ std::tanf( tr.FOVAngle * 0.5f ) };
+				const float fitDistance{ std::max( halfY / tanHalfFOV, halfX / (tanHalfFOV * aspectRatio) ) };
+				world = DirectX::XMMatrixTranslation( -(bounds.min.x + halfX), -(bounds.min.y + halfY),
+					-(bounds.min.z + halfZ) + halfZ + fitDistance * 1.1f );
+			}
+			const DirectX::XMMATRIX view{ DirectX::XMMatrixLookAtLH(
+				DirectX::XMVectorSet( 0.f, 0.f, -1.f, 1.f ), DirectX::XMVectorZero(), DirectX::XMVectorSet( 0.f, 1.f, 0.f, 0.f ) ) };
+			const DirectX::XMMATRIX projection{ DirectX::XMMatrixPerspectiveFovLH( tr.FOVAngle, aspectRatio, tr.farZ, tr.nearZ ) };
+			DirectX::XMStoreFloat4x4( &tr.cbData.mat, DirectX::XMMatrixTranspose( world * view ) );
+			DirectX::XMStoreFloat4x4( &tr.cbData.projection, DirectX::XMMatrixTranspose( projection ) );
+
+			DirectX::XMStoreFloat4x4( &tr.viewMatrix, DirectX::XMMatrixTranspose( view ) );
+			const DirectX::XMFLOAT3& directionWS{ data.directionalLight.directionWS };
+			DirectX::XMStoreFloat3( &data.directionalLight.cb.directionVS, DirectX::XMVector3Normalize( DirectX::XMVector3TransformNormal(
+				DirectX::XMVector3Normalize( DirectX::XMLoadFloat3( &directionWS ) ), DirectX::XMLoadFloat4x4( &tr.viewMatrix ) ) ) );
+			return data;
+		}
+	}
+
+	RT::CameraCB FramingCamera( const AABB& bounds, float aspectRatio ) {
+		RT::CameraCB camera{};
+		camera.verticalFOV = DirectX::XMConvertToRadians( 60.f );
+		camera.aspectRatio = aspectRatio;
+		camera.cameraForward = { 0.f, 0.f, -1.f };
+		camera.cameraRight = { 1.f, 0.f, 0.f };
+		camera.cameraUp = { 0.f, 1.f, 0.f };
+		camera.forwardMult = 1;
+
+		if ( bounds.IsEmpty() ) {
+			camera.cameraPosition = { 0.f, 0.f, 35.f };
+			return camera;
+		}
+
+		const DirectX::XMFLOAT3 center{
+			(bounds.min.x + bounds.max.x) * 0.5f,
+			(bounds.min.y + bounds.max.y) * 0.5f,
+			(bounds.min.z + bounds.max.z) * 0.5f };
+		const float halfX{ (bounds.max.x - bounds.min.x) * 0.5f };
+		const float halfY{ (bounds.max.y - bounds.min.y) * 0.5f };
+		const float halfZ{ (bounds.max.z - bounds.min.z) * 0.5f };
+
+		// Distance at which both the width and the height fit the view, with a small margin.
+		const float tanHalfFOV{ std::tanf( camera.verticalFOV * 0.5f ) };
+		const float fitDistance{ std::max( halfY / tanHalfFOV, halfX / (tanHalfFOV * aspectRatio) ) };
+		camera.cameraPosition = { center.x, center.y, center.z + halfZ + fitDistance * 1.1f + 0.01f };
+		return camera;
+	}
+
+	void PacketTraversal( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr TraversalMode modes[]{
+			TraversalMode::SingleRay, TraversalMode::Packet4, TraversalMode::Packet8, TraversalMode::Packet16 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			// Every timed frame traces, instead of re-shading the visibility buffer of the previous one.
+			tracer.visibilityBuffer = false;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)",
+				scenePath, width, height, tracer.GetBVH().GetTriangles().size() ), LogLevel::Info );
+
+			std::vector<uint32_t> reference;
+			double singleRayMs{};
+			for ( TraversalMode mode : modes ) {
+				tracer.traversalMode = mode;
+				const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+
+				const std::vector<uint32_t>& frame{ tracer.GetFrameBuffer() };
+				if ( mode == TraversalMode::SingleRay ) {
+					reference = frame;
+					singleRayMs = bestMs;
+				}
+
+				const PacketStats& stats{ tracer.GetStats().packetStats };
+				log( std::format( "[ Benchmark ]   {:<16} {:8.2f} ms {:8.2f} MRays/s  x{:.2f}  "
+					"incoherent {} / {}, frustum culled {}, lane fallbacks {}, mismatching pixels {}",
+					ToString( mode ), bestMs, tracer.GetStats().rays / (bestMs * 1000.0),
+					singleRayMs / bestMs, stats.incoherent, stats.packets, stats.frustumCulled,
+					stats.laneFallbacks, CountMismatches( frame, reference ) ), LogLevel::Info );
+			}
+		}
+	}
+
+	void WideTraversal( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		log( std::format( "[ Benchmark ] Detected SIMD width: {}.", DetectSIMDWidth() ), LogLevel::Info );
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			// Every timed frame traces, instead of re-shading the visibility buffer of the previous one.
+			tracer.visibilityBuffer = false;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)",
+				scenePath, width, height, tracer.GetBVH().GetTriangles().size() ), LogLevel::Info );
+
+			tracer.traversalMode = TraversalMode::SingleRay;
+			const double binaryMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+			const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+			log( std::format( "[ Benchmark ]   BVH2 {:8} nodes {:8} KiB {:8.2f} ms {:8.2f} MRays/s",
+				tracer.GetBVH().GetNodes().size(), tracer.GetBVH().GetMemoryUsage() / 1024, binaryMs,
+				tracer.GetStats().rays / (binaryMs * 1000.0) ), LogLevel::Info );
+
+			tracer.traversalMode = TraversalMode::WideBVH;
+			for ( unsigned wideWidth : { 4u, 8u } ) {
+				tracer.wideBVHWidth = wideWidth;
+				tracer.BuildAccelerationStructure( scene.GetMeshes() );
+				const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+
+				const WideBVH& wide{ tracer.GetWideBVH() };
+				log( std::format( "[ Benchmark ]   BVH{} {:8} nodes {:8} KiB {:8.2f} ms {:8.2f} MRays/s  x{:.2f}  "
+					"mismatching pixels {}", wide.GetWidth(), wide.GetNodeCount(), wide.GetMemoryUsage() / 1024,
+					bestMs, tracer.GetStats().rays / (bestMs * 1000.0), binaryMs / bestMs,
+					CountMismatches( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+			}
+		}
+	}
+
+	void QuantizedTraversal( const std::vector<std::string>& scenePaths, uint32_t syntheticTriangles, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+
+		auto compare = [&]( const std::string& name, const std::vector<Mesh>& meshes, unsigned width,
+			unsigned height, unsigned frameIterations ) {
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( meshes );
+			// Every timed frame traces, instead of re-shading the visibility buffer of the previous one.
+			tracer.visibilityBuffer = false;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			// The first wide frame builds the wide and quantized BVHs.
+			tracer.traversalMode = TraversalMode::WideBVH;
+			const double wideMs{ BestFrameMs( tracer, params, width, height, frameIterations ) };
+			const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+
+			const WideBVH& wide{ tracer.GetWideBVH() };
+			const QuantizedBVH& quantized{ tracer.GetQuantizedBVH() };
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, BVH{})", name, width, height,
+				tracer.GetBVH().GetTriangles().size(), wide.GetWidth() ), LogLevel::Info );
+			if ( quantized.GetNodeCount() != wide.GetNodeCount() ) {
+				log( "[ Benchmark ]   Quantized BVH unavailable for this scene.", LogLevel::Warning );
+				return;
+			}
+
+			tracer.traversalMode = TraversalMode::QuantizedBVH;
+			const double quantizedMs{ BestFrameMs( tracer, params, width, height, frameIterations ) };
+
+			const size_t wideNodeBytes{ wide.GetNodeMemoryUsage() };
+			const size_t quantizedNodeBytes{ quantized.GetNodeMemoryUsage() };
+			const size_t blockBytes{ wide.GetMemoryUsage() - wideNodeBytes };
+			log( std::format( "[ Benchmark ]   nodes {:8} KiB -> {:8} KiB ({:.1f}% saved), "
+				"with triangles {:8} KiB -> {:8} KiB ({:.1f}% saved)",
+				wideNodeBytes / 1024, quantizedNodeBytes / 1024,
+				100.0 * (1.0 - static_cast<double>(quantizedNodeBytes) / wideNodeBytes),
+				(wideNodeBytes + blockBytes) / 1024, (quantizedNodeBytes + blockBytes) / 1024,
+				100.0 * (1.0 - static_cast<double>(quantizedNodeBytes + blockBytes) / (wideNodeBytes + blockBytes)) ),
+				LogLevel::Info );
+			log( std::format( "[ Benchmark ]   fp32 {:8.2f} ms, quantized {:8.2f} ms ({:+.1f}%), mismatching pixels {}",
+				wideMs, quantizedMs, 100.0 * (quantizedMs / wideMs - 1.0),
+				CountMismatches( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+		};
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			compare( scenePath, scene.GetMeshes(), RenderWidth( scene ), RenderHeight( scene ), iterations );
+		}
+
+		if ( syntheticTriangles > 0 ) {
+			const std::vector<Mesh> meshes{ SyntheticTerrain( syntheticTriangles ) };
+			// Large scenes take long to build and trace, one timed frame is enough.
+			compare( "Synthetic terrain", meshes, 1920, 1080, 1 );
+		}
+	}
+
+	void SpatialSplits( const std::vector<std::string>& scenePaths, uint32_t syntheticTriangles, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+
+		struct Variant {
+			const char* name;
+			bool spatialSplits;
+			bool preSplit;
+		};
+		constexpr Variant variants[]{
+			{ "SAH", false, false }, { "Pre-split", false, true },
+			{ "SBVH", true, false }, { "SBVH + pre-split", true, true } };
+
+		auto compare = [&]( const std::string& name, const std::vector<Mesh>& meshes, unsigned width,
+			unsigned height, unsigned frameIterations ) {
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			// Every timed frame traces, instead of re-shading the visibility buffer of the previous one.
+			tracer.visibilityBuffer = false;
+
+			FrameParams params{};
+			std::vector<uint32_t> reference;
+			double sahSingleMs{};
+			double sahWideMs{};
+			for ( const Variant& variant : variants ) {
+				tracer.bvhSettings.spatialSplits = variant.spatialSplits;
+				tracer.bvhSettings.preSplit = variant.preSplit;
+
+				const std::chrono::high_resolution_clock::time_point start{
+					std::chrono::high_resolution_clock::now() };
+				tracer.BuildAccelerationStructure( meshes );
+				const std::chrono::duration<double, std::milli> buildMs{
+					std::chrono::high_resolution_clock::now() - start };
+
+				const BVH& bvh{ tracer.GetBVH() };
+				if ( reference.empty() ) {
+					params.camera = FramingCamera( bvh.GetBounds(), static_cast<float>(width) / height );
+					log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)", name, width, height,
+						bvh.GetTriangles().size() ), LogLevel::Info );
+				}
+
+				tracer.traversalMode = TraversalMode::WideBVH;
+				const double wideMs{ BestFrameMs( tracer, params, width, height, frameIterations ) };
+				tracer.traversalMode = TraversalMode::SingleRay;
+				const double singleMs{ BestFrameMs( tracer, params, width, height, frameIterations ) };
+				if ( reference.empty() ) {
+					reference = tracer.GetFrameBuffer();
+					sahSingleMs = singleMs;
+					sahWideMs = wideMs;
+				}
+
+				log( std::format( "[ Benchmark ]   {:<16} {:8} refs {:8} nodes {:8} KiB build {:8.2f} ms  "
+					"BVH2 {:8.2f} ms x{:.2f}  BVH{} {:8.2f} ms x{:.2f}  mismatching pixels {}",
+					variant.name, bvh.GetTriangles().size(), bvh.GetNodes().size(), bvh.GetMemoryUsage() / 1024,
+					buildMs.count(), singleMs, sahSingleMs / singleMs, tracer.GetWideBVH().GetWidth(), wideMs,
+					sahWideMs / wideMs, CountMismatches( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+			}
+		};
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			compare( scenePath, scene.GetMeshes(), RenderWidth( scene ), RenderHeight( scene ), iterations );
+		}
+
+		if ( syntheticTriangles > 0 )
+			compare( "Synthetic slivers", { SyntheticSlivers( syntheticTriangles ) }, 1920, 1080, iterations );
+	}
+
+	void BVHCache( const std::vector<std::string>& scenePaths, uint32_t syntheticTriangles, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		const std::filesystem::path cacheDirectory{ std::filesystem::temp_directory_path() / "WolfRendererBVHCache" };
+		std::error_code error{};
+		std::filesystem::remove_all( cacheDirectory, error );
+
+		auto compare = [&]( const std::string& name, const std::vector<Mesh>& meshes, unsigned width, unsigned height ) {
+			// Time from the loaded meshes to the first finished frame, including the BVH build or load.
+			auto firstFrame = [&]( Tracer& tracer, double& bvhMs ) {
+				// Time tracing the frame, like the other traversal benchmarks.
+				tracer.visibilityBuffer = false;
+				const std::chrono::high_resolution_clock::time_point start{
+					std::chrono::high_resolution_clock::now() };
+				tracer.BuildAccelerationStructure( meshes );
+				bvhMs = std::chrono::duration<double, std::milli>{ std::chrono::high_resolution_clock::now() - start }.count();
+
+				FrameParams params{};
+				params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+				tracer.RenderFrame( params, width, height );
+				return std::chrono::duration<double, std::milli>{ std::chrono::high_resolution_clock::now() - start }.count();
+			};
+
+			Tracer cold{};
+			cold.log.SetMinLevel( LogLevel::Error );
+			cold.bvhCacheDirectory = cacheDirectory.string();
+			double coldBVHMs{};
+			const double coldMs{ firstFrame( cold, coldBVHMs ) };
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)", name, width, height,
+				cold.GetBVH().GetTriangles().size() ), LogLevel::Info );
+
+			// Every warm run starts from a fresh tracer, like a new launch of the application.
+			double warmBVHMs{ FLT_MAX };
+			double warmMs{ FLT_MAX };
+			bool fromCache{ true };
+			size_t mismatches{};
+			for ( unsigned i{}; i < std::max( iterations, 1u ); ++i ) {
+				Tracer warm{};
+				warm.log.SetMinLevel( LogLevel::Error );
+				warm.bvhCacheDirectory = cacheDirectory.string();
+				double bvhMs{};
+				warmMs = std::min( warmMs, firstFrame( warm, bvhMs ) );
+				warmBVHMs = std::min( warmBVHMs, bvhMs );
+				fromCache &= warm.GetBVH().IsFromCache();
+				mismatches = std::max( mismatches, CountMismatches( warm.GetFrameBuffer(), cold.GetFrameBuffer() ) );
+			}
+			if ( !fromCache )
+				log( "[ Benchmark ]   The BVH cache was not used, check that the cache directory is writable.",
+					LogLevel::Warning );
+
+			uintmax_t cacheBytes{};
+			for ( const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator( cacheDirectory, error ) )
+				cacheBytes = std::max( cacheBytes, entry.file_size( error ) );
+
+			log( std::format( "[ Benchmark ]   cold: BVH {:9.2f} ms, first frame {:9.2f} ms", coldBVHMs, coldMs ),
+				LogLevel::Info );
+			log( std::format( "[ Benchmark ]   warm: BVH {:9.2f} ms, first frame {:9.2f} ms  x{:.1f}  "
+				"cache file {} KiB, mismatching pixels {}", warmBVHMs, warmMs, coldMs / warmMs, cacheBytes / 1024,
+				mismatches ), LogLevel::Info );
+
+			// Keep one scene in the cache at a time, so the file size above belongs to this scene.
+			std::filesystem::remove_all( cacheDirectory, error );
+		};
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			compare( scenePath, scene.GetMeshes(), RenderWidth( scene ), RenderHeight( scene ) );
+		}
+
+		if ( syntheticTriangles > 0 )
+			compare( "Synthetic terrain", { SyntheticTerrain( syntheticTriangles ) }, 1920, 1080 );
+	}
+
+	void BucketScheduling( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr BucketOrder orders[]{ BucketOrder::Scanline, BucketOrder::Hilbert, BucketOrder::Spiral };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			// Every timed frame traces, instead of re-shading the visibility buffer of the previous one.
+			tracer.visibilityBuffer = false;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			std::vector<unsigned> sizes{ 8, 16, 32, 64 };
+			if ( scene.settings.bucketSize && std::find( sizes.begin(), sizes.end(), scene.settings.bucketSize ) == sizes.end() )
+				sizes.insert( sizes.begin(), scene.settings.bucketSize );
+			// 0 is the auto-tuned size.
+			sizes.push_back( 0 );
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, scene bucket size {})", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), scene.settings.bucketSize ), LogLevel::Info );
+
+			std::vector<uint32_t> reference;
+			for ( BucketOrder order : orders ) {
+				tracer.bucketOrder = order;
+				for ( unsigned size : sizes ) {
+					tracer.bucketSize = size;
+					if ( size == 0 ) {
+						// Let the auto-tuning try all of its candidates before timing.
+						for ( unsigned i{}; i < 4; ++i )
+							tracer.RenderFrame( params, width, height );
+					}
+					const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+					if ( reference.empty() )
+						reference = tracer.GetFrameBuffer();
+
+					const FrameStats& stats{ tracer.GetStats() };
+					log( std::format( "[ Benchmark ]   {:<8} bucket {:3}{} {:6} buckets {:8.2f} ms {:8.2f} MRays/s  "
+						"steals {:4}  imbalance {:.3f}  mismatching pixels {}", ToString( order ), stats.bucketSize,
+						size == 0 ? " (auto)" : "       ", stats.buckets, bestMs, stats.rays / (bestMs * 1000.0),
+						stats.steals, stats.loadImbalance, CountMismatches( tracer.GetFrameBuffer(), reference ) ),
+						LogLevel::Info );
+				}
+			}
+
+			// A centered quarter of the frame must match the full frame inside the region.
+			tracer.bucketOrder = BucketOrder::Hilbert;
+			tracer.bucketSize = scene.settings.bucketSize;
+			tracer.crop = { width / 4, height / 4, width / 2, height / 2 };
+			const double cropMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+			size_t cropMismatches{};
+			for ( unsigned y{ tracer.crop.y }; y < tracer.crop.y + tracer.crop.height; ++y )
+				for ( unsigned x{ tracer.crop.x }; x < tracer.crop.x + tracer.crop.width; ++x )
+					cropMismatches += tracer.GetFrameBuffer()[static_cast<size_t>(y) * width + x] != reference[static_cast<size_t>(y) * width + x];
+			log( std::format( "[ Benchmark ]   crop {}x{} at ({}, {}): {:8.2f} ms, mismatching pixels {}",
+				tracer.crop.width, tracer.crop.height, tracer.crop.x, tracer.crop.y, cropMs, cropMismatches ),
+				LogLevel::Info );
+		}
+	}
+
+	void FrameBufferLayout( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned width{ 3840 };
+		constexpr unsigned height{ 2160 };
+		std::vector<unsigned> threadCounts{ 1 };
+		while ( threadCounts.back() * 2 < std::thread::hardware_concurrency() )
+			threadCounts.push_back( threadCounts.back() * 2 );
+		if ( std::thread::hardware_concurrency() > 1 )
+			threadCounts.push_back( std::thread::hardware_concurrency() );
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			// Primary hits only and no visibility buffer, so the frame buffer writes are a large share of the frame.
+			tracer.visibilityBuffer = false;
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size() ), LogLevel::Info );
+
+			for ( const unsigned size : { 8u, 32u } ) {
+				tracer.bucketSize = size;
+				double rowMajorSingleMs{};
+				double tiledSingleMs{};
+				for ( const unsigned threads : threadCounts ) {
+					tracer.threadCount = threads;
+					tracer.tiledFrameBuffer = false;
+					const double rowMajorMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+					const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+					tracer.tiledFrameBuffer = true;
+					const double tiledMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+					if ( threads == 1 ) {
+						rowMajorSingleMs = rowMajorMs;
+						tiledSingleMs = tiledMs;
+					}
+
+					log( std::format( "[ Benchmark ]   bucket {:2} {:3} threads: row-major {:8.2f} ms (x{:5.2f}), tiled {:8.2f} ms "
+						"(x{:5.2f}, linearize {:.2f} ms)  x{:.2f}, mismatching pixels {}", size, threads, rowMajorMs,
+						rowMajorSingleMs / rowMajorMs, tiledMs, tiledSingleMs / tiledMs, tracer.GetStats().linearizeMs,
+						rowMajorMs / tiledMs, CountMismatches( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+				}
+			}
+		}
+	}
+
+	void Integrators( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+
+		struct Config {
+			Integrator integrator;
+			TraversalMode mode;
+			bool sorting;
+		};
+		constexpr Config configs[]{
+			{ Integrator::Megakernel, TraversalMode::SingleRay, false },
+			{ Integrator::Megakernel, TraversalMode::WideBVH, false },
+			{ Integrator::Wavefront, TraversalMode::SingleRay, false },
+			{ Integrator::Wavefront, TraversalMode::SingleRay, true },
+			{ Integrator::Wavefront, TraversalMode::Packet8, false },
+			{ Integrator::Wavefront, TraversalMode::Packet8, true },
+			{ Integrator::Wavefront, TraversalMode::WideBVH, true } };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			tracer.lights = scene.GetLights();
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, {} materials, {} bounces)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), tracer.materials.size(), tracer.maxBounces ), LogLevel::Info );
+
+			// Speedups are relative to the megakernel on the same BVH: binary for single rays and packets, or wide.
+			std::vector<uint32_t> reference;
+			double megakernelRaysPerMs[2]{};
+			for ( const Config& config : configs ) {
+				tracer.integrator = config.integrator;
+				tracer.traversalMode = config.mode;
+				tracer.wavefrontSorting = config.sorting;
+				const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+
+				const FrameStats& stats{ tracer.GetStats() };
+				const double raysPerMs{ stats.rays / bestMs };
+				const bool wide{ config.mode == TraversalMode::WideBVH };
+				if ( reference.empty() )
+					reference = tracer.GetFrameBuffer();
+				if ( config.integrator == Integrator::Megakernel )
+					megakernelRaysPerMs[wide] = raysPerMs;
+
+				std::string stages{};
+				if ( config.integrator == Integrator::Wavefront )
+					stages = std::format( "  sort {:7.2f} ms, trace {:7.2f} ms, shade {:7.2f} ms",
+						stats.sortMs, stats.traceMs, stats.shadeMs );
+				log( std::format( "[ Benchmark ]   {:<10} {:<16} {:<8} {:8.2f} ms {:8.2f} MRays/s  x{:.2f}  "
+					"{} rays, {} bounces, mismatching pixels {}{}", ToString( config.integrator ), ToString( config.mode ),
+					config.sorting ? "sorted" : "unsorted", bestMs, raysPerMs / 1000.0, raysPerMs / megakernelRaysPerMs[wide],
+					stats.rays, stats.bounces, CountMismatches( tracer.GetFrameBuffer(), reference ), stages ),
+					LogLevel::Info );
+			}
+		}
+	}
+
+	void PathTracing( const std::vector<std::string>& scenePaths, unsigned samplesPerPixel, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+
+		constexpr unsigned bounceBudgets[]{ 4, 16, 64 };
+		constexpr unsigned rouletteDepth{ 3 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			tracer.lights = scene.GetLights();
+			tracer.integrator = Integrator::PathTracer;
+			tracer.traversalMode = TraversalMode::WideBVH;
+			tracer.samplesPerPixel = samplesPerPixel;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, {} materials, {} spp)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), tracer.materials.size(), samplesPerPixel ), LogLevel::Info );
+
+			// Roulette must not change the expected color, only its noise, so the mean of the
+			// frame is compared to the frame of the same budget without roulette.
+			const double paths{ static_cast<double>(width) * height * samplesPerPixel };
+			for ( const unsigned budget : bounceBudgets ) {
+				tracer.maxBounces = budget;
+				double fullMs{};
+				double fullMean{};
+				for ( const bool roulette : { false, true } ) {
+					tracer.russianRouletteDepth = roulette ? rouletteDepth : budget;
+					const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+					const FrameStats& stats{ tracer.GetStats() };
+					const double mean{ MeanIntensity( tracer.GetFrameBuffer() ) };
+					if ( !roulette ) {
+						fullMs = bestMs;
+						fullMean = mean;
+					}
+
+					log( std::format( "[ Benchmark ]   {:2} bounces, roulette {:<3} {:9.2f} ms {:8.2f} MRays/s  x{:.2f}  "
+						"{:.2f} rays/path, mean {:.4f} ({:+.2f}%)", budget, roulette ? "on" : "off", bestMs,
+						stats.rays / (bestMs * 1000.0), fullMs / bestMs, stats.rays / paths, mean,
+						fullMean > 0.0 ? 100.0 * (mean - fullMean) / fullMean : 0.0 ), LogLevel::Info );
+				}
+			}
+		}
+	}
+
+	void ShadowRays( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr uint32_t rayCount{ 1u << 20 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+			const std::vector<Light>& lights{ scene.GetLights() };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			const BVH& bvh{ tracer.GetBVH() };
+			const std::span<const Triangle> triangles{ bvh.GetTriangles() };
+
+			log( std::format( "[ Benchmark ] {} ({} triangles, {} lights)", scenePath, triangles.size(), lights.size() ),
+				LogLevel::Info );
+			if ( lights.empty() || triangles.empty() ) {
+				log( "[ Benchmark ]   No lights or triangles, skipping the scene.", LogLevel::Warning );
+				continue;
+			}
+
+			// Shadow rays from random surface points to the lights. Closest-hit rays in the same directions,
+			// but not ending at the light, are what the path rays of the scene cost.
+			std::vector<Ray> shadowRays( rayCount );
+			std::mt19937 random{ 42 };
+			std::uniform_real_distribution<float> uniform{ 0.f, 1.f };
+			for ( uint32_t i{}; i < rayCount; ++i ) {
+				const Triangle& tri{ triangles[random() % triangles.size()] };
+				float u{ uniform( random ) };
+				float v{ uniform( random ) };
+				if ( u + v > 1.f ) {
+					u = 1.f - u;
+					v = 1.f - v;
+				}
+				DirectX::XMFLOAT3 normal{
+					tri.edge1.y * tri.edge2.z - tri.edge1.z * tri.edge2.y,
+					tri.edge1.z * tri.edge2.x - tri.edge1.x * tri.edge2.z,
+					tri.edge1.x * tri.edge2.y - tri.edge1.y * tri.edge2.x };
+				const DirectX::XMFLOAT3& light{ lights[i % lights.size()].position };
+				const DirectX::XMFLOAT3 point{
+					tri.v0.x + tri.edge1.x * u + tri.edge2.x * v,
+					tri.v0.y + tri.edge1.y * u + tri.edge2.y * v,
+					tri.v0.z + tri.edge1.z * u + tri.edge2.z * v };
+				const DirectX::XMFLOAT3 toLight{ light.x - point.x, light.y - point.y, light.z - point.z };
+				const float sideSign{ normal.x * toLight.x + normal.y * toLight.y + normal.z * toLight.z < 0.f ? -1.f : 1.f };
+				const float normalScale{ sideSign * 1e-4f / std::max( std::sqrt(
+					normal.x * normal.x + normal.y * normal.y + normal.z * normal.z ), 1e-20f ) };
+				const DirectX::XMFLOAT3 origin{
+					point.x + normal.x * normalScale, point.y + normal.y * normalScale, point.z + normal.z * normalScale };
+				const DirectX::XMFLOAT3 direction{ light.x - origin.x, light.y - origin.y, light.z - origin.z };
+				const float distance{ std::sqrt( direction.x * direction.x + direction.y * direction.y + direction.z * direction.z ) };
+				const float invDistance{ 1.f / std::max( distance, 1e-20f ) };
+				shadowRays[i] = { origin, Ray{}.tMin,
+					{ direction.x * invDistance, direction.y * invDistance, direction.z * invDistance }, distance };
+			}
+
+			WideBVH wideBVH{};
+			wideBVH.Build( bvh );
+
+			// Best of the iterations, in nanoseconds per ray. Also returns how many rays hit something.
+			const auto timeRays = [&]( auto&& trace, uint32_t& hits ) {
+				double bestNs{ DBL_MAX };
+				for ( unsigned iteration{}; iteration < iterations; ++iteration ) {
+					hits = 0;
+					const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+					for ( const Ray& ray : shadowRays ) {
+						Hit hit{};
+						hits += trace( ray, hit ) ? 1 : 0;
+					}
+					const std::chrono::duration<double, std::nano> duration{ std::chrono::high_resolution_clock::now() - start };
+					bestNs = std::min( bestNs, duration.count() / rayCount );
+				}
+				return bestNs;
+			};
+
+			for ( const bool wide : { false, true } ) {
+				uint32_t pathHits{};
+				const double pathNs{ timeRays( [&]( const Ray& ray, Hit& hit ) {
+					const Ray unbounded{ ray.origin, ray.tMin, ray.direction, Ray{}.tMax };
+					return wide ? wideBVH.Intersect( unbounded, hit ) : bvh.Intersect( unbounded, hit );
+				}, pathHits ) };
+				uint32_t closestHits{};
+				const double closestNs{ timeRays( [&]( const Ray& ray, Hit& hit ) {
+					return wide ? wideBVH.Intersect( ray, hit ) : bvh.Intersect( ray, hit );
+				}, closestHits ) };
+				uint32_t anyHits{};
+				const double anyNs{ timeRays( [&]( const Ray& ray, Hit& hit ) {
+					return wide ? wideBVH.IntersectAny( ray, hit ) : bvh.IntersectAny( ray, hit );
+				}, anyHits ) };
+
+				log( std::format( "[ Benchmark ]   {:<10} path ray {:6.1f} ns, shadow ray closest hit {:6.1f} ns (x{:.2f}), "
+					"any hit {:6.1f} ns (x{:.2f}), occluded {:.1f}%{}", wide ? "Wide BVH" : "Binary BVH", pathNs, closestNs,
+					pathNs / closestNs, anyNs, pathNs / anyNs, 100.0 * anyHits / rayCount,
+					anyHits == closestHits ? "" : ", OCCLUSION MISMATCH" ), LogLevel::Info );
+			}
+
+			// The occluder cache depends on the order shadow rays are traced in, so it is measured on
+			// path traced frames. The frames trace the same rays with and without it.
+			tracer.integrator = Integrator::PathTracer;
+			tracer.traversalMode = TraversalMode::WideBVH;
+			tracer.lights = lights;
+			tracer.maxBounces = 2;
+			FrameParams params{};
+			params.camera = FramingCamera( bvh.GetBounds(), static_cast<float>(width) / height );
+			for ( const bool cache : { false, true } ) {
+				tracer.occluderCache = cache;
+				const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+				const FrameStats& stats{ tracer.GetStats() };
+				log( std::format( "[ Benchmark ]   Path traced frame, occluder cache {:<3} {:8.2f} ms, {} path rays, "
+					"{} shadow rays, {} occluded, cache hits {:.1f}% of occluded", cache ? "on" : "off", bestMs, stats.rays,
+					stats.shadowRays, stats.occludedShadowRays,
+					100.0 * stats.occluderCacheHits / std::max<uint64_t>( stats.occludedShadowRays, 1 ) ), LogLevel::Info );
+			}
+		}
+	}
+
+	void ManyLights( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr uint32_t lightCounts[]{ 16, 64, 256, 1024 };
+		constexpr unsigned sampleCounts[]{ 1, 4 };
+		constexpr unsigned samplesPerPixel{ 4 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			// Summing 1024 lights per pixel is slow, the frames are rendered at a quarter of the pixels.
+			const unsigned width{ std::max( RenderWidth( scene ) / 2, 1u ) };
+			const unsigned height{ std::max( RenderHeight( scene ) / 2, 1u ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			tracer.integrator = Integrator::PathTracer;
+			tracer.traversalMode = TraversalMode::WideBVH;
+			tracer.samplesPerPixel = samplesPerPixel;
+			// Direct light only, so the frames differ by the light sampling alone.
+			tracer.maxBounces = 0;
+
+			const AABB& bounds{ tracer.GetBVH().GetBounds() };
+			FrameParams params{};
+			params.camera = FramingCamera( bounds, static_cast<float>(width) / height );
+
+			// The scene's total intensity is spread over the generated lights, so every light count
+			// lights the scene about as brightly. Scenes without lights get one bright enough to light
+			// a surface at the scene's extent.
+			const DirectX::XMFLOAT3 extent{ bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z };
+			const float extentSq{ extent.x * extent.x + extent.y * extent.y + extent.z * extent.z };
+			float totalIntensity{};
+			for ( const Light& light : scene.GetLights() )
+				totalIntensity += light.intensity;
+			if ( totalIntensity <= 0.f )
+				totalIntensity = 4.f * DirectX::XM_PI * extentSq;
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, {} spp, direct light only)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), samplesPerPixel ), LogLevel::Info );
+
+			for ( const uint32_t lightCount : lightCounts ) {
+				// Lights in the scene's bounds, a quarter larger on every side. Intensities span two orders of
+				// magnitude, as lamps of a real scene do.
+				std::mt19937 random{ lightCount };
+				std::uniform_real_distribution<float> uniform{ -0.25f, 1.25f };
+				std::uniform_real_distribution<float> exponent{ 0.f, 2.f };
+				tracer.lights.assign( lightCount, {} );
+				float intensitySum{};
+				for ( Light& light : tracer.lights ) {
+					light.position = { bounds.min.x + extent.x * uniform( random ), bounds.min.y + extent.y * uniform( random ),
+						bounds.min.z + extent.z * uniform( random ) };
+					light.intensity = std::pow( 10.f, exponent( random ) );
+					intensitySum += light.intensity;
+				}
+				for ( Light& light : tracer.lights )
+					light.intensity *= totalIntensity / intensitySum;
+
+				tracer.lightSampling = LightSampling::All;
+				const double allMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+				const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+				const double pixels{ static_cast<double>(width) * height };
+				log( std::format( "[ Benchmark ]   {:4} lights, {:<7} {:9.2f} ms, {:7.1f} shadow rays/pixel", lightCount,
+					ToString( LightSampling::All ), allMs, tracer.GetStats().shadowRays / pixels ), LogLevel::Info );
+
+				for ( const unsigned samples : sampleCounts ) {
+					tracer.lightSamples = samples;
+					for ( const LightSampling sampling : { LightSampling::Uniform, LightSampling::Tree } ) {
+						tracer.lightSampling = sampling;
+						const double bestMs{ BestFrameMs( tracer, params, width, height, iterations ) };
+						log( std::format( "[ Benchmark ]   {:4} lights, {:<7} {:9.2f} ms, {:7.1f} shadow rays/pixel, x{:.2f}, "
+							"{} sample(s), RMSE {:.4f}", lightCount, ToString( sampling ), bestMs,
+							tracer.GetStats().shadowRays / pixels, allMs / bestMs, samples,
+							RootMeanSquareError( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+					}
+				}
+			}
+		}
+	}
+
+	void Samplers( const std::vector<std::string>& scenePaths, unsigned referenceSamples ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned sampleCounts[]{ 1, 2, 4, 8, 16, 32 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			// The reference frame needs hundreds of paths per pixel, the frames are rendered at a sixteenth of the pixels.
+			const unsigned width{ std::max( RenderWidth( scene ) / 4, 1u ) };
+			const unsigned height{ std::max( RenderHeight( scene ) / 4, 1u ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			tracer.lights = scene.GetLights();
+			tracer.integrator = Integrator::PathTracer;
+			tracer.traversalMode = TraversalMode::WideBVH;
+			tracer.maxBounces = 4;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			// The reference uses other sequences than the measured frames, so their errors don't cancel.
+			tracer.samplerType = SamplerType::Sobol;
+			tracer.samplerSeed = 1;
+			tracer.samplesPerPixel = referenceSamples;
+			tracer.RenderFrame( params, width, height );
+			const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, reference {} spp in {:.2f} ms)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), referenceSamples, tracer.GetStats().renderMs ), LogLevel::Info );
+
+			tracer.samplerSeed = 0;
+			for ( const unsigned samples : sampleCounts ) {
+				tracer.samplesPerPixel = samples;
+				std::string errors{};
+				double whiteError{};
+				for ( const SamplerType type : { SamplerType::White, SamplerType::Sobol, SamplerType::BlueNoise } ) {
+					tracer.samplerType = type;
+					tracer.RenderFrame( params, width, height );
+					const double error{ RootMeanSquareError( tracer.GetFrameBuffer(), reference ) };
+					if ( type == SamplerType::White )
+						whiteError = error;
+					errors += std::format( "  {:<9} RMSE {:.4f} (x{:.2f})", ToString( type ), error, whiteError / error );
+				}
+				log( std::format( "[ Benchmark ]   {:3} spp{}", samples, errors ), LogLevel::Info );
+			}
+		}
+	}
+
+	void AdaptiveSampling( const std::vector<std::string>& scenePaths, unsigned referenceSamples ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned uniformSamples[]{ 4, 16, 64 };
+		constexpr float thresholds[]{ 0.02f, 0.01f, 0.005f };
+		constexpr float mapThreshold{ 0.01f };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			// The reference frame needs hundreds of paths per pixel, the frames are rendered at a sixteenth of the pixels.
+			const unsigned width{ std::max( RenderWidth( scene ) / 4, 1u ) };
+			const unsigned height{ std::max( RenderHeight( scene ) / 4, 1u ) };
+			const double pixels{ static_cast<double>(width) * height };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			tracer.lights = scene.GetLights();
+			tracer.integrator = Integrator::PathTracer;
+			tracer.traversalMode = TraversalMode::WideBVH;
+			tracer.maxBounces = 4;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			// The reference uses other sequences than the measured frames, so their errors don't cancel.
+			tracer.samplerSeed = 1;
+			tracer.samplesPerPixel = referenceSamples;
+			tracer.RenderFrame( params, width, height );
+			const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+			tracer.samplerSeed = 0;
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, reference {} spp in {:.2f} ms)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), referenceSamples, tracer.GetStats().renderMs ), LogLevel::Info );
+
+			for ( const unsigned samples : uniformSamples ) {
+				tracer.samplesPerPixel = samples;
+				tracer.RenderFrame( params, width, height );
+				log( std::format( "[ Benchmark ]   Uniform  {:3} spp           {:9.2f} ms, {:6.1f} spp average, RMSE {:.4f}",
+					samples, tracer.GetStats().renderMs, tracer.GetStats().samples / pixels,
+					RootMeanSquareError( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+			}
+
+			tracer.adaptiveSampling = true;
+			tracer.samplesPerPixel = 4;
+			tracer.adaptiveMaxSamples = 256;
+			for ( const float threshold : thresholds ) {
+				tracer.adaptiveErrorThreshold = threshold;
+				tracer.RenderFrame( params, width, height );
+				const FrameStats& stats{ tracer.GetStats() };
+				log( std::format( "[ Benchmark ]   Adaptive 4-{} spp, error {:.3f} {:9.2f} ms, {:6.1f} spp average, RMSE {:.4f}, "
+					"{} passes", tracer.adaptiveMaxSamples, threshold, stats.renderMs, stats.samples / pixels,
+					RootMeanSquareError( tracer.GetFrameBuffer(), reference ), stats.adaptivePasses ), LogLevel::Info );
+			}
+
+			// Samples per pixel of every tile as a power of two, a tile per character.
+			tracer.adaptiveErrorThreshold = mapThreshold;
+			tracer.RenderFrame( params, width, height );
+			const FrameStats& stats{ tracer.GetStats() };
+			log( std::format( "[ Benchmark ]   log2( samples per pixel ) of every {}x{} tile at error {:.3f}:", tracer.adaptiveTileSize,
+				tracer.adaptiveTileSize, mapThreshold ), LogLevel::Info );
+			for ( size_t row{}; row < stats.tileSamples.size(); row += stats.tileColumns ) {
+				std::string line{};
+				for ( size_t tile{ row }; tile < row + stats.tileColumns; ++tile )
+					line += static_cast<char>('0' + std::bit_width( stats.tileSamples[tile] ) - 1);
+				log( std::format( "[ Benchmark ]     {}", line ), LogLevel::Info );
+			}
+			tracer.adaptiveSampling = false;
+		}
+	}
+
+	void Denoising( const std::vector<std::string>& scenePaths, unsigned referenceSamples, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned sampleCounts[]{ 1, 2, 4 };
+		constexpr unsigned simdWidths[]{ 1, 4, 8 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			// The reference frame needs hundreds of paths per pixel, the errors are measured at a sixteenth of the pixels.
+			const unsigned width{ std::max( RenderWidth( scene ) / 4, 1u ) };
+			const unsigned height{ std::max( RenderHeight( scene ) / 4, 1u ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			tracer.materials = scene.GetMaterials();
+			tracer.lights = scene.GetLights();
+			tracer.integrator = Integrator::PathTracer;
+			tracer.traversalMode = TraversalMode::WideBVH;
+			tracer.maxBounces = 4;
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			// The reference uses other sequences than the measured frames, so their errors don't cancel.
+			tracer.samplerSeed = 1;
+			tracer.samplesPerPixel = referenceSamples;
+			tracer.RenderFrame( params, width, height );
+			const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+			tracer.samplerSeed = 0;
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, reference {} spp in {:.2f} ms)", scenePath, width, height,
+				tracer.GetBVH().GetTriangles().size(), referenceSamples, tracer.GetStats().renderMs ), LogLevel::Info );
+
+			for ( const unsigned samples : sampleCounts ) {
+				tracer.samplesPerPixel = samples;
+				tracer.denoise = false;
+				tracer.RenderFrame( params, width, height );
+				const double noisyError{ RootMeanSquareError( tracer.GetFrameBuffer(), reference ) };
+				tracer.denoise = true;
+				tracer.RenderFrame( params, width, height );
+				const double denoisedError{ RootMeanSquareError( tracer.GetFrameBuffer(), reference ) };
+				log( std::format( "[ Benchmark ]   {} spp: RMSE {:.4f}, denoised {:.4f} (x{:.2f})", samples, noisyError,
+					denoisedError, noisyError / denoisedError ), LogLevel::Info );
+			}
+
+			// Filter time at the scene's resolution, on the inputs of a 1 spp frame.
+			const unsigned fullWidth{ RenderWidth( scene ) };
+			const unsigned fullHeight{ RenderHeight( scene ) };
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(fullWidth) / fullHeight );
+			tracer.samplesPerPixel = 1;
+			tracer.RenderFrame( params, fullWidth, fullHeight );
+			ThreadPool pool{ tracer.threadCount };
+			for ( const unsigned simdWidth : simdWidths ) {
+				tracer.denoiser.simdWidth = simdWidth;
+				double bestMs{ DBL_MAX };
+				for ( unsigned i{}; i < iterations; ++i )
+					bestMs = std::min( bestMs, tracer.denoiser.Filter( pool ) );
+				log( std::format( "[ Benchmark ]   {}x{} filter, {} pixel(s) at once, {} threads: {:8.2f} ms, {:6.1f} MPixels/s",
+					fullWidth, fullHeight, simdWidth, pool.GetThreadCount(), bestMs,
+					static_cast<double>(fullWidth) * fullHeight / (bestMs * 1000.0) ), LogLevel::Info );
+			}
+			tracer.denoiser.simdWidth = 0;
+		}
+	}
+
+	void Reshading( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		struct Edit {
+			const char* name;
+			uint32_t bgColorPacked;
+			BOOL randomColors;
+		};
+		constexpr Edit edits[]{
+			{ "Random colors off", 0xFF2D2D2D, false },
+			{ "Background", 0xFF80A0C0, false },
+			{ "Random colors on", 0xFF80A0C0, true } };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)",
+				scenePath, width, height, tracer.GetBVH().GetTriangles().size() ), LogLevel::Info );
+
+			// The visibility buffer is traced once with the scene's initial colors, every edit only re-shades it.
+			tracer.visibilityBuffer = true;
+			tracer.RenderFrame( params, width, height );
+			for ( const Edit& edit : edits ) {
+				FrameParams edited{ params };
+				edited.bgColorPacked = edit.bgColorPacked;
+				edited.randomColors = edit.randomColors;
+
+				tracer.visibilityBuffer = false;
+				const double retraceMs{ BestFrameMs( tracer, edited, width, height, iterations ) };
+				const std::vector<uint32_t> reference{ tracer.GetFrameBuffer() };
+				tracer.visibilityBuffer = true;
+				const double reshadeMs{ BestFrameMs( tracer, edited, width, height, iterations ) };
+
+				log( std::format( "[ Benchmark ]   {:<18} retrace {:8.2f} ms, {} {:8.2f} ms  x{:.2f}, mismatching pixels {}",
+					edit.name, retraceMs, tracer.GetStats().reshaded ? "re-shade" : "traced", reshadeMs, retraceMs / reshadeMs,
+					CountMismatches( tracer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+			}
+
+			// A camera change invalidates the visibility buffer, the next frame traces again.
+			params.camera.cameraPosition.x += 0.01f;
+			tracer.RenderFrame( params, width, height );
+			log( std::format( "[ Benchmark ]   Camera moved: {} in {:.2f} ms", tracer.GetStats().reshaded ? "re-shaded" : "traced",
+				tracer.GetStats().renderMs ), LogLevel::Info );
+		}
+	}
+
+	void SoftwareRasterizer( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned tileSizes[]{ 32, 64, 128 };
+		constexpr unsigned simdWidths[]{ 4, 8 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Rasterizer rasterizer{};
+			rasterizer.log.SetMinLevel( LogLevel::Error );
+			// Forward shading, so repeated frames rasterize again.
+			rasterizer.visibilityBuffer = false;
+			rasterizer.SetMeshes( scene.GetMeshes() );
+			Raster::Data data{ FramingRasterData( scene.GetMeshes(), static_cast<float>(width) / height ) };
+
+			const auto bestFrame = [&]() {
+				RasterStats best{};
+				best.renderMs = DBL_MAX;
+				for ( unsigned i{}; i <= iterations; ++i ) {
+					rasterizer.RenderFrame( data, 0, width, height );
+					if ( i > 0 && rasterizer.GetStats().renderMs < best.renderMs )
+						best = rasterizer.GetStats();
+				}
+				return best;
+			};
+
+			RasterStats stats{ bestFrame() };
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles, {} culled, {} threads)", scenePath, width, height,
+				stats.triangles, stats.culledTriangles, rasterizer.threadCount ? rasterizer.threadCount : std::thread::hardware_concurrency() ),
+				LogLevel::Info );
+			for ( const unsigned tileSize : tileSizes )
+				for ( const unsigned simdWidth : simdWidths ) {
+					rasterizer.tileSize = tileSize;
+					rasterizer.simdWidth = simdWidth;
+					stats = bestFrame();
+					log( std::format( "[ Benchmark ]   {:3} px tiles, {} lanes: {:7.2f} ms (vertex {:.2f}, bin {:.2f}, raster {:.2f}), "
+						"{:7.2f} MTris/s, {:7.2f} MPixels/s, {:.2f} tiles per triangle", tileSize, simdWidth, stats.renderMs,
+						stats.vertexMs, stats.binMs, stats.rasterMs, stats.trianglesPerSecond * 1e-6, stats.pixelsPerSecond * 1e-6,
+						static_cast<double>(stats.binnedReferences) / std::max<uint64_t>( stats.setupTriangles, 1 ) ), LogLevel::Info );
+				}
+			rasterizer.tileSize = Rasterizer{}.tileSize;
+			rasterizer.simdWidth = 0;
+
+			data.showBackfaces = true;
+			stats = bestFrame();
+			log( std::format( "[ Benchmark ]   Backfaces shown: {:7.2f} ms, {} culled, {:7.2f} MTris/s, {:7.2f} MPixels/s", stats.renderMs,
+				stats.culledTriangles, stats.trianglesPerSecond * 1e-6, stats.pixelsPerSecond * 1e-6 ), LogLevel::Info );
+
+			data.showBackfaces = false;
+			data.renderEdges = true;
+			data.renderVerts = true;
+			stats = bestFrame();
+			log( std::format( "[ Benchmark ]   Edges and vertices: {:7.2f} ms (raster {:.2f}), {} lines, {} points, {} overlay pixels",
+				stats.renderMs, stats.rasterMs, stats.setupLines, stats.setupPoints, stats.overlayPixels ), LogLevel::Info );
+		}
+	}
+
+	void RasterVisibilityBuffer( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		struct Edit {
+			const char* name;
+			uint32_t shadeMode;
+			uint32_t useRandomColors;
+			uint32_t packedColor;
+			uint32_t lightColor;
+			float bgGray;
+		};
+		constexpr Edit edits[]{
+			{ "Unlit", 1, 1, 0xFFFFFFFF, 0xFFFFFFFF, 0.f },
+			{ "Mesh color", 0, 0, 0xFF3080E0, 0xFFFFFFFF, 0.f },
+			{ "Light color", 0, 0, 0xFF3080E0, 0xFF60C0FF, 0.f },
+			{ "Background", 0, 0, 0xFF3080E0, 0xFF60C0FF, 0.5f } };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Rasterizer rasterizer{};
+			rasterizer.log.SetMinLevel( LogLevel::Error );
+			Raster::Data data{ FramingRasterData( scene.GetMeshes(), static_cast<float>(width) / height ) };
+			data.renderEdges = true;
+
+			// Setting the meshes drops the visibility buffer, so every timed frame rasterizes.
+			const auto bestFrame = [&]( const Raster::Data& frameData ) {
+				RasterStats best{};
+				best.renderMs = DBL_MAX;
+				for ( unsigned i{}; i < iterations; ++i ) {
+					rasterizer.SetMeshes( scene.GetMeshes() );
+					rasterizer.RenderFrame( frameData, 0, width, height );
+					if ( rasterizer.GetStats().renderMs < best.renderMs )
+						best = rasterizer.GetStats();
+				}
+				return best;
+			};
+
+			rasterizer.visibilityBuffer = false;
+			const RasterStats forward{ bestFrame( data ) };
+			const std::vector<uint32_t> reference{ rasterizer.GetFrameBuffer() };
+			rasterizer.visibilityBuffer = true;
+			const RasterStats deferred{ bestFrame( data ) };
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)", scenePath, width, height, forward.triangles ),
+				LogLevel::Info );
+			log( std::format( "[ Benchmark ]   Forward:           {:7.2f} ms (raster {:.2f}), {} fragments shaded",
+				forward.renderMs, forward.rasterMs, forward.pixels ), LogLevel::Info );
+			log( std::format( "[ Benchmark ]   Visibility buffer: {:7.2f} ms (raster {:.2f}, resolve {:.2f}), {} pixels shaded "
+				"(x{:.2f} fewer), mismatching pixels {}", deferred.renderMs, deferred.rasterMs, deferred.resolveMs,
+				deferred.shadedPixels, static_cast<double>(forward.pixels) / std::max<uint64_t>( deferred.shadedPixels, 1 ),
+				CountMismatches( rasterizer.GetFrameBuffer(), reference, 1 ) ), LogLevel::Info );
+
+			// The visibility buffer is rasterized once with the scene's shading, every edit only shades it again.
+			for ( const Edit& edit : edits ) {
+				Raster::Data edited{ data };
+				edited.sceneData.shadeMode = edit.shadeMode;
+				edited.sceneData.useRandomColors = edit.useRandomColors;
+				edited.sceneData.packedColor = edit.packedColor;
+				edited.directionalLight.cb.pckedColor = edit.lightColor;
+				edited.bgColor[0] = edited.bgColor[1] = edited.bgColor[2] = edit.bgGray;
+
+				rasterizer.visibilityBuffer = false;
+				const double forwardMs{ bestFrame( edited ).renderMs };
+				const std::vector<uint32_t> editReference{ rasterizer.GetFrameBuffer() };
+				rasterizer.visibilityBuffer = true;
+				bestFrame( data );
+				double reshadeMs{ DBL_MAX };
+				for ( unsigned i{}; i < iterations; ++i ) {
+					rasterizer.RenderFrame( edited, 0, width, height );
+					reshadeMs = std::min( reshadeMs, rasterizer.GetStats().renderMs );
+				}
+
+				log( std::format( "[ Benchmark ]   {:<12} forward {:7.2f} ms, {} {:7.2f} ms  x{:.2f}, mismatching pixels {}",
+					edit.name, forwardMs, rasterizer.GetStats().reshaded ? "re-shade" : "rasterized", reshadeMs,
+					forwardMs / reshadeMs, CountMismatches( rasterizer.GetFrameBuffer(), editReference, 1 ) ), LogLevel::Info );
+			}
+
+			// A camera change drops the visibility buffer, the next frame rasterizes again.
+			data.camera.cbData.mat.m[0][3] += 0.01f;
+			rasterizer.RenderFrame( data, 0, width, height );
+			log( std::format( "[ Benchmark ]   Camera moved: {} in {:.2f} ms", rasterizer.GetStats().reshaded ? "re-shaded" :
+				"rasterized", rasterizer.GetStats().renderMs ), LogLevel::Info );
+		}
+	}
+
+	void HybridRendering( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Tracer tracer{};
+			tracer.log.SetMinLevel( LogLevel::Error );
+			tracer.BuildAccelerationStructure( scene.GetMeshes() );
+			Rasterizer rasterizer{};
+			rasterizer.log.SetMinLevel( LogLevel::Error );
+			const Raster::Data data{ FramingRasterData( scene.GetMeshes(), static_cast<float>(width) / height ) };
+
+			// Setting the meshes drops the visibility buffer, so every timed frame rasterizes.
+			const auto bestFrame = [&]() {
+				RasterStats best{};
+				best.renderMs = DBL_MAX;
+				for ( unsigned i{}; i < iterations; ++i ) {
+					rasterizer.SetMeshes( scene.GetMeshes() );
+					rasterizer.RenderFrame( data, 0, width, height );
+					if ( rasterizer.GetStats().renderMs < best.renderMs )
+						best = rasterizer.GetStats();
+				}
+				return best;
+			};
+
+			const RasterStats raster{ bestFrame() };
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} triangles)", scenePath, width, height, raster.triangles ),
+				LogLevel::Info );
+			log( std::format( "[ Benchmark ]   Raster only:            {:7.2f} ms (raster {:.2f}, resolve {:.2f})",
+				raster.renderMs, raster.rasterMs, raster.resolveMs ), LogLevel::Info );
+
+			rasterizer.SetRayTracing( &tracer.GetBVH(), scene.GetMaterials() );
+			const RasterStats shadows{ bestFrame() };
+			log( std::format( "[ Benchmark ]   Traced shadows:         {:7.2f} ms (raster {:.2f}, resolve {:.2f}), "
+				"{} shadow rays, {:.1f}% occluded", shadows.renderMs, shadows.rasterMs, shadows.resolveMs, shadows.shadowRays,
+				100. * shadows.occludedShadowRays / std::max<uint64_t>( shadows.shadowRays, 1 ) ), LogLevel::Info );
+
+			rasterizer.reflectivity = 0.3f;
+			for ( const unsigned bounces : { 1u, 2u } ) {
+				rasterizer.reflectionBounces = bounces;
+				const RasterStats reflections{ bestFrame() };
+				log( std::format( "[ Benchmark ]   Shadows, {} reflection(s): {:7.2f} ms (resolve {:.2f}), {} shadow rays, "
+					"{} reflection rays", bounces, reflections.renderMs, reflections.resolveMs, reflections.shadowRays,
+					reflections.reflectionRays ), LogLevel::Info );
+			}
+			rasterizer.reflectivity = 0.f;
+			rasterizer.reflectionBounces = 1;
+			rasterizer.SetRayTracing( nullptr );
+
+			// Ray tracing the primary visibility too, which the hybrid frames rasterize instead.
+			FrameParams params{};
+			params.camera = FramingCamera( tracer.GetBVH().GetBounds(), static_cast<float>(width) / height );
+			tracer.visibilityBuffer = false;
+			log( std::format( "[ Benchmark ]   Primary rays traced:    {:7.2f} ms",
+				BestFrameMs( tracer, params, width, height, iterations ) ), LogLevel::Info );
+		}
+	}
+
+	void ShadingKernels( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		struct Shading {
+			const char* name;
+			uint32_t shadeMode;
+			uint32_t useRandomColors;
+			uint32_t disco;
+		};
+		constexpr Shading shadings[]{
+			{ "Lit, random colors", 0, 1, 0 },
+			{ "Unlit, random colors", 1, 1, 0 },
+			{ "Lit, mesh color", 0, 0, 0 },
+			{ "Unlit, mesh color", 1, 0, 0 },
+			{ "Lit, disco", 0, 0, 1 } };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const unsigned width{ RenderWidth( scene ) };
+			const unsigned height{ RenderHeight( scene ) };
+
+			Rasterizer rasterizer{};
+			rasterizer.log.SetMinLevel( LogLevel::Error );
+			rasterizer.SetMeshes( scene.GetMeshes() );
+			const Raster::Data data{ FramingRasterData( scene.GetMeshes(), static_cast<float>(width) / height ) };
+			rasterizer.RenderFrame( data, 0, width, height );
+			log( std::format( "[ Benchmark ] {} ({}x{}, {} pixels shaded)", scenePath, width, height,
+				rasterizer.GetStats().shadedPixels ), LogLevel::Info );
+
+			// The visibility buffer stays, every frame only resolves it again with the kernel picked for the frame.
+			for ( const Shading& shading : shadings ) {
+				Raster::Data shaded{ data };
+				shaded.sceneData.shadeMode = shading.shadeMode;
+				shaded.sceneData.useRandomColors = shading.useRandomColors;
+				shaded.sceneData.disco = shading.disco;
+				shaded.sceneData.discoSpeed = 4;
+
+				const auto bestResolve = [&]( bool specialized ) {
+					rasterizer.specializedShading = specialized;
+					RasterStats best{};
+					best.resolveMs = DBL_MAX;
+					for ( unsigned i{}; i < iterations; ++i ) {
+						rasterizer.RenderFrame( shaded, 0, width, height );
+						if ( rasterizer.GetStats().resolveMs < best.resolveMs )
+							best = rasterizer.GetStats();
+					}
+					return best;
+				};
+
+				const RasterStats generic{ bestResolve( false ) };
+				const std::vector<uint32_t> reference{ rasterizer.GetFrameBuffer() };
+				const RasterStats specialized{ bestResolve( true ) };
+				const auto nsPerPixel = []( const RasterStats& stats ) {
+					return stats.resolveMs * 1e6 / std::max<uint64_t>( stats.shadedPixels, 1 );
+				};
+				log( std::format( "[ Benchmark ]   {:<21} generic {:6.2f} ms ({:5.2f} ns/pixel), specialized {:6.2f} ms "
+					"({:5.2f} ns/pixel)  x{:.2f}, mismatching pixels {}", shading.name, generic.resolveMs, nsPerPixel( generic ),
+					specialized.resolveMs, nsPerPixel( specialized ), generic.resolveMs / specialized.resolveMs,
+					CountMismatches( rasterizer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+			}
+		}
+	}
+
+	void EdgeExtraction( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		ThreadPool singleThread{ 1 };
+		ThreadPool allThreads{};
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			std::vector<Mesh> meshes{ scene.GetMeshes() };
+
+			const auto bestBuild = [&]( ThreadPool& pool ) {
+				double best{ DBL_MAX };
+				for ( unsigned i{}; i < iterations; ++i ) {
+					const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+					for ( Mesh& mesh : meshes )
+						Raster::BuildEdges( mesh, pool );
+					best = std::min( best, std::chrono::duration<double, std::milli>{
+						std::chrono::high_resolution_clock::now() - start }.count() );
+				}
+				return best;
+			};
+
+			const double singleMs{ bestBuild( singleThread ) };
+			std::vector<std::vector<uint32_t>> singleEdges;
+			for ( const Mesh& mesh : meshes )
+				singleEdges.push_back( mesh.edgeIndices );
+			const double parallelMs{ bestBuild( allThreads ) };
+
+			uint64_t triangles{};
+			uint64_t edges{};
+			uint64_t boundary{};
+			uint64_t crease{};
+			bool identical{ true };
+			for ( size_t i{}; i < meshes.size(); ++i ) {
+				triangles += meshes[i].indices.size() / 3;
+				edges += meshes[i].edgeIndices.size() / 2;
+				boundary += meshes[i].boundaryEdgeCount;
+				crease += meshes[i].creaseEdgeCount;
+				identical = identical && meshes[i].edgeIndices == singleEdges[i];
+			}
+			log( std::format( "[ Benchmark ] {} ({} triangles): {} edges instead of {} ({:.2f}x fewer), {} boundary, {} crease",
+				scenePath, triangles, edges, triangles * 3, static_cast<double>(triangles * 3) / std::max<uint64_t>( edges, 1 ),
+				boundary, crease ), LogLevel::Info );
+			log( std::format( "[ Benchmark ]   1 thread: {:.3f} ms, {} threads: {:.3f} ms ({:.2f}x), {}", singleMs,
+				allThreads.GetThreadCount(), parallelMs, singleMs / parallelMs, identical ? "same edges" : "EDGES DIFFER" ),
+				LogLevel::Info );
+		}
+	}
+
+	void FrustumCulling( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		// Scenes hold few meshes, so clusters of triangles stand in for many small meshes.
+		constexpr uint32_t clusterTriangles{ 16 };
+		constexpr unsigned viewCount{ 16 };
+		constexpr unsigned simdWidths[]{ 1, 4, 8 };
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			const std::vector<Mesh>& meshes{ scene.GetMeshes() };
+
+			std::vector<AABB> boxes;
+			AABB sceneBounds{};
+			for ( const Mesh& mesh : meshes )
+				for ( size_t first{}; first < mesh.indices.size(); first += clusterTriangles * 3 ) {
+					AABB& box{ boxes.emplace_back() };
+					const size_t last{ std::min( first + clusterTriangles * 3, mesh.indices.size() ) };
+					for ( size_t i{ first }; i < last; ++i )
+						box.Grow( mesh.vertices[mesh.indices[i]].position );
+					sceneBounds.Grow( box );
+				}
+			if ( boxes.empty() )
+				continue;
+
+			// The framing camera moved most of the way to the scene and orbiting it, so part of the boxes leaves the frustum.
+			const float aspectRatio{ static_cast<float>(RenderWidth( scene )) / RenderHeight( scene ) };
+			const Raster::Data framing{ FramingRasterData( meshes, aspectRatio ) };
+			const DirectX::XMMATRIX worldView{ DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &framing.camera.cbData.mat ) ) };
+			const DirectX::XMFLOAT3 center{ (sceneBounds.min.x + sceneBounds.max.x) * 0.5f,
+				(sceneBounds.min.y + sceneBounds.max.y) * 0.5f, (sceneBounds.min.z + sceneBounds.max.z) * 0.5f };
+			const float centerDepth{ DirectX::XMVectorGetZ( DirectX::XMVector3Transform( DirectX::XMLoadFloat3( &center ), worldView ) ) };
+			std::vector<Raster::Transformation::TransformDataCB> views( viewCount, framing.camera.cbData );
+			for ( unsigned view{}; view < viewCount; ++view ) {
+				const DirectX::XMMATRIX orbit{ DirectX::XMMatrixTranslation( -center.x, -center.y, -center.z ) *
+					DirectX::XMMatrixRotationY( DirectX::XM_2PI * view / viewCount ) *
+					DirectX::XMMatrixTranslation( center.x, center.y, center.z ) };
+				DirectX::XMStoreFloat4x4( &views[view].mat, DirectX::XMMatrixTranspose(
+					orbit * worldView * DirectX::XMMatrixTranslation( 0.f, 0.f, -centerDepth * 0.8f ) ) );
+			}
+
+			Raster::FrustumCuller culler{};
+			culler.SetBounds( boxes );
+			std::vector<std::vector<uint32_t>> reference( viewCount );
+			log( std::format( "[ Benchmark ] {} ({} boxes of {} triangles, {} views)", scenePath, boxes.size(),
+				clusterTriangles, viewCount ), LogLevel::Info );
+			for ( const unsigned simdWidth : simdWidths ) {
+				culler.simdWidth = simdWidth;
+				double bestMs{ DBL_MAX };
+				uint64_t visible{};
+				bool identical{ true };
+				for ( unsigned i{}; i < iterations; ++i ) {
+					const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+					for ( const Raster::Transformation::TransformDataCB& view : views )
+						culler.Cull( view );
+					bestMs = std::min( bestMs, std::chrono::duration<double, std::milli>{
+						std::chrono::high_resolution_clock::now() - start }.count() / viewCount );
+				}
+				for ( unsigned view{}; view < viewCount; ++view ) {
+					const std::vector<uint32_t>& result{ culler.Cull( views[view] ) };
+					visible += result.size();
+					if ( simdWidth == simdWidths[0] )
+						reference[view] = result;
+					identical = identical && result == reference[view];
+				}
+				log( std::format( "[ Benchmark ]   {} lanes: {:8.4f} ms per frame, {:8.2f} MBoxes/s, {:5.1f}% visible, {}",
+					simdWidth, bestMs, boxes.size() / (bestMs * 1e3), 100. * visible / (static_cast<double>(boxes.size()) * viewCount),
+					identical ? "same boxes" : "BOXES DIFFER" ), LogLevel::Info );
+			}
+		}
+	}
+
+	void OcclusionCulling( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned simdWidths[]{ 4, 8 };
+
+		const auto compare = [&]( const std::string& name, const std::vector<Mesh>& meshes, unsigned width, unsigned height ) {
+			const Raster::Data data{ FramingRasterData( meshes, static_cast<float>(width) / height ) };
+			Raster::FrustumCuller frustumCuller{};
+			frustumCuller.SetMeshes( meshes );
+			const std::vector<uint32_t>& candidates{ frustumCuller.Cull( data.camera.cbData ) };
+
+			Raster::OcclusionCuller occlusionCuller{};
+			occlusionCuller.SetMeshes( meshes );
+			log( std::format( "[ Benchmark ] {} ({} meshes, {} in the frustum, {}x{} depth buffer)", name, meshes.size(),
+				candidates.size(), occlusionCuller.width,
+				std::lround( occlusionCuller.width * static_cast<float>(height) / width ) ), LogLevel::Info );
+			for ( const unsigned simdWidth : simdWidths ) {
+				occlusionCuller.simdWidth = simdWidth;
+				Raster::OcclusionStats best{};
+				best.rasterMs = DBL_MAX;
+				for ( unsigned i{}; i < iterations; ++i ) {
+					occlusionCuller.Cull( data.camera.cbData, candidates, data.showBackfaces );
+					const Raster::OcclusionStats& stats{ occlusionCuller.GetStats() };
+					if ( stats.rasterMs + stats.testMs < best.rasterMs + best.testMs )
+						best = stats;
+				}
+				log( std::format( "[ Benchmark ]   {} lanes: {} occluders ({} triangles), {} of {} occluded, "
+					"raster {:.3f} ms, pyramid and tests {:.3f} ms", simdWidth, best.occluders, best.occluderTriangles,
+					best.occluded, best.tested, best.rasterMs, best.testMs ), LogLevel::Info );
+			}
+
+			// Conservative culling leaves every visible pixel in place.
+			Rasterizer rasterizer{};
+			rasterizer.log.SetMinLevel( LogLevel::Error );
+			rasterizer.visibilityBuffer = false;
+			rasterizer.SetMeshes( meshes );
+			const auto bestFrameMs = [&]() {
+				double bestMs{ DBL_MAX };
+				for ( unsigned i{}; i <= iterations; ++i ) {
+					rasterizer.RenderFrame( data, 0, width, height );
+					if ( i > 0 )
+						bestMs = std::min( bestMs, rasterizer.GetStats().renderMs );
+				}
+				return bestMs;
+			};
+			const double allMs{ bestFrameMs() };
+			const std::vector<uint32_t> reference{ rasterizer.GetFrameBuffer() };
+			rasterizer.SetMeshMask( occlusionCuller.GetMask() );
+			const double culledMs{ bestFrameMs() };
+			log( std::format( "[ Benchmark ]   CPU raster: {:.2f} ms with all meshes, {:.2f} ms without the {} culled, "
+				"mismatching pixels {}", allMs, culledMs, rasterizer.GetStats().maskedMeshes,
+				CountMismatches( rasterizer.GetFrameBuffer(), reference ) ), LogLevel::Info );
+		};
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			compare( scenePath, scene.GetMeshes(), RenderWidth( scene ), RenderHeight( scene ) );
+		}
+		compare( "Synthetic wall and cubes", SyntheticOccluders( 16 ), 1280, 720 );
+	}
+
+	void ClusterCulling( const std::vector<std::string>& scenePaths, unsigned iterations ) {
+		Logger log{ std::cout, LogLevel::Info };
+		constexpr unsigned viewCount{ 8 };
+		ThreadPool pool{};
+
+		const auto compare = [&]( const std::string& name, std::vector<Mesh>& meshes, float aspectRatio ) {
+			uint64_t triangles{};
+			size_t clusters{};
+			const std::chrono::high_resolution_clock::time_point buildStart{ std::chrono::high_resolution_clock::now() };
+			for ( Mesh& mesh : meshes ) {
+				Raster::BuildClusters( mesh, pool );
+				triangles += mesh.indices.size() / 3;
+				clusters += mesh.clusters.size();
+			}
+			const double buildMs{ std::chrono::duration<double, std::milli>{ std::chrono::high_resolution_clock::now() - buildStart }.count() };
+			log( std::format( "[ Benchmark ] {} ({} triangles, {} clusters built in {:.2f} ms, {} views)", name, triangles,
+				clusters, buildMs, viewCount ), LogLevel::Info );
+
+			// The framing camera orbiting the scene, tilted down, and moved in so part of it leaves the frustum.
+			const Raster::Data framing{ FramingRasterData( meshes, aspectRatio ) };
+			const DirectX::XMMATRIX worldView{ DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &framing.camera.cbData.mat ) ) };
+			AABB bounds{};
+			for ( const Mesh& mesh : meshes )
+				for ( const Vertex& vertex : mesh.vertices )
+					bounds.Grow( vertex.position );
+			const DirectX::XMFLOAT3 center{ (bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f,
+				(bounds.min.z + bounds.max.z) * 0.5f };
+			const float centerDepth{ DirectX::XMVectorGetZ( DirectX::XMVector3Transform( DirectX::XMLoadFloat3( &center ), worldView ) ) };
+
+			Raster::FrustumCuller frustumCuller{};
+			frustumCuller.SetMeshes( meshes );
+			Raster::ClusterCuller clusterCuller{};
+			clusterCuller.SetMeshes( meshes );
+			for ( unsigned view{}; view < viewCount; ++view ) {
+				Raster::Transformation::TransformDataCB transform{ framing.camera.cbData };
+				const DirectX::XMMATRIX orbit{ DirectX::XMMatrixTranslation( -center.x, -center.y, -center.z ) *
+					DirectX::XMMatrixRotationY( DirectX::XM_2PI * view / viewCount ) * DirectX::XMMatrixRotationX( 0.5f ) *
+					DirectX::XMMatrixTranslation( center.x, center.y, center.z ) };
+				DirectX::XMStoreFloat4x4( &transform.mat, DirectX::XMMatrixTranspose(
+					orbit * worldView * DirectX::XMMatrixTranslation( 0.f, 0.f, -centerDepth * 0.4f ) ) );
+
+				const std::vector<uint32_t> visibleMeshes{ frustumCuller.Cull( transform ) };
+				double bestMs{ DBL_MAX };
+				for ( unsigned i{}; i < iterations; ++i ) {
+					clusterCuller.Cull( transform, visibleMeshes, {}, false );
+					bestMs = std::min( bestMs, clusterCuller.GetStats().cullMs );
+				}
+				const Raster::ClusterStats stats{ clusterCuller.GetStats() };
+
+				// Every triangle the raster passes would draw, front facing and not outside one frustum plane, has to be kept.
+				const DirectX::XMMATRIX projection{ DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &transform.projection ) ) };
+				const DirectX::XMMATRIX clipMatrix{ DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &transform.mat ) ) * projection };
+				DirectX::XMFLOAT3 camera{};
+				DirectX::XMStoreFloat3( &camera, DirectX::XMVector3TransformCoord( DirectX::XMVectorZero(),
+					DirectX::XMMatrixInverse( nullptr, DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &transform.mat ) ) ) ) );
+				uint64_t missing{};
+				for ( uint32_t meshIdx{}; meshIdx < meshes.size(); ++meshIdx ) {
+					const Mesh& mesh{ meshes[meshIdx] };
+					std::vector<char> kept( mesh.indices.size() / 3, 0 );
+					for ( const Raster::IndexRange& range : clusterCuller.GetRanges( meshIdx ) )
+						std::fill_n( kept.begin() + range.first / 3, range.count / 3, 1 );
+					for ( size_t triangle{}; triangle < kept.size(); ++triangle ) {
+						if ( kept[triangle] )
+							continue;
+						const DirectX::XMFLOAT3& p0{ mesh.vertices[mesh.indices[triangle * 3]].position };
+						const DirectX::XMFLOAT3& p1{ mesh.vertices[mesh.indices[triangle * 3 + 1]].position };
+						const DirectX::XMFLOAT3& p2{ mesh.vertices[mesh.indices[triangle * 3 + 2]].position };
+						const DirectX::XMVECTOR normal{ DirectX::XMVector3Cross(
+							DirectX::XMVectorSubtract( DirectX::XMLoadFloat3( &p1 ), DirectX::XMLoadFloat3( &p0 ) ),
+							DirectX::XMVectorSubtract( DirectX::XMLoadFloat3( &p2 ), DirectX::XMLoadFloat3( &p0 ) ) ) };
+						const bool frontFacing{ DirectX::XMVectorGetX( DirectX::XMVector3Dot( normal,
+							DirectX::XMVectorSubtract( DirectX::XMLoadFloat3( &camera ), DirectX::XMLoadFloat3( &p0 ) ) ) ) > 0.f };
+						unsigned outside{ 0x3F };
+						for ( const DirectX::XMFLOAT3* p : { &p0, &p1, &p2 } ) {
+							DirectX::XMFLOAT4 c{};
+							DirectX::XMStoreFloat4( &c, DirectX::XMVector3Transform( DirectX::XMLoadFloat3( p ), clipMatrix ) );
+							outside &= (c.x < -c.w ? 1u : 0u) | (c.x > c.w ? 2u : 0u) | (c.y < -c.w ? 4u : 0u) |
+								(c.y > c.w ? 8u : 0u) | (c.z < 0.f ? 16u : 0u) | (c.z > c.w ? 32u : 0u);
+						}
+						missing += frontFacing && outside == 0;
+					}
+				}
+
+				log( std::format( "[ Benchmark ]   View {}: {} clusters, {} outside, {} back facing, {} ranges, {:5.1f}% of the "
+					"triangles kept, {:.3f} ms, {} drawn triangles missing", view, stats.tested, stats.outside, stats.backfacing,
+					stats.ranges, 100. * stats.triangles / std::max<uint64_t>( triangles, 1 ), bestMs, missing ), LogLevel::Info );
+			}
+		};
+
+		for ( const std::string& scenePath : scenePaths ) {
+			Scene scene{ scenePath };
+			LoadScene( scene );
+			std::vector<Mesh> meshes{ scene.GetMeshes() };
+			compare( scenePath, meshes, static_cast<float>(RenderWidth( scene )) / RenderHeight( scene ) );
+		}
+		std::vector<Mesh> terrain{ SyntheticTerrain( 1u << 18 ) };
+		compare( "Synthetic terrain", terrain, 16.f / 9.f );
+	}
+
+	bool RunFromCommandLine( int argc, char* argv[] ) {
+		if ( argc < 2 )
+			return false;
+
+		const bool quantized{ std::strcmp( argv[1], "--bench-quantized" ) == 0 };
+		const bool sbvh{ std::strcmp( argv[1], "--bench-sbvh" ) == 0 };
+		const bool cache{ std::strcmp( argv[1], "--bench-bvh-cache" ) == 0 };
+		if ( quantized || sbvh || cache ) {
+			uint32_t syntheticTriangles{};
+			int first{ 2 };
+			if ( argc >= 4 && std::strcmp( argv[2], "--synthetic" ) == 0 ) {
+				syntheticTriangles = static_cast<uint32_t>(std::strtoul( argv[3], nullptr, 10 ));
+				first = 4;
+			}
+			const std::vector<std::string> scenePaths( argv + first, argv + argc );
+			if ( quantized )
+				QuantizedTraversal( scenePaths, syntheticTriangles );
+			else if ( sbvh )
+				SpatialSplits( scenePaths, syntheticTriangles );
+			else
+				BVHCache( scenePaths, syntheticTriangles );
+			return true;
+		}
+
+		if ( argc < 3 )
+			return false;
+
+		const std::vector<std::string> scenePaths( argv + 2, argv + argc );
+		if ( std::strcmp( argv[1], "--bench-packets" ) == 0 ) {
+			PacketTraversal( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-wide" ) == 0 ) {
+			WideTraversal( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-buckets" ) == 0 ) {
+			BucketScheduling( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-framebuffer" ) == 0 ) {
+			FrameBufferLayout( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-wavefront" ) == 0 ) {
+			Integrators( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-path" ) == 0 ) {
+			PathTracing( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-shadows" ) == 0 ) {
+			ShadowRays( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-lights" ) == 0 ) {
+			ManyLights( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-samplers" ) == 0 ) {
+			Samplers( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-adaptive" ) == 0 ) {
+			AdaptiveSampling( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-raster-vbuffer" ) == 0 ) {
+			RasterVisibilityBuffer( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-hybrid" ) == 0 ) {
+			HybridRendering( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-shading" ) == 0 ) {
+			ShadingKernels( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-clusters" ) == 0 ) {
+			ClusterCulling( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-culling" ) == 0 ) {
+			FrustumCulling( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-occlusion" ) == 0 ) {
+			OcclusionCulling( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-denoise" ) == 0 ) {
+			Denoising( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-edges" ) == 0 ) {
+			EdgeExtraction( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-raster" ) == 0 ) {
+			SoftwareRasterizer( scenePaths );
+			return true;
+		}
+		if ( std::strcmp( argv[1], "--bench-reshade" ) == 0 ) {
+			Reshading( scenePaths );
+			return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,780 @@
+#include "CPUTracer.hpp" // Tracer, Integrator, PackColor, UnpackColor
+#include "RayPacket.hpp" // NoHit
+
+#include <algorithm> // min, max, fill
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // sqrtf, cosf, sinf
+#include <numeric> // iota
+#include <vector> // erase_if
+
+
+namespace CPU {
+	namespace {
+		/// Rays handed to a worker at once by the wavefront stages. A multiple of every packet size.
+		constexpr uint32_t ChunkSize{ 1024 };
+		/// Secondary rays weighted below this can't change an 8-bit channel and are not spawned.
+		constexpr float MinThroughput{ 1.f / 512.f };
+		/// Secondary ray origins are pushed off the surface by this much along the geometric normal.
+		constexpr float SurfaceOffset{ 1e-4f };
+		/// Cells per axis of the origin grid used as sort key. 6 bits per axis, 18 bits of Morton code.
+		constexpr uint32_t SortGridBits{ 6 };
+		/// Bits sorted per radix pass. Two passes cover the 3 octant and 18 Morton bits.
+		constexpr uint32_t RadixBits{ 11 };
+		/// Upper bound of the Russian roulette survival chance, so paths trapped in white glass still end.
+		constexpr float MaxSurvival{ 0.95f };
+		constexpr float Pi{ 3.14159265f };
+
+		const Material DefaultMaterial{};
+
+		uint32_t ChunkCount( uint32_t count ) {
+			return (count + ChunkSize - 1) / ChunkSize;
+		}
+
+		/// Grows a wavefront buffer to hold at least the given number of elements. Never shrinks it,
+		/// so buffers are not reallocated or re-initialized between bounces and frames.
+		template <typename T>
+		void GrowBuffer( std::vector<T>& buffer, size_t size ) {
+			if ( buffer.size() < size )
+				buffer.resize( size );
+		}
+
+		DirectX::XMFLOAT3 Add( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.x + b.x, a.y + b.y, a.z + b.z };
+		}
+
+		DirectX::XMFLOAT3 Sub( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.x - b.x, a.y - b.y, a.z - b.z };
+		}
+
+		DirectX::XMFLOAT3 Mul( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.x * b.x, a.y * b.y, a.z * b.z };
+		}
+
+		DirectX::XMFLOAT3 Scale( const DirectX::XMFLOAT3& a, float s ) {
+			return { a.x * s, a.y * s, a.z * s };
+		}
+
+		float Dot( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		DirectX::XMFLOAT3 Cross( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+
+		DirectX::XMFLOAT3 Normalize( const DirectX::XMFLOAT3& a ) {
+			const float lengthSq{ Dot( a, a ) };
+			return lengthSq > 0.f ? Scale( a, 1.f / std::sqrtf( lengthSq ) ) : a;
+		}
+
+		DirectX::XMFLOAT3 Reflect( const DirectX::XMFLOAT3& direction, const DirectX::XMFLOAT3& normal ) {
+			return Sub( direction, Scale( normal, 2.f * Dot( direction, normal ) ) );
+		}
+
+		/// Refracted direction and Schlick's Fresnel reflectance of a ray hitting a dielectric.
+		/// @param[in] direction  Normalized ray direction.
+		/// @param[in] normal     Normal facing the side the ray came from.
+		/// @param[in] ior        Index of refraction of the material.
+		/// @param[in] entering   Whether the ray goes from outside into the material.
+		/// @param[out] refracted  The refracted direction, not normalized.
+		/// @param[out] fresnel    Fraction of the light that is reflected.
+		/// @return  False on total internal reflection, which reflects all light.
+		bool Refract( const DirectX::XMFLOAT3& direction, const DirectX::XMFLOAT3& normal, float ior, bool entering,
+			DirectX::XMFLOAT3& refracted, float& fresnel ) {
+			const float eta{ entering ? 1.f / ior : ior };
+			const float cosI{ -Dot( direction, normal ) };
+			const float k{ 1.f - eta * eta * (1.f - cosI * cosI) };
+			if ( k < 0.f )
+				return false;
+
+			// Schlick's approximation, evaluated on the side with the larger angle.
+			const float cosT{ std::sqrtf( k ) };
+			const float r0{ (1.f - ior) / (1.f + ior) };
+			const float m{ 1.f - (entering ? cosI : cosT) };
+			fresnel = r0 * r0 + (1.f - r0 * r0) * (m * m) * (m * m) * m;
+			refracted = Add( Scale( direction, eta ), Scale( normal, eta * cosI - cosT ) );
+			return true;
+		}
+
+		/// Cosine-weighted direction on the hemisphere around a normal. Its pdf cancels the
+		/// cosine of a diffuse surface, so the throughput is only weighted by the albedo.
+		/// @param[in] normal  Normalized hemisphere axis.
+		/// @param[in] u1, u2  Uniform random numbers in [0, 1).
+		DirectX::XMFLOAT3 SampleCosineHemisphere( const DirectX::XMFLOAT3& normal, float u1, float u2 ) {
+			// Orthonormal basis without branches on the normal's largest axis (Duff et al. 2017).
+			const float sign{ normal.z >= 0.f ? 1.f : -1.f };
+			const float a{ -1.f / (sign + normal.z) };
+			const float b{ normal.x * normal.y * a };
+			const DirectX::XMFLOAT3 tangent{ 1.f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x };
+			const DirectX::XMFLOAT3 bitangent{ b, sign + normal.y * normal.y * a, -normal.y };
+
+			const float radius{ std::sqrtf( u1 ) };
+			const float phi{ 2.f * Pi * u2 };
+			return Add( Add( Scale( tangent, radius * std::cosf( phi ) ), Scale( bitangent, radius * std::sinf( phi ) ) ),
+				Scale( normal, std::sqrtf( std::max( 1.f - u1, 0.f ) ) ) );
+		}
+
+		/// Sampler dimensions of a path. The pixel jitter comes first, then the same dimensions at every
+		/// bounce, so all samples of a pixel make each decision with the same dimension.
+		enum PathDimension : uint32_t {
+			LightDimension,
+			DirectionDimension,
+			FresnelDimension,
+			RouletteDimension,
+			DimensionsPerBounce
+		};
+
+		uint32_t BounceDimension( unsigned bounce, PathDimension dimension ) {
+			return 1 + bounce * DimensionsPerBounce + dimension;
+		}
+
+		/// Spreads the low 10 bits of a value to every third bit.
+		uint32_t SpreadBits( uint32_t value ) {
+			value = (value | (value << 16)) & 0x030000FF;
+			value = (value | (value << 8)) & 0x0300F00F;
+			value = (value | (value << 4)) & 0x030C30C3;
+			value = (value | (value << 2)) & 0x09249249;
+			return value;
+		}
+
+		/// Grid cell of a coordinate inside [min, min + extent], clamped to the grid.
+		uint32_t GridCell( float value, float min, float invExtent ) {
+			constexpr float cells{ static_cast<float>(1u << SortGridBits) };
+			const float cell{ (value - min) * invExtent * cells };
+			return static_cast<uint32_t>(std::min( std::max( cell, 0.f ), cells - 1.f ));
+		}
+	}
+
+	TraversalMode Tracer::RayTraversalMode() const {
+		if ( traversalMode == TraversalMode::QuantizedBVH && !m_quantizedBVHBuilt )
+			return TraversalMode::WideBVH;
+		return traversalMode;
+	}
+
+	void Tracer::IntersectClosest( const Ray& ray, Hit& hit ) const {
+		const TraversalMode mode{ RayTraversalMode() };
+		if ( mode == TraversalMode::WideBVH )
+			m_wideBVH.Intersect( ray, hit );
+		else if ( mode == TraversalMode::QuantizedBVH )
+			m_quantizedBVH.Intersect( ray, hit );
+		else
+			m_bvh.Intersect( ray, hit );
+	}
+
+	Tracer::SurfaceHit Tracer::GetSurface( const Ray& ray, const Hit& hit ) const {
+		const Mesh& mesh{ m_meshes[hit.instanceIdx] };
+		const Material& material{ mesh.materialIdx < materials.size() ? materials[mesh.materialIdx] : DefaultMaterial };
+		const uint32_t* indices{ &mesh.indices[static_cast<size_t>(hit.primIdx) * 3] };
+		const Vertex& v0{ mesh.vertices[indices[0]] };
+		const Vertex& v1{ mesh.vertices[indices[1]] };
+		const Vertex& v2{ mesh.vertices[indices[2]] };
+
+		// Both normals face the side the ray came from. Refraction needs to know which side that is.
+		DirectX::XMFLOAT3 geometricNormal{ Normalize( Cross( Sub( v1.position, v0.position ), Sub( v2.position, v0.position ) ) ) };
+		const bool entering{ Dot( ray.direction, geometricNormal ) < 0.f };
+		if ( !entering )
+			geometricNormal = Scale( geometricNormal, -1.f );
+
+		DirectX::XMFLOAT3 normal{ geometricNormal };
+		if ( material.smoothShading ) {
+			const float w{ 1.f - hit.u - hit.v };
+			normal = Normalize( Add( Add( Scale( v0.normal, w ), Scale( v1.normal, hit.u ) ), Scale( v2.normal, hit.v ) ) );
+			if ( !entering )
+				normal = Scale( normal, -1.f );
+			// Interpolated normals can face away from the ray near silhouettes.
+			if ( Dot( normal, ray.direction ) >= 0.f )
+				normal = geometricNormal;
+		}
+
+		return { &material, Add( ray.origin, Scale( ray.direction, hit.t ) ), geometricNormal, normal, entering };
+	}
+
+	bool Tracer::Occluded( const Ray& ray, Triangle& occluder, ShadowContext& shadows ) const {
+		++shadows.rays;
+		Hit hit{};
+		hit.t = ray.tMax;
+		if ( occluderCache && occluder.primIdx != NoHit && IntersectTriangle( ray, occluder, hit ) ) {
+			++shadows.occluded;
+			++shadows.cacheHits;
+			return true;
+		}
+
+		hit = Hit{};
+		const TraversalMode mode{ RayTraversalMode() };
+		if ( !anyHitShadows )
+			IntersectClosest( ray, hit );
+		else if ( mode == TraversalMode::WideBVH )
+			m_wideBVH.IntersectAny( ray, hit );
+		else if ( mode == TraversalMode::QuantizedBVH )
+			m_quantizedBVH.IntersectAny( ray, hit );
+		else
+			m_bvh.IntersectAny( ray, hit );
+		if ( !hit.IsValid() )
+			return false;
+
+		++shadows.occluded;
+		if ( occluderCache ) {
+			const Mesh& mesh{ m_meshes[hit.instanceIdx] };
+			const uint32_t* indices{ &mesh.indices[static_cast<size_t>(hit.primIdx) * 3] };
+			const DirectX::XMFLOAT3& v0{ mesh.vertices[indices[0]].position };
+			occluder = { v0, Sub( mesh.vertices[indices[1]].position, v0 ), Sub( mesh.vertices[indices[2]].position, v0 ),
+				hit.primIdx, hit.instanceIdx };
+		}
+		return true;
+	}
+
+	float Tracer::LightIrradiance( const SurfaceHit& surface, uint32_t light, bool primary, ShadowContext& shadows ) const {
+		const DirectX::XMFLOAT3 origin{ Add( surface.position, Scale( surface.geometricNormal, SurfaceOffset ) ) };
+		const DirectX::XMFLOAT3 toLight{ Sub( lights[light].position, origin ) };
+		const float distanceSq{ Dot( toLight, toLight ) };
+		if ( distanceSq <= 0.f )
+			return 0.f;
+		const float distance{ std::sqrtf( distanceSq ) };
+		const DirectX::XMFLOAT3 direction{ Scale( toLight, 1.f / distance ) };
+
+		// Lights behind the surface need no shadow ray.
+		const float cosine{ Dot( direction, surface.normal ) };
+		if ( cosine <= 0.f || Dot( direction, surface.geometricNormal ) <= 0.f )
+			return 0.f;
+		if ( Occluded( Ray{ origin, Ray{}.tMin, direction, distance }, shadows.occluders[light * 2 + (primary ? 0 : 1)], shadows ) )
+			return 0.f;
+		return lights[light].intensity * cosine / (4.f * Pi * distanceSq);
+	}
+
+	float Tracer::DirectLight( const SurfaceHit& surface, bool primary, float u, ShadowContext& shadows ) const {
+		const uint32_t lightCount{ static_cast<uint32_t>(lights.size()) };
+		float irradiance{};
+		if ( lightSampling == LightSampling::All || lightCount <= lightSamples ) {
+			for ( uint32_t light{}; light < lightCount; ++light )
+				irradiance += LightIrradiance( surface, light, primary, shadows );
+			return irradiance;
+		}
+
+		// One sample per stratum of [0, 1), so the picked lights are spread over the distribution.
+		for ( unsigned sample{}; sample < lightSamples; ++sample ) {
+			const float stratum{ (sample + u) / lightSamples };
+			uint32_t light{ std::min( static_cast<uint32_t>(stratum * lightCount), lightCount - 1 ) };
+			float pdf{ 1.f / lightCount };
+			if ( lightSampling == LightSampling::Tree )
+				light = m_lightTree.Sample( surface.position, surface.normal, stratum, pdf );
+			if ( light != NoLight )
+				irradiance += LightIrradiance( surface, light, primary, shadows ) / pdf;
+		}
+		return irradiance / lightSamples;
+	}
+
+	Tracer::Scatter Tracer::ShadeMaterial( const PathRay& path, const Hit& hit, unsigned bounce, ShadowContext& shadows ) const {
+		Scatter scatter{};
+		const DirectX::XMFLOAT3& direction{ path.ray.direction };
+		if ( !hit.IsValid() ) {
+			scatter.color = Mul( path.throughput, UnpackColor( m_params.bgColorPacked ) );
+			return scatter;
+		}
+
+		const SurfaceHit surface{ GetSurface( path.ray, hit ) };
+		const Material& material{ *surface.material };
+		const DirectX::XMFLOAT3& normal{ surface.normal };
+		const auto spawn = [&]( const DirectX::XMFLOAT3& rayDirection, float side, const DirectX::XMFLOAT3& throughput ) {
+			if ( bounce >= maxBounces || std::max( { throughput.x, throughput.y, throughput.z } ) < MinThroughput )
+				return;
+			PathRay& ray{ scatter.rays[scatter.rayCount++] };
+			ray.ray = Ray{ Add( surface.position, Scale( surface.geometricNormal, side * SurfaceOffset ) ), Ray{}.tMin,
+				Normalize( rayDirection ), Ray{}.tMax };
+			ray.throughput = throughput;
+			ray.pixel = path.pixel;
+		};
+
+		switch ( material.type ) {
+			case MaterialType::Constant:
+				scatter.color = Mul( path.throughput, material.albedo );
+				break;
+			case MaterialType::Reflective:
+				spawn( Reflect( direction, normal ), 1.f, Mul( path.throughput, material.albedo ) );
+				break;
+			case MaterialType::Refractive: {
+				DirectX::XMFLOAT3 refracted;
+				float fresnel;
+				if ( !Refract( direction, normal, material.ior, surface.entering, refracted, fresnel ) ) {
+					spawn( Reflect( direction, normal ), 1.f, path.throughput );
+					break;
+				}
+				spawn( Reflect( direction, normal ), 1.f, Scale( path.throughput, fresnel ) );
+				spawn( refracted, -1.f, Scale( path.throughput, 1.f - fresnel ) );
+				break;
+			}
+			case MaterialType::Diffuse:
+			default:
+				// Scenes without lights are lit from the viewer.
+				scatter.color = Mul( path.throughput, lights.empty() ?
+					Scale( material.albedo, -Dot( direction, normal ) ) : Scale( material.albedo,
+					DirectLight( surface, bounce == 0, Sampler{ SamplerType::White, path.pixel, bounce, m_params.sampleIndex,
+						samplerSeed }.Get1D(), shadows ) ) );
+				break;
+		}
+		return scatter;
+	}
+
+	DirectX::XMFLOAT3 Tracer::TraceRadiance( const PathRay& path, unsigned bounce, uint64_t& rays, ShadowContext& shadows ) const {
+		Hit hit{};
+		IntersectClosest( path.ray, hit );
+		++rays;
+
+		const Scatter scatter{ ShadeMaterial( path, hit, bounce, shadows ) };
+		DirectX::XMFLOAT3 color{ scatter.color };
+		for ( uint32_t i{}; i < scatter.rayCount; ++i )
+			color = Add( color, TraceRadiance( scatter.rays[i], bounce + 1, rays, shadows ) );
+		return color;
+	}
+
+	void Tracer::TracePixel( unsigned x, unsigned y, uint32_t first, unsigned count, PixelSamples& sums, uint64_t& rays,
+		ShadowContext& shadows ) const {
+		for ( uint32_t sample{ first }; sample < first + count; ++sample ) {
+			Sampler sampler{ samplerType, x, y, sample, samplerSeed };
+			const DirectX::XMFLOAT2 jitter{ sampler.Get2D() };
+			PrimaryAOVs aovs{};
+			const DirectX::XMFLOAT3 color{ TracePath( GeneratePrimaryRay( x, y, jitter.x, jitter.y ), sampler, rays, shadows, aovs ) };
+			const float luminance{ std::min( 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z, 1.f ) };
+			sums.color = Add( sums.color, color );
+			sums.luminance += luminance;
+			sums.luminanceSq += luminance * luminance;
+			sums.aovs.albedo = Add( sums.aovs.albedo, aovs.albedo );
+			sums.aovs.normal = Add( sums.aovs.normal, aovs.normal );
+			sums.aovs.depth += aovs.depth;
+		}
+		sums.count += count;
+	}
+
+	void Tracer::SetDenoiserPixel( uint32_t index, const PixelSamples& sums ) {
+		const float scale{ 1.f / sums.count };
+		denoiser.SetPixel( index, Scale( sums.color, scale ), Scale( sums.aovs.albedo, scale ), Scale( sums.aovs.normal, scale ),
+			sums.aovs.depth * scale );
+	}
+
+	void Tracer::ApplyDenoiser() {
+		m_stats.denoiseMs = denoiser.Filter( *m_pool );
+		for ( unsigned y{}; y < m_region.height; ++y )
+			for ( unsigned x{}; x < m_region.width; ++x )
+				FramePixel( m_region.x + x, m_region.y + y ) =
+					PackColor( denoiser.GetPixel( y * m_region.width + x ) );
+	}
+
+	void Tracer::RenderBlockPaths( unsigned x0, unsigned y0, unsigned xEnd, unsigned yEnd, uint64_t& rays, ShadowContext& shadows ) {
+		const unsigned samples{ std::max( samplesPerPixel, 1u ) };
+		for ( unsigned y{ y0 }; y < yEnd; ++y ) {
+			for ( unsigned x{ x0 }; x < xEnd; ++x ) {
+				// Progressive frames continue the pixel's sequence.
+				PixelSamples sums{};
+				TracePixel( x, y, m_params.sampleIndex * samples, samples, sums, rays, shadows );
+				FramePixel( x, y ) = PackColor( Scale( sums.color, 1.f / samples ) );
+				if ( denoise )
+					SetDenoiserPixel( (y - m_region.y) * m_region.width + (x - m_region.x), sums );
+			}
+		}
+	}
+
+	void Tracer::RenderAdaptive( const RenderRegion& region ) {
+		using Clock = std::chrono::high_resolution_clock;
+		using Milliseconds = std::chrono::duration<double, std::milli>;
+		const Clock::time_point start{ Clock::now() };
+
+		const unsigned tileSize{ std::max( adaptiveTileSize, 1u ) };
+		const unsigned columns{ (region.width + tileSize - 1) / tileSize };
+		const uint32_t tileCount{ columns * ((region.height + tileSize - 1) / tileSize) };
+		// A single sample has no variance.
+		const unsigned baseSamples{ std::max( samplesPerPixel, 2u ) };
+		const unsigned maxSamples{ std::max( adaptiveMaxSamples, baseSamples ) };
+
+		m_pixelSamples.assign( static_cast<size_t>(region.width) * region.height, {} );
+		m_stats.tileColumns = columns;
+		m_stats.tileSamples.assign( tileCount, 0 );
+		std::vector<float> errors( tileCount );
+
+		// Padded, so threads don't share cache lines while they update their statistics.
+		struct alignas(64) WorkerStats {
+			uint64_t rays{};
+			ShadowContext shadows{};
+		};
+		std::vector<WorkerStats> workerStats( m_pool->GetThreadCount() );
+		for ( WorkerStats& stats : workerStats )
+			stats.shadows.Reset( lights.size() );
+
+		const auto overBudget = [&]() {
+			return adaptiveTimeBudgetMs > 0.0 && Milliseconds{ Clock::now() - start }.count() >= adaptiveTimeBudgetMs;
+		};
+
+		std::vector<uint32_t> active( tileCount );
+		std::iota( active.begin(), active.end(), 0u );
+		for ( unsigned pass{};; ++pass ) {
+			m_pool->ParallelFor( static_cast<uint32_t>(active.size()), [&]( uint32_t index, unsigned worker ) {
+				// The base pass always completes, refinement stops when the budget runs out.
+				if ( pass > 0 && overBudget() )
+					return;
+
+				const uint32_t tile{ active[index] };
+				const unsigned done{ m_stats.tileSamples[tile] };
+				const unsigned count{ done == 0 ? baseSamples : std::min( done, maxSamples - done ) };
+				const unsigned x0{ region.x + (tile % columns) * tileSize };
+				const unsigned y0{ region.y + (tile / columns) * tileSize };
+				const unsigned xEnd{ std::min( x0 + tileSize, region.x + region.width ) };
+				const unsigned yEnd{ std::min( y0 + tileSize, region.y + region.height ) };
+
+				const float samples{ static_cast<float>(done + count) };
+				float errorSq{};
+				for ( unsigned y{ y0 }; y < yEnd; ++y ) {
+					for ( unsigned x{ x0 }; x < xEnd; ++x ) {
+						PixelSamples& sums{ m_pixelSamples[static_cast<size_t>(y - region.y) * region.width + (x - region.x)] };
+						TracePixel( x, y, m_params.sampleIndex * maxSamples + done, count, sums, workerStats[worker].rays,
+							workerStats[worker].shadows );
+						FramePixel( x, y ) = PackColor( Scale( sums.color, 1.f / samples ) );
+
+						// Sample variance of the luminance over the samples is the variance of the pixel's mean.
+						const float mean{ sums.luminance / samples };
+						errorSq += std::max( sums.luminanceSq / samples - mean * mean, 0.f ) / (samples - 1.f);
+					}
+				}
+				m_stats.tileSamples[tile] = done + count;
+				errors[tile] = std::sqrtf( errorSq / ((xEnd - x0) * (yEnd - y0)) );
+			} );
+
+			std::erase_if( active, [&]( uint32_t tile ) {
+				return errors[tile] <= adaptiveErrorThreshold || m_stats.tileSamples[tile] >= maxSamples;
+			} );
+			if ( active.empty() || overBudget() )
+				break;
+			++m_stats.adaptivePasses;
+		}
+
+		if ( denoise )
+			for ( uint32_t pixel{}; pixel < m_pixelSamples.size(); ++pixel )
+				SetDenoiserPixel( pixel, m_pixelSamples[pixel] );
+
+		for ( uint32_t tile{}; tile < tileCount; ++tile ) {
+			const unsigned x0{ (tile % columns) * tileSize };
+			const unsigned y0{ (tile / columns) * tileSize };
+			m_stats.samples += static_cast<uint64_t>(m_stats.tileSamples[tile]) *
+				(std::min( x0 + tileSize, region.width ) - x0) * (std::min( y0 + tileSize, region.height ) - y0);
+		}
+		for ( const WorkerStats& stats : workerStats ) {
+			m_stats.rays += stats.rays;
+			m_stats.shadowRays += stats.shadows.rays;
+			m_stats.occludedShadowRays += stats.shadows.occluded;
+			m_stats.occluderCacheHits += stats.shadows.cacheHits;
+		}
+	}
+
+	DirectX::XMFLOAT3 Tracer::TracePath( Ray ray, Sampler& sampler, uint64_t& rays, ShadowContext& shadows,
+		PrimaryAOVs& aovs ) const {
+		DirectX::XMFLOAT3 throughput{ 1.f, 1.f, 1.f };
+		DirectX::XMFLOAT3 radiance{};
+		for ( unsigned bounce{};; ++bounce ) {
+			Hit hit{};
+			IntersectClosest( ray, hit );
+			++rays;
+			if ( !hit.IsValid() ) {
+				if ( bounce == 0 )
+					aovs = { UnpackColor( m_params.bgColorPacked ), {}, MissDepth };
+				return Add( radiance, Mul( throughput, UnpackColor( m_params.bgColorPacked ) ) );
+			}
+
+			// Point lights can't be hit by bounced rays, so they are only reached through shadow rays.
+			// The background and constant materials are lit by hitting them.
+			const SurfaceHit surface{ GetSurface( ray, hit ) };
+			const Material& material{ *surface.material };
+			if ( bounce == 0 )
+				aovs = { material.albedo, surface.normal, hit.t };
+			if ( material.type == MaterialType::Constant )
+				return Add( radiance, Mul( throughput, material.albedo ) );
+			if ( material.type == MaterialType::Diffuse && !lights.empty() ) {
+				sampler.SetDimension( BounceDimension( bounce, LightDimension ) );
+				radiance = Add( radiance, Mul( throughput, Scale( material.albedo,
+					DirectLight( surface, bounce == 0, sampler.Get1D(), shadows ) ) ) );
+			}
+			if ( bounce >= maxBounces )
+				return radiance;
+
+			DirectX::XMFLOAT3 direction{};
+			float side{ 1.f };
+			switch ( material.type ) {
+				case MaterialType::Reflective:
+					direction = Reflect( ray.direction, surface.normal );
+					throughput = Mul( throughput, material.albedo );
+					break;
+				case MaterialType::Refractive: {
+					// Reflects with the Fresnel reflectance as probability, which cancels the Fresnel weight.
+					DirectX::XMFLOAT3 refracted;
+					float fresnel;
+					sampler.SetDimension( BounceDimension( bounce, FresnelDimension ) );
+					if ( Refract( ray.direction, surface.normal, material.ior, surface.entering, refracted, fresnel ) &&
+						sampler.Get1D() >= fresnel ) {
+						direction = refracted;
+						side = -1.f;
+					}
+					else {
+						direction = Reflect( ray.direction, surface.normal );
+					}
+					break;
+				}
+				case MaterialType::Diffuse:
+				default: {
+					sampler.SetDimension( BounceDimension( bounce, DirectionDimension ) );
+					const DirectX::XMFLOAT2 u{ sampler.Get2D() };
+					direction = SampleCosineHemisphere( surface.normal, u.x, u.y );
+					throughput = Mul( throughput, material.albedo );
+					break;
+				}
+			}
+
+			// Russian roulette. Dim paths end early, survivors carry the energy of the ended ones.
+			if ( bounce + 1 >= russianRouletteDepth ) {
+				const float survival{ std::min( std::max( { throughput.x, throughput.y, throughput.z } ), MaxSurvival ) };
+				sampler.SetDimension( BounceDimension( bounce, RouletteDimension ) );
+				if ( sampler.Get1D() >= survival )
+					return radiance;
+				throughput = Scale( throughput, 1.f / survival );
+			}
+
+			ray = Ray{ Add( surface.position, Scale( surface.geometricNormal, side * SurfaceOffset ) ), Ray{}.tMin,
+				Normalize( direction ), Ray{}.tMax };
+		}
+	}
+
+	void Tracer::RenderWavefront( const RenderRegion& region ) {
+		using Clock = std::chrono::high_resolution_clock;
+		using Milliseconds = std::chrono::duration<double, std::milli>;
+
+		const uint32_t pixelCount{ region.width * region.height };
+		const uint32_t batchSize{ std::max( wavefrontBatchSize, ChunkSize ) };
+		m_radiance.assign( pixelCount, {} );
+		m_wavefrontShadows.resize( m_pool->GetThreadCount() );
+		for ( ShadowContext& shadows : m_wavefrontShadows )
+			shadows.Reset( lights.size() );
+
+		for ( uint32_t first{}; first < pixelCount; first += batchSize ) {
+			// Primary rays in scanline order, so consecutive rays are already coherent.
+			m_rayCount = std::min( batchSize, pixelCount - first );
+			GrowBuffer( m_rays, m_rayCount );
+			m_pool->ParallelFor( ChunkCount( m_rayCount ), [&]( uint32_t chunk, unsigned ) {
+				const uint32_t end{ std::min( (chunk + 1) * ChunkSize, m_rayCount ) };
+				for ( uint32_t i{ chunk * ChunkSize }; i < end; ++i ) {
+					const uint32_t pixel{ first + i };
+					m_rays[i] = { GeneratePrimaryRay( region.x + pixel % region.width, region.y + pixel / region.width ),
+						{ 1.f, 1.f, 1.f }, pixel };
+				}
+			} );
+
+			for ( unsigned bounce{}; m_rayCount > 0; ++bounce ) {
+				m_stats.rays += m_rayCount;
+				m_stats.bounces = std::max( m_stats.bounces, bounce );
+
+				const Clock::time_point sortStart{ Clock::now() };
+				if ( wavefrontSorting && bounce > 0 )
+					SortRays();
+
+				const Clock::time_point traceStart{ Clock::now() };
+				TraceRays( m_stats.packetStats );
+
+				const Clock::time_point shadeStart{ Clock::now() };
+				ShadeRays( bounce );
+
+				const Clock::time_point shadeEnd{ Clock::now() };
+				m_stats.sortMs += Milliseconds{ traceStart - sortStart }.count();
+				m_stats.traceMs += Milliseconds{ shadeStart - traceStart }.count();
+				m_stats.shadeMs += Milliseconds{ shadeEnd - shadeStart }.count();
+			}
+		}
+
+		for ( uint32_t pixel{}; pixel < pixelCount; ++pixel ) {
+			FramePixel( region.x + pixel % region.width, region.y + pixel / region.width ) = PackColor( m_radiance[pixel] );
+		}
+
+		for ( const ShadowContext& shadows : m_wavefrontShadows ) {
+			m_stats.shadowRays += shadows.rays;
+			m_stats.occludedShadowRays += shadows.occluded;
+			m_stats.occluderCacheHits += shadows.cacheHits;
+		}
+	}
+
+	void Tracer::SortRays() {
+		const uint32_t count{ m_rayCount };
+
+		// Rays with equal direction signs first, so packets of sorted rays stay coherent.
+		// Within an octant, rays starting close to each other visit the same nodes.
+		const AABB bounds{ m_bvh.GetBounds() };
+		const DirectX::XMFLOAT3 invExtent{
+			1.f / std::max( bounds.max.x - bounds.min.x, 1e-6f ),
+			1.f / std::max( bounds.max.y - bounds.min.y, 1e-6f ),
+			1.f / std::max( bounds.max.z - bounds.min.z, 1e-6f ) };
+		GrowBuffer( m_sortKeys, count );
+		GrowBuffer( m_order, count );
+		GrowBuffer( m_orderScratch, count );
+		m_pool->ParallelFor( ChunkCount( count ), [&]( uint32_t chunk, unsigned ) {
+			const uint32_t end{ std::min( (chunk + 1) * ChunkSize, count ) };
+			for ( uint32_t i{ chunk * ChunkSize }; i < end; ++i ) {
+				const Ray& ray{ m_rays[i].ray };
+				const uint32_t octant{
+					(ray.direction.x < 0.f ? 1u : 0u) | (ray.direction.y < 0.f ? 2u : 0u) | (ray.direction.z < 0.f ? 4u : 0u) };
+				const uint32_t morton{
+					SpreadBits( GridCell( ray.origin.x, bounds.min.x, invExtent.x ) ) |
+					(SpreadBits( GridCell( ray.origin.y, bounds.min.y, invExtent.y ) ) << 1) |
+					(SpreadBits( GridCell( ray.origin.z, bounds.min.z, invExtent.z ) ) << 2) };
+				m_sortKeys[i] = (octant << (3 * SortGridBits)) | morton;
+				m_order[i] = i;
+			}
+		} );
+
+		// LSD radix sort of the ray indices. Stable, so equal keys keep their previous order.
+		constexpr uint32_t buckets{ 1u << RadixBits };
+		uint32_t histogram[buckets];
+		for ( uint32_t shift{}; shift < 3 * SortGridBits + 3; shift += RadixBits ) {
+			std::fill( std::begin( histogram ), std::end( histogram ), 0u );
+			for ( uint32_t i{}; i < count; ++i )
+				++histogram[(m_sortKeys[m_order[i]] >> shift) & (buckets - 1)];
+			uint32_t offset{};
+			for ( uint32_t& bucket : histogram ) {
+				const uint32_t size{ bucket };
+				bucket = offset;
+				offset += size;
+			}
+			for ( uint32_t i{}; i < count; ++i )
+				m_orderScratch[histogram[(m_sortKeys[m_order[i]] >> shift) & (buckets - 1)]++] = m_order[i];
+			m_order.swap( m_orderScratch );
+		}
+
+		GrowBuffer( m_raysScratch, count );
+		m_pool->ParallelFor( ChunkCount( count ), [&]( uint32_t chunk, unsigned ) {
+			const uint32_t end{ std::min( (chunk + 1) * ChunkSize, count ) };
+			for ( uint32_t i{ chunk * ChunkSize }; i < end; ++i )
+				m_raysScratch[i] = m_rays[m_order[i]];
+		} );
+		m_rays.swap( m_raysScratch );
+	}
+
+	void Tracer::TraceRays( PacketStats& stats ) {
+		const uint32_t count{ m_rayCount };
+		GrowBuffer( m_hits, count );
+
+		const auto tracePackets = [&]<unsigned N>( uint32_t begin, uint32_t end, PacketStats& workerStats ) {
+			RayPacket<N> packet;
+			for ( uint32_t first{ begin }; first < end; first += N ) {
+				// Lanes past the end repeat the last ray to keep the packet coherent.
+				for ( unsigned lane{}; lane < N; ++lane ) {
+					const Ray& ray{ m_rays[std::min( first + lane, end - 1 )].ray };
+					packet.ox[lane] = ray.origin.x;
+					packet.oy[lane] = ray.origin.y;
+					packet.oz[lane] = ray.origin.z;
+					packet.dx[lane] = ray.direction.x;
+					packet.dy[lane] = ray.direction.y;
+					packet.dz[lane] = ray.direction.z;
+				}
+				packet.tMin = Ray{}.tMin;
+				packet.ResetHits( Ray{}.tMax );
+
+				m_bvh.IntersectPacket( packet, &workerStats );
+
+				for ( unsigned lane{}; lane < N && first + lane < end; ++lane ) {
+					Hit& hit{ m_hits[first + lane] };
+					hit.t = packet.tMax[lane];
+					hit.u = packet.u[lane];
+					hit.v = packet.v[lane];
+					hit.primIdx = packet.primIdx[lane];
+					hit.instanceIdx = packet.instanceIdx[lane];
+				}
+			}
+		};
+
+		std::vector<PacketStats> workerStats( m_pool->GetThreadCount() );
+		m_pool->ParallelFor( ChunkCount( count ), [&]( uint32_t chunk, unsigned worker ) {
+			const uint32_t begin{ chunk * ChunkSize };
+			const uint32_t end{ std::min( begin + ChunkSize, count ) };
+			switch ( traversalMode ) {
+				case TraversalMode::Packet4:
+					tracePackets.template operator()<4>( begin, end, workerStats[worker] );
+					break;
+				case TraversalMode::Packet8:
+					tracePackets.template operator()<8>( begin, end, workerStats[worker] );
+					break;
+				case TraversalMode::Packet16:
+					tracePackets.template operator()<16>( begin, end, workerStats[worker] );
+					break;
+				default:
+					for ( uint32_t i{ begin }; i < end; ++i ) {
+						m_hits[i] = Hit{};
+						IntersectClosest( m_rays[i].ray, m_hits[i] );
+					}
+					break;
+			}
+		} );
+		for ( const PacketStats& worker : workerStats )
+			stats += worker;
+	}
+
+	void Tracer::ShadeRays( unsigned bounce ) {
+		const uint32_t count{ m_rayCount };
+		const uint32_t chunks{ ChunkCount( count ) };
+
+		// Every chunk is shaded sorted by material, so each material's branch runs over consecutive rays.
+		// Sorting within the chunk keeps its rays in cache, which a global sort would scatter.
+		// Unknown materials share a slot, misses go last. Results are stored in shading order.
+		const uint32_t materialSlots{ static_cast<uint32_t>(materials.size()) + 2 };
+		std::vector<std::vector<uint32_t>> slotOffsets( m_pool->GetThreadCount(), std::vector<uint32_t>( materialSlots + 1 ) );
+		GrowBuffer( m_sortKeys, count );
+		GrowBuffer( m_order, count );
+		GrowBuffer( m_pixelColors, count );
+		GrowBuffer( m_spawnedRays, static_cast<size_t>(count) * 2 );
+		GrowBuffer( m_spawnCounts, count );
+		GrowBuffer( m_chunkOffsets, static_cast<size_t>(chunks) + 1 );
+		m_chunkOffsets[0] = 0;
+		m_pool->ParallelFor( chunks, [&]( uint32_t chunk, unsigned worker ) {
+			const uint32_t begin{ chunk * ChunkSize };
+			const uint32_t end{ std::min( begin + ChunkSize, count ) };
+
+			std::vector<uint32_t>& offsets{ slotOffsets[worker] };
+			std::fill( offsets.begin(), offsets.end(), 0u );
+			for ( uint32_t i{ begin }; i < end; ++i ) {
+				const Hit& hit{ m_hits[i] };
+				m_sortKeys[i] = hit.IsValid() ?
+					std::min( m_meshes[hit.instanceIdx].materialIdx, materialSlots - 2 ) : materialSlots - 1;
+				++offsets[m_sortKeys[i] + 1];
+			}
+			offsets[0] = begin;
+			for ( uint32_t slot{}; slot < materialSlots; ++slot )
+				offsets[slot + 1] += offsets[slot];
+			for ( uint32_t i{ begin }; i < end; ++i )
+				m_order[offsets[m_sortKeys[i]]++] = i;
+
+			uint32_t spawned{};
+			for ( uint32_t i{ begin }; i < end; ++i ) {
+				const uint32_t ray{ m_order[i] };
+				const Scatter scatter{ ShadeMaterial( m_rays[ray], m_hits[ray], bounce, m_wavefrontShadows[worker] ) };
+				m_pixelColors[i] = { scatter.color, m_rays[ray].pixel };
+				m_spawnCounts[i] = static_cast<uint8_t>(scatter.rayCount);
+				for ( uint32_t j{}; j < scatter.rayCount; ++j )
+					m_spawnedRays[static_cast<size_t>(i) * 2 + j] = scatter.rays[j];
+				spawned += scatter.rayCount;
+			}
+			m_chunkOffsets[chunk + 1] = spawned;
+		} );
+
+		// Several rays of one bounce may belong to the same pixel, so colors are added serially.
+		// It is a single add per ray, next to nothing compared to tracing it.
+		for ( uint32_t i{}; i < count; ++i ) {
+			DirectX::XMFLOAT3& radiance{ m_radiance[m_pixelColors[i].pixel] };
+			radiance = Add( radiance, m_pixelColors[i].color );
+		}
+
+		// Compaction: every chunk writes its spawned rays at its prefix sum, keeping the shading order.
+		for ( uint32_t chunk{}; chunk < chunks; ++chunk )
+			m_chunkOffsets[chunk + 1] += m_chunkOffsets[chunk];
+		const uint32_t spawnedCount{ m_chunkOffsets[chunks] };
+		GrowBuffer( m_raysScratch, spawnedCount );
+		m_pool->ParallelFor( chunks, [&]( uint32_t chunk, unsigned ) {
+			const uint32_t end{ std::min( (chunk + 1) * ChunkSize, count ) };
+			uint32_t offset{ m_chunkOffsets[chunk] };
+			for ( uint32_t i{ chunk * ChunkSize }; i < end; ++i )
+				for ( uint32_t j{}; j < m_spawnCounts[i]; ++j )
+					m_raysScratch[offset++] = m_spawnedRays[static_cast<size_t>(i) * 2 + j];
+		} );
+		m_rays.swap( m_raysScratch );
+		m_rayCount = spawnedCount;
+	}
+}
@@ -0,0 +1,554 @@
+#include "CPUTracer.hpp" // Tracer, FrameParams, TraversalMode
+
+#include <algorithm> // min, max, sort, equal
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // tanf, sqrtf, floor, atan2, abs
+#include <cstring> // memcmp
+#include <filesystem> // path
+#include <format> // format
+#include <fstream> // ofstream
+#include <iterator> // size
+#include <numeric> // iota
+#include <thread> // hardware_concurrency
+#include <utility> // pair, swap
+
+
+namespace CPU {
+	namespace {
+		/// Bucket sizes tried by the auto-tuning, in order. Multiples of every packet footprint.
+		constexpr unsigned BucketSizeCandidates[]{ 32, 16, 64, 8 };
+
+		/// Packet footprint width in pixels. 4 -> 2x2, 8 -> 4x2, 16 -> 4x4.
+		template <unsigned N>
+		constexpr unsigned PacketWidth() {
+			return N == 4 ? 2 : 4;
+		}
+
+		/// Clips the region to the frame. An empty region selects the whole frame.
+		RenderRegion ClampRegion( const RenderRegion& region, unsigned width, unsigned height ) {
+			if ( region.width == 0 || region.height == 0 )
+				return { 0, 0, width, height };
+
+			const unsigned x{ std::min( region.x, width ) };
+			const unsigned y{ std::min( region.y, height ) };
+			return { x, y, std::min( region.width, width - x ), std::min( region.height, height - y ) };
+		}
+
+		/// Index of cell (x, y) along the Hilbert curve filling an n x n grid, n a power of two.
+		uint32_t HilbertIndex( uint32_t n, uint32_t x, uint32_t y ) {
+			uint32_t index{};
+			for ( uint32_t s{ n / 2 }; s > 0; s /= 2 ) {
+				const uint32_t rx{ (x & s) ? 1u : 0u };
+				const uint32_t ry{ (y & s) ? 1u : 0u };
+				index += s * s * ((3 * rx) ^ ry);
+				// Rotate the quadrant, so the curve inside it starts next to the previous one.
+				if ( ry == 0 ) {
+					if ( rx == 1 ) {
+						x = n - 1 - x;
+						y = n - 1 - y;
+					}
+					std::swap( x, y );
+				}
+			}
+			return index;
+		}
+
+		/// Bucket indices (row-major in the bucket grid) in the order they are handed out.
+		std::vector<uint32_t> OrderBuckets( BucketOrder order, unsigned bucketsX, unsigned bucketsY ) {
+			std::vector<uint32_t> buckets( static_cast<size_t>(bucketsX) * bucketsY );
+			std::iota( buckets.begin(), buckets.end(), 0u );
+
+			if ( order == BucketOrder::Hilbert ) {
+				uint32_t n{ 1 };
+				while ( n < std::max( bucketsX, bucketsY ) )
+					n *= 2;
+				std::vector<uint32_t> keys( buckets.size() );
+				for ( uint32_t bucket : buckets )
+					keys[bucket] = HilbertIndex( n, bucket % bucketsX, bucket / bucketsX );
+				std::sort( buckets.begin(), buckets.end(),
+					[&keys]( uint32_t a, uint32_t b ) { return keys[a] < keys[b]; } );
+			} else if ( order == BucketOrder::Spiral ) {
+				// Ring around the center first, then the angle within the ring.
+				std::vector<std::pair<float, float>> keys( buckets.size() );
+				for ( uint32_t bucket : buckets ) {
+					const float dx{ (bucket % bucketsX) + 0.5f - bucketsX * 0.5f };
+					const float dy{ (bucket / bucketsX) + 0.5f - bucketsY * 0.5f };
+					keys[bucket] = { std::floor( std::max( std::abs( dx ), std::abs( dy ) ) ), std::atan2( dy, dx ) };
+				}
+				std::sort( buckets.begin(), buckets.end(),
+					[&keys]( uint32_t a, uint32_t b ) { return keys[a] < keys[b]; } );
+			}
+			return buckets;
+		}
+	}
+
+	const char* ToString( TraversalMode mode ) {
+		switch ( mode ) {
+			case TraversalMode::SingleRay:
+				return "Single ray";
+			case TraversalMode::Packet4:
+				return "Packet 4 (2x2)";
+			case TraversalMode::Packet8:
+				return "Packet 8 (4x2)";
+			case TraversalMode::Packet16:
+				return "Packet 16 (4x4)";
+			case TraversalMode::WideBVH:
+				return "Wide BVH";
+			case TraversalMode::QuantizedBVH:
+				return "Quantized BVH";
+			default:
+				return "Unknown";
+		}
+	}
+
+	const char* ToString( BucketOrder order ) {
+		switch ( order ) {
+			case BucketOrder::Scanline:
+				return "Scanline";
+			case BucketOrder::Hilbert:
+				return "Hilbert";
+			case BucketOrder::Spiral:
+				return "Spiral";
+			default:
+				return "Unknown";
+		}
+	}
+
+	const char* ToString( Integrator integrator ) {
+		switch ( integrator ) {
+			case Integrator::Primary:
+				return "Primary";
+			case Integrator::Megakernel:
+				return "Megakernel";
+			case Integrator::Wavefront:
+				return "Wavefront";
+			case Integrator::PathTracer:
+				return "PathTracer";
+			default:
+				return "Unknown";
+		}
+	}
+
+	const char* ToString( LightSampling sampling ) {
+		switch ( sampling ) {
+			case LightSampling::All:
+				return "All";
+			case LightSampling::Uniform:
+				return "Uniform";
+			case LightSampling::Tree:
+				return "Tree";
+			default:
+				return "Unknown";
+		}
+	}
+
+	void Tracer::BuildAccelerationStructure( const std::vector<Mesh>& meshes ) {
+		const std::chrono::high_resolution_clock::time_point start{
+			std::chrono::high_resolution_clock::now() };
+
+		m_wideBVHBuilt = false;
+		m_visibilityKey.valid = false;
+		m_meshes = meshes;
+		uint64_t cacheKey{};
+		std::filesystem::path cachePath{};
+		bool fromCache{ false };
+		if ( !bvhCacheDirectory.empty() ) {
+			cacheKey = BVH::ComputeCacheKey( meshes, bvhSettings );
+			cachePath = std::filesystem::path{ bvhCacheDirectory } / std::format( "{:016x}.bvh", cacheKey );
+			fromCache = m_bvh.LoadCache( cachePath, cacheKey, meshes );
+		}
+		if ( !fromCache )
+			m_bvh.Build( meshes, bvhSettings );
+
+		const std::chrono::duration<double, std::milli> duration{
+			std::chrono::high_resolution_clock::now() - start };
+		log( std::format( "[ CPU Tracer ] BVH {}: {} triangle references, {} nodes, {:.2f} ms.",
+			fromCache ? "loaded from cache" : "built", m_bvh.GetTriangles().size(), m_bvh.GetNodes().size(),
+			duration.count() ) );
+
+		if ( !fromCache && !cachePath.empty() && !m_bvh.GetNodes().empty() && !m_bvh.SaveCache( cachePath, cacheKey ) )
+			log( std::format( "[ CPU Tracer ] Could not write the BVH cache file {}.", cachePath.string() ),
+				LogLevel::Warning );
+	}
+
+	void Tracer::BuildWideBVH() {
+		m_wideBVH.Build( m_bvh, wideBVHWidth );
+		m_wideBVHBuiltWidth = wideBVHWidth;
+		m_quantizedBVHBuilt = m_quantizedBVH.Build( m_wideBVH );
+		m_wideBVHBuilt = true;
+
+		log( std::format( "[ CPU Tracer ] Collapsed to BVH{}: {} nodes, {} KiB.",
+			m_wideBVH.GetWidth(), m_wideBVH.GetNodeCount(), m_wideBVH.GetMemoryUsage() / 1024 ) );
+		if ( m_quantizedBVHBuilt )
+			log( std::format( "[ CPU Tracer ] Quantized nodes: {} KiB instead of {} KiB.",
+				m_quantizedBVH.GetNodeMemoryUsage() / 1024, m_wideBVH.GetNodeMemoryUsage() / 1024 ) );
+		else
+			log( "[ CPU Tracer ] A leaf is too large for quantized nodes. Quantized traversal uses the wide BVH instead.",
+				LogLevel::Warning );
+	}
+
+	void Tracer::RenderFrame( const FrameParams& params, unsigned width, unsigned height ) {
+		const bool wideMode{ traversalMode == TraversalMode::WideBVH || traversalMode == TraversalMode::QuantizedBVH };
+		if ( wideMode && (!m_wideBVHBuilt || m_wideBVHBuiltWidth != wideBVHWidth) )
+			BuildWideBVH();
+
+		m_params = params;
+		m_width = width;
+		m_height = height;
+		m_tanHalfFOV = std::tanf( params.camera.verticalFOV * 0.5f );
+		m_frameBuffer.assign( static_cast<size_t>(width) * height, params.bgColorPacked );
+		if ( tiledFrameBuffer )
+			m_tiledFrame.Resize( width, height );
+		m_stats = {};
+
+		// Light positions and intensities are edited between frames, the tree follows them.
+		const bool lightsChanged{ !std::equal( lights.begin(), lights.end(), m_lightTreeLights.begin(), m_lightTreeLights.end(),
+			[]( const Light& a, const Light& b ) {
+				return a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z &&
+					a.intensity == b.intensity;
+			} ) };
+		if ( lightSampling == LightSampling::Tree && lightsChanged ) {
+			m_lightTree.Build( lights );
+			m_lightTreeLights = lights;
+		}
+
+		const std::chrono::high_resolution_clock::time_point start{
+			std::chrono::high_resolution_clock::now() };
+
+		const RenderRegion region{ ClampRegion( crop, width, height ) };
+		m_region = region;
+		if ( region.width == 0 || region.height == 0 )
+			return;
+
+		const unsigned desiredThreads{ std::max( 1u, threadCount ? threadCount : std::thread::hardware_concurrency() ) };
+		if ( !m_pool || m_pool->GetThreadCount() != desiredThreads )
+			m_pool = std::make_unique<ThreadPool>( desiredThreads );
+
+		// The wavefront integrator streams the whole region, it has no buckets.
+		if ( integrator == Integrator::Wavefront ) {
+			RenderWavefront( region );
+			LinearizeFrame( region );
+			m_stats.renderMs = std::chrono::duration<double, std::milli>{
+				std::chrono::high_resolution_clock::now() - start }.count();
+			m_stats.loadImbalance = 1.0;
+			return;
+		}
+		// Only the shading inputs changed since the visibility buffer was traced: shade it again.
+		const bool keepVisibility{ integrator == Integrator::Primary && visibilityBuffer };
+		if ( keepVisibility && VisibilityMatches( region ) ) {
+			ReshadeRegion( region );
+			LinearizeFrame( region );
+			m_stats.renderMs = std::chrono::duration<double, std::milli>{
+				std::chrono::high_resolution_clock::now() - start }.count();
+			m_stats.reshaded = true;
+			m_stats.loadImbalance = 1.0;
+			return;
+		}
+		if ( keepVisibility ) {
+			m_visibilityKey = { params.camera, width, height, region, true };
+			m_visibility.resize( static_cast<size_t>(width) * height );
+		}
+
+		const bool denoising{ denoise && integrator == Integrator::PathTracer };
+		if ( denoising )
+			denoiser.Resize( region.width, region.height );
+		if ( integrator == Integrator::PathTracer && adaptiveSampling ) {
+			RenderAdaptive( region );
+			if ( denoising )
+				ApplyDenoiser();
+			LinearizeFrame( region );
+			m_stats.renderMs = std::chrono::duration<double, std::milli>{
+				std::chrono::high_resolution_clock::now() - start }.count();
+			m_stats.loadImbalance = 1.0;
+			return;
+		}
+
+		const unsigned size{ SelectBucketSize( region ) };
+		const unsigned bucketsX{ (region.width + size - 1) / size };
+		const unsigned bucketsY{ (region.height + size - 1) / size };
+		const std::vector<uint32_t> buckets{ OrderBuckets( bucketOrder, bucketsX, bucketsY ) };
+
+		// Padded, so threads don't share cache lines while they update their statistics.
+		struct alignas(64) WorkerStats {
+			PacketStats packetStats{};
+			uint64_t rays{};
+			double renderMs{};
+			ShadowContext shadows{};
+		};
+		std::vector<WorkerStats> workerStats( m_pool->GetThreadCount() );
+		for ( WorkerStats& stats : workerStats )
+			stats.shadows.Reset( lights.size() );
+
+		m_stats.steals = m_pool->ParallelFor( static_cast<uint32_t>(buckets.size()),
+			[&]( uint32_t index, unsigned worker ) {
+				const std::chrono::high_resolution_clock::time_point bucketStart{
+					std::chrono::high_resolution_clock::now() };
+
+				const uint32_t bucket{ buckets[index] };
+				const unsigned x0{ region.x + (bucket % bucketsX) * size };
+				const unsigned y0{ region.y + (bucket / bucketsX) * size };
+				RenderBlock( x0, y0, std::min( x0 + size, region.x + region.width ),
+					std::min( y0 + size, region.y + region.height ), workerStats[worker].packetStats,
+					workerStats[worker].rays, workerStats[worker].shadows );
+
+				workerStats[worker].renderMs += std::chrono::duration<double, std::milli>{
+					std::chrono::high_resolution_clock::now() - bucketStart }.count();
+			} );
+
+		if ( denoising )
+			ApplyDenoiser();
+		LinearizeFrame( region );
+
+		double totalMs{};
+		double busiestMs{};
+		for ( const WorkerStats& stats : workerStats ) {
+			m_stats.packetStats += stats.packetStats;
+			m_stats.rays += stats.rays;
+			m_stats.shadowRays += stats.shadows.rays;
+			m_stats.occludedShadowRays += stats.shadows.occluded;
+			m_stats.occluderCacheHits += stats.shadows.cacheHits;
+			totalMs += stats.renderMs;
+			busiestMs = std::max( busiestMs, stats.renderMs );
+		}
+
+		const std::chrono::duration<double, std::milli> duration{
+			std::chrono::high_resolution_clock::now() - start };
+		m_stats.renderMs = duration.count();
+		m_stats.bucketSize = size;
+		m_stats.buckets = static_cast<uint32_t>(buckets.size());
+		m_stats.loadImbalance = totalMs > 0.0 ? busiestMs * workerStats.size() / totalMs : 1.0;
+		if ( integrator == Integrator::PathTracer )
+			m_stats.samples = static_cast<uint64_t>(region.width) * region.height * std::max( samplesPerPixel, 1u );
+
+		if ( bucketSize == 0 )
+			UpdateBucketTuning( size, m_stats.renderMs );
+	}
+
+	unsigned Tracer::SelectBucketSize( const RenderRegion& region ) {
+		if ( bucketSize > 0 )
+			return bucketSize;
+
+		const unsigned threads{ m_pool->GetThreadCount() };
+		if ( m_tuning.regionWidth != region.width || m_tuning.regionHeight != region.height ||
+			m_tuning.threads != threads || m_tuning.mode != traversalMode || m_tuning.integrator != integrator )
+			m_tuning = { region.width, region.height, threads, traversalMode, integrator };
+
+		constexpr unsigned candidateCount{ static_cast<unsigned>(std::size( BucketSizeCandidates )) };
+		return m_tuning.step < candidateCount ? BucketSizeCandidates[m_tuning.step] : m_tuning.bestSize;
+	}
+
+	void Tracer::UpdateBucketTuning( unsigned size, double renderMs ) {
+		constexpr unsigned candidateCount{ static_cast<unsigned>(std::size( BucketSizeCandidates )) };
+		if ( m_tuning.step >= candidateCount )
+			return;
+
+		if ( renderMs < m_tuning.bestMs ) {
+			m_tuning.bestMs = renderMs;
+			m_tuning.bestSize = size;
+		}
+		if ( ++m_tuning.step == candidateCount )
+			log( std::format( "[ CPU Tracer ] Auto-tuned bucket size: {} ({:.2f} ms).",
+				m_tuning.bestSize, m_tuning.bestMs ) );
+	}
+
+	void Tracer::RenderBlock( unsigned x0, unsigned y0, unsigned xEnd, unsigned yEnd, PacketStats& stats, uint64_t& rays,
+		ShadowContext& shadows ) {
+		if ( integrator == Integrator::Megakernel ) {
+			// Pixels are numbered in the render region, like in the wavefront integrator, so both pick the same lights.
+			for ( unsigned y{ y0 }; y < yEnd; ++y ) {
+				for ( unsigned x{ x0 }; x < xEnd; ++x ) {
+					const PathRay path{ GeneratePrimaryRay( x, y ), { 1.f, 1.f, 1.f },
+						(y - m_region.y) * m_region.width + (x - m_region.x) };
+					FramePixel( x, y ) = PackColor( TraceRadiance( path, 0, rays, shadows ) );
+				}
+			}
+			return;
+		}
+		if ( integrator == Integrator::PathTracer ) {
+			RenderBlockPaths( x0, y0, xEnd, yEnd, rays, shadows );
+			return;
+		}
+
+		rays += static_cast<uint64_t>(xEnd - x0) * (yEnd - y0);
+		switch ( traversalMode ) {
+			case TraversalMode::Packet4:
+				RenderBlockPackets<4>( x0, y0, xEnd, yEnd, stats );
+				return;
+			case TraversalMode::Packet8:
+				RenderBlockPackets<8>( x0, y0, xEnd, yEnd, stats );
+				return;
+			case TraversalMode::Packet16:
+				RenderBlockPackets<16>( x0, y0, xEnd, yEnd, stats );
+				return;
+			default:
+				break;
+		}
+
+		const TraversalMode mode{ RayTraversalMode() };
+		for ( unsigned y{ y0 }; y < yEnd; ++y ) {
+			for ( unsigned x{ x0 }; x < xEnd; ++x ) {
+				Hit hit{};
+				if ( mode == TraversalMode::WideBVH )
+					m_wideBVH.Intersect( GeneratePrimaryRay( x, y ), hit );
+				else if ( mode == TraversalMode::QuantizedBVH )
+					m_quantizedBVH.Intersect( GeneratePrimaryRay( x, y ), hit );
+				else
+					m_bvh.Intersect( GeneratePrimaryRay( x, y ), hit );
+				FramePixel( x, y ) = Shade( hit.primIdx, hit.instanceIdx );
+				if ( visibilityBuffer )
+					m_visibility[static_cast<size_t>(y) * m_width + x] = hit;
+			}
+		}
+	}
+
+	template <unsigned N>
+	void Tracer::RenderBlockPackets( unsigned x0, unsigned y0, unsigned xEnd, unsigned yEnd, PacketStats& stats ) {
+		constexpr unsigned packetW{ PacketWidth<N>() };
+		constexpr unsigned packetH{ N / packetW };
+
+		RayPacket<N> packet;
+		for ( unsigned py{ y0 }; py < yEnd; py += packetH ) {
+			for ( unsigned px{ x0 }; px < xEnd; px += packetW ) {
+				// Lanes outside the image repeat the last valid pixel to keep the packet coherent.
+				for ( unsigned lane{}; lane < N; ++lane ) {
+					const unsigned x{ std::min( px + lane % packetW, xEnd - 1 ) };
+					const unsigned y{ std::min( py + lane / packetW, yEnd - 1 ) };
+					const Ray ray{ GeneratePrimaryRay( x, y ) };
+					packet.ox[lane] = ray.origin.x;
+					packet.oy[lane] = ray.origin.y;
+					packet.oz[lane] = ray.origin.z;
+					packet.dx[lane] = ray.direction.x;
+					packet.dy[lane] = ray.direction.y;
+					packet.dz[lane] = ray.direction.z;
+				}
+				packet.tMin = Ray{}.tMin;
+				packet.ResetHits( Ray{}.tMax );
+
+				m_bvh.IntersectPacket( packet, &stats );
+
+				for ( unsigned lane{}; lane < N; ++lane ) {
+					const unsigned x{ px + lane % packetW };
+					const unsigned y{ py + lane / packetW };
+					if ( x >= xEnd || y >= yEnd )
+						continue;
+					FramePixel( x, y ) = Shade( packet.primIdx[lane], packet.instanceIdx[lane] );
+					if ( visibilityBuffer )
+						m_visibility[static_cast<size_t>(y) * m_width + x] = { packet.tMax[lane], packet.u[lane], packet.v[lane], packet.primIdx[lane],
+							packet.instanceIdx[lane] };
+				}
+			}
+		}
+	}
+
+	Ray Tracer::GeneratePrimaryRay( unsigned pixelX, unsigned pixelY, float subpixelX, float subpixelY ) const {
+		const RT::CameraCB& cam{ m_params.camera };
+
+		// Pixel sample to NDC [0, 1], then to screen space [-1, 1] with a flipped Y axis.
+		const float x{ 2.f * ((pixelX + subpixelX) / m_width) - 1.f };
+		const float y{ 1.f - 2.f * ((pixelY + subpixelY) / m_height) };
+
+		const float sx{ x * cam.aspectRatio * m_tanHalfFOV };
+		const float sy{ y * m_tanHalfFOV };
+		const float fm{ static_cast<float>(cam.forwardMult) };
+		DirectX::XMFLOAT3 dir{
+			cam.cameraForward.x * fm + sx * cam.cameraRight.x + sy * cam.cameraUp.x,
+			cam.cameraForward.y * fm + sx * cam.cameraRight.y + sy * cam.cameraUp.y,
+			cam.cameraForward.z * fm + sx * cam.cameraRight.z + sy * cam.cameraUp.z
+		};
+		const float invLen{ 1.f / std::sqrtf( dir.x * dir.x + dir.y * dir.y + dir.z * dir.z ) };
+		dir = { dir.x * invLen, dir.y * invLen, dir.z * invLen };
+
+		return Ray{ cam.cameraPosition, 0.001f, dir, 100000.f };
+	}
+
+	uint32_t Tracer::Shade( uint32_t primIdx, uint32_t instanceIdx ) const {
+		if ( primIdx == NoHit )
+			return m_params.bgColorPacked;
+
+		if ( !m_params.randomColors )
+			return 0xFFFFFFFF;
+
+		// Same as ComputePrimitiveId() with one geometry per BLAS, then HashToColor() written
+		// to an R8G8B8A8_UNORM target: the low 3 bytes of the hash become R, G and B.
+		const uint32_t primitiveId{ primIdx + instanceIdx * 2654435761u };
+		return 0xFF000000 | (HashUint( primitiveId ) & 0x00FFFFFF);
+	}
+
+	bool Tracer::VisibilityMatches( const RenderRegion& region ) const {
+		const VisibilityKey& key{ m_visibilityKey };
+		return key.valid && key.width == m_width && key.height == m_height &&
+			key.region.x == region.x && key.region.y == region.y &&
+			key.region.width == region.width && key.region.height == region.height &&
+			std::memcmp( &key.camera, &m_params.camera, sizeof( RT::CameraCB ) ) == 0;
+	}
+
+	void Tracer::ReshadeRegion( const RenderRegion& region ) {
+		m_pool->ParallelFor( region.height, [&]( uint32_t row, unsigned ) {
+			const unsigned y{ region.y + row };
+			const Hit* hits{ m_visibility.data() + static_cast<size_t>(y) * m_width };
+			for ( unsigned x{ region.x }; x < region.x + region.width; ++x )
+				FramePixel( x, y ) = Shade( hits[x].primIdx, hits[x].instanceIdx );
+		} );
+	}
+
+	void Tracer::LinearizeFrame( const RenderRegion& region ) {
+		if ( !tiledFrameBuffer )
+			return;
+		const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+		m_tiledFrame.Linearize( reinterpret_cast<uint8_t*>(m_frameBuffer.data()), m_width * sizeof( uint32_t ),
+			region.x, region.y, region.width, region.height, *m_pool );
+		m_stats.linearizeMs = std::chrono::duration<double, std::milli>{
+			std::chrono::high_resolution_clock::now() - start }.count();
+	}
+
+	void Tracer::WriteImageToFile( const char* fileName ) {
+		std::ofstream fileStream( fileName, std::ios::binary );
+		if ( !fileStream.is_open() ) {
+			log( "Couldn't open file.", LogLevel::Error );
+			return;
+		}
+
+		fileStream << "P6 ";
+		fileStream << m_width << " " << m_height << " ";
+		fileStream << "255\n";
+
+		for ( uint32_t pixel : m_frameBuffer ) {
+			const unsigned char rgb[3]{
+				static_cast<unsigned char>(pixel & 0xFF),
+				static_cast<unsigned char>((pixel >> 8) & 0xFF),
+				static_cast<unsigned char>((pixel >> 16) & 0xFF)
+			};
+			fileStream.write( reinterpret_cast<const char*>(rgb), 3 );
+		}
+
+		fileStream.close();
+	}
+
+	const std::vector<uint32_t>& Tracer::GetFrameBuffer() const {
+		return m_frameBuffer;
+	}
+
+	const FrameStats& Tracer::GetStats() const {
+		return m_stats;
+	}
+
+	const BVH& Tracer::GetBVH() const {
+		return m_bvh;
+	}
+
+	const WideBVH& Tracer::GetWideBVH() const {
+		return m_wideBVH;
+	}
+
+	const QuantizedBVH& Tracer::GetQuantizedBVH() const {
+		return m_quantizedBVH;
+	}
+
+	unsigned Tracer::GetWidth() const {
+		return m_width;
+	}
+
+	unsigned Tracer::GetHeight() const {
+		return m_height;
+	}
+}
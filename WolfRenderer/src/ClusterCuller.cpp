@@ -0,0 +1,95 @@
+#include "ClusterCuller.hpp" // ClusterCuller, ClusterStats, IndexRange
+
+#include <algorithm> // fill
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // sqrt
+#include <DirectXMath.h> // XMMatrixInverse, XMVector3TransformCoord
+
+#include "BVH.hpp" // AABB
+#include "OcclusionCuller.hpp" // IsVisible
+
+
+namespace Raster {
+	void ClusterCuller::SetMeshes( const std::vector<Mesh>& meshes ) {
+		m_meshes = meshes;
+		m_clusterOffsets.assign( 1, 0 );
+		std::vector<CPU::AABB> bounds;
+		for ( const Mesh& mesh : meshes ) {
+			for ( const MeshCluster& cluster : mesh.clusters )
+				bounds.push_back( { cluster.boundsMin, cluster.boundsMax } );
+			m_clusterOffsets.push_back( static_cast<uint32_t>(bounds.size()) );
+		}
+		m_frustumCuller.SetBounds( bounds );
+		m_inFrustum.assign( bounds.size(), 0 );
+		m_ranges.clear();
+		m_rangeOffsets.assign( meshes.size() + 1, 0 );
+	}
+
+	void ClusterCuller::Cull( const Transformation::TransformDataCB& transform, const std::vector<uint32_t>& meshes,
+		std::span<const uint64_t> mask, bool showBackfaces ) {
+		const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+		m_stats = {};
+		m_ranges.clear();
+
+		std::fill( m_inFrustum.begin(), m_inFrustum.end(), 0 );
+		for ( const uint32_t cluster : m_frustumCuller.Cull( transform ) )
+			m_inFrustum[cluster] = 1;
+
+		// The camera in object space, the inverse of world-view applied to the view space origin.
+		const DirectX::XMMATRIX worldView{ DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &transform.mat ) ) };
+		DirectX::XMFLOAT3 camera{};
+		DirectX::XMStoreFloat3( &camera, DirectX::XMVector3TransformCoord(
+			DirectX::XMVectorZero(), DirectX::XMMatrixInverse( nullptr, worldView ) ) );
+
+		size_t next{};
+		for ( uint32_t meshIdx{}; meshIdx < m_meshes.size(); ++meshIdx ) {
+			m_rangeOffsets[meshIdx] = static_cast<uint32_t>(m_ranges.size());
+			if ( next == meshes.size() || meshes[next] != meshIdx )
+				continue;
+			++next;
+			if ( !mask.empty() && !IsVisible( mask, meshIdx ) )
+				continue;
+
+			const std::vector<MeshCluster>& clusters{ m_meshes[meshIdx].clusters };
+			m_stats.tested += static_cast<uint32_t>(clusters.size());
+			for ( uint32_t clusterIdx{}; clusterIdx < clusters.size(); ++clusterIdx ) {
+				const MeshCluster& cluster{ clusters[clusterIdx] };
+				if ( !m_inFrustum[m_clusterOffsets[meshIdx] + clusterIdx] ) {
+					++m_stats.outside;
+					continue;
+				}
+
+				if ( !showBackfaces && cluster.coneSin < 1.f ) {
+					const DirectX::XMFLOAT3 toCenter{ cluster.center.x - camera.x, cluster.center.y - camera.y, cluster.center.z - camera.z };
+					const float distance{ std::sqrt( toCenter.x * toCenter.x + toCenter.y * toCenter.y + toCenter.z * toCenter.z ) };
+					const float along{ toCenter.x * cluster.coneAxis.x + toCenter.y * cluster.coneAxis.y + toCenter.z * cluster.coneAxis.z };
+					// Every point of the sphere is at most radius closer along the axis and radius farther away.
+					if ( along > cluster.coneSin * distance + cluster.radius * (1.f + cluster.coneSin) ) {
+						++m_stats.backfacing;
+						continue;
+					}
+				}
+
+				const uint32_t first{ cluster.firstTriangle * 3 };
+				const uint32_t count{ cluster.triangleCount * 3 };
+				m_stats.triangles += cluster.triangleCount;
+				if ( m_ranges.size() > m_rangeOffsets[meshIdx] && m_ranges.back().first + m_ranges.back().count == first )
+					m_ranges.back().count += count;
+				else
+					m_ranges.push_back( { first, count } );
+			}
+		}
+		m_rangeOffsets[m_meshes.size()] = static_cast<uint32_t>(m_ranges.size());
+
+		m_stats.ranges = static_cast<uint32_t>(m_ranges.size());
+		m_stats.cullMs = std::chrono::duration<double, std::milli>{ std::chrono::high_resolution_clock::now() - start }.count();
+	}
+
+	std::span<const IndexRange> ClusterCuller::GetRanges( uint32_t mesh ) const {
+		return std::span<const IndexRange>{ m_ranges }.subspan( m_rangeOffsets[mesh], m_rangeOffsets[mesh + 1] - m_rangeOffsets[mesh] );
+	}
+
+	const ClusterStats& ClusterCuller::GetStats() const {
+		return m_stats;
+	}
+}
@@ -0,0 +1,186 @@
+#include "Denoiser.hpp" // Denoiser, MissDepth
+
+#include <algorithm> // min, max
+#include <chrono> // high_resolution_clock, duration
+
+#include "SIMD.hpp" // Simd
+#include "WideBVH.hpp" // DetectSIMDWidth
+
+
+namespace CPU {
+	namespace {
+		/// B3 spline taps, the same in x and y.
+		constexpr float Kernel[5]{ 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+		/// Planes of one iteration.
+		struct Planes {
+			const float* color[3];
+			const float* albedo[3];
+			const float* normal[3];
+			const float* depth;
+			float* output[3];
+			unsigned width;
+			unsigned height;
+		};
+
+		/// Inverse sigmas of one iteration. Color, albedo and normal scale squared differences.
+		struct Scales {
+			float color;
+			float albedo;
+			float normal;
+			float depth; ///< Also divided by the tap distance.
+			int step;
+		};
+
+		/// (1 - x / 16)^16, cut off at 0. Close to exp( -x ) for small x, without an exp in SIMD.
+		template <typename S>
+		typename S::Reg EdgeWeight( typename S::Reg x ) {
+			typename S::Reg t{ S::Max( S::Sub( S::Set1( 1.f ), S::Mul( x, S::Set1( 1.f / 16.f ) ) ), S::Set1( 0.f ) ) };
+			t = S::Mul( t, t );
+			t = S::Mul( t, t );
+			t = S::Mul( t, t );
+			return S::Mul( t, t );
+		}
+
+		template <typename S>
+		typename S::Reg DistanceSq( const typename S::Reg ( &a )[3], const float* const ( &planes )[3], size_t tap ) {
+			typename S::Reg sum{ S::Set1( 0.f ) };
+			for ( int channel{}; channel < 3; ++channel ) {
+				const typename S::Reg difference{ S::Sub( a[channel], S::LoadU( planes[channel] + tap ) ) };
+				sum = S::Add( sum, S::Mul( difference, difference ) );
+			}
+			return sum;
+		}
+
+		/// Filters the pixels [x, x + lanes) of a row. Without CheckX, all horizontal taps must be inside the row.
+		template <typename S, bool CheckX>
+		void FilterPixels( const Planes& planes, const Scales& scales, unsigned x, unsigned y ) {
+			using Reg = typename S::Reg;
+			const size_t center{ static_cast<size_t>(y) * planes.width + x };
+			Reg color[3];
+			Reg albedo[3];
+			Reg normal[3];
+			for ( int channel{}; channel < 3; ++channel ) {
+				color[channel] = S::LoadU( planes.color[channel] + center );
+				albedo[channel] = S::LoadU( planes.albedo[channel] + center );
+				normal[channel] = S::LoadU( planes.normal[channel] + center );
+			}
+			const Reg depth{ S::LoadU( planes.depth + center ) };
+			const Reg depthScale{ S::Div( S::Set1( scales.depth ), depth ) };
+
+			Reg sum[3]{ S::Set1( 0.f ), S::Set1( 0.f ), S::Set1( 0.f ) };
+			Reg weightSum{ S::Set1( 0.f ) };
+			for ( int dy{ -2 }; dy <= 2; ++dy ) {
+				const int ty{ static_cast<int>(y) + dy * scales.step };
+				if ( ty < 0 || ty >= static_cast<int>(planes.height) )
+					continue;
+				for ( int dx{ -2 }; dx <= 2; ++dx ) {
+					const int tx{ static_cast<int>(x) + dx * scales.step };
+					if constexpr ( CheckX )
+						if ( tx < 0 || tx >= static_cast<int>(planes.width) )
+							continue;
+					const size_t tap{ static_cast<size_t>(ty) * planes.width + tx };
+
+					Reg distance{ S::Mul( DistanceSq<S>( color, planes.color, tap ), S::Set1( scales.color ) ) };
+					distance = S::Add( distance, S::Mul( DistanceSq<S>( albedo, planes.albedo, tap ), S::Set1( scales.albedo ) ) );
+					distance = S::Add( distance, S::Mul( DistanceSq<S>( normal, planes.normal, tap ), S::Set1( scales.normal ) ) );
+					distance = S::Add( distance, S::Mul( S::Abs( S::Sub( depth, S::LoadU( planes.depth + tap ) ) ), depthScale ) );
+					const Reg weight{ S::Mul( S::Set1( Kernel[dx + 2] * Kernel[dy + 2] ), EdgeWeight<S>( distance ) ) };
+
+					for ( int channel{}; channel < 3; ++channel )
+						sum[channel] = S::Add( sum[channel], S::Mul( weight, S::LoadU( planes.color[channel] + tap ) ) );
+					weightSum = S::Add( weightSum, weight );
+				}
+			}
+
+			// The center tap always has a positive weight.
+			for ( int channel{}; channel < 3; ++channel )
+				S::StoreU( planes.output[channel] + center, S::Div( sum[channel], weightSum ) );
+		}
+	}
+
+	void Denoiser::Resize( unsigned width, unsigned height ) {
+		m_width = width;
+		m_height = height;
+		const size_t count{ static_cast<size_t>(width) * height };
+		for ( int channel{}; channel < 3; ++channel ) {
+			m_color[0][channel].assign( count, 0.f );
+			m_color[1][channel].assign( count, 0.f );
+			m_albedo[channel].assign( count, 0.f );
+			m_normal[channel].assign( count, 0.f );
+		}
+		m_depth.assign( count, MissDepth );
+		m_result = 0;
+	}
+
+	void Denoiser::SetPixel( uint32_t index, const DirectX::XMFLOAT3& color, const DirectX::XMFLOAT3& albedo,
+		const DirectX::XMFLOAT3& normal, float depth ) {
+		// Filtered in the displayed range. Unclamped, single bright samples would be spread into blotches.
+		m_color[0][0][index] = std::min( std::max( color.x, 0.f ), 1.f );
+		m_color[0][1][index] = std::min( std::max( color.y, 0.f ), 1.f );
+		m_color[0][2][index] = std::min( std::max( color.z, 0.f ), 1.f );
+		m_albedo[0][index] = albedo.x;
+		m_albedo[1][index] = albedo.y;
+		m_albedo[2][index] = albedo.z;
+		m_normal[0][index] = normal.x;
+		m_normal[1][index] = normal.y;
+		m_normal[2][index] = normal.z;
+		m_depth[index] = depth;
+	}
+
+	double Denoiser::Filter( ThreadPool& pool ) {
+		const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+		const unsigned width{ simdWidth == 1 || simdWidth == 4 || simdWidth == 8 ? simdWidth : DetectSIMDWidth() };
+
+		for ( unsigned iteration{}; iteration < iterations; ++iteration ) {
+			const unsigned source{ iteration & 1 };
+			pool.ParallelFor( m_height, [&]( uint32_t row, unsigned ) {
+				if ( width == 8 )
+					FilterRow<8>( row, iteration, source );
+				else if ( width == 4 )
+					FilterRow<4>( row, iteration, source );
+				else
+					FilterRow<1>( row, iteration, source );
+			} );
+		}
+		m_result = iterations & 1;
+
+		return std::chrono::duration<double, std::milli>{ std::chrono::high_resolution_clock::now() - start }.count();
+	}
+
+	DirectX::XMFLOAT3 Denoiser::GetPixel( uint32_t index ) const {
+		return { m_color[m_result][0][index], m_color[m_result][1][index], m_color[m_result][2][index] };
+	}
+
+	template <unsigned W>
+	void Denoiser::FilterRow( unsigned row, unsigned iteration, unsigned source ) {
+		const std::array<std::vector<float>, 3>& color{ m_color[source] };
+		std::array<std::vector<float>, 3>& output{ m_color[source ^ 1] };
+		const Planes planes{
+			{ color[0].data(), color[1].data(), color[2].data() },
+			{ m_albedo[0].data(), m_albedo[1].data(), m_albedo[2].data() },
+			{ m_normal[0].data(), m_normal[1].data(), m_normal[2].data() },
+			m_depth.data(),
+			{ output[0].data(), output[1].data(), output[2].data() },
+			m_width, m_height };
+
+		const int step{ 1 << iteration };
+		// The color sigma halves every iteration, so its inverse square grows by 4.
+		const Scales scales{
+			static_cast<float>(1u << (2 * iteration)) / (colorSigma * colorSigma),
+			1.f / (albedoSigma * albedoSigma),
+			1.f / (normalSigma * normalSigma),
+			1.f / (depthSigma * step),
+			step };
+
+		// Pixels closer to the row's ends than the outer taps are filtered one by one, with bounds checks.
+		const unsigned margin{ 2u * step };
+		unsigned x{};
+		for ( ; x < std::min( margin, m_width ); ++x )
+			FilterPixels<Simd<1>, true>( planes, scales, x, row );
+		for ( ; x + W + margin <= m_width; x += W )
+			FilterPixels<Simd<W>, false>( planes, scales, x, row );
+		for ( ; x < m_width; ++x )
+			FilterPixels<Simd<1>, true>( planes, scales, x, row );
+	}
+}
@@ -0,0 +1,140 @@
+#include "FrustumCuller.hpp" // FrustumCuller, CullingStats
+
+#include <algorithm> // min
+#include <bit> // countr_zero
+#include <cfloat> // FLT_MAX
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // abs
+
+#include "SIMD.hpp" // Simd
+#include "WideBVH.hpp" // DetectSIMDWidth
+
+
+namespace Raster {
+	namespace {
+		/// SoA arrays are padded to this many boxes, the widest SIMD width.
+		constexpr uint32_t Padding{ 8 };
+	}
+
+	void FrustumCuller::SetMeshes( const std::vector<Mesh>& meshes ) {
+		std::vector<CPU::AABB> bounds( meshes.size() );
+		for ( size_t i{}; i < meshes.size(); ++i )
+			for ( const Vertex& vertex : meshes[i].vertices )
+				bounds[i].Grow( vertex.position );
+		SetBounds( bounds );
+	}
+
+	void FrustumCuller::SetBounds( const std::vector<CPU::AABB>& bounds ) {
+		m_centerX.clear();
+		m_centerY.clear();
+		m_centerZ.clear();
+		m_extentX.clear();
+		m_extentY.clear();
+		m_extentZ.clear();
+		m_indices.clear();
+		for ( size_t i{}; i < bounds.size(); ++i ) {
+			const CPU::AABB& box{ bounds[i] };
+			if ( box.IsEmpty() )
+				continue;
+			m_centerX.push_back( (box.min.x + box.max.x) * 0.5f );
+			m_centerY.push_back( (box.min.y + box.max.y) * 0.5f );
+			m_centerZ.push_back( (box.min.z + box.max.z) * 0.5f );
+			m_extentX.push_back( (box.max.x - box.min.x) * 0.5f );
+			m_extentY.push_back( (box.max.y - box.min.y) * 0.5f );
+			m_extentZ.push_back( (box.max.z - box.min.z) * 0.5f );
+			m_indices.push_back( static_cast<uint32_t>(i) );
+		}
+		m_count = static_cast<uint32_t>(m_indices.size());
+
+		// Padding lanes are masked out, any value works.
+		const size_t padded{ (m_count + Padding - 1) / Padding * Padding };
+		for ( std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ } )
+			values->resize( padded, 0.f );
+		m_visible.clear();
+		m_visible.reserve( m_count );
+	}
+
+	const std::vector<uint32_t>& FrustumCuller::Cull( const Transformation::TransformDataCB& transform ) {
+		const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+
+		// Both matrices are stored transposed, so projection * mat maps object space column vectors to clip
+		// space and its rows give x, y, z and w. Reverse-Z keeps -w <= x, y <= w and 0 <= z <= w inside.
+		float clip[4][4];
+		for ( int row{}; row < 4; ++row )
+			for ( int column{}; column < 4; ++column )
+				clip[row][column] = transform.projection.m[row][0] * transform.mat.m[0][column] +
+					transform.projection.m[row][1] * transform.mat.m[1][column] +
+					transform.projection.m[row][2] * transform.mat.m[2][column] +
+					transform.projection.m[row][3] * transform.mat.m[3][column];
+		float planes[6][4];
+		for ( int i{}; i < 4; ++i ) {
+			planes[0][i] = clip[3][i] + clip[0][i]; // Left.
+			planes[1][i] = clip[3][i] - clip[0][i]; // Right.
+			planes[2][i] = clip[3][i] + clip[1][i]; // Bottom.
+			planes[3][i] = clip[3][i] - clip[1][i]; // Top.
+			planes[4][i] = clip[2][i]; // Far, z = 0 with reverse-Z.
+			planes[5][i] = clip[3][i] - clip[2][i]; // Near, z = w.
+		}
+
+		m_visible.clear();
+		const unsigned width{ simdWidth == 1 || simdWidth == 4 || simdWidth == 8 ? simdWidth : CPU::DetectSIMDWidth() };
+		if ( width == 8 )
+			CullBoxes<8>( planes );
+		else if ( width == 4 )
+			CullBoxes<4>( planes );
+		else
+			CullBoxes<1>( planes );
+
+		m_stats.tested = m_count;
+		m_stats.visible = static_cast<uint32_t>(m_visible.size());
+		m_stats.culled = m_count - m_stats.visible;
+		m_stats.cullMs = std::chrono::duration<double, std::milli>{ std::chrono::high_resolution_clock::now() - start }.count();
+		return m_visible;
+	}
+
+	const std::vector<uint32_t>& FrustumCuller::GetVisible() const {
+		return m_visible;
+	}
+
+	const CullingStats& FrustumCuller::GetStats() const {
+		return m_stats;
+	}
+
+	template <unsigned W>
+	void FrustumCuller::CullBoxes( const float ( &planes )[6][4] ) {
+		using S = CPU::Simd<W>;
+		using Reg = typename S::Reg;
+
+		// The box's extents projected on a plane's normal: the farthest any corner gets from the center.
+		float absNormals[6][3];
+		for ( int plane{}; plane < 6; ++plane )
+			for ( int axis{}; axis < 3; ++axis )
+				absNormals[plane][axis] = std::abs( planes[plane][axis] );
+
+		for ( uint32_t first{}; first < m_count; first += W ) {
+			const Reg centerX{ S::LoadU( m_centerX.data() + first ) };
+			const Reg centerY{ S::LoadU( m_centerY.data() + first ) };
+			const Reg centerZ{ S::LoadU( m_centerZ.data() + first ) };
+			const Reg extentX{ S::LoadU( m_extentX.data() + first ) };
+			const Reg extentY{ S::LoadU( m_extentY.data() + first ) };
+			const Reg extentZ{ S::LoadU( m_extentZ.data() + first ) };
+
+			// Signed distance of the corner farthest inside every plane, the smallest one deciding.
+			Reg nearest{ S::Set1( FLT_MAX ) };
+			for ( int plane{}; plane < 6; ++plane ) {
+				Reg distance{ S::Add( S::Mul( S::Set1( planes[plane][0] ), centerX ), S::Set1( planes[plane][3] ) ) };
+				distance = S::Add( distance, S::Mul( S::Set1( planes[plane][1] ), centerY ) );
+				distance = S::Add( distance, S::Mul( S::Set1( planes[plane][2] ), centerZ ) );
+				distance = S::Add( distance, S::Mul( S::Set1( absNormals[plane][0] ), extentX ) );
+				distance = S::Add( distance, S::Mul( S::Set1( absNormals[plane][1] ), extentY ) );
+				distance = S::Add( distance, S::Mul( S::Set1( absNormals[plane][2] ), extentZ ) );
+				nearest = S::Min( nearest, distance );
+			}
+
+			const uint32_t lanes{ std::min( W, m_count - first ) };
+			int mask{ S::Mask( S::Ge( nearest, S::Set1( 0.f ) ) ) & static_cast<int>((1u << lanes) - 1) };
+			for ( ; mask != 0; mask &= mask - 1 )
+				m_visible.push_back( m_indices[first + std::countr_zero( static_cast<unsigned>(mask) )] );
+		}
+	}
+}
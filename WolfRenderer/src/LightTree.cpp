@@ -0,0 +1,202 @@
+#include "LightTree.hpp" // LightTree, LightNode, NoLight
+
+#include <algorithm> // min, max, partition
+#include <cfloat> // FLT_MAX
+#include <cmath> // sqrtf
+#include <numeric> // iota
+
+
+namespace CPU {
+	namespace {
+		/// SAH-like candidate planes per axis.
+		constexpr uint32_t BinCount{ 12 };
+
+		float Component( const DirectX::XMFLOAT3& vec, int axis ) {
+			return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+		}
+
+		/// Sum of the box extents. Unlike the area, it does not vanish for lights on a plane or a line.
+		float Extent( const AABB& box ) {
+			if ( box.IsEmpty() )
+				return 0.f;
+			return (box.max.x - box.min.x) + (box.max.y - box.min.y) + (box.max.z - box.min.z);
+		}
+
+		/// Estimated contribution of a node to a shading point. Exact for a single light.
+		float Importance( const LightNode& node, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& normal ) {
+			const AABB& box{ node.bounds };
+			const DirectX::XMFLOAT3 toCenter{
+				(box.min.x + box.max.x) * 0.5f - position.x,
+				(box.min.y + box.max.y) * 0.5f - position.y,
+				(box.min.z + box.max.z) * 0.5f - position.z };
+			const float halfX{ (box.max.x - box.min.x) * 0.5f };
+			const float halfY{ (box.max.y - box.min.y) * 0.5f };
+			const float halfZ{ (box.max.z - box.min.z) * 0.5f };
+			const float radiusSq{ halfX * halfX + halfY * halfY + halfZ * halfZ };
+			const float distanceSq{ toCenter.x * toCenter.x + toCenter.y * toCenter.y + toCenter.z * toCenter.z };
+
+			// Smallest angle between the normal and any direction into the box's bounding sphere.
+			// Nodes entirely behind the surface get a negative bound and can't be picked.
+			float cosine{ 1.f };
+			if ( distanceSq > radiusSq ) {
+				const float distance{ std::sqrtf( distanceSq ) };
+				const float cosCenter{ std::min( std::max(
+					(toCenter.x * normal.x + toCenter.y * normal.y + toCenter.z * normal.z) / distance, -1.f ), 1.f ) };
+				const float sinSphere{ std::sqrtf( radiusSq / distanceSq ) };
+				const float cosSphere{ std::sqrtf( 1.f - sinSphere * sinSphere ) };
+				// cos( center angle - sphere angle ), without evaluating the angles.
+				if ( cosCenter < cosSphere )
+					cosine = cosCenter * cosSphere + std::sqrtf( 1.f - cosCenter * cosCenter ) * sinSphere;
+			}
+
+			// Inside the bounding sphere, the distance is clamped to its radius.
+			return node.intensity * std::max( cosine, 0.f ) / std::max( std::max( distanceSq, radiusSq ), 1e-8f );
+		}
+	}
+
+	void LightTree::Build( const std::vector<Light>& lights ) {
+		m_nodes.clear();
+		if ( lights.empty() )
+			return;
+
+		const uint32_t lightCount{ static_cast<uint32_t>(lights.size()) };
+		std::vector<uint32_t> order( lightCount );
+		std::iota( order.begin(), order.end(), 0u );
+		m_nodes.reserve( static_cast<size_t>(lightCount) * 2 - 1 );
+		m_nodes.emplace_back();
+
+		struct Task {
+			uint32_t node;
+			uint32_t first;
+			uint32_t count;
+		};
+		std::vector<Task> stack{ { 0, 0, lightCount } };
+		while ( !stack.empty() ) {
+			const Task task{ stack.back() };
+			stack.pop_back();
+
+			LightNode node{};
+			for ( uint32_t i{ task.first }; i < task.first + task.count; ++i ) {
+				node.bounds.Grow( lights[order[i]].position );
+				node.intensity += std::max( lights[order[i]].intensity, 0.f );
+			}
+			if ( task.count == 1 ) {
+				node.index = LightNode::LeafFlag | order[task.first];
+				m_nodes[task.node] = node;
+				continue;
+			}
+
+			// Binned split with the lowest intensity times extent, summed over both children.
+			struct Bin {
+				AABB bounds;
+				float intensity{};
+				uint32_t count{};
+			};
+			int bestAxis{ -1 };
+			uint32_t bestBin{};
+			float bestCost{ FLT_MAX };
+			for ( int axis{}; axis < 3; ++axis ) {
+				const float bMin{ Component( node.bounds.min, axis ) };
+				const float bMax{ Component( node.bounds.max, axis ) };
+				if ( bMax <= bMin )
+					continue;
+
+				Bin bins[BinCount]{};
+				const float scale{ BinCount / (bMax - bMin) };
+				for ( uint32_t i{ task.first }; i < task.first + task.count; ++i ) {
+					const Light& light{ lights[order[i]] };
+					const uint32_t bin{ std::min( BinCount - 1,
+						static_cast<uint32_t>((Component( light.position, axis ) - bMin) * scale) ) };
+					bins[bin].bounds.Grow( light.position );
+					bins[bin].intensity += std::max( light.intensity, 0.f );
+					++bins[bin].count;
+				}
+
+				float leftCost[BinCount - 1];
+				AABB leftBox{};
+				float leftIntensity{};
+				for ( uint32_t i{}; i < BinCount - 1; ++i ) {
+					leftBox.Grow( bins[i].bounds );
+					leftIntensity += bins[i].intensity;
+					leftCost[i] = leftIntensity * Extent( leftBox );
+				}
+				AABB rightBox{};
+				float rightIntensity{};
+				uint32_t rightCount{};
+				for ( uint32_t i{ BinCount - 1 }; i > 0; --i ) {
+					rightBox.Grow( bins[i].bounds );
+					rightIntensity += bins[i].intensity;
+					rightCount += bins[i].count;
+					const float cost{ leftCost[i - 1] + rightIntensity * Extent( rightBox ) };
+					if ( rightCount > 0 && rightCount < task.count && cost < bestCost ) {
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = i;
+					}
+				}
+			}
+
+			uint32_t leftCount{ task.count / 2 };
+			if ( bestAxis >= 0 ) {
+				const float bMin{ Component( node.bounds.min, bestAxis ) };
+				const float scale{ BinCount / (Component( node.bounds.max, bestAxis ) - bMin) };
+				const auto middle{ std::partition( order.begin() + task.first, order.begin() + task.first + task.count,
+					[&]( uint32_t light ) {
+						return std::min( BinCount - 1,
+							static_cast<uint32_t>((Component( lights[light].position, bestAxis ) - bMin) * scale) ) < bestBin;
+					} ) };
+				leftCount = static_cast<uint32_t>(middle - (order.begin() + task.first));
+			}
+			// Lights at the same position can't be split spatially, they are halved by index instead.
+
+			node.index = static_cast<uint32_t>(m_nodes.size());
+			m_nodes[task.node] = node;
+			m_nodes.emplace_back();
+			m_nodes.emplace_back();
+			stack.push_back( { node.index + 1, task.first + leftCount, task.count - leftCount } );
+			stack.push_back( { node.index, task.first, leftCount } );
+		}
+	}
+
+	uint32_t LightTree::Sample( const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& normal, float u, float& pdf ) const {
+		pdf = 0.f;
+		if ( m_nodes.empty() || Importance( m_nodes[0], position, normal ) <= 0.f )
+			return NoLight;
+
+		float probability{ 1.f };
+		const LightNode* node{ &m_nodes[0] };
+		while ( !node->IsLeaf() ) {
+			const LightNode& left{ m_nodes[node->index] };
+			const LightNode& right{ m_nodes[node->index + 1] };
+			const float leftImportance{ Importance( left, position, normal ) };
+			const float rightImportance{ Importance( right, position, normal ) };
+			const float total{ leftImportance + rightImportance };
+			if ( total <= 0.f )
+				return NoLight;
+
+			// The random number is rescaled to the picked child's interval, so it stays uniform.
+			const float leftProbability{ leftImportance / total };
+			if ( u < leftProbability ) {
+				u /= leftProbability;
+				probability *= leftProbability;
+				node = &left;
+			} else {
+				u = (u - leftProbability) / (1.f - leftProbability);
+				probability *= 1.f - leftProbability;
+				node = &right;
+			}
+			u = std::min( u, 0.99999994f );
+		}
+
+		pdf = probability;
+		return node->GetLightIndex();
+	}
+
+	bool LightTree::IsEmpty() const {
+		return m_nodes.empty();
+	}
+
+	std::span<const LightNode> LightTree::GetNodes() const {
+		return m_nodes;
+	}
+}
@@ -0,0 +1,55 @@
+#include "MappedFile.hpp" // MappedFile
+
+
+namespace CPU {
+	MappedFile::~MappedFile() {
+		Close();
+	}
+
+	bool MappedFile::Open( const std::filesystem::path& path ) {
+		Close();
+
+		m_file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr );
+		if ( m_file == INVALID_HANDLE_VALUE )
+			return false;
+
+		LARGE_INTEGER size{};
+		// Empty files cannot be mapped.
+		if ( !GetFileSizeEx( m_file, &size ) || size.QuadPart <= 0 ) {
+			Close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingW( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if ( !m_mapping ) {
+			Close();
+			return false;
+		}
+
+		m_data = static_cast<const std::byte*>(MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ));
+		if ( !m_data ) {
+			Close();
+			return false;
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if ( m_data )
+			UnmapViewOfFile( m_data );
+		if ( m_mapping )
+			CloseHandle( m_mapping );
+		if ( m_file != INVALID_HANDLE_VALUE )
+			CloseHandle( m_file );
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = nullptr;
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	std::span<const std::byte> MappedFile::GetData() const {
+		return { m_data, m_size };
+	}
+}
@@ -0,0 +1,64 @@
+#include "MeshClusters.hpp" // BuildClusters
+
+#include <algorithm> // min, max
+#include <cfloat> // FLT_MAX
+#include <cmath> // sqrt
+#include <vector> // vector
+
+
+namespace Raster {
+	void BuildClusters( Mesh& mesh, CPU::ThreadPool& pool, uint32_t trianglesPerCluster ) {
+		const uint32_t triangleCount{ static_cast<uint32_t>(mesh.indices.size() / 3) };
+		trianglesPerCluster = std::max( trianglesPerCluster, 1u );
+		mesh.clusters.assign( (triangleCount + trianglesPerCluster - 1) / trianglesPerCluster, {} );
+
+		pool.ParallelFor( static_cast<uint32_t>(mesh.clusters.size()), [&]( uint32_t clusterIdx, unsigned ) {
+			MeshCluster& cluster{ mesh.clusters[clusterIdx] };
+			cluster.firstTriangle = clusterIdx * trianglesPerCluster;
+			cluster.triangleCount = std::min( trianglesPerCluster, triangleCount - cluster.firstTriangle );
+
+			DirectX::XMFLOAT3 boundsMin{ FLT_MAX, FLT_MAX, FLT_MAX };
+			DirectX::XMFLOAT3 boundsMax{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			DirectX::XMFLOAT3 normalSum{};
+			// Unit face normals. cross( p1 - p0, p2 - p0 ) points to the side the triangle is front facing from.
+			std::vector<DirectX::XMFLOAT3> normals;
+			normals.reserve( cluster.triangleCount );
+			for ( uint32_t triangle{ cluster.firstTriangle }; triangle < cluster.firstTriangle + cluster.triangleCount; ++triangle ) {
+				const DirectX::XMFLOAT3* p[3];
+				for ( unsigned corner{}; corner < 3; ++corner ) {
+					p[corner] = &mesh.vertices[mesh.indices[triangle * 3 + corner]].position;
+					boundsMin = { std::min( boundsMin.x, p[corner]->x ), std::min( boundsMin.y, p[corner]->y ), std::min( boundsMin.z, p[corner]->z ) };
+					boundsMax = { std::max( boundsMax.x, p[corner]->x ), std::max( boundsMax.y, p[corner]->y ), std::max( boundsMax.z, p[corner]->z ) };
+				}
+
+				const DirectX::XMFLOAT3 e1{ p[1]->x - p[0]->x, p[1]->y - p[0]->y, p[1]->z - p[0]->z };
+				const DirectX::XMFLOAT3 e2{ p[2]->x - p[0]->x, p[2]->y - p[0]->y, p[2]->z - p[0]->z };
+				const DirectX::XMFLOAT3 normal{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+				const float lengthSq{ normal.x * normal.x + normal.y * normal.y + normal.z * normal.z };
+				if ( lengthSq <= 0.f )
+					continue;
+				const float invLength{ 1.f / std::sqrt( lengthSq ) };
+				normals.push_back( { normal.x * invLength, normal.y * invLength, normal.z * invLength } );
+				normalSum = { normalSum.x + normals.back().x, normalSum.y + normals.back().y, normalSum.z + normals.back().z };
+			}
+
+			cluster.boundsMin = boundsMin;
+			cluster.boundsMax = boundsMax;
+			cluster.center = { (boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f };
+			const DirectX::XMFLOAT3 half{ boundsMax.x - cluster.center.x, boundsMax.y - cluster.center.y, boundsMax.z - cluster.center.z };
+			cluster.radius = std::sqrt( half.x * half.x + half.y * half.y + half.z * half.z );
+
+			// The cone's angle is the largest between the axis and a normal. Past 90 degrees no view sees only back faces.
+			const float sumLength{ std::sqrt( normalSum.x * normalSum.x + normalSum.y * normalSum.y + normalSum.z * normalSum.z ) };
+			cluster.coneSin = 1.f;
+			if ( sumLength <= 0.f )
+				return;
+			cluster.coneAxis = { normalSum.x / sumLength, normalSum.y / sumLength, normalSum.z / sumLength };
+			float minCos{ 1.f };
+			for ( const DirectX::XMFLOAT3& normal : normals )
+				minCos = std::min( minCos, normal.x * cluster.coneAxis.x + normal.y * cluster.coneAxis.y + normal.z * cluster.coneAxis.z );
+			if ( minCos > 0.f )
+				cluster.coneSin = std::sqrt( std::max( 0.f, 1.f - minCos * minCos ) );
+		} );
+	}
+}
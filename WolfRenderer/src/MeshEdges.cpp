@@ -0,0 +1,161 @@
+#include "MeshEdges.hpp" // BuildEdges, SelectEdges, EdgeRange
+
+#include <algorithm> // sort, min, max
+#include <array> // array
+#include <cmath> // cos, sqrt
+#include <vector> // vector
+
+
+namespace Raster {
+	namespace {
+		/// Triangles per task when computing normals and bucketing edges.
+		constexpr uint32_t TriangleChunk{ 16384 };
+		/// Buckets per thread, so threads that finish early find more to take.
+		constexpr uint32_t BucketsPerThread{ 8 };
+
+		/// A side of a triangle: its vertex pair, the lower index in the high bits, and the triangle.
+		struct HalfEdge {
+			uint64_t key;
+			uint32_t triangle;
+		};
+
+		/// Order of the classes in Mesh::edgeIndices.
+		enum EdgeClass {
+			Boundary,
+			Crease,
+			Smooth,
+			EdgeClassCount
+		};
+	}
+
+	void BuildEdges( Mesh& mesh, CPU::ThreadPool& pool, float creaseAngle ) {
+		const uint32_t triangleCount{ static_cast<uint32_t>(mesh.indices.size() / 3) };
+		const uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+		mesh.edgeIndices.clear();
+		mesh.boundaryEdgeCount = 0;
+		mesh.creaseEdgeCount = 0;
+		if ( triangleCount == 0 || vertexCount == 0 )
+			return;
+
+		const uint32_t chunkCount{ (triangleCount + TriangleChunk - 1) / TriangleChunk };
+		const uint32_t bucketCount{ std::min( vertexCount, pool.GetThreadCount() * BucketsPerThread ) };
+		const auto bucketOf = [&]( uint32_t vertex ) {
+			return static_cast<uint32_t>(static_cast<uint64_t>(vertex) * bucketCount / vertexCount);
+		};
+		const auto forEachSide = [&]( uint32_t chunk, const auto& visit ) {
+			const uint32_t last{ std::min( (chunk + 1) * TriangleChunk, triangleCount ) };
+			for ( uint32_t triangle{ chunk * TriangleChunk }; triangle < last; ++triangle )
+				for ( unsigned side{}; side < 3; ++side ) {
+					const uint32_t a{ mesh.indices[triangle * 3 + side] };
+					const uint32_t b{ mesh.indices[triangle * 3 + (side + 1) % 3] };
+					// Sides of degenerate triangles can repeat a vertex.
+					if ( a != b )
+						visit( std::min( a, b ), std::max( a, b ), triangle );
+				}
+		};
+
+		// Unit face normals, zero for degenerate triangles, and the sides every chunk adds to every bucket.
+		std::vector<DirectX::XMFLOAT3> normals( triangleCount );
+		std::vector<uint32_t> cursors( static_cast<size_t>(chunkCount) * bucketCount, 0 );
+		pool.ParallelFor( chunkCount, [&]( uint32_t chunk, unsigned ) {
+			const uint32_t last{ std::min( (chunk + 1) * TriangleChunk, triangleCount ) };
+			for ( uint32_t triangle{ chunk * TriangleChunk }; triangle < last; ++triangle ) {
+				const DirectX::XMFLOAT3& p0{ mesh.vertices[mesh.indices[triangle * 3]].position };
+				const DirectX::XMFLOAT3& p1{ mesh.vertices[mesh.indices[triangle * 3 + 1]].position };
+				const DirectX::XMFLOAT3& p2{ mesh.vertices[mesh.indices[triangle * 3 + 2]].position };
+				const DirectX::XMFLOAT3 e1{ p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+				const DirectX::XMFLOAT3 e2{ p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+				DirectX::XMFLOAT3 normal{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+				const float lengthSq{ normal.x * normal.x + normal.y * normal.y + normal.z * normal.z };
+				const float invLength{ lengthSq > 0.f ? 1.f / std::sqrt( lengthSq ) : 0.f };
+				normals[triangle] = { normal.x * invLength, normal.y * invLength, normal.z * invLength };
+			}
+
+			uint32_t* chunkCounts{ cursors.data() + static_cast<size_t>(chunk) * bucketCount };
+			forEachSide( chunk, [&]( uint32_t low, uint32_t, uint32_t ) { ++chunkCounts[bucketOf( low )]; } );
+		} );
+
+		// Buckets in vertex order, every bucket holding the chunks' sides in chunk order.
+		std::vector<uint32_t> bucketStarts( bucketCount + 1 );
+		uint32_t sideCount{};
+		for ( uint32_t bucket{}; bucket < bucketCount; ++bucket ) {
+			bucketStarts[bucket] = sideCount;
+			for ( uint32_t chunk{}; chunk < chunkCount; ++chunk ) {
+				uint32_t& cursor{ cursors[static_cast<size_t>(chunk) * bucketCount + bucket] };
+				const uint32_t count{ cursor };
+				cursor = sideCount;
+				sideCount += count;
+			}
+		}
+		bucketStarts[bucketCount] = sideCount;
+
+		std::vector<HalfEdge> sides( sideCount );
+		pool.ParallelFor( chunkCount, [&]( uint32_t chunk, unsigned ) {
+			uint32_t* chunkCursors{ cursors.data() + static_cast<size_t>(chunk) * bucketCount };
+			forEachSide( chunk, [&]( uint32_t low, uint32_t high, uint32_t triangle ) {
+				sides[chunkCursors[bucketOf( low )]++] = { static_cast<uint64_t>(low) << 32 | high, triangle };
+			} );
+		} );
+
+		// Runs of equal keys are one edge, its length the number of triangles sharing it.
+		const float cosCrease{ std::cos( creaseAngle ) };
+		std::vector<std::array<std::vector<uint32_t>, EdgeClassCount>> bucketEdges( bucketCount );
+		pool.ParallelFor( bucketCount, [&]( uint32_t bucket, unsigned ) {
+			HalfEdge* const first{ sides.data() + bucketStarts[bucket] };
+			HalfEdge* const last{ sides.data() + bucketStarts[bucket + 1] };
+			std::sort( first, last, []( const HalfEdge& a, const HalfEdge& b ) {
+				return a.key < b.key || (a.key == b.key && a.triangle < b.triangle);
+			} );
+
+			std::array<std::vector<uint32_t>, EdgeClassCount>& edges{ bucketEdges[bucket] };
+			for ( const HalfEdge* run{ first }; run != last; ) {
+				const HalfEdge* runEnd{ run + 1 };
+				while ( runEnd != last && runEnd->key == run->key )
+					++runEnd;
+
+				EdgeClass edgeClass{ Smooth };
+				if ( runEnd - run == 1 )
+					edgeClass = Boundary;
+				else if ( runEnd - run > 2 )
+					edgeClass = Crease;
+				else {
+					const DirectX::XMFLOAT3& n0{ normals[run[0].triangle] };
+					const DirectX::XMFLOAT3& n1{ normals[run[1].triangle] };
+					const bool degenerate{ (n0.x == 0.f && n0.y == 0.f && n0.z == 0.f) ||
+						(n1.x == 0.f && n1.y == 0.f && n1.z == 0.f) };
+					if ( !degenerate && n0.x * n1.x + n0.y * n1.y + n0.z * n1.z < cosCrease )
+						edgeClass = Crease;
+				}
+				edges[edgeClass].push_back( static_cast<uint32_t>(run->key >> 32) );
+				edges[edgeClass].push_back( static_cast<uint32_t>(run->key) );
+				run = runEnd;
+			}
+		} );
+
+		size_t indexCount{};
+		for ( const std::array<std::vector<uint32_t>, EdgeClassCount>& edges : bucketEdges )
+			for ( const std::vector<uint32_t>& classEdges : edges )
+				indexCount += classEdges.size();
+		mesh.edgeIndices.reserve( indexCount );
+		for ( unsigned edgeClass{}; edgeClass < EdgeClassCount; ++edgeClass )
+			for ( const std::array<std::vector<uint32_t>, EdgeClassCount>& edges : bucketEdges )
+				mesh.edgeIndices.insert( mesh.edgeIndices.end(), edges[edgeClass].begin(), edges[edgeClass].end() );
+		for ( const std::array<std::vector<uint32_t>, EdgeClassCount>& edges : bucketEdges ) {
+			mesh.boundaryEdgeCount += static_cast<uint32_t>(edges[Boundary].size() / 2);
+			mesh.creaseEdgeCount += static_cast<uint32_t>(edges[Crease].size() / 2);
+		}
+	}
+
+	EdgeRange SelectEdges( EdgeMode mode, uint32_t edgeCount, uint32_t boundaryCount, uint32_t creaseCount ) {
+		switch ( mode ) {
+			case EdgeMode::Feature:
+				return { 0, boundaryCount + creaseCount };
+			case EdgeMode::Boundary:
+				return { 0, boundaryCount };
+			case EdgeMode::Crease:
+				return { boundaryCount, creaseCount };
+			default:
+				return { 0, edgeCount };
+		}
+	}
+}
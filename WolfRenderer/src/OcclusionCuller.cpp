@@ -0,0 +1,319 @@
+#include "OcclusionCuller.hpp" // OcclusionCuller, OcclusionStats
+
+#include <algorithm> // min, max, sort, fill, copy_n
+#include <cfloat> // FLT_MAX
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // abs, floor, lround
+#include <utility> // pair
+
+#include "SIMD.hpp" // Simd
+#include "WideBVH.hpp" // DetectSIMDWidth
+
+
+namespace Raster {
+	namespace {
+		using Clock = std::chrono::high_resolution_clock;
+
+		double ElapsedMs( Clock::time_point start ) {
+			return std::chrono::duration<double, std::milli>{ Clock::now() - start }.count();
+		}
+
+		/// Pixel center offsets of the lanes of a row, enough for the widest SIMD width.
+		alignas(32) constexpr float LaneCenters[8]{ 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+	}
+
+	void OcclusionCuller::SetMeshes( const std::vector<Mesh>& meshes ) {
+		m_meshes = meshes;
+		m_bounds.assign( meshes.size(), {} );
+		for ( size_t i{}; i < meshes.size(); ++i )
+			for ( const Vertex& vertex : meshes[i].vertices )
+				m_bounds[i].Grow( vertex.position );
+		m_mask.assign( (meshes.size() + 63) / 64, 0 );
+	}
+
+	const std::vector<uint64_t>& OcclusionCuller::Cull( const Transformation::TransformDataCB& transform,
+		const std::vector<uint32_t>& candidates, bool showBackfaces ) {
+		Clock::time_point start{ Clock::now() };
+		m_stats = {};
+		std::fill( m_mask.begin(), m_mask.end(), 0 );
+		for ( const uint32_t mesh : candidates )
+			m_mask[mesh >> 6] |= 1ull << (mesh & 63);
+		if ( !enabled || candidates.empty() )
+			return m_mask;
+
+		// The constant buffer holds the transposed matrices, so rows multiply column vectors like mul( M, v ).
+		for ( int row{}; row < 4; ++row )
+			for ( int column{}; column < 4; ++column )
+				m_clipMatrix[row][column] = transform.projection.m[row][0] * transform.mat.m[0][column] +
+					transform.projection.m[row][1] * transform.mat.m[1][column] +
+					transform.projection.m[row][2] * transform.mat.m[2][column] +
+					transform.projection.m[row][3] * transform.mat.m[3][column];
+		m_showBackfaces = showBackfaces;
+
+		// The projection scales X by 1 / aspect ratio more than Y.
+		const float aspectRatio{ transform.projection.m[0][0] != 0.f ?
+			transform.projection.m[1][1] / transform.projection.m[0][0] : 1.f };
+		m_width = std::max( width, 8u );
+		m_height = std::max( 1u, static_cast<unsigned>(std::lround( m_width / std::max( aspectRatio, 1e-3f ) )) );
+		m_stride = m_width + 8;
+		m_depth.assign( static_cast<size_t>(m_stride) * m_height, 0.f );
+
+		// The largest projected boxes make the best occluders. A box around the camera covers the whole screen.
+		std::vector<ScreenBounds> bounds( candidates.size() );
+		std::vector<std::pair<float, uint32_t>> order;
+		order.reserve( candidates.size() );
+		for ( size_t i{}; i < candidates.size(); ++i ) {
+			bounds[i] = Project( m_bounds[candidates[i]] );
+			const ScreenBounds& box{ bounds[i] };
+			const float area{ box.crossesNear ? static_cast<float>(m_width) * m_height :
+				std::max( 0.f, std::min( box.maxX, static_cast<float>(m_width) ) - std::max( box.minX, 0.f ) ) *
+				std::max( 0.f, std::min( box.maxY, static_cast<float>(m_height) ) - std::max( box.minY, 0.f ) ) };
+			order.emplace_back( area, static_cast<uint32_t>(i) );
+		}
+		std::sort( order.begin(), order.end(), []( const auto& a, const auto& b ) {
+			return a.first > b.first || (a.first == b.first && a.second < b.second);
+		} );
+
+		const unsigned lanes{ simdWidth == 4 || simdWidth == 8 ? simdWidth : CPU::DetectSIMDWidth() };
+		uint64_t budget{ occluderTriangleBudget };
+		for ( const auto& [area, candidate] : order ) {
+			if ( m_stats.occluders >= maxOccluders || area <= 0.f )
+				break;
+			const uint32_t mesh{ candidates[candidate] };
+			const uint64_t triangles{ m_meshes[mesh].indices.size() / 3 };
+			if ( triangles == 0 || triangles > budget )
+				continue;
+			budget -= triangles;
+			++m_stats.occluders;
+			m_stats.occluderTriangles += triangles;
+			if ( lanes == 8 )
+				RasterizeOccluder<8>( mesh );
+			else
+				RasterizeOccluder<4>( mesh );
+		}
+		m_stats.rasterMs = ElapsedMs( start );
+
+		start = Clock::now();
+		BuildPyramid();
+		for ( size_t i{}; i < candidates.size(); ++i ) {
+			++m_stats.tested;
+			if ( IsOccluded( bounds[i] ) ) {
+				m_mask[candidates[i] >> 6] &= ~(1ull << (candidates[i] & 63));
+				++m_stats.occluded;
+			}
+		}
+		m_stats.testMs = ElapsedMs( start );
+		return m_mask;
+	}
+
+	const std::vector<uint64_t>& OcclusionCuller::GetMask() const {
+		return m_mask;
+	}
+
+	const OcclusionStats& OcclusionCuller::GetStats() const {
+		return m_stats;
+	}
+
+	OcclusionCuller::ScreenBounds OcclusionCuller::Project( const CPU::AABB& box ) const {
+		ScreenBounds result{ FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, 0.f, false };
+		if ( box.IsEmpty() )
+			return result;
+
+		for ( unsigned corner{}; corner < 8; ++corner ) {
+			const float p[3]{ corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+				corner & 4 ? box.max.z : box.min.z };
+			float clip[4];
+			for ( int row{}; row < 4; ++row )
+				clip[row] = m_clipMatrix[row][0] * p[0] + m_clipMatrix[row][1] * p[1] + m_clipMatrix[row][2] * p[2] +
+					m_clipMatrix[row][3];
+			// Reverse-Z puts the near plane at z = w, anything past it can't be projected.
+			if ( clip[2] > clip[3] || clip[3] <= 0.f ) {
+				result.crossesNear = true;
+				return result;
+			}
+
+			const float invW{ 1.f / clip[3] };
+			const float x{ (clip[0] * invW * 0.5f + 0.5f) * m_width };
+			const float y{ (0.5f - clip[1] * invW * 0.5f) * m_height };
+			result.minX = std::min( result.minX, x );
+			result.minY = std::min( result.minY, y );
+			result.maxX = std::max( result.maxX, x );
+			result.maxY = std::max( result.maxY, y );
+			result.nearest = std::max( result.nearest, clip[2] * invW );
+		}
+		return result;
+	}
+
+	template <unsigned W>
+	void OcclusionCuller::RasterizeOccluder( uint32_t meshIdx ) {
+		const Mesh& mesh{ m_meshes[meshIdx] };
+		m_clipVertices.resize( mesh.vertices.size() );
+		for ( size_t i{}; i < mesh.vertices.size(); ++i ) {
+			const DirectX::XMFLOAT3& p{ mesh.vertices[i].position };
+			float clip[4];
+			for ( int row{}; row < 4; ++row )
+				clip[row] = m_clipMatrix[row][0] * p.x + m_clipMatrix[row][1] * p.y + m_clipMatrix[row][2] * p.z +
+					m_clipMatrix[row][3];
+			m_clipVertices[i] = { clip[0], clip[1], clip[2], clip[3] };
+		}
+
+		for ( size_t triangle{}; triangle + 2 < mesh.indices.size(); triangle += 3 ) {
+			const DirectX::XMFLOAT4 corners[3]{ m_clipVertices[mesh.indices[triangle]],
+				m_clipVertices[mesh.indices[triangle + 1]], m_clipVertices[mesh.indices[triangle + 2]] };
+
+			// Clip against the near plane, z = w with reverse-Z, like the raster passes.
+			DirectX::XMFLOAT4 polygon[4];
+			unsigned count{};
+			for ( unsigned i{}; i < 3; ++i ) {
+				const DirectX::XMFLOAT4& a{ corners[i] };
+				const DirectX::XMFLOAT4& b{ corners[(i + 1) % 3] };
+				const float distanceA{ a.w - a.z };
+				const float distanceB{ b.w - b.z };
+				if ( distanceA >= 0.f )
+					polygon[count++] = a;
+				if ( (distanceA >= 0.f) != (distanceB >= 0.f) ) {
+					const float t{ distanceA / (distanceA - distanceB) };
+					polygon[count++] = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+				}
+			}
+			for ( unsigned fan{ 1 }; fan + 1 < count; ++fan ) {
+				const DirectX::XMFLOAT4 fanCorners[3]{ polygon[0], polygon[fan], polygon[fan + 1] };
+				RasterizeTriangle<W>( fanCorners );
+			}
+		}
+	}
+
+	template <unsigned W>
+	void OcclusionCuller::RasterizeTriangle( const DirectX::XMFLOAT4 ( &vertices )[3] ) {
+		using S = CPU::Simd<W>;
+		using Reg = typename S::Reg;
+
+		float x[3];
+		float y[3];
+		float z[3];
+		for ( unsigned i{}; i < 3; ++i ) {
+			if ( vertices[i].w <= 0.f )
+				return;
+			const float invW{ 1.f / vertices[i].w };
+			// NDC to pixels, Y flipped like the viewport transform.
+			x[i] = (vertices[i].x * invW * 0.5f + 0.5f) * m_width;
+			y[i] = (0.5f - vertices[i].y * invW * 0.5f) * m_height;
+			z[i] = vertices[i].z * invW;
+		}
+
+		// Clockwise in pixel space (Y down) is front facing, the D3D12 default.
+		const float area2{ (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]) };
+		if ( area2 == 0.f || (area2 < 0.f && !m_showBackfaces) )
+			return;
+
+		// Clamped as floats, vertices close to the camera plane project far outside the screen.
+		const float lastX{ static_cast<float>(m_width - 1) };
+		const float lastY{ static_cast<float>(m_height - 1) };
+		const int minX{ static_cast<int>(std::clamp( std::floor( std::min( { x[0], x[1], x[2] } ) ), -1.f, lastX + 1.f )) };
+		const int maxX{ static_cast<int>(std::clamp( std::floor( std::max( { x[0], x[1], x[2] } ) ), -1.f, lastX )) };
+		const int minY{ static_cast<int>(std::clamp( std::floor( std::min( { y[0], y[1], y[2] } ) ), -1.f, lastY + 1.f )) };
+		const int maxY{ static_cast<int>(std::clamp( std::floor( std::max( { y[0], y[1], y[2] } ) ), -1.f, lastY )) };
+		if ( std::max( minX, 0 ) > maxX || std::max( minY, 0 ) > maxY )
+			return;
+
+		// Edge i, opposite vertex i, is positive inside: A * x + B * y + C. Its value at a pixel center minus half the
+		// pixel's extent along the edge normal is the value at the pixel's most outside corner.
+		const float sign{ area2 > 0.f ? 1.f : -1.f };
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		for ( unsigned edge{}; edge < 3; ++edge ) {
+			const unsigned a{ (edge + 1) % 3 };
+			const unsigned b{ (edge + 2) % 3 };
+			edgeA[edge] = (y[a] - y[b]) * sign;
+			edgeB[edge] = (x[b] - x[a]) * sign;
+			edgeC[edge] = -edgeA[edge] * x[a] - edgeB[edge] * y[a] - 0.5f * (std::abs( edgeA[edge] ) + std::abs( edgeB[edge] ));
+		}
+
+		// Depth plane, lowered to its farthest value over a pixel.
+		const float depthA{ ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area2 };
+		const float depthB{ ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area2 };
+		const float depthC{ z[0] - depthA * x[0] - depthB * y[0] - 0.5f * (std::abs( depthA ) + std::abs( depthB )) };
+
+		const Reg laneCenters{ S::LoadU( LaneCenters ) };
+		const Reg zero{ S::Set1( 0.f ) };
+		for ( int row{ std::max( minY, 0 ) }; row <= maxY; ++row ) {
+			const float centerY{ row + 0.5f };
+			float* depthRow{ m_depth.data() + static_cast<size_t>(row) * m_stride };
+			for ( int column{ std::max( minX, 0 ) }; column <= maxX; column += W ) {
+				const Reg centerX{ S::Add( S::Set1( static_cast<float>(column) ), laneCenters ) };
+				Reg inside{ S::Ge( S::Add( S::Mul( S::Set1( edgeA[0] ), centerX ), S::Set1( edgeB[0] * centerY + edgeC[0] ) ), zero ) };
+				inside = S::And( inside, S::Ge( S::Add( S::Mul( S::Set1( edgeA[1] ), centerX ), S::Set1( edgeB[1] * centerY + edgeC[1] ) ), zero ) );
+				inside = S::And( inside, S::Ge( S::Add( S::Mul( S::Set1( edgeA[2] ), centerX ), S::Set1( edgeB[2] * centerY + edgeC[2] ) ), zero ) );
+				if ( S::Mask( inside ) == 0 )
+					continue;
+
+				// Fully covered pixels lie within the triangle's bounds, lanes past maxX only pass in the row padding.
+				const Reg depth{ S::Add( S::Mul( S::Set1( depthA ), centerX ), S::Set1( depthB * centerY + depthC ) ) };
+				const Reg current{ S::LoadU( depthRow + column ) };
+				S::StoreU( depthRow + column, S::Select( current, S::Max( current, depth ), inside ) );
+			}
+		}
+	}
+
+	void OcclusionCuller::BuildPyramid() {
+		m_levelWidths.assign( 1, m_width );
+		m_levelHeights.assign( 1, m_height );
+		while ( m_levelWidths.back() > 1 || m_levelHeights.back() > 1 ) {
+			m_levelWidths.push_back( (m_levelWidths.back() + 1) / 2 );
+			m_levelHeights.push_back( (m_levelHeights.back() + 1) / 2 );
+		}
+		m_pyramid.resize( m_levelWidths.size() );
+
+		m_pyramid[0].resize( static_cast<size_t>(m_width) * m_height );
+		for ( unsigned row{}; row < m_height; ++row )
+			std::copy_n( m_depth.data() + static_cast<size_t>(row) * m_stride, m_width, m_pyramid[0].data() + static_cast<size_t>(row) * m_width );
+
+		// Odd sizes clamp the second child to the last one, so every texel covers all the pixels below it.
+		for ( size_t level{ 1 }; level < m_pyramid.size(); ++level ) {
+			const std::vector<float>& below{ m_pyramid[level - 1] };
+			const unsigned belowWidth{ m_levelWidths[level - 1] };
+			const unsigned belowHeight{ m_levelHeights[level - 1] };
+			std::vector<float>& texels{ m_pyramid[level] };
+			texels.resize( static_cast<size_t>(m_levelWidths[level]) * m_levelHeights[level] );
+			for ( unsigned row{}; row < m_levelHeights[level]; ++row ) {
+				const size_t row0{ static_cast<size_t>(row * 2) * belowWidth };
+				const size_t row1{ static_cast<size_t>(std::min( row * 2 + 1, belowHeight - 1 )) * belowWidth };
+				for ( unsigned column{}; column < m_levelWidths[level]; ++column ) {
+					const unsigned column0{ column * 2 };
+					const unsigned column1{ std::min( column * 2 + 1, belowWidth - 1 ) };
+					texels[static_cast<size_t>(row) * m_levelWidths[level] + column] = std::min(
+						std::min( below[row0 + column0], below[row0 + column1] ), std::min( below[row1 + column0], below[row1 + column1] ) );
+				}
+			}
+		}
+	}
+
+	bool OcclusionCuller::IsOccluded( const ScreenBounds& box ) const {
+		if ( box.crossesNear )
+			return false;
+		// The projection of a box in front of the camera lies within its corners' rectangle.
+		if ( box.maxX < 0.f || box.maxY < 0.f || box.minX >= m_width || box.minY >= m_height || box.minX > box.maxX )
+			return true;
+
+		unsigned x0{ static_cast<unsigned>(std::max( box.minX, 0.f )) };
+		unsigned y0{ static_cast<unsigned>(std::max( box.minY, 0.f )) };
+		unsigned x1{ static_cast<unsigned>(std::min( box.maxX, static_cast<float>(m_width - 1) )) };
+		unsigned y1{ static_cast<unsigned>(std::min( box.maxY, static_cast<float>(m_height - 1) )) };
+
+		// The level where the rectangle overlaps at most 2x2 texels.
+		size_t level{};
+		while ( level + 1 < m_pyramid.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1) )
+			++level;
+		x0 >>= level;
+		y0 >>= level;
+		x1 >>= level;
+		y1 >>= level;
+
+		float farthest{ FLT_MAX };
+		for ( unsigned row{ y0 }; row <= y1; ++row )
+			for ( unsigned column{ x0 }; column <= x1; ++column )
+				farthest = std::min( farthest, m_pyramid[level][static_cast<size_t>(row) * m_levelWidths[level] + column] );
+		return box.nearest < farthest;
+	}
+}
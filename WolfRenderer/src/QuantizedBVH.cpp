@@ -0,0 +1,283 @@
+#include "QuantizedBVH.hpp" // QuantizedBVH, QuantizedNode
+
+#include <algorithm> // min, max
+#include <cmath> // ceil, floor, log2
+#include <cstring> // memcpy
+
+#include "SIMD.hpp" // Simd, SafeRcp
+
+
+namespace CPU {
+	namespace {
+		/// Every child of a wide node is at least one binary level below it, so a path has at most MaxBVHDepth
+		/// nodes, each leaving at most 7 of its children on the stack, and the root.
+		constexpr unsigned MaxStackSize{ (MaxBVHDepth - 1) * 7 + 1 };
+		constexpr uint8_t InnerFlag{ 0x80 };
+		constexpr uint32_t MaxLeafBlocks{ 3 };
+
+		/// 2^exponent, built from the float bits. Exponents are kept in the normal range [-126, 127].
+		float ExponentScale( int8_t exponent ) {
+			const uint32_t bits{ static_cast<uint32_t>(exponent + 127) << 23 };
+			float scale;
+			std::memcpy( &scale, &bits, sizeof( scale ) );
+			return scale;
+		}
+
+		/// Decodes one quantized plane the same way the traversal does.
+		float Dequantize( float origin, float scale, uint8_t q ) {
+			return origin + static_cast<float>(q) * scale;
+		}
+
+		/// Picks the smallest power-of-two cell size for which 255 cells span [origin, maxValue].
+		int8_t ChooseExponent( float origin, float maxValue ) {
+			const float extent{ maxValue - origin };
+			if ( extent <= 0.f )
+				return -126;
+
+			int exponent{ static_cast<int>(std::ceil( std::log2( extent / 255.f ) )) };
+			exponent = std::max( exponent, -126 );
+			// Rounding of the decode may still fall short of the maximum, so grow until it is covered.
+			while ( exponent < 127 && Dequantize( origin, ExponentScale( static_cast<int8_t>(exponent) ), 255 ) < maxValue )
+				++exponent;
+			return static_cast<int8_t>(exponent);
+		}
+
+		/// Conservative quantization of the lower plane: the decoded value is <= value.
+		uint8_t QuantizeLow( float origin, float scale, float value ) {
+			float q{ std::floor( (value - origin) / scale ) };
+			q = std::clamp( q, 0.f, 255.f );
+			uint8_t result{ static_cast<uint8_t>(q) };
+			while ( result > 0 && Dequantize( origin, scale, result ) > value )
+				--result;
+			return result;
+		}
+
+		/// Conservative quantization of the upper plane: the decoded value is >= value.
+		uint8_t QuantizeHigh( float origin, float scale, float value ) {
+			float q{ std::ceil( (value - origin) / scale ) };
+			q = std::clamp( q, 0.f, 255.f );
+			uint8_t result{ static_cast<uint8_t>(q) };
+			while ( result < 255 && Dequantize( origin, scale, result ) < value )
+				++result;
+			return result;
+		}
+
+		/// Quantizes every node of the wide BVH. Node indices and block indices are kept, because
+		/// the collapse already stores the inner children and the leaf blocks of a node contiguously.
+		template <unsigned W>
+		bool Compress( const WideStorage<W>& wide, std::vector<QuantizedNode<W>>& out ) {
+			out.clear();
+			out.reserve( wide.nodes.size() );
+
+			for ( const WideNode<W>& node : wide.nodes ) {
+				QuantizedNode<W> qNode{};
+				qNode.childBase = EmptyChild;
+				qNode.blockBase = EmptyChild;
+
+				AABB bounds{};
+				for ( unsigned i{}; i < W; ++i ) {
+					if ( node.child[i] == EmptyChild )
+						continue;
+					bounds.Grow( DirectX::XMFLOAT3{ node.minX[i], node.minY[i], node.minZ[i] } );
+					bounds.Grow( DirectX::XMFLOAT3{ node.maxX[i], node.maxY[i], node.maxZ[i] } );
+					if ( node.blockCount[i] == 0 )
+						qNode.childBase = std::min( qNode.childBase, node.child[i] );
+					else
+						qNode.blockBase = std::min( qNode.blockBase, node.child[i] );
+				}
+
+				if ( bounds.IsEmpty() ) {
+					out.push_back( qNode );
+					continue;
+				}
+
+				qNode.originX = bounds.min.x;
+				qNode.originY = bounds.min.y;
+				qNode.originZ = bounds.min.z;
+				qNode.exponentX = ChooseExponent( bounds.min.x, bounds.max.x );
+				qNode.exponentY = ChooseExponent( bounds.min.y, bounds.max.y );
+				qNode.exponentZ = ChooseExponent( bounds.min.z, bounds.max.z );
+				const float scaleX{ ExponentScale( qNode.exponentX ) };
+				const float scaleY{ ExponentScale( qNode.exponentY ) };
+				const float scaleZ{ ExponentScale( qNode.exponentZ ) };
+
+				for ( unsigned i{}; i < W; ++i ) {
+					if ( node.child[i] == EmptyChild )
+						continue;
+
+					if ( node.blockCount[i] == 0 ) {
+						qNode.meta[i] = static_cast<uint8_t>(InnerFlag | (node.child[i] - qNode.childBase));
+					} else {
+						const uint32_t offset{ node.child[i] - qNode.blockBase };
+						if ( node.blockCount[i] > MaxLeafBlocks || offset > 0x1F )
+							return false;
+						qNode.meta[i] = static_cast<uint8_t>((node.blockCount[i] << 5) | offset);
+					}
+
+					qNode.qloX[i] = QuantizeLow( qNode.originX, scaleX, node.minX[i] );
+					qNode.qloY[i] = QuantizeLow( qNode.originY, scaleY, node.minY[i] );
+					qNode.qloZ[i] = QuantizeLow( qNode.originZ, scaleZ, node.minZ[i] );
+					qNode.qhiX[i] = QuantizeHigh( qNode.originX, scaleX, node.maxX[i] );
+					qNode.qhiY[i] = QuantizeHigh( qNode.originY, scaleY, node.maxY[i] );
+					qNode.qhiZ[i] = QuantizeHigh( qNode.originZ, scaleZ, node.maxZ[i] );
+				}
+				out.push_back( qNode );
+			}
+			return true;
+		}
+
+		/// AnyHit returns at the first hit and skips sorting the children by distance.
+		template <unsigned W, bool AnyHit>
+		bool IntersectQuantized( const std::vector<QuantizedNode<W>>& nodes,
+			const std::vector<TriangleBlock<W>>& blocks, const Ray& ray, Hit& hit ) {
+			using S = Simd<W>;
+			using Reg = typename S::Reg;
+
+			if ( nodes.empty() )
+				return false;
+
+			hit.t = std::min( hit.t, ray.tMax );
+			const Reg ox{ S::Set1( ray.origin.x ) };
+			const Reg oy{ S::Set1( ray.origin.y ) };
+			const Reg oz{ S::Set1( ray.origin.z ) };
+			const Reg rdx{ S::Set1( SafeRcp( ray.direction.x ) ) };
+			const Reg rdy{ S::Set1( SafeRcp( ray.direction.y ) ) };
+			const Reg rdz{ S::Set1( SafeRcp( ray.direction.z ) ) };
+			const Reg tMin{ S::Set1( ray.tMin ) };
+
+			struct Entry {
+				uint32_t index; ///< Node or first triangle block.
+				uint32_t blockCount; ///< Zero for inner nodes.
+				float dist; ///< Entry distance into the child's box.
+			};
+			Entry stack[MaxStackSize];
+			uint32_t stackSize{};
+			stack[stackSize++] = { 0, 0, ray.tMin };
+
+			bool found{ false };
+			while ( stackSize > 0 ) {
+				const Entry entry{ stack[--stackSize] };
+				if ( entry.dist > hit.t )
+					continue;
+
+				if ( entry.blockCount > 0 ) {
+					for ( uint32_t b{}; b < entry.blockCount; ++b ) {
+						if ( IntersectBlock( blocks[entry.index + b], ray, hit ) ) {
+							if constexpr ( AnyHit )
+								return true;
+							found = true;
+						}
+					}
+					continue;
+				}
+
+				const QuantizedNode<W>& node{ nodes[entry.index] };
+
+				// Decode to world space first, then run the same slab test as the uncompressed
+				// wide BVH. Decoded boxes contain the exact ones, so no hit can be lost.
+				const Reg originX{ S::Set1( node.originX ) };
+				const Reg originY{ S::Set1( node.originY ) };
+				const Reg originZ{ S::Set1( node.originZ ) };
+				const Reg scaleX{ S::Set1( ExponentScale( node.exponentX ) ) };
+				const Reg scaleY{ S::Set1( ExponentScale( node.exponentY ) ) };
+				const Reg scaleZ{ S::Set1( ExponentScale( node.exponentZ ) ) };
+
+				const Reg minX{ S::Add( originX, S::Mul( S::LoadBytes( node.qloX ), scaleX ) ) };
+				const Reg minY{ S::Add( originY, S::Mul( S::LoadBytes( node.qloY ), scaleY ) ) };
+				const Reg minZ{ S::Add( originZ, S::Mul( S::LoadBytes( node.qloZ ), scaleZ ) ) };
+				const Reg maxX{ S::Add( originX, S::Mul( S::LoadBytes( node.qhiX ), scaleX ) ) };
+				const Reg maxY{ S::Add( originY, S::Mul( S::LoadBytes( node.qhiY ), scaleY ) ) };
+				const Reg maxZ{ S::Add( originZ, S::Mul( S::LoadBytes( node.qhiZ ), scaleZ ) ) };
+
+				const Reg tx1{ S::Mul( S::Sub( minX, ox ), rdx ) };
+				const Reg tx2{ S::Mul( S::Sub( maxX, ox ), rdx ) };
+				const Reg ty1{ S::Mul( S::Sub( minY, oy ), rdy ) };
+				const Reg ty2{ S::Mul( S::Sub( maxY, oy ), rdy ) };
+				const Reg tz1{ S::Mul( S::Sub( minZ, oz ), rdz ) };
+				const Reg tz2{ S::Mul( S::Sub( maxZ, oz ), rdz ) };
+
+				Reg tNear{ S::Max( S::Min( tx1, tx2 ), tMin ) };
+				tNear = S::Max( tNear, S::Min( ty1, ty2 ) );
+				tNear = S::Max( tNear, S::Min( tz1, tz2 ) );
+				Reg tFar{ S::Min( S::Max( tx1, tx2 ), S::Set1( hit.t ) ) };
+				tFar = S::Min( tFar, S::Max( ty1, ty2 ) );
+				tFar = S::Min( tFar, S::Max( tz1, tz2 ) );
+
+				const int mask{ S::Mask( S::Le( tNear, tFar ) ) };
+				if ( mask == 0 )
+					continue;
+
+				alignas(32) float dists[W];
+				S::Store( dists, tNear );
+
+				// Insertion into the stack top keeps it sorted, nearest child on top.
+				const uint32_t base{ stackSize };
+				for ( unsigned i{}; i < W; ++i ) {
+					const uint8_t meta{ node.meta[i] };
+					if ( !((mask >> i) & 1) || meta == 0 )
+						continue;
+
+					const Entry child{ (meta & InnerFlag) ?
+						Entry{ node.childBase + (meta & 0x7F), 0, dists[i] } :
+						Entry{ node.blockBase + (meta & 0x1F), static_cast<uint32_t>(meta >> 5), dists[i] } };
+					if constexpr ( AnyHit ) {
+						stack[stackSize++] = child;
+						continue;
+					}
+					uint32_t pos{ stackSize++ };
+					while ( pos > base && stack[pos - 1].dist < child.dist ) {
+						stack[pos] = stack[pos - 1];
+						--pos;
+					}
+					stack[pos] = child;
+				}
+			}
+			return found;
+		}
+	}
+
+	bool QuantizedBVH::Build( const WideBVH& wideBVH ) {
+		m_width = wideBVH.GetWidth();
+		m_nodes4.clear();
+		m_nodes8.clear();
+		m_blocks4 = &wideBVH.GetBVH4().blocks;
+		m_blocks8 = &wideBVH.GetBVH8().blocks;
+
+		const bool success{ m_width == 8 ?
+			Compress( wideBVH.GetBVH8(), m_nodes8 ) : Compress( wideBVH.GetBVH4(), m_nodes4 ) };
+		if ( !success ) {
+			m_nodes4.clear();
+			m_nodes8.clear();
+			m_width = 0;
+		}
+		return success;
+	}
+
+	bool QuantizedBVH::Intersect( const Ray& ray, Hit& hit ) const {
+		if ( m_width == 8 )
+			return IntersectQuantized<8, false>( m_nodes8, *m_blocks8, ray, hit );
+		if ( m_width == 4 )
+			return IntersectQuantized<4, false>( m_nodes4, *m_blocks4, ray, hit );
+		return false;
+	}
+
+	bool QuantizedBVH::IntersectAny( const Ray& ray, Hit& hit ) const {
+		if ( m_width == 8 )
+			return IntersectQuantized<8, true>( m_nodes8, *m_blocks8, ray, hit );
+		if ( m_width == 4 )
+			return IntersectQuantized<4, true>( m_nodes4, *m_blocks4, ray, hit );
+		return false;
+	}
+
+	unsigned QuantizedBVH::GetWidth() const {
+		return m_width;
+	}
+
+	size_t QuantizedBVH::GetNodeCount() const {
+		return m_width == 8 ? m_nodes8.size() : m_nodes4.size();
+	}
+
+	size_t QuantizedBVH::GetNodeMemoryUsage() const {
+		return m_width == 8 ? m_nodes8.size() * sizeof( QuantizedNode<8> ) : m_nodes4.size() * sizeof( QuantizedNode<4> );
+	}
+}
@@ -0,0 +1,997 @@
+#include "Rasterizer.hpp" // Rasterizer, RasterStats
+
+#include <algorithm> // min, max, fill, copy_n, upper_bound
+#include <bit> // countr_zero, popcount
+#include <chrono> // high_resolution_clock, duration
+#include <cmath> // floor, ceil, abs, pow, sqrtf
+#include <cstring> // memcmp
+#include <DirectXMath.h> // XMMatrixInverse, XMVector3TransformCoord, XMVector3TransformNormal
+#include <format> // format
+#include <thread> // hardware_concurrency
+#include <utility> // swap
+
+#include "CPUTracer.hpp" // PackColor, UnpackColor
+#include "SIMD.hpp" // Simd
+#include "WideBVH.hpp" // DetectSIMDWidth
+
+
+namespace CPU {
+	namespace {
+		/// Vertices transformed per task of the vertex stage.
+		constexpr uint32_t VertexChunk{ 4096 };
+		/// Triangles set up and binned per task. Every chunk has its own bins.
+		constexpr uint32_t TriangleChunk{ 1024 };
+		/// Wireframe edges set up and binned per task.
+		constexpr uint32_t EdgeChunk{ 4096 };
+		/// Edges lie on the faces they outline, so their interpolated depth is tested with this much relative slack.
+		/// The GPU edge pass tests GREATER against the same depth and loses about half of the edge pixels.
+		constexpr float EdgeDepthBias{ 1e-3f };
+		/// Secondary rays start this far off the surface along its geometric normal, same as the CPU tracer's.
+		constexpr float SurfaceOffset{ 1e-4f };
+		// Visibility buffer ids above the triangles, which are numbered over all meshes.
+		constexpr uint32_t BackgroundId{ 0xFFFFFFFF };
+		constexpr uint32_t EdgeId{ 0xFFFFFFFE };
+		constexpr uint32_t PointId{ 0xFFFFFFFD };
+
+		using Clock = std::chrono::high_resolution_clock;
+
+		double ElapsedMs( Clock::time_point start ) {
+			return std::chrono::duration<double, std::milli>{ Clock::now() - start }.count();
+		}
+
+		DirectX::XMFLOAT3 Normalize( const DirectX::XMFLOAT3& v ) {
+			const float lengthSq{ v.x * v.x + v.y * v.y + v.z * v.z };
+			if ( lengthSq <= 0.f )
+				return v;
+			const float invLength{ 1.f / std::sqrtf( lengthSq ) };
+			return { v.x * invLength, v.y * invLength, v.z * invLength };
+		}
+
+		float Dot( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		DirectX::XMFLOAT3 Add( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.x + b.x, a.y + b.y, a.z + b.z };
+		}
+
+		DirectX::XMFLOAT3 Sub( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.x - b.x, a.y - b.y, a.z - b.z };
+		}
+
+		DirectX::XMFLOAT3 Scale( const DirectX::XMFLOAT3& a, float s ) {
+			return { a.x * s, a.y * s, a.z * s };
+		}
+
+		DirectX::XMFLOAT3 Cross( const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b ) {
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+
+		DirectX::XMFLOAT3 Transform( const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT4X4& matrix ) {
+			DirectX::XMFLOAT3 result{};
+			DirectX::XMStoreFloat3( &result, DirectX::XMVector3TransformCoord(
+				DirectX::XMLoadFloat3( &point ), DirectX::XMLoadFloat4x4( &matrix ) ) );
+			return result;
+		}
+
+		DirectX::XMFLOAT3 TransformNormal( const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT4X4& matrix ) {
+			DirectX::XMFLOAT3 result{};
+			DirectX::XMStoreFloat3( &result, DirectX::XMVector3TransformNormal(
+				DirectX::XMLoadFloat3( &normal ), DirectX::XMLoadFloat4x4( &matrix ) ) );
+			return result;
+		}
+
+		float Saturate( float value ) {
+			return std::min( std::max( value, 0.f ), 1.f );
+		}
+
+		// Colors of GetAlbedoColor() in ConstColor.hlsl.
+		constexpr DirectX::XMFLOAT3 RedColor{ 0.84f, 0.41f, 0.29f };
+		constexpr DirectX::XMFLOAT3 BlueColor{ 0.21f, 0.5f, 0.73f };
+		constexpr DirectX::XMFLOAT3 PurpleColor{ 0.49f, 0.52f, 0.97f };
+		constexpr DirectX::XMFLOAT3 YellowColor{ 1.f, 0.99f, 0.57f };
+		constexpr DirectX::XMFLOAT3 OrangeColor{ 0.94f, 0.53f, 0.31f };
+		constexpr DirectX::XMFLOAT3 PinkColor{ 0.94f, 0.53f, 0.75f };
+		constexpr DirectX::XMFLOAT3 RandomColors[6]{ RedColor, PurpleColor, BlueColor, YellowColor, OrangeColor, PinkColor };
+
+		/// Same as GetAlbedoColor() in ConstColor.hlsl.
+		DirectX::XMFLOAT3 GetAlbedoColor( const Raster::SceneDataCB& sceneData, uint32_t frameIdx, uint32_t primID ) {
+			if ( sceneData.useRandomColors )
+				return RandomColors[primID % 6];
+			if ( sceneData.disco ) {
+				const uint32_t speed{ std::max( sceneData.discoSpeed, 1u ) };
+				return frameIdx % speed <= speed / 2 ? RedColor : PurpleColor;
+			}
+			return UnpackColor( sceneData.packedColor );
+		}
+
+		/// Linear interpolation of all vertex shader outputs, exact in clip space.
+		template <typename V>
+		V Lerp( const V& a, const V& b, float t ) {
+			const auto lerp = [t]( float x, float y ) { return x + (y - x) * t; };
+			return {
+				{ lerp( a.position.x, b.position.x ), lerp( a.position.y, b.position.y ),
+					lerp( a.position.z, b.position.z ), lerp( a.position.w, b.position.w ) },
+				{ lerp( a.viewPosition.x, b.viewPosition.x ), lerp( a.viewPosition.y, b.viewPosition.y ),
+					lerp( a.viewPosition.z, b.viewPosition.z ) },
+				{ lerp( a.normal.x, b.normal.x ), lerp( a.normal.y, b.normal.y ), lerp( a.normal.z, b.normal.z ) } };
+		}
+
+		/// Frustum planes a clip space position is outside of, one bit each. Reverse-Z keeps 0 <= z <= w.
+		unsigned OutCode( const DirectX::XMFLOAT4& p ) {
+			return (p.x < -p.w ? 1u : 0u) | (p.x > p.w ? 2u : 0u) | (p.y < -p.w ? 4u : 0u) | (p.y > p.w ? 8u : 0u) |
+				(p.z < 0.f ? 16u : 0u) | (p.z > p.w ? 32u : 0u);
+		}
+	}
+
+	void Rasterizer::SetMeshes( const std::vector<Mesh>& meshes ) {
+		m_meshes = meshes;
+		m_vertexOffsets.assign( 1, 0 );
+		m_triangleOffsets.assign( 1, 0 );
+		for ( const Mesh& mesh : meshes ) {
+			m_vertexOffsets.push_back( m_vertexOffsets.back() + static_cast<uint32_t>(mesh.vertices.size()) );
+			m_triangleOffsets.push_back( m_triangleOffsets.back() + static_cast<uint32_t>(mesh.indices.size() / 3) );
+		}
+		m_visibilityKey.valid = false;
+		log( std::format( "[ CPU Rasterizer ] {} meshes, {} vertices, {} triangles.",
+			meshes.size(), m_vertexOffsets.back(), m_triangleOffsets.back() ) );
+	}
+
+	void Rasterizer::SetRayTracing( const BVH* bvh, std::span<const Material> materials ) {
+		m_bvh = bvh;
+		m_materials = materials;
+	}
+
+	void Rasterizer::SetMeshMask( std::span<const uint64_t> mask ) {
+		m_meshMask = mask;
+	}
+
+	void Rasterizer::RenderFrame( const Raster::Data& data, uint32_t frameIdx, unsigned width, unsigned height ) {
+		const Clock::time_point start{ Clock::now() };
+
+		m_stats = {};
+		SetShadingInputs( data, frameIdx );
+		VisibilityKey key{ data.camera.cbData, width, height, data.showBackfaces, data.renderFaces, data.renderEdges,
+			data.edgeMode, data.renderVerts, data.vertexSize, {}, true };
+		key.meshMask.assign( m_meshMask.begin(), m_meshMask.end() );
+
+		// Only the shading inputs changed since the visibility buffer was rasterized: shade it again.
+		if ( visibilityBuffer && VisibilityMatches( key ) && m_pool ) {
+			const Clock::time_point resolveStart{ Clock::now() };
+			ResolveVisibility();
+			m_stats.resolveMs = ElapsedMs( resolveStart );
+			m_stats.reshaded = true;
+			m_stats.renderMs = ElapsedMs( start );
+			return;
+		}
+		m_visibilityKey = std::move( key );
+		m_visibilityKey.valid = visibilityBuffer;
+		m_writeVisibility = visibilityBuffer;
+
+		m_transform = data.camera.cbData;
+		m_showBackfaces = data.showBackfaces;
+		m_renderFaces = data.renderFaces;
+		m_renderEdges = data.renderEdges;
+		m_edgeMode = data.edgeMode;
+		m_renderVerts = data.renderVerts;
+		m_vertexSize = data.vertexSize;
+		m_width = width;
+		m_height = height;
+		m_tileSize = (std::max( tileSize, 8u ) + 7) & ~7u;
+		m_tilesX = (width + m_tileSize - 1) / m_tileSize;
+		m_tilesY = (height + m_tileSize - 1) / m_tileSize;
+		m_frameBuffer.assign( static_cast<size_t>(width) * height, m_bgColorPacked );
+		m_depthBuffer.assign( static_cast<size_t>(width) * height, 0.f );
+		if ( m_writeVisibility )
+			m_visibility.assign( static_cast<size_t>(width) * height, BackgroundId );
+		else
+			m_visibility.clear();
+		m_stats.triangles = m_triangleOffsets.empty() ? 0 : m_triangleOffsets.back();
+		const auto isDrawn = [&]( size_t mesh ) {
+			return m_meshMask.empty() || Raster::IsVisible( m_meshMask, static_cast<uint32_t>(mesh) );
+		};
+		for ( size_t mesh{}; mesh < m_meshes.size(); ++mesh )
+			m_stats.maskedMeshes += !isDrawn( mesh );
+		m_stats.tiles = m_tilesX * m_tilesY;
+		if ( !(m_renderFaces || m_renderEdges || m_renderVerts) || width == 0 || height == 0 || m_meshes.empty() ) {
+			m_stats.renderMs = ElapsedMs( start );
+			return;
+		}
+
+		const unsigned desiredThreads{ std::max( 1u, threadCount ? threadCount : std::thread::hardware_concurrency() ) };
+		if ( !m_pool || m_pool->GetThreadCount() != desiredThreads )
+			m_pool = std::make_unique<ThreadPool>( desiredThreads );
+
+		// Vertex stage, which also sets up and bins the vertex points.
+		Clock::time_point stageStart{ Clock::now() };
+		const uint32_t tileCount{ m_tilesX * m_tilesY };
+		const uint32_t vertexCount{ m_vertexOffsets.back() };
+		m_vertices.resize( vertexCount );
+		m_pointBins.resize( (vertexCount + VertexChunk - 1) / VertexChunk );
+		m_pool->ParallelFor( static_cast<uint32_t>(m_pointBins.size()), [&]( uint32_t chunk, unsigned ) {
+			PointBin& pointBin{ m_pointBins[chunk] };
+			pointBin.points.clear();
+			pointBin.tiles.resize( tileCount );
+			for ( std::vector<uint32_t>& tile : pointBin.tiles )
+				tile.clear();
+
+			const uint32_t first{ chunk * VertexChunk };
+			const uint32_t last{ std::min( first + VertexChunk, vertexCount ) };
+			size_t mesh{ static_cast<size_t>(std::upper_bound( m_vertexOffsets.begin(), m_vertexOffsets.end(), first ) -
+				m_vertexOffsets.begin()) - 1 };
+			for ( uint32_t vertex{ first }; vertex < last; ++vertex ) {
+				while ( vertex >= m_vertexOffsets[mesh + 1] )
+					++mesh;
+				if ( !isDrawn( mesh ) )
+					continue;
+				m_vertices[vertex] = ShadeVertex( m_meshes[mesh].vertices[vertex - m_vertexOffsets[mesh]] );
+				if ( m_renderVerts )
+					SetupPoint( m_vertices[vertex], pointBin );
+			}
+		} );
+		for ( const PointBin& pointBin : m_pointBins )
+			m_stats.setupPoints += pointBin.points.size();
+		m_stats.vertexMs = ElapsedMs( stageStart );
+
+		// Clipping, culling, setup and binning, every chunk of triangles or edges into its own bins.
+		stageStart = Clock::now();
+		const uint32_t triangleCount{ m_renderFaces ? m_triangleOffsets.back() : 0 };
+		m_edgeRanges.clear();
+		m_edgeOffsets.assign( 1, 0 );
+		if ( m_renderEdges )
+			for ( size_t meshIdx{}; meshIdx < m_meshes.size(); ++meshIdx ) {
+				const Mesh& mesh{ m_meshes[meshIdx] };
+				m_edgeRanges.push_back( isDrawn( meshIdx ) ? Raster::SelectEdges( m_edgeMode,
+					static_cast<uint32_t>(mesh.edgeIndices.size() / 2), mesh.boundaryEdgeCount, mesh.creaseEdgeCount ) :
+					Raster::EdgeRange{ 0, 0 } );
+				m_edgeOffsets.push_back( m_edgeOffsets.back() + m_edgeRanges.back().count );
+			}
+		const uint32_t edgeCount{ m_edgeOffsets.back() };
+		m_bins.resize( (triangleCount + TriangleChunk - 1) / TriangleChunk );
+		m_lineBins.resize( (edgeCount + EdgeChunk - 1) / EdgeChunk );
+		const uint32_t triangleChunks{ static_cast<uint32_t>(m_bins.size()) };
+		m_pool->ParallelFor( triangleChunks + static_cast<uint32_t>(m_lineBins.size()), [&]( uint32_t chunk, unsigned ) {
+			if ( chunk >= triangleChunks ) {
+				BinEdges( chunk - triangleChunks );
+				return;
+			}
+
+			Bin& bin{ m_bins[chunk] };
+			bin.triangles.clear();
+			bin.tiles.resize( tileCount );
+			for ( std::vector<uint32_t>& tile : bin.tiles )
+				tile.clear();
+			bin.culled = 0;
+			bin.references = 0;
+
+			const uint32_t first{ chunk * TriangleChunk };
+			const uint32_t last{ std::min( first + TriangleChunk, triangleCount ) };
+			size_t mesh{ static_cast<size_t>(std::upper_bound( m_triangleOffsets.begin(), m_triangleOffsets.end(), first ) -
+				m_triangleOffsets.begin()) - 1 };
+			for ( uint32_t triangle{ first }; triangle < last; ++triangle ) {
+				while ( triangle >= m_triangleOffsets[mesh + 1] )
+					++mesh;
+				if ( !isDrawn( mesh ) )
+					continue;
+				const uint32_t primID{ triangle - m_triangleOffsets[mesh] };
+				const uint32_t* indices{ m_meshes[mesh].indices.data() + static_cast<size_t>(primID) * 3 };
+				const ShadedVertex* vertices{ m_vertices.data() + m_vertexOffsets[mesh] };
+				const ShadedVertex corners[3]{ vertices[indices[0]], vertices[indices[1]], vertices[indices[2]] };
+				SetupTriangle( corners, primID, triangle, bin );
+			}
+		} );
+		for ( const LineBin& lineBin : m_lineBins )
+			m_stats.setupLines += lineBin.lines.size();
+		for ( const Bin& bin : m_bins ) {
+			m_stats.culledTriangles += bin.culled;
+			m_stats.setupTriangles += bin.triangles.size();
+			m_stats.binnedReferences += bin.references;
+		}
+		m_stats.binMs = ElapsedMs( stageStart );
+
+		// Tiles in parallel, each into the tile target of its worker.
+		stageStart = Clock::now();
+		m_tileTargets.resize( m_pool->GetThreadCount() );
+		for ( TileTarget& target : m_tileTargets ) {
+			target.color.resize( static_cast<size_t>(m_tileSize) * m_tileSize );
+			target.depth.resize( static_cast<size_t>(m_tileSize) * m_tileSize );
+			target.pixels = 0;
+			target.overlayPixels = 0;
+			target.shadedPixels = 0;
+		}
+		// The tile kernel of the frame's SIMD width and shading, picked once for all tiles.
+		static constexpr std::array<PassKernel, KernelCount> tileKernels4{ MakeTileKernels<4>( std::make_integer_sequence<unsigned, KernelCount>{} ) };
+		static constexpr std::array<PassKernel, KernelCount> tileKernels8{ MakeTileKernels<8>( std::make_integer_sequence<unsigned, KernelCount>{} ) };
+		const unsigned lanes{ simdWidth == 4 || simdWidth == 8 ? simdWidth : DetectSIMDWidth() };
+		const PassKernel rasterizeTile{ (lanes == 8 ? tileKernels8 : tileKernels4)[SelectKernel()] };
+		m_pool->ParallelFor( tileCount, [&]( uint32_t tile, unsigned worker ) {
+			(this->*rasterizeTile)( tile, m_tileTargets[worker] );
+		} );
+		for ( const TileTarget& target : m_tileTargets ) {
+			m_stats.pixels += target.pixels;
+			m_stats.overlayPixels += target.overlayPixels;
+		}
+		m_stats.rasterMs = ElapsedMs( stageStart );
+
+		// Every pixel shaded once, after all its fragments were depth tested.
+		if ( m_writeVisibility ) {
+			stageStart = Clock::now();
+			ResolveVisibility();
+			m_stats.resolveMs = ElapsedMs( stageStart );
+		}
+
+		m_stats.renderMs = ElapsedMs( start );
+		m_stats.trianglesPerSecond = m_stats.triangles / (m_stats.renderMs * 0.001);
+		m_stats.pixelsPerSecond = m_stats.pixels / (m_stats.renderMs * 0.001);
+	}
+
+	Rasterizer::ShadedVertex Rasterizer::ShadeVertex( const Vertex& vertex ) const {
+		// The constant buffer holds the transposed matrices, so rows multiply column vectors like mul( M, v ).
+		const DirectX::XMFLOAT4X4& worldView{ m_transform.mat };
+		const DirectX::XMFLOAT4X4& projection{ m_transform.projection };
+		const DirectX::XMFLOAT3& p{ vertex.position };
+
+		float view[4];
+		for ( int row{}; row < 4; ++row )
+			view[row] = worldView.m[row][0] * p.x + worldView.m[row][1] * p.y + worldView.m[row][2] * p.z + worldView.m[row][3];
+		float clip[4];
+		for ( int row{}; row < 4; ++row )
+			clip[row] = projection.m[row][0] * view[0] + projection.m[row][1] * view[1] +
+				projection.m[row][2] * view[2] + projection.m[row][3] * view[3];
+
+		// mul( normal, (float3x3)WorldView ), the normal as a row vector like in VSMain.
+		const DirectX::XMFLOAT3& n{ vertex.normal };
+		const DirectX::XMFLOAT3 normal{
+			n.x * worldView.m[0][0] + n.y * worldView.m[1][0] + n.z * worldView.m[2][0],
+			n.x * worldView.m[0][1] + n.y * worldView.m[1][1] + n.z * worldView.m[2][1],
+			n.x * worldView.m[0][2] + n.y * worldView.m[1][2] + n.z * worldView.m[2][2] };
+
+		return { { clip[0], clip[1], clip[2], clip[3] }, { view[0], view[1], view[2] }, Normalize( normal ) };
+	}
+
+	void Rasterizer::SetupTriangle( const ShadedVertex ( &vertices )[3], uint32_t primID, uint32_t triangleId, Bin& bin ) const {
+		if ( OutCode( vertices[0].position ) & OutCode( vertices[1].position ) & OutCode( vertices[2].position ) ) {
+			++bin.culled;
+			return;
+		}
+
+		// Clip against the near plane, z = w with reverse-Z. Keeping w >= z also keeps w positive,
+		// so nothing behind the camera is projected. One plane turns a triangle into at most a quad.
+		ShadedVertex polygon[4];
+		unsigned count{};
+		for ( unsigned i{}; i < 3; ++i ) {
+			const ShadedVertex& a{ vertices[i] };
+			const ShadedVertex& b{ vertices[(i + 1) % 3] };
+			const float distanceA{ a.position.w - a.position.z };
+			const float distanceB{ b.position.w - b.position.z };
+			if ( distanceA >= 0.f )
+				polygon[count++] = a;
+			if ( (distanceA >= 0.f) != (distanceB >= 0.f) )
+				polygon[count++] = Lerp( a, b, distanceA / (distanceA - distanceB) );
+		}
+
+		bool binned{ false };
+		for ( unsigned fan{ 1 }; fan + 1 < count; ++fan ) {
+			const ShadedVertex* corners[3]{ &polygon[0], &polygon[fan], &polygon[fan + 1] };
+
+			TriangleSetup setup{};
+			setup.primID = primID;
+			setup.triangleId = triangleId;
+			float x[3];
+			float y[3];
+			float depth[3];
+			for ( unsigned i{}; i < 3; ++i ) {
+				const DirectX::XMFLOAT4& p{ corners[i]->position };
+				setup.invW[i] = 1.f / p.w;
+				// NDC to pixels, Y flipped like the viewport transform.
+				x[i] = (p.x * setup.invW[i] * 0.5f + 0.5f) * m_width;
+				y[i] = (0.5f - p.y * setup.invW[i] * 0.5f) * m_height;
+				depth[i] = p.z * setup.invW[i];
+				setup.viewPosition[i] = corners[i]->viewPosition;
+				setup.normal[i] = corners[i]->normal;
+			}
+
+			for ( unsigned edge{}; edge < 3; ++edge ) {
+				unsigned a{ (edge + 1) % 3 };
+				unsigned b{ (edge + 2) % 3 };
+				setup.edgeA[edge] = y[a] - y[b];
+				setup.edgeB[edge] = x[b] - x[a];
+				if ( y[b] < y[a] || (y[b] == y[a] && x[b] < x[a]) )
+					std::swap( a, b );
+				setup.edgeRefX[edge] = x[a];
+				setup.edgeRefY[edge] = y[a];
+			}
+			float area2{ setup.edgeA[0] * (x[0] - setup.edgeRefX[0]) + setup.edgeB[0] * (y[0] - setup.edgeRefY[0]) };
+
+			// Clockwise in pixel space (Y down) is front facing, the D3D12 default.
+			if ( area2 == 0.f || (area2 < 0.f && !m_showBackfaces) )
+				continue;
+			if ( area2 < 0.f ) {
+				for ( unsigned edge{}; edge < 3; ++edge ) {
+					setup.edgeA[edge] = -setup.edgeA[edge];
+					setup.edgeB[edge] = -setup.edgeB[edge];
+				}
+				area2 = -area2;
+			}
+			for ( unsigned edge{}; edge < 3; ++edge )
+				setup.topLeft[edge] = setup.edgeA[edge] > 0.f || (setup.edgeA[edge] == 0.f && setup.edgeB[edge] > 0.f);
+			setup.invArea = 1.f / area2;
+
+			setup.depthA = (depth[0] * setup.edgeA[0] + depth[1] * setup.edgeA[1] + depth[2] * setup.edgeA[2]) * setup.invArea;
+			setup.depthB = (depth[0] * setup.edgeB[0] + depth[1] * setup.edgeB[1] + depth[2] * setup.edgeB[2]) * setup.invArea;
+			setup.depth0 = depth[0];
+			setup.x0 = x[0];
+			setup.y0 = y[0];
+
+			// Pixels whose centers can be inside.
+			setup.minX = std::max( static_cast<int>(std::ceil( std::min( { x[0], x[1], x[2] } ) - 0.5f )), 0 );
+			setup.minY = std::max( static_cast<int>(std::ceil( std::min( { y[0], y[1], y[2] } ) - 0.5f )), 0 );
+			setup.maxX = std::min( static_cast<int>(std::floor( std::max( { x[0], x[1], x[2] } ) - 0.5f )),
+				static_cast<int>(m_width) - 1 );
+			setup.maxY = std::min( static_cast<int>(std::floor( std::max( { y[0], y[1], y[2] } ) - 0.5f )),
+				static_cast<int>(m_height) - 1 );
+			if ( setup.minX > setup.maxX || setup.minY > setup.maxY )
+				continue;
+
+			const uint32_t index{ static_cast<uint32_t>(bin.triangles.size()) };
+			bin.triangles.push_back( setup );
+			for ( unsigned tileY{ setup.minY / m_tileSize }; tileY <= setup.maxY / m_tileSize; ++tileY )
+				for ( unsigned tileX{ setup.minX / m_tileSize }; tileX <= setup.maxX / m_tileSize; ++tileX ) {
+					bin.tiles[tileY * m_tilesX + tileX].push_back( index );
+					++bin.references;
+				}
+			binned = true;
+		}
+		if ( !binned )
+			++bin.culled;
+	}
+
+	void Rasterizer::BinEdges( uint32_t chunk ) {
+		LineBin& bin{ m_lineBins[chunk] };
+		bin.lines.clear();
+		bin.tiles.resize( m_tilesX * m_tilesY );
+		for ( std::vector<uint32_t>& tile : bin.tiles )
+			tile.clear();
+
+		const uint32_t first{ chunk * EdgeChunk };
+		const uint32_t last{ std::min( first + EdgeChunk, m_edgeOffsets.back() ) };
+		size_t mesh{ static_cast<size_t>(std::upper_bound( m_edgeOffsets.begin(), m_edgeOffsets.end(), first ) -
+			m_edgeOffsets.begin()) - 1 };
+		for ( uint32_t edge{ first }; edge < last; ++edge ) {
+			while ( edge >= m_edgeOffsets[mesh + 1] )
+				++mesh;
+			// The edge pass draws without culling, so back faces have their edges too.
+			const uint32_t* indices{ m_meshes[mesh].edgeIndices.data() +
+				static_cast<size_t>(m_edgeRanges[mesh].first + edge - m_edgeOffsets[mesh]) * 2 };
+			const ShadedVertex* vertices{ m_vertices.data() + m_vertexOffsets[mesh] };
+			SetupLine( vertices[indices[0]], vertices[indices[1]], bin );
+		}
+	}
+
+	void Rasterizer::SetupLine( const ShadedVertex& a, const ShadedVertex& b, LineBin& bin ) const {
+		if ( OutCode( a.position ) & OutCode( b.position ) )
+			return;
+
+		// Near plane clipping, same as for triangles.
+		const float distanceA{ a.position.w - a.position.z };
+		const float distanceB{ b.position.w - b.position.z };
+		if ( distanceA < 0.f && distanceB < 0.f )
+			return;
+		DirectX::XMFLOAT4 endpoints[2]{ a.position, b.position };
+		if ( distanceA < 0.f )
+			endpoints[0] = Lerp( a, b, distanceA / (distanceA - distanceB) ).position;
+		else if ( distanceB < 0.f )
+			endpoints[1] = Lerp( a, b, distanceA / (distanceA - distanceB) ).position;
+
+		float x[2];
+		float y[2];
+		float depth[2];
+		for ( unsigned i{}; i < 2; ++i ) {
+			const float invW{ 1.f / endpoints[i].w };
+			x[i] = (endpoints[i].x * invW * 0.5f + 0.5f) * m_width;
+			y[i] = (0.5f - endpoints[i].y * invW * 0.5f) * m_height;
+			depth[i] = endpoints[i].z * invW;
+		}
+
+		LineSetup setup{};
+		setup.steep = std::abs( y[1] - y[0] ) > std::abs( x[1] - x[0] );
+		float major[2]{ x[0], x[1] };
+		float minor[2]{ y[0], y[1] };
+		if ( setup.steep )
+			std::swap( major, minor );
+		if ( major[1] < major[0] ) {
+			std::swap( major[0], major[1] );
+			std::swap( minor[0], minor[1] );
+			std::swap( depth[0], depth[1] );
+		}
+		const int majorSize{ static_cast<int>(setup.steep ? m_height : m_width) };
+		const int minorSize{ static_cast<int>(setup.steep ? m_width : m_height) };
+		setup.first = std::max( static_cast<int>(std::ceil( major[0] - 0.5f )), 0 );
+		setup.last = std::min( static_cast<int>(std::ceil( major[1] - 0.5f )) - 1, majorSize - 1 );
+		if ( setup.first > setup.last )
+			return;
+		setup.major0 = major[0];
+		setup.minor0 = minor[0];
+		setup.depth0 = depth[0];
+		setup.slope = (minor[1] - minor[0]) / (major[1] - major[0]);
+		setup.depthSlope = (depth[1] - depth[0]) / (major[1] - major[0]);
+
+		// Tiles the line crosses, one run of tiles along the minor axis per tile along the major axis.
+		const int size{ static_cast<int>(m_tileSize) };
+		const uint32_t index{ static_cast<uint32_t>(bin.lines.size()) };
+		bool binned{ false };
+		for ( int majorTile{ setup.first / size }; majorTile <= setup.last / size; ++majorTile ) {
+			const int start{ std::max( setup.first, majorTile * size ) };
+			const int end{ std::min( setup.last, majorTile * size + size - 1 ) };
+			const int minorStart{ static_cast<int>(std::floor( setup.MinorAt( start ) )) };
+			const int minorEnd{ static_cast<int>(std::floor( setup.MinorAt( end ) )) };
+			const int minorMin{ std::max( std::min( minorStart, minorEnd ), 0 ) };
+			const int minorMax{ std::min( std::max( minorStart, minorEnd ), minorSize - 1 ) };
+			for ( int minorTile{ minorMin / size }; minorMin <= minorMax && minorTile <= minorMax / size; ++minorTile ) {
+				const int tileX{ setup.steep ? minorTile : majorTile };
+				const int tileY{ setup.steep ? majorTile : minorTile };
+				bin.tiles[tileY * m_tilesX + tileX].push_back( index );
+				binned = true;
+			}
+		}
+		if ( binned )
+			bin.lines.push_back( setup );
+	}
+
+	void Rasterizer::SetupPoint( const ShadedVertex& vertex, PointBin& bin ) const {
+		// The geometry shader's quad keeps the vertex's z and w, so the point is clipped as a whole by them.
+		const DirectX::XMFLOAT4& p{ vertex.position };
+		if ( m_vertexSize <= 0.f || p.w <= 0.f || p.z < 0.f || p.z > p.w )
+			return;
+
+		PointSetup setup{};
+		const float invW{ 1.f / p.w };
+		setup.x = (p.x * invW * 0.5f + 0.5f) * m_width;
+		setup.y = (0.5f - p.y * invW * 0.5f) * m_height;
+		setup.depth = p.z * invW;
+		setup.minX = std::max( static_cast<int>(std::ceil( setup.x - m_vertexSize - 0.5f )), 0 );
+		setup.minY = std::max( static_cast<int>(std::ceil( setup.y - m_vertexSize - 0.5f )), 0 );
+		setup.maxX = std::min( static_cast<int>(std::floor( setup.x + m_vertexSize - 0.5f )), static_cast<int>(m_width) - 1 );
+		setup.maxY = std::min( static_cast<int>(std::floor( setup.y + m_vertexSize - 0.5f )), static_cast<int>(m_height) - 1 );
+		if ( setup.minX > setup.maxX || setup.minY > setup.maxY )
+			return;
+
+		const uint32_t index{ static_cast<uint32_t>(bin.points.size()) };
+		bin.points.push_back( setup );
+		for ( unsigned tileY{ setup.minY / m_tileSize }; tileY <= setup.maxY / m_tileSize; ++tileY )
+			for ( unsigned tileX{ setup.minX / m_tileSize }; tileX <= setup.maxX / m_tileSize; ++tileX )
+				bin.tiles[tileY * m_tilesX + tileX].push_back( index );
+	}
+
+	unsigned Rasterizer::SelectKernel() const {
+		if ( !specializedShading )
+			return GenericKernel;
+		return (m_sceneData.useRandomColors ? RandomColorsKernel : 0u) | (m_sceneData.shadeMode == 1 ? UnlitKernel : 0u);
+	}
+
+	template <unsigned W, unsigned Kernel>
+	void Rasterizer::RasterizeTile( uint32_t tile, TileTarget& target ) {
+		using S = Simd<W>;
+		using Reg = typename S::Reg;
+		static constexpr float laneOffsets[8]{ 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+
+		const int size{ static_cast<int>(m_tileSize) };
+		const int tileX{ static_cast<int>(tile % m_tilesX) * size };
+		const int tileY{ static_cast<int>(tile / m_tilesX) * size };
+		const int tileEndX{ std::min( tileX + size, static_cast<int>(m_width) ) };
+		const int tileEndY{ std::min( tileY + size, static_cast<int>(m_height) ) };
+		std::fill( target.color.begin(), target.color.end(), m_writeVisibility ? BackgroundId : m_bgColorPacked );
+		std::fill( target.depth.begin(), target.depth.end(), 0.f );
+
+		const Reg laneCenters{ S::LoadU( laneOffsets ) };
+		alignas(32) float edgeValues[3][W];
+		for ( const Bin& bin : m_bins ) {
+			for ( const uint32_t index : bin.tiles[tile] ) {
+				const TriangleSetup& setup{ bin.triangles[index] };
+				const int minX{ std::max( setup.minX, tileX ) };
+				const int maxX{ std::min( setup.maxX, tileEndX - 1 ) };
+				const int minY{ std::max( setup.minY, tileY ) };
+				const int maxY{ std::min( setup.maxY, tileEndY - 1 ) };
+				// Groups of W pixels start at multiples of W in the tile, so they never leave the tile target.
+				const int startX{ tileX + (minX - tileX) / static_cast<int>(W) * static_cast<int>(W) };
+				const Reg firstCenter{ S::Set1( minX + 0.5f ) };
+				const Reg lastCenter{ S::Set1( maxX + 0.5f ) };
+
+				for ( int y{ minY }; y <= maxY; ++y ) {
+					const float centerY{ y + 0.5f };
+					Reg rowTerms[3];
+					for ( unsigned edge{}; edge < 3; ++edge )
+						rowTerms[edge] = S::Set1( setup.edgeB[edge] * (centerY - setup.edgeRefY[edge]) );
+					const Reg rowDepth{ S::Set1( setup.depth0 + setup.depthB * (centerY - setup.y0) ) };
+					float* depthRow{ target.depth.data() + static_cast<size_t>(y - tileY) * size };
+					uint32_t* colorRow{ target.color.data() + static_cast<size_t>(y - tileY) * size };
+
+					for ( int x{ startX }; x <= maxX; x += W ) {
+						const Reg centerX{ S::Add( S::Set1( static_cast<float>(x) ), laneCenters ) };
+						Reg inside{ S::And( S::Ge( centerX, firstCenter ), S::Le( centerX, lastCenter ) ) };
+						Reg edges[3];
+						for ( unsigned edge{}; edge < 3; ++edge ) {
+							edges[edge] = S::Add( S::Mul( S::Set1( setup.edgeA[edge] ),
+								S::Sub( centerX, S::Set1( setup.edgeRefX[edge] ) ) ), rowTerms[edge] );
+							const Reg zero{ S::Set1( 0.f ) };
+							inside = S::And( inside, setup.topLeft[edge] ? S::Ge( edges[edge], zero ) : S::Gt( edges[edge], zero ) );
+						}
+						if ( !S::Mask( inside ) )
+							continue;
+
+						// Reverse-Z: nearer fragments have the greater depth.
+						const Reg depth{ S::Add( rowDepth, S::Mul( S::Set1( setup.depthA ), S::Sub( centerX, S::Set1( setup.x0 ) ) ) ) };
+						const Reg stored{ S::LoadU( depthRow + (x - tileX) ) };
+						const Reg pass{ S::And( inside, S::Gt( depth, stored ) ) };
+						int mask{ S::Mask( pass ) };
+						if ( !mask )
+							continue;
+						S::StoreU( depthRow + (x - tileX), S::Select( stored, depth, pass ) );
+						if ( m_writeVisibility ) {
+							target.pixels += std::popcount( static_cast<unsigned>(mask) );
+							for ( ; mask != 0; mask &= mask - 1 )
+								colorRow[x - tileX + std::countr_zero( static_cast<unsigned>(mask) )] = setup.triangleId;
+							continue;
+						}
+
+						for ( unsigned edge{}; edge < 3; ++edge )
+							S::StoreU( edgeValues[edge], edges[edge] );
+						for ( ; mask != 0; mask &= mask - 1 ) {
+							const int lane{ std::countr_zero( static_cast<unsigned>(mask) ) };
+							// Perspective-correct barycentrics.
+							float weights[3];
+							float weightSum{};
+							for ( unsigned vertex{}; vertex < 3; ++vertex ) {
+								weights[vertex] = edgeValues[vertex][lane] * setup.invArea * setup.invW[vertex];
+								weightSum += weights[vertex];
+							}
+							const float invWeightSum{ 1.f / weightSum };
+							DirectX::XMFLOAT3 viewPosition{};
+							DirectX::XMFLOAT3 normal{};
+							for ( unsigned vertex{}; vertex < 3; ++vertex ) {
+								const float weight{ weights[vertex] * invWeightSum };
+								viewPosition.x += setup.viewPosition[vertex].x * weight;
+								viewPosition.y += setup.viewPosition[vertex].y * weight;
+								viewPosition.z += setup.viewPosition[vertex].z * weight;
+								normal.x += setup.normal[vertex].x * weight;
+								normal.y += setup.normal[vertex].y * weight;
+								normal.z += setup.normal[vertex].z * weight;
+							}
+							colorRow[x - tileX + lane] = PackColor( ShadeSurface<Kernel>( setup.primID, viewPosition, normal ) );
+							++target.pixels;
+						}
+					}
+				}
+			}
+		}
+
+		if ( m_renderEdges )
+			DrawLines( tile, target );
+		if ( m_renderVerts )
+			DrawPoints( tile, target );
+
+		for ( int y{ tileY }; y < tileEndY; ++y ) {
+			const size_t source{ static_cast<size_t>(y - tileY) * size };
+			const size_t destination{ static_cast<size_t>(y) * m_width + tileX };
+			std::copy_n( target.color.data() + source, tileEndX - tileX,
+				(m_writeVisibility ? m_visibility.data() : m_frameBuffer.data()) + destination );
+			std::copy_n( target.depth.data() + source, tileEndX - tileX, m_depthBuffer.data() + destination );
+		}
+	}
+
+	void Rasterizer::DrawLines( uint32_t tile, TileTarget& target ) const {
+		const int size{ static_cast<int>(m_tileSize) };
+		const int tileX{ static_cast<int>(tile % m_tilesX) * size };
+		const int tileY{ static_cast<int>(tile / m_tilesX) * size };
+		const int tileEndX{ std::min( tileX + size, static_cast<int>(m_width) ) };
+		const int tileEndY{ std::min( tileY + size, static_cast<int>(m_height) ) };
+
+		for ( const LineBin& bin : m_lineBins ) {
+			for ( const uint32_t index : bin.tiles[tile] ) {
+				const LineSetup& setup{ bin.lines[index] };
+				const int majorStart{ setup.steep ? tileY : tileX };
+				const int majorEnd{ setup.steep ? tileEndY : tileEndX };
+				const int minorStart{ setup.steep ? tileX : tileY };
+				const int minorEnd{ setup.steep ? tileEndX : tileEndY };
+				const int first{ std::max( setup.first, majorStart ) };
+				const int last{ std::min( setup.last, majorEnd - 1 ) };
+				for ( int major{ first }; major <= last; ++major ) {
+					const int minor{ static_cast<int>(std::floor( setup.MinorAt( major ) )) };
+					if ( minor < minorStart || minor >= minorEnd )
+						continue;
+					const int x{ setup.steep ? minor : major };
+					const int y{ setup.steep ? major : minor };
+					const size_t pixel{ static_cast<size_t>(y - tileY) * size + (x - tileX) };
+					const float depth{ setup.depth0 + setup.depthSlope * (major + 0.5f - setup.major0) };
+					float& stored{ target.depth[pixel] };
+					if ( depth * (1.f + EdgeDepthBias) < stored )
+						continue;
+					target.color[pixel] = m_writeVisibility ? EdgeId : m_edgeColor;
+					stored = std::max( stored, depth );
+					++target.overlayPixels;
+				}
+			}
+		}
+	}
+
+	void Rasterizer::DrawPoints( uint32_t tile, TileTarget& target ) const {
+		const int size{ static_cast<int>(m_tileSize) };
+		const int tileX{ static_cast<int>(tile % m_tilesX) * size };
+		const int tileY{ static_cast<int>(tile / m_tilesX) * size };
+		const int tileEndX{ std::min( tileX + size, static_cast<int>(m_width) ) };
+		const int tileEndY{ std::min( tileY + size, static_cast<int>(m_height) ) };
+		const float radiusSq{ m_vertexSize * m_vertexSize };
+
+		for ( const PointBin& bin : m_pointBins ) {
+			for ( const uint32_t index : bin.tiles[tile] ) {
+				const PointSetup& setup{ bin.points[index] };
+				for ( int y{ std::max( setup.minY, tileY ) }; y <= std::min( setup.maxY, tileEndY - 1 ); ++y ) {
+					const float dy{ y + 0.5f - setup.y };
+					for ( int x{ std::max( setup.minX, tileX ) }; x <= std::min( setup.maxX, tileEndX - 1 ); ++x ) {
+						const float dx{ x + 0.5f - setup.x };
+						const size_t pixel{ static_cast<size_t>(y - tileY) * size + (x - tileX) };
+						// Cut to a circle like ConstColorVertexPass.hlsl. GREATER_EQUAL, without writing depth.
+						if ( dx * dx + dy * dy > radiusSq || setup.depth < target.depth[pixel] )
+							continue;
+						target.color[pixel] = m_writeVisibility ? PointId : m_vertexColor;
+						++target.overlayPixels;
+					}
+				}
+			}
+		}
+	}
+
+	void Rasterizer::SetShadingInputs( const Raster::Data& data, uint32_t frameIdx ) {
+		m_sceneData = data.sceneData;
+		m_light = data.directionalLight.cb;
+		m_lightDirection = Normalize( { -m_light.directionVS.x, -m_light.directionVS.y, -m_light.directionVS.z } );
+		m_lightColor = UnpackColor( m_light.pckedColor );
+		m_frameIdx = frameIdx;
+		m_edgeColor = data.edgeColor;
+		m_vertexColor = data.vertexColor;
+		m_bgColor = { data.bgColor[0], data.bgColor[1], data.bgColor[2] };
+		m_bgColorPacked = PackColor( m_bgColor );
+		Raster::SceneDataCB uniform{ m_sceneData };
+		uniform.useRandomColors = 0;
+		m_uniformAlbedo = GetAlbedoColor( uniform, frameIdx, 0 );
+	}
+
+	bool Rasterizer::VisibilityMatches( const VisibilityKey& key ) const {
+		const VisibilityKey& last{ m_visibilityKey };
+		return last.valid && last.width == key.width && last.height == key.height &&
+			last.showBackfaces == key.showBackfaces && last.renderFaces == key.renderFaces &&
+			last.renderEdges == key.renderEdges && last.edgeMode == key.edgeMode && last.renderVerts == key.renderVerts &&
+			last.vertexSize == key.vertexSize && last.meshMask == key.meshMask &&
+			std::memcmp( &last.transform, &key.transform, sizeof( Raster::Transformation::TransformDataCB ) ) == 0;
+	}
+
+	void Rasterizer::ResolveVisibility() {
+		m_frameBuffer.resize( m_visibility.size() );
+		m_tileTargets.resize( m_pool->GetThreadCount() );
+		for ( TileTarget& target : m_tileTargets ) {
+			target.shadedPixels = 0;
+			target.shadowRays = 0;
+			target.occludedShadowRays = 0;
+			target.reflectionRays = 0;
+		}
+		// Hybrid rendering traces in the meshes' space.
+		if ( m_bvh ) {
+			const DirectX::XMMATRIX worldView{ DirectX::XMMatrixTranspose( DirectX::XMLoadFloat4x4( &m_transform.mat ) ) };
+			DirectX::XMStoreFloat4x4( &m_worldView, worldView );
+			DirectX::XMStoreFloat4x4( &m_viewToObject, DirectX::XMMatrixInverse( nullptr, worldView ) );
+			m_objectLightDirection = Normalize( TransformNormal( m_lightDirection, m_viewToObject ) );
+			m_objectCamera = Transform( { 0.f, 0.f, 0.f }, m_viewToObject );
+		}
+
+		// The row kernel of the frame's shading, picked once for all rows.
+		static constexpr std::array<PassKernel, KernelCount> rowKernels{ MakeRowKernels( std::make_integer_sequence<unsigned, KernelCount>{} ) };
+		const PassKernel resolveRow{ rowKernels[SelectKernel()] };
+		m_pool->ParallelFor( m_height, [&]( uint32_t y, unsigned worker ) {
+			(this->*resolveRow)( y, m_tileTargets[worker] );
+		} );
+		for ( const TileTarget& target : m_tileTargets ) {
+			m_stats.shadedPixels += target.shadedPixels;
+			m_stats.shadowRays += target.shadowRays;
+			m_stats.occludedShadowRays += target.occludedShadowRays;
+			m_stats.reflectionRays += target.reflectionRays;
+		}
+	}
+
+	template <unsigned Kernel>
+	void Rasterizer::ResolveRow( uint32_t y, TileTarget& target ) {
+		// The triangle of the last pixel shaded, which most of its neighbours share.
+		uint32_t lastId{ BackgroundId };
+		uint32_t meshIdx{};
+		uint32_t primID{};
+		const ShadedVertex* corners[3]{};
+		const Vertex* objectCorners[3]{};
+		// Rows of the inverse of the matrix whose columns are the corners' clip space (x, y, w), up to a scale.
+		// Applied to a pixel's (x, y, 1) in NDC they give its perspective-correct barycentrics, up to a scale.
+		DirectX::XMFLOAT3 inverseRows[3]{};
+		const float ndcY{ 1.f - (y + 0.5f) * 2.f / m_height };
+		uint64_t shaded{};
+
+		for ( unsigned x{}; x < m_width; ++x ) {
+			const size_t pixel{ static_cast<size_t>(y) * m_width + x };
+			const uint32_t id{ m_visibility[pixel] };
+			if ( id == BackgroundId || id == EdgeId || id == PointId ) {
+				m_frameBuffer[pixel] = id == BackgroundId ? m_bgColorPacked : id == EdgeId ? m_edgeColor : m_vertexColor;
+				continue;
+			}
+
+			if ( id != lastId ) {
+				lastId = id;
+				meshIdx = static_cast<uint32_t>(std::upper_bound( m_triangleOffsets.begin(),
+					m_triangleOffsets.end(), id ) - m_triangleOffsets.begin()) - 1;
+				primID = id - m_triangleOffsets[meshIdx];
+				const uint32_t* indices{ m_meshes[meshIdx].indices.data() + static_cast<size_t>(primID) * 3 };
+				const ShadedVertex* vertices{ m_vertices.data() + m_vertexOffsets[meshIdx] };
+				for ( unsigned vertex{}; vertex < 3; ++vertex ) {
+					corners[vertex] = &vertices[indices[vertex]];
+					objectCorners[vertex] = &m_meshes[meshIdx].vertices[indices[vertex]];
+				}
+				for ( unsigned vertex{}; vertex < 3; ++vertex ) {
+					const DirectX::XMFLOAT4& a{ corners[(vertex + 1) % 3]->position };
+					const DirectX::XMFLOAT4& b{ corners[(vertex + 2) % 3]->position };
+					inverseRows[vertex] = { a.y * b.w - a.w * b.y, a.w * b.x - a.x * b.w, a.x * b.y - a.y * b.x };
+				}
+			}
+
+			const float ndcX{ (x + 0.5f) * 2.f / m_width - 1.f };
+			float weights[3];
+			float weightSum{};
+			for ( unsigned vertex{}; vertex < 3; ++vertex ) {
+				weights[vertex] = inverseRows[vertex].x * ndcX + inverseRows[vertex].y * ndcY + inverseRows[vertex].z;
+				weightSum += weights[vertex];
+			}
+			const float invWeightSum{ 1.f / weightSum };
+			DirectX::XMFLOAT3 viewPosition{};
+			DirectX::XMFLOAT3 normal{};
+			for ( unsigned vertex{}; vertex < 3; ++vertex ) {
+				const float weight{ weights[vertex] * invWeightSum };
+				viewPosition.x += corners[vertex]->viewPosition.x * weight;
+				viewPosition.y += corners[vertex]->viewPosition.y * weight;
+				viewPosition.z += corners[vertex]->viewPosition.z * weight;
+				normal.x += corners[vertex]->normal.x * weight;
+				normal.y += corners[vertex]->normal.y * weight;
+				normal.z += corners[vertex]->normal.z * weight;
+			}
+			++shaded;
+			if ( !m_bvh ) {
+				m_frameBuffer[pixel] = PackColor( ShadeSurface<Kernel>( primID, viewPosition, normal ) );
+				continue;
+			}
+
+			// The rasterized surface in the meshes' space, the same barycentrics applied to the mesh's vertices.
+			DirectX::XMFLOAT3 objectPosition{};
+			for ( unsigned vertex{}; vertex < 3; ++vertex )
+				objectPosition = Add( objectPosition, Scale( objectCorners[vertex]->position, weights[vertex] * invWeightSum ) );
+			const DirectX::XMFLOAT3 direction{ Normalize( Sub( objectPosition, m_objectCamera ) ) };
+			m_frameBuffer[pixel] = PackColor( ShadeHybrid<Kernel>( meshIdx, primID, objectPosition, direction, viewPosition,
+				normal, 0, target ) );
+		}
+		target.shadedPixels += shaded;
+	}
+
+	template <unsigned Kernel>
+	DirectX::XMFLOAT3 Rasterizer::ShadeHybrid( uint32_t meshIdx, uint32_t primID, const DirectX::XMFLOAT3& objectPosition,
+		const DirectX::XMFLOAT3& direction, const DirectX::XMFLOAT3& viewPosition, const DirectX::XMFLOAT3& normal,
+		unsigned bounce, TileTarget& target ) const {
+		const Mesh& mesh{ m_meshes[meshIdx] };
+		const uint32_t* indices{ mesh.indices.data() + static_cast<size_t>(primID) * 3 };
+		const DirectX::XMFLOAT3& p0{ mesh.vertices[indices[0]].position };
+		const DirectX::XMFLOAT3 geometricNormal{ Normalize( Cross( Sub( mesh.vertices[indices[1]].position, p0 ),
+			Sub( mesh.vertices[indices[2]].position, p0 ) ) ) };
+		const Material* material{ mesh.materialIdx < m_materials.size() ? &m_materials[mesh.materialIdx] : nullptr };
+		const bool mirror{ material && material->type == MaterialType::Reflective };
+		const float reflected{ mirror ? 1.f : reflectivity };
+
+		DirectX::XMFLOAT3 color{};
+		if ( reflected < 1.f ) {
+			// The directional light is blocked by anything between the surface and it. Surfaces facing away are unlit.
+			float lightVisibility{ 1.f };
+			if ( tracedShadows && m_sceneData.shadeMode != 1 && Dot( normal, m_lightDirection ) > 0.f ) {
+				const float side{ Dot( geometricNormal, m_objectLightDirection ) >= 0.f ? 1.f : -1.f };
+				const Ray ray{ Add( objectPosition, Scale( geometricNormal, side * SurfaceOffset ) ), Ray{}.tMin,
+					m_objectLightDirection };
+				Hit hit{};
+				++target.shadowRays;
+				if ( m_bvh->IntersectAny( ray, hit ) ) {
+					lightVisibility = 0.f;
+					++target.occludedShadowRays;
+				}
+			}
+			color = Scale( ShadeSurface<Kernel>( primID, viewPosition, normal, lightVisibility ), 1.f - reflected );
+		}
+		if ( reflected <= 0.f )
+			return color;
+
+		DirectX::XMFLOAT3 reflection{ m_bgColor };
+		if ( bounce < reflectionBounces ) {
+			// Mirrored about the shading normal of the side the ray came from.
+			DirectX::XMFLOAT3 objectNormal{ Normalize( TransformNormal( normal, m_viewToObject ) ) };
+			if ( Dot( objectNormal, direction ) > 0.f )
+				objectNormal = Scale( objectNormal, -1.f );
+			const DirectX::XMFLOAT3 reflectedDirection{ Normalize( Sub( direction,
+				Scale( objectNormal, 2.f * Dot( direction, objectNormal ) ) ) ) };
+			const float side{ Dot( geometricNormal, reflectedDirection ) >= 0.f ? 1.f : -1.f };
+			const Ray ray{ Add( objectPosition, Scale( geometricNormal, side * SurfaceOffset ) ), Ray{}.tMin, reflectedDirection };
+			Hit hit{};
+			++target.reflectionRays;
+			if ( m_bvh->Intersect( ray, hit ) ) {
+				const Mesh& hitMesh{ m_meshes[hit.instanceIdx] };
+				const uint32_t* hitIndices{ hitMesh.indices.data() + static_cast<size_t>(hit.primIdx) * 3 };
+				const float weights[3]{ 1.f - hit.u - hit.v, hit.u, hit.v };
+				DirectX::XMFLOAT3 hitNormal{};
+				for ( unsigned vertex{}; vertex < 3; ++vertex )
+					hitNormal = Add( hitNormal, Scale( hitMesh.vertices[hitIndices[vertex]].normal, weights[vertex] ) );
+				const DirectX::XMFLOAT3 hitPosition{ Add( ray.origin, Scale( ray.direction, hit.t ) ) };
+				reflection = ShadeHybrid<Kernel>( hit.instanceIdx, hit.primIdx, hitPosition, reflectedDirection,
+					Transform( hitPosition, m_worldView ), Normalize( TransformNormal( hitNormal, m_worldView ) ), bounce + 1,
+					target );
+			}
+		}
+		const DirectX::XMFLOAT3 tint{ mirror ? material->albedo : DirectX::XMFLOAT3{ 1.f, 1.f, 1.f } };
+		return Add( color, { reflection.x * tint.x * reflected, reflection.y * tint.y * reflected, reflection.z * tint.z * reflected } );
+	}
+
+	template <unsigned Kernel>
+	DirectX::XMFLOAT3 Rasterizer::ShadeSurface( uint32_t primID, const DirectX::XMFLOAT3& viewPosition,
+		const DirectX::XMFLOAT3& interpolatedNormal, float lightVisibility ) const {
+		DirectX::XMFLOAT3 albedo;
+		if constexpr ( Kernel == GenericKernel ) {
+			albedo = GetAlbedoColor( m_sceneData, m_frameIdx, primID );
+			// Don't calculate lighting in "Unlit" shade mode.
+			if ( m_sceneData.shadeMode == 1 )
+				return albedo;
+		}
+		else {
+			if constexpr ( (Kernel & RandomColorsKernel) != 0 )
+				albedo = RandomColors[primID % 6];
+			else
+				albedo = m_uniformAlbedo;
+			if constexpr ( (Kernel & UnlitKernel) != 0 )
+				return albedo;
+		}
+
+		const DirectX::XMFLOAT3 normal{ Normalize( interpolatedNormal ) };
+		const DirectX::XMFLOAT3& lightDir{ m_lightDirection };
+		const float diffuseFactor{ Saturate( Dot( normal, lightDir ) ) };
+
+		// Blinn-Phong, the camera at the view space origin.
+		const DirectX::XMFLOAT3 viewDir{ Normalize( { -viewPosition.x, -viewPosition.y, -viewPosition.z } ) };
+		const DirectX::XMFLOAT3 halfDir{ Normalize( { lightDir.x + viewDir.x, lightDir.y + viewDir.y, lightDir.z + viewDir.z } ) };
+		const float specularFactor{ std::pow( Saturate( Dot( normal, halfDir ) ), m_light.specularStrength ) };
+
+		const DirectX::XMFLOAT3& lightColor{ m_lightColor };
+		const float intensity{ m_light.intensity * lightVisibility };
+		return {
+			intensity * (albedo.x * lightColor.x * diffuseFactor + lightColor.x * specularFactor),
+			intensity * (albedo.y * lightColor.y * diffuseFactor + lightColor.y * specularFactor),
+			intensity * (albedo.z * lightColor.z * diffuseFactor + lightColor.z * specularFactor) };
+	}
+
+	const std::vector<uint32_t>& Rasterizer::GetVisibilityBuffer() const {
+		return m_visibility;
+	}
+
+	const std::vector<uint32_t>& Rasterizer::GetFrameBuffer() const {
+		return m_frameBuffer;
+	}
+
+	const std::vector<float>& Rasterizer::GetDepthBuffer() const {
+		return m_depthBuffer;
+	}
+
+	const RasterStats& Rasterizer::GetStats() const {
+		return m_stats;
+	}
+
+	unsigned Rasterizer::GetWidth() const {
+		return m_width;
+	}
+
+	unsigned Rasterizer::GetHeight() const {
+		return m_height;
+	}
+}
@@ -8,6 +8,7 @@
 #include <DirectXMath.h>
 #include <dxc/dxcapi.h>
 
+#include <cstring> // memcmp
 #include <filesystem> // path, absolute
 
 
@@ -44,6 +45,19 @@ namespace Core {
 	}
 
 	void WolfRenderer::RenderFrameRayTracing() {
+		dataRT.camera.cbData.cameraPosition = dataRT.camera.position;
+		dataRT.camera.cbData.cameraForward = dataRT.camera.forward;
+		dataRT.camera.cbData.cameraRight = dataRT.camera.right;
+		dataRT.camera.cbData.cameraUp = dataRT.camera.up;
+		dataRT.camera.cbData.verticalFOV = dataRT.camera.verticalFOV;
+		dataRT.camera.cbData.aspectRatio = dataRT.camera.aspectRatio;
+		// Convert bool value to either -1 or 1 to avoid if branch and get multiplier.
+		dataRT.camera.cbData.forwardMult = dataRT.GetMatchRTCameraToRaster();
+
+		// A converged image is still in the output texture and is presented again as is.
+		if ( !UpdateAccumulation() )
+			return;
+
 		ID3D12DescriptorHeap* heaps[] = { m_uavsrvHeap.Get() };
 		m_cmdList->SetDescriptorHeaps( _countof( heaps ), heaps );
 		m_cmdList->SetComputeRootSignature( m_globalRootSignature.Get() );
@@ -52,29 +66,45 @@ namespace Core {
 		m_cmdList->SetComputeRootDescriptorTable(
 			0, m_uavsrvHeap->GetGPUDescriptorHandleForHeapStart() );
 
-		// Slot b1: Root Constant - random colors and background color.
+		// Slot b1: Root Constant - random colors, background color and progressive sample.
 		m_cmdList->SetComputeRoot32BitConstant( 1, dataRT.bgColorPacked, 0 );
 		m_cmdList->SetComputeRoot32BitConstant( 1, dataRT.randomColors, 1 );
+		m_cmdList->SetComputeRoot32BitConstant( 1, dataRT.progressive ? m_accumulatedSamples - 1 : 0, 2 );
+		m_cmdList->SetComputeRoot32BitConstant( 1, dataRT.progressive, 3 );
 
 		// Slot b2: Camera Data.
 		m_cmdList->SetComputeRootConstantBufferView(
 			2, dataRT.camera.cb->GetGPUVirtualAddress() );
 
-		dataRT.camera.cbData.cameraPosition = dataRT.camera.position;
-		dataRT.camera.cbData.cameraForward = dataRT.camera.forward;
-		dataRT.camera.cbData.cameraRight = dataRT.camera.right;
-		dataRT.camera.cbData.cameraUp = dataRT.camera.up;
-		dataRT.camera.cbData.verticalFOV = dataRT.camera.verticalFOV;
-		dataRT.camera.cbData.aspectRatio = dataRT.camera.aspectRatio;
-		// Convert bool value to either -1 or 1 to avoid if branch and get multiplier.
-		dataRT.camera.cbData.forwardMult = dataRT.GetMatchRTCameraToRaster();
-
 		memcpy( dataRT.camera.cbMappedPtr, &dataRT.camera.cbData, sizeof( dataRT.camera.cbData ) );
 
 		m_cmdList->SetPipelineState1( m_rtStateObject.Get() );
 		m_cmdList->DispatchRays( &m_dispatchRaysDesc );
 	}
 
+	bool WolfRenderer::UpdateAccumulation() {
+		if ( !dataRT.progressive ) {
+			m_accumulatedSamples = 0;
+			return true;
+		}
+
+		const bool changed{
+			std::memcmp( &m_accumulatedCamera, &dataRT.camera.cbData, sizeof( RT::CameraCB ) ) != 0 ||
+			m_accumulatedBgColor != dataRT.bgColorPacked ||
+			m_accumulatedRandomColors != dataRT.randomColors };
+		if ( changed ) {
+			m_accumulatedCamera = dataRT.camera.cbData;
+			m_accumulatedBgColor = dataRT.bgColorPacked;
+			m_accumulatedRandomColors = dataRT.randomColors;
+			m_accumulatedSamples = 0;
+		}
+
+		if ( m_accumulatedSamples >= dataRT.maxAccumulatedSamples )
+			return false;
+		++m_accumulatedSamples;
+		return true;
+	}
+
 	void WolfRenderer::FrameEndRayTracing() {
 		D3D12_RESOURCE_BARRIER barrier{};
 		barrier.Transition.pResource = m_raytracingOutput.Get();
@@ -91,7 +121,7 @@ namespace Core {
 	}
 
 	void WolfRenderer::CreateGlobalRootSignature() {
-		D3D12_DESCRIPTOR_RANGE1 ranges[2] = {};
+		D3D12_DESCRIPTOR_RANGE1 ranges[3] = {};
 
 		/* It's very important which range at which position will be placed. This directly
 		 * correlates to the order of creation. Here, since UAV is created first in the
@@ -114,19 +144,26 @@ namespace Core {
 		ranges[1].RegisterSpace = 0;
 		ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
+		// Create a Range of type UAV for the progressive accumulation buffer, created third.
+		ranges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+		ranges[2].NumDescriptors = 1;
+		ranges[2].BaseShaderRegister = 1; // u1
+		ranges[2].RegisterSpace = 0;
+		ranges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
 		// Describe the root parameter that will be stored in the Root Signature.
 		D3D12_ROOT_PARAMETER1 rootParams[3] = {};
 
-		// Param 0 - descriptor table with UAV and SRV.
+		// Param 0 - descriptor table with the output UAV, the TLAS SRV and the accumulation UAV.
 		rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
 		rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-		rootParams[0].DescriptorTable.NumDescriptorRanges = 2;
+		rootParams[0].DescriptorTable.NumDescriptorRanges = _countof( ranges );
 		rootParams[0].DescriptorTable.pDescriptorRanges = ranges;
 
-		// Param b0 - Scene Data: random color and background color root constants.
+		// Param b0 - Scene Data: background color, random color, sample index and progressive root constants.
 		rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
 		rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-		rootParams[1].Constants.Num32BitValues = 2;
+		rootParams[1].Constants.Num32BitValues = 4;
 		rootParams[1].Constants.ShaderRegister = 0; // b0
 		rootParams[1].Constants.RegisterSpace = 0;
 
@@ -360,9 +397,30 @@ namespace Core {
 		);
 		CHECK_HR( "Failed to create ray tracing output texture.", hr, log );
 
-		// Create a descriptor heap and a descriptor for the output texture.
+		// Progressive samples are summed in fp32, so thousands of them still average exactly enough.
+		D3D12_RESOURCE_DESC accumDesc{ CD3DX12_RESOURCE_DESC::Tex2D(
+			DXGI_FORMAT_R32G32B32A32_FLOAT,
+			scene.settings.renderWidth,
+			scene.settings.renderHeight,
+			1,
+			1
+		) };
+		accumDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		hr = m_device->CreateCommittedResource(
+			&heapProps,
+			D3D12_HEAP_FLAG_NONE,
+			&accumDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nullptr,
+			IID_PPV_ARGS( &m_accumulationBuffer )
+		);
+		CHECK_HR( "Failed to create ray tracing accumulation texture.", hr, log );
+		m_accumulatedSamples = 0;
+
+		// Create a descriptor heap for the output texture, the TLAS and the accumulation texture.
 		D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
-		heapDesc.NumDescriptors = 2;
+		heapDesc.NumDescriptors = 3;
 		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
@@ -384,6 +442,19 @@ namespace Core {
 			m_uavsrvHeap->GetCPUDescriptorHandleForHeapStart()
 		);
 
+		// The THIRD slot (offset by 2), after the TLAS SRV.
+		UINT handleSize = m_device->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
+		CD3DX12_CPU_DESCRIPTOR_HANDLE accumHandle(
+			m_uavsrvHeap->GetCPUDescriptorHandleForHeapStart(), 2, handleSize );
+
+		uavDesc.Format = accumDesc.Format;
+		m_device->CreateUnorderedAccessView(
+			m_accumulationBuffer.Get(),
+			nullptr,
+			&uavDesc,
+			accumHandle
+		);
+
 		log( "[ Ray Tracing ] Shader output texture created." );
 	}
 
@@ -1,4 +1,5 @@
 #include "Lights.hpp"
+#include "MeshEdges.hpp" // SelectEdges, EdgeRange
 #include "Renderer.hpp"
 #include "utils.hpp" // CHECK_HR
 
@@ -14,6 +15,7 @@
 #include <cmath> // abs, exp, tan
 #include <format> // format
 #include <string> // string
+#include <vector> // vector
 
 namespace Core {
 	void WolfRenderer::PrepareForRasterization() {
@@ -29,6 +31,9 @@ namespace Core {
 		m_gpuMeshesRaster.clear();
 		for ( const Mesh& mesh: scene.GetMeshes() )
 			CreateMeshBuffers(mesh);
+		m_frustumCuller.SetMeshes( scene.GetMeshes() );
+		m_occlusionCuller.SetMeshes( scene.GetMeshes() );
+		m_clusterCuller.SetMeshes( scene.GetMeshes() );
 		CreateTransformConstantBuffer();
 		CreateSceneDataConstantBuffer();
 		CreateScreenDataConstantBuffer();
@@ -60,6 +65,14 @@ namespace Core {
 	}
 
 	void WolfRenderer::RenderFrameRasterization() {
+		// Meshes entirely outside the frustum or hidden behind the occluders are skipped by every pass.
+		const std::vector<uint32_t>& visibleMeshes{ m_frustumCuller.Cull( dataRaster.camera.cbData ) };
+		m_occlusionCuller.enabled = dataRaster.occlusionCulling;
+		const std::vector<uint64_t>& visibleMask{
+			m_occlusionCuller.Cull( dataRaster.camera.cbData, visibleMeshes, dataRaster.showBackfaces ) };
+		// The face pass only draws the clusters in the frustum and, with backface culling, facing the camera.
+		m_clusterCuller.Cull( dataRaster.camera.cbData, visibleMeshes, visibleMask, dataRaster.showBackfaces );
+
 		// Root signatures can't exist all at the same time.
 		// Draw calls need to be issued before setting a new root signature.
 		if ( dataRaster.renderFaces ) {
@@ -92,13 +105,20 @@ namespace Core {
 			m_cmdList->SetGraphicsRootConstantBufferView( 3, m_lightingDataCB->GetGPUVirtualAddress() );
 			memcpy( m_lightingDataCBMappedPtr, &dataRaster.directionalLight.cb, sizeof( dataRaster.directionalLight.cb ) );
 		
-			for ( const Raster::GPUMesh& mesh : m_gpuMeshesRaster ) {
+			for ( uint32_t meshIdx : visibleMeshes ) {
+				if ( !Raster::IsVisible( visibleMask, meshIdx ) )
+					continue;
+				const Raster::GPUMesh& mesh{ m_gpuMeshesRaster[meshIdx] };
 				m_cmdList->IASetVertexBuffers( 0, 1, &mesh.vbView );
 				m_cmdList->IASetIndexBuffer( &mesh.ibView );
 
 				// IA stands for Input Assembler.
 				m_cmdList->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-				m_cmdList->DrawIndexedInstanced( static_cast<UINT>(mesh.indexCount), 1, 0, 0, 0 );
+				for ( const Raster::IndexRange& range : m_clusterCuller.GetRanges( meshIdx ) ) {
+					// Slot b1: SV_PrimitiveID restarts at every draw, the offset keeps the mesh's triangle indices.
+					m_cmdList->SetGraphicsRoot32BitConstant( 1, range.first / 3, 1 );
+					m_cmdList->DrawIndexedInstanced( range.count, 1, range.first, 0, 0 );
+				}
 			}
 		}
 
@@ -113,14 +133,23 @@ namespace Core {
 			m_cmdList->SetGraphicsRootConstantBufferView(
 				0, dataRaster.camera.const_buffer->GetGPUVirtualAddress() );
 
-			for ( const Raster::GPUMesh& mesh : m_gpuMeshesRaster ) {
-				m_cmdList->IASetVertexBuffers( 0, 1, &mesh.vbView );
-				m_cmdList->IASetIndexBuffer( &mesh.ibView );
+			// Slot b1: Edges color (in Edges Pixel shader). Root constants persist over the draws.
+			m_cmdList->SetGraphicsRoot32BitConstant( 1, dataRaster.edgeColor, 0 );
+			m_cmdList->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_LINELIST );
 
-				// Slot b1: Edges color (in Edges Pixel shader).
-				m_cmdList->SetGraphicsRoot32BitConstant( 1, dataRaster.edgeColor, 0 );
+			for ( uint32_t meshIdx : visibleMeshes ) {
+				if ( !Raster::IsVisible( visibleMask, meshIdx ) )
+					continue;
+				const Raster::GPUMesh& mesh{ m_gpuMeshesRaster[meshIdx] };
+				// Every edge once, instead of the triangles in wireframe, which draw shared edges twice.
+				const Raster::EdgeRange edges{ Raster::SelectEdges(
+					dataRaster.edgeMode, mesh.edgeCount, mesh.boundaryEdgeCount, mesh.creaseEdgeCount ) };
+				if ( edges.count == 0 )
+					continue;
 
-				m_cmdList->DrawIndexedInstanced( static_cast<UINT>(mesh.indexCount), 1, 0, 0, 0 );
+				m_cmdList->IASetVertexBuffers( 0, 1, &mesh.vbView );
+				m_cmdList->IASetIndexBuffer( &mesh.ibView );
+				m_cmdList->DrawIndexedInstanced( edges.count * 2, 1, mesh.indexCount + edges.first * 2, 0, 0 );
 			}
 		}
 
@@ -135,7 +164,10 @@ namespace Core {
 			m_cmdList->SetGraphicsRootConstantBufferView(
 				0, dataRaster.camera.const_buffer->GetGPUVirtualAddress() );
 
-			for ( const Raster::GPUMesh& mesh : m_gpuMeshesRaster ) {
+			for ( uint32_t meshIdx : visibleMeshes ) {
+				if ( !Raster::IsVisible( visibleMask, meshIdx ) )
+					continue;
+				const Raster::GPUMesh& mesh{ m_gpuMeshesRaster[meshIdx] };
 				m_cmdList->IASetVertexBuffers( 0, 1, &mesh.vbView );
 				m_cmdList->IASetIndexBuffer( &mesh.ibView );
 
@@ -157,6 +189,14 @@ namespace Core {
 		}
 	}
 
+	const Raster::CullingStats& WolfRenderer::GetCullingStats() const {
+		return m_frustumCuller.GetStats();
+	}
+
+	const Raster::OcclusionStats& WolfRenderer::GetOcclusionStats() const {
+		return m_occlusionCuller.GetStats();
+	}
+
 	void WolfRenderer::FrameEndRasterization() {
 		D3D12_RESOURCE_BARRIER barrier{};
 		barrier.Transition.pResource = m_renderTargets[m_scFrameIdx].Get();
@@ -176,7 +216,7 @@ namespace Core {
 		rootParams[shaderRegisterCBV].Descriptor.RegisterSpace = 0;
 		shaderRegisterCBV++;
 
-		// Param b1 - frameIdx, specStrength.
+		// Param b1 - frameIdx, first primitive of the draw.
 		rootParams[shaderRegisterCBV].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
 		rootParams[shaderRegisterCBV].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 		rootParams[shaderRegisterCBV].Constants.ShaderRegister = shaderRegisterCBV;
@@ -389,7 +429,7 @@ namespace Core {
 
 		psoDesc.pRootSignature = m_rootSignatureEdges.Get();
 		psoDesc.PS = { g_const_color_wire_ps, _countof( g_const_color_wire_ps ) };
-		psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; // Wireframe.
+		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; // Edge line lists.
 		hr = m_device->CreateGraphicsPipelineState(
 			&psoDesc,
 			IID_PPV_ARGS( &m_pipelineStateEdges )
@@ -415,7 +455,8 @@ namespace Core {
 
 	void WolfRenderer::CreateMeshBuffers( const Mesh& mesh ) {
 		const size_t vbSize{ sizeof( Vertex ) * mesh.vertices.size() };
-		const size_t ibSize{ sizeof( uint32_t ) * mesh.indices.size() };
+		// The edge line list is stored after the triangles.
+		const size_t ibSize{ sizeof( uint32_t ) * (mesh.indices.size() + mesh.edgeIndices.size()) };
 
 		// Create the "Intermediate" Upload Buffers (Staging).
 		ComPtr<ID3D12Resource> vbUpload{ nullptr };
@@ -466,13 +507,18 @@ namespace Core {
 			void* pIndexData{ nullptr };
 			hr = ibUpload->Map( 0, nullptr, &pIndexData );
 			CHECK_HR( "Failed to map upload buffer.", hr, log );
-			memcpy( pIndexData, mesh.indices.data(), ibSize );
+			memcpy( pIndexData, mesh.indices.data(), sizeof( uint32_t ) * mesh.indices.size() );
+			memcpy( static_cast<uint32_t*>(pIndexData) + mesh.indices.size(), mesh.edgeIndices.data(),
+				sizeof( uint32_t ) * mesh.edgeIndices.size() );
 			ibUpload->Unmap( 0, nullptr );
 		}
 
 		Raster::GPUMesh gpuMesh;
 		gpuMesh.vertexCount = static_cast<UINT>(mesh.vertices.size());
 		gpuMesh.indexCount = static_cast<UINT>(mesh.indices.size());
+		gpuMesh.edgeCount = static_cast<UINT>(mesh.edgeIndices.size() / 2);
+		gpuMesh.boundaryEdgeCount = mesh.boundaryEdgeCount;
+		gpuMesh.creaseEdgeCount = mesh.creaseEdgeCount;
 
 		// Create the destination Vertex Buffer (Default Heap).
 		// Default heap used (GPU VRAM) that CPU can't access directly.
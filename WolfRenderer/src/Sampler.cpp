@@ -0,0 +1,206 @@
+#include "Sampler.hpp" // Sampler, SamplerType, Philox, OwenScramble
+
+#include <algorithm> // min
+#include <cmath> // exp
+#include <vector> // vector
+
+#include "CPUTracer.hpp" // HashUint
+
+
+namespace CPU {
+	namespace {
+		uint32_t ReverseBits( uint32_t value ) {
+			value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+			value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+			value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+			value = ((value >> 8) & 0x00FF00FF) | ((value & 0x00FF00FF) << 8);
+			return (value >> 16) | (value << 16);
+		}
+
+		/// Second dimension of the Sobol sequence. The first one is the bit-reversed index.
+		uint32_t Sobol1( uint32_t index ) {
+			uint32_t value{};
+			for ( uint32_t direction{ 0x80000000 }; index != 0; index >>= 1, direction ^= direction >> 1 )
+				if ( index & 1 )
+					value ^= direction;
+			return value;
+		}
+
+		/// 32-bit fixed point to [0, 1). Only 24 bits fit a float, rounding up could return 1.
+		float ToUnitFloat( uint32_t value ) {
+			return (value >> 8) * (1.f / 16777216.f);
+		}
+
+		/// Void-and-cluster: points are ranked by repeatedly removing the tightest cluster of an initial
+		/// pattern and filling the largest void, where the energy of a pixel is a Gaussian-weighted sum of
+		/// the points around it on the torus. The rank order is the blue noise value.
+		std::vector<float> GenerateBlueNoise() {
+			constexpr uint32_t size{ BlueNoiseSize };
+			constexpr uint32_t count{ size * size };
+			constexpr float sigma{ 1.5f };
+
+			std::vector<float> kernel( count );
+			for ( uint32_t y{}; y < size; ++y )
+				for ( uint32_t x{}; x < size; ++x ) {
+					const float dx{ static_cast<float>(std::min( x, size - x )) };
+					const float dy{ static_cast<float>(std::min( y, size - y )) };
+					kernel[y * size + x] = std::exp( -(dx * dx + dy * dy) / (2.f * sigma * sigma) );
+				}
+
+			std::vector<uint8_t> pattern( count );
+			std::vector<float> energy( count );
+			const auto toggle = [&]( uint32_t pixel ) {
+				const float sign{ pattern[pixel] ? -1.f : 1.f };
+				pattern[pixel] ^= 1;
+				const uint32_t px{ pixel % size };
+				const uint32_t py{ pixel / size };
+				for ( uint32_t y{}; y < size; ++y )
+					for ( uint32_t x{}; x < size; ++x )
+						energy[y * size + x] += sign * kernel[((y - py) % size) * size + (x - px) % size];
+			};
+			// Tightest cluster: the point with the highest energy. Largest void: the empty pixel with the lowest.
+			const auto find = [&]( bool cluster ) {
+				uint32_t best{};
+				float bestEnergy{ cluster ? -1.f : 1e30f };
+				for ( uint32_t pixel{}; pixel < count; ++pixel )
+					if ( pattern[pixel] == (cluster ? 1 : 0) && (cluster ? energy[pixel] > bestEnergy : energy[pixel] < bestEnergy) ) {
+						best = pixel;
+						bestEnergy = energy[pixel];
+					}
+				return best;
+			};
+
+			// Random initial pattern covering a tenth of the tile, spread out until no point moves anymore.
+			uint32_t initialCount{};
+			for ( uint32_t i{}; initialCount < count / 10; ++i ) {
+				const uint32_t pixel{ HashUint( i ) % count };
+				if ( !pattern[pixel] ) {
+					toggle( pixel );
+					++initialCount;
+				}
+			}
+			for ( uint32_t iteration{}; iteration < count; ++iteration ) {
+				const uint32_t cluster{ find( true ) };
+				toggle( cluster );
+				const uint32_t largestVoid{ find( false ) };
+				toggle( largestVoid );
+				if ( largestVoid == cluster )
+					break;
+			}
+
+			std::vector<uint32_t> rank( count );
+			const std::vector<uint8_t> initialPattern{ pattern };
+			const std::vector<float> initialEnergy{ energy };
+			for ( uint32_t remaining{ initialCount }; remaining > 0; ) {
+				const uint32_t cluster{ find( true ) };
+				toggle( cluster );
+				rank[cluster] = --remaining;
+			}
+
+			// The energy of the empty pixels mirrors the energy of the points, so filling the largest void
+			// past half of the tile is the same as removing the tightest cluster of the empty pixels.
+			pattern = initialPattern;
+			energy = initialEnergy;
+			for ( uint32_t filled{ initialCount }; filled < count; ++filled ) {
+				const uint32_t largestVoid{ find( false ) };
+				toggle( largestVoid );
+				rank[largestVoid] = filled;
+			}
+
+			std::vector<float> tile( count );
+			for ( uint32_t pixel{}; pixel < count; ++pixel )
+				tile[pixel] = (rank[pixel] + 0.5f) / count;
+			return tile;
+		}
+	}
+
+	const char* ToString( SamplerType type ) {
+		switch ( type ) {
+			case SamplerType::White:
+				return "White";
+			case SamplerType::Sobol:
+				return "Sobol";
+			case SamplerType::BlueNoise:
+				return "BlueNoise";
+			default:
+				return "Unknown";
+		}
+	}
+
+	std::array<uint32_t, 4> Philox( std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key ) {
+		for ( int round{}; round < 10; ++round ) {
+			const uint64_t product0{ static_cast<uint64_t>(0xD2511F53) * counter[0] };
+			const uint64_t product1{ static_cast<uint64_t>(0xCD9E8D57) * counter[2] };
+			counter = {
+				static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0], static_cast<uint32_t>(product1),
+				static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1], static_cast<uint32_t>(product0) };
+			key[0] += 0x9E3779B9;
+			key[1] += 0xBB67AE85;
+		}
+		return counter;
+	}
+
+	uint32_t OwenScramble( uint32_t value, uint32_t seed ) {
+		// Laine-Karras permutation on the reversed bits: every bit is flipped depending on the more significant ones.
+		value = ReverseBits( value );
+		value ^= value * 0x3D20ADEA;
+		value += seed;
+		value *= (seed >> 16) | 1;
+		value ^= value * 0x05526C56;
+		value ^= value * 0x53A22864;
+		return ReverseBits( value );
+	}
+
+	std::span<const float> GetBlueNoiseTile() {
+		static const std::vector<float> tile{ GenerateBlueNoise() };
+		return tile;
+	}
+
+	Sampler::Sampler( SamplerType type, uint32_t x, uint32_t y, uint32_t sampleIndex, uint32_t seed ) :
+		m_type{ type }, m_x{ x }, m_y{ y }, m_sampleIndex{ sampleIndex }, m_seed{ seed },
+		m_pixelSeed{ HashUint( x ^ HashUint( y ^ HashUint( seed ) ) ) } {}
+
+	float Sampler::Get1D() {
+		return ToUnitFloat( Next()[0] );
+	}
+
+	DirectX::XMFLOAT2 Sampler::Get2D() {
+		const std::array<uint32_t, 2> values{ Next() };
+		return { ToUnitFloat( values[0] ), ToUnitFloat( values[1] ) };
+	}
+
+	void Sampler::SetDimension( uint32_t dimension ) {
+		m_dimension = dimension;
+	}
+
+	std::array<uint32_t, 2> Sampler::Next() {
+		const uint32_t dimension{ m_dimension++ };
+		if ( m_type == SamplerType::White ) {
+			const std::array<uint32_t, 4> words{ Philox( { m_x, m_y, m_sampleIndex, dimension }, { m_seed, 0x6A09E667 } ) };
+			return { words[0], words[1] };
+		}
+
+		// Every dimension is a 2D Sobol point of a shuffled index (Burley 2020). The shuffle keeps
+		// the first 2^k samples a block of 2^k Sobol points, so they stay stratified, while
+		// decorrelating the dimensions. Blue noise shares the scramble between all pixels.
+		const uint32_t dimensionSeed{ HashUint( (m_type == SamplerType::Sobol ? m_pixelSeed : HashUint( m_seed )) ^
+			HashUint( dimension ) ) };
+		const uint32_t index{ OwenScramble( m_sampleIndex, dimensionSeed ) };
+		std::array<uint32_t, 2> values{
+			OwenScramble( ReverseBits( index ), HashUint( dimensionSeed ^ 0x1 ) ),
+			OwenScramble( Sobol1( index ), HashUint( dimensionSeed ^ 0x2 ) ) };
+
+		if ( m_type == SamplerType::BlueNoise ) {
+			// Toroidal shift by the tile, read at another offset for every coordinate. In fixed point,
+			// the wrap-around of the addition is the wrap-around of the shift.
+			const std::span<const float> tile{ GetBlueNoiseTile() };
+			for ( uint32_t i{}; i < 2; ++i ) {
+				const uint32_t offset{ HashUint( dimension * 2 + i ) };
+				const uint32_t x{ (m_x + offset) % BlueNoiseSize };
+				const uint32_t y{ (m_y + (offset >> 16)) % BlueNoiseSize };
+				values[i] += static_cast<uint32_t>(tile[y * BlueNoiseSize + x] * 4294967296.0);
+			}
+		}
+		return values;
+	}
+}
@@ -2,8 +2,13 @@
 
 #include "rapidjson/istreamwrapper.h" // IStreamWrapper
 
+#include "MeshClusters.hpp" // BuildClusters
+#include "MeshEdges.hpp" // BuildEdges
+
 #include <fstream> // ifstream
 #include <iostream> // cerr, cout
+#include <string_view> // string_view
+#include <unordered_map> // unordered_map
 
 
 Scene::Scene() : log{ std::cout } {}
@@ -24,6 +29,8 @@ void Scene::ParseSceneFile() {
 		log( "Parse errors found in scene file: " + m_filePath, LogLevel::Critical );
 
 	ParseSettingsTag( doc );
+	ParseMaterialsTag( doc );
+	ParseLightsTag( doc );
 	ParseObjectsTag( doc );
 }
 
@@ -31,6 +38,14 @@ const std::vector<Mesh>& Scene::GetMeshes() const {
 	return m_meshes;
 }
 
+const std::vector<Material>& Scene::GetMaterials() const {
+	return m_materials;
+}
+
+const std::vector<Light>& Scene::GetLights() const {
+	return m_lights;
+}
+
 void Scene::ParseSettingsTag( const rapidjson::Document& doc ) {
 	// JSON Tags to look for.
 	constexpr char t_settings[]{ "settings" };
@@ -73,10 +88,11 @@ void Scene::ParseSettingsTag( const rapidjson::Document& doc ) {
 	}
 	settings.renderHeight = imgSettings[t_height].GetUint();
 
-	if ( imgSettings.HasMember( t_bucketSize ) && imgSettings[t_bucketSize].IsInt() ) {
-		log( "Ignoring bucket size information in scene file.", LogLevel::Debug );
+	if ( imgSettings.HasMember( t_bucketSize ) && imgSettings[t_bucketSize].IsInt() &&
+		imgSettings[t_bucketSize].GetInt() > 0 ) {
+		settings.bucketSize = imgSettings[t_bucketSize].GetUint();
 	} else {
-		log( "Bucket size not specified in scene file." );
+		log( "Bucket size not specified in scene file. The CPU tracer will pick one." );
 	}
 }
 
@@ -85,6 +101,7 @@ void Scene::ParseObjectsTag( const rapidjson::Document& doc ) {
 	constexpr char t_objects[]{ "objects" };
 	constexpr char t_vertices[]{ "vertices" };
 	constexpr char t_triangles[]{ "triangles" };
+	constexpr char t_materialIndex[]{ "material_index" };
 
 	if ( !doc.HasMember( t_objects ) || !doc[t_objects].IsArray() ) {
 		log( "No objects found in scene file.", LogLevel::Critical );
@@ -111,6 +128,145 @@ void Scene::ParseObjectsTag( const rapidjson::Document& doc ) {
 		}
 		LoadMesh( mesh[t_vertices].GetArray(), mesh[t_triangles].GetArray() );
 		m_meshes.back().name = "object_" + std::to_string( i );
+
+		if ( mesh.HasMember( t_materialIndex ) && mesh[t_materialIndex].IsUint() &&
+			mesh[t_materialIndex].GetUint() < m_materials.size() ) {
+			m_meshes.back().materialIdx = mesh[t_materialIndex].GetUint();
+		} else if ( mesh.HasMember( t_materialIndex ) ) {
+			log( "Wrong material index of object " + std::to_string( i ) + ". Using the first material.",
+				LogLevel::Error );
+		}
+	}
+
+	// Unique edges for the wireframe passes, clusters for culling the face pass.
+	if ( !m_pool )
+		m_pool = std::make_unique<CPU::ThreadPool>();
+	for ( Mesh& mesh : m_meshes ) {
+		Raster::BuildEdges( mesh, *m_pool );
+		log( "Edges of " + mesh.name + ": " + std::to_string( mesh.edgeIndices.size() / 2 ) + " (" +
+			std::to_string( mesh.boundaryEdgeCount ) + " boundary, " + std::to_string( mesh.creaseEdgeCount ) + " crease)." );
+		Raster::BuildClusters( mesh, *m_pool );
+	}
+}
+
+void Scene::ParseMaterialsTag( const rapidjson::Document& doc ) {
+	// JSON Tags to look for.
+	constexpr char t_textures[]{ "textures" };
+	constexpr char t_materials[]{ "materials" };
+	constexpr char t_name[]{ "name" };
+	constexpr char t_type[]{ "type" };
+	constexpr char t_albedo[]{ "albedo" };
+	constexpr char t_ior[]{ "ior" };
+	constexpr char t_smoothShading[]{ "smooth_shading" };
+	constexpr char t_innerColor[]{ "inner_color" };
+	constexpr char t_colorA[]{ "color_A" };
+
+	const auto readColor = []( const rapidjson::Value& value, DirectX::XMFLOAT3& color ) {
+		if ( !value.IsArray() || value.Size() != 3 || !value[0].IsNumber() || !value[1].IsNumber() || !value[2].IsNumber() )
+			return false;
+		color = {
+			static_cast<float>(value[0].GetDouble()),
+			static_cast<float>(value[1].GetDouble()),
+			static_cast<float>(value[2].GetDouble()) };
+		return true;
+	};
+
+	// Only flat albedo textures are supported. Other textures are reduced to their first color.
+	std::unordered_map<std::string_view, DirectX::XMFLOAT3> textures;
+	if ( doc.HasMember( t_textures ) && doc[t_textures].IsArray() ) {
+		for ( const rapidjson::Value& texture : doc[t_textures].GetArray() ) {
+			if ( !texture.IsObject() || !texture.HasMember( t_name ) || !texture[t_name].IsString() )
+				continue;
+
+			DirectX::XMFLOAT3 color{ 1.f, 1.f, 1.f };
+			if ( !texture.HasMember( t_albedo ) || !readColor( texture[t_albedo], color ) ) {
+				if ( texture.HasMember( t_innerColor ) )
+					readColor( texture[t_innerColor], color );
+				else if ( texture.HasMember( t_colorA ) )
+					readColor( texture[t_colorA], color );
+				log( std::string{ "Texture \"" } + texture[t_name].GetString() +
+					"\" is not a flat albedo. Using a single color.", LogLevel::Warning );
+			}
+			textures[texture[t_name].GetString()] = color;
+		}
+	}
+
+	if ( doc.HasMember( t_materials ) && doc[t_materials].IsArray() ) {
+		for ( const rapidjson::Value& materialObj : doc[t_materials].GetArray() ) {
+			Material material{};
+			if ( !materialObj.IsObject() ) {
+				log( "Non-object found in materials array. Using a default material.", LogLevel::Error );
+				m_materials.push_back( material );
+				continue;
+			}
+
+			const std::string_view type{ materialObj.HasMember( t_type ) && materialObj[t_type].IsString() ?
+				materialObj[t_type].GetString() : "" };
+			if ( type == "reflective" ) {
+				material.type = MaterialType::Reflective;
+			} else if ( type == "refractive" ) {
+				material.type = MaterialType::Refractive;
+			} else if ( type == "constant" ) {
+				material.type = MaterialType::Constant;
+			} else if ( type != "diffuse" ) {
+				log( "Unknown material type \"" + std::string{ type } + "\". Using diffuse.", LogLevel::Warning );
+			}
+
+			if ( materialObj.HasMember( t_albedo ) ) {
+				const rapidjson::Value& albedo{ materialObj[t_albedo] };
+				if ( albedo.IsString() ) {
+					const auto texture{ textures.find( albedo.GetString() ) };
+					if ( texture != textures.end() )
+						material.albedo = texture->second;
+					else
+						log( std::string{ "Unknown texture \"" } + albedo.GetString() + "\".", LogLevel::Error );
+				} else if ( !readColor( albedo, material.albedo ) ) {
+					log( "Wrong albedo format in material. Using white.", LogLevel::Error );
+				}
+			}
+
+			if ( materialObj.HasMember( t_ior ) && materialObj[t_ior].IsNumber() )
+				material.ior = static_cast<float>(materialObj[t_ior].GetDouble());
+			if ( materialObj.HasMember( t_smoothShading ) && materialObj[t_smoothShading].IsBool() )
+				material.smoothShading = materialObj[t_smoothShading].GetBool();
+
+			m_materials.push_back( material );
+		}
+	}
+
+	if ( m_materials.empty() ) {
+		log( "No materials found in scene file. Using a default diffuse material.", LogLevel::Debug );
+		m_materials.emplace_back();
+	}
+}
+
+void Scene::ParseLightsTag( const rapidjson::Document& doc ) {
+	// JSON Tags to look for.
+	constexpr char t_lights[]{ "lights" };
+	constexpr char t_intensity[]{ "intensity" };
+	constexpr char t_position[]{ "position" };
+
+	if ( !doc.HasMember( t_lights ) || !doc[t_lights].IsArray() )
+		return;
+
+	for ( const rapidjson::Value& lightObj : doc[t_lights].GetArray() ) {
+		if ( !lightObj.IsObject() || !lightObj.HasMember( t_intensity ) || !lightObj[t_intensity].IsNumber() ||
+			!lightObj.HasMember( t_position ) || !lightObj[t_position].IsArray() ) {
+			log( "Wrong light format. Skipping light.", LogLevel::Error );
+			continue;
+		}
+
+		const rapidjson::Value& position{ lightObj[t_position] };
+		if ( position.Size() != 3 || !position[0].IsNumber() || !position[1].IsNumber() || !position[2].IsNumber() ) {
+			log( "Wrong light position format. Skipping light.", LogLevel::Error );
+			continue;
+		}
+
+		m_lights.push_back( { {
+			static_cast<float>(position[0].GetDouble()),
+			static_cast<float>(position[1].GetDouble()),
+			static_cast<float>(position[2].GetDouble()) },
+			static_cast<float>(lightObj[t_intensity].GetDouble()) } );
 	}
 }
 
@@ -157,4 +313,6 @@ const std::string Scene::GetRenderScenePath() const {
 
 void Scene::Cleanup() {
 	m_meshes.clear();
+	m_materials.clear();
+	m_lights.clear();
 }
@@ -0,0 +1,145 @@
+#include "ThreadPool.hpp" // ThreadPool
+
+#include <algorithm> // max
+
+
+namespace CPU {
+	namespace {
+		uint64_t PackRange( uint32_t begin, uint32_t end ) {
+			return static_cast<uint64_t>(begin) | (static_cast<uint64_t>(end) << 32);
+		}
+
+		uint32_t RangeBegin( uint64_t range ) {
+			return static_cast<uint32_t>(range);
+		}
+
+		uint32_t RangeEnd( uint64_t range ) {
+			return static_cast<uint32_t>(range >> 32);
+		}
+	}
+
+	ThreadPool::ThreadPool( unsigned threadCount )
+		: m_threadCount{ std::max( 1u, threadCount ? threadCount : std::thread::hardware_concurrency() ) },
+		m_shares{ std::make_unique<Share[]>( m_threadCount ) } {
+		// Worker 0 is the thread calling ParallelFor.
+		for ( unsigned worker{ 1 }; worker < m_threadCount; ++worker )
+			m_threads.emplace_back( &ThreadPool::WorkerLoop, this, worker );
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for ( std::thread& thread : m_threads )
+			thread.join();
+	}
+
+	uint64_t ThreadPool::ParallelFor( uint32_t count, const std::function<void( uint32_t, unsigned )>& task ) {
+		if ( count == 0 )
+			return 0;
+
+		for ( unsigned worker{}; worker < m_threadCount; ++worker ) {
+			const uint32_t begin{ static_cast<uint32_t>(static_cast<uint64_t>(count) * worker / m_threadCount) };
+			const uint32_t end{ static_cast<uint32_t>(static_cast<uint64_t>(count) * (worker + 1) / m_threadCount) };
+			m_shares[worker].range.store( PackRange( begin, end ) );
+		}
+		m_steals = 0;
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_task = &task;
+			m_running = m_threadCount - 1;
+			++m_generation;
+		}
+		m_wake.notify_all();
+
+		Work( 0 );
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_done.wait( lock, [this] { return m_running == 0; } );
+		m_task = nullptr;
+		return m_steals;
+	}
+
+	unsigned ThreadPool::GetThreadCount() const {
+		return m_threadCount;
+	}
+
+	void ThreadPool::WorkerLoop( unsigned worker ) {
+		uint64_t generation{};
+		while ( true ) {
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				m_wake.wait( lock, [&] { return m_stop || m_generation != generation; } );
+				if ( m_stop )
+					return;
+				generation = m_generation;
+			}
+
+			Work( worker );
+
+			bool last{};
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				last = --m_running == 0;
+			}
+			if ( last )
+				m_done.notify_one();
+		}
+	}
+
+	void ThreadPool::Work( unsigned worker ) {
+		const std::function<void( uint32_t, unsigned )>& task{ *m_task };
+		do {
+			uint32_t index{};
+			while ( Pop( worker, index ) )
+				task( index, worker );
+		} while ( Steal( worker ) );
+	}
+
+	bool ThreadPool::Pop( unsigned worker, uint32_t& index ) {
+		std::atomic<uint64_t>& share{ m_shares[worker].range };
+		uint64_t range{ share.load() };
+		while ( RangeBegin( range ) < RangeEnd( range ) ) {
+			if ( share.compare_exchange_weak( range, PackRange( RangeBegin( range ) + 1, RangeEnd( range ) ) ) ) {
+				index = RangeBegin( range );
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool ThreadPool::Steal( unsigned thief ) {
+		while ( true ) {
+			unsigned victim{ thief };
+			uint64_t victimRange{};
+			uint32_t largest{};
+			for ( unsigned worker{}; worker < m_threadCount; ++worker ) {
+				if ( worker == thief )
+					continue;
+				const uint64_t range{ m_shares[worker].range.load() };
+				const uint32_t size{ RangeEnd( range ) > RangeBegin( range ) ? RangeEnd( range ) - RangeBegin( range ) : 0 };
+				if ( size > largest ) {
+					largest = size;
+					victim = worker;
+					victimRange = range;
+				}
+			}
+			if ( largest == 0 )
+				return false;
+
+			// The victim keeps the front half, which it is about to work on anyway.
+			const uint32_t begin{ RangeBegin( victimRange ) };
+			const uint32_t end{ RangeEnd( victimRange ) };
+			const uint32_t middle{ begin + largest / 2 };
+			if ( m_shares[victim].range.compare_exchange_strong( victimRange, PackRange( begin, middle ) ) ) {
+				// Only the owner refills its own share, and only once it is empty.
+				m_shares[thief].range.store( PackRange( middle, end ) );
+				++m_steals;
+				return true;
+			}
+		}
+	}
+}
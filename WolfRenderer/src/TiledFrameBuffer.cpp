@@ -0,0 +1,43 @@
+#include "TiledFrameBuffer.hpp" // TiledFrameBuffer
+
+#include <algorithm> // min, max
+#include <cstring> // memcpy
+#include <immintrin.h> // SSE2 intrinsics
+
+
+namespace CPU {
+	void TiledFrameBuffer::Resize( unsigned width, unsigned height ) {
+		m_tilesX = (width + TileSide - 1) / TileSide;
+		m_tiles.resize( static_cast<size_t>(m_tilesX) * ((height + TileSide - 1) / TileSide) );
+	}
+
+	void TiledFrameBuffer::Linearize( uint8_t* image, size_t rowPitch, unsigned x, unsigned y, unsigned width,
+		unsigned height, ThreadPool& pool ) const {
+		if ( width == 0 || height == 0 )
+			return;
+
+		const unsigned xEnd{ x + width };
+		const unsigned yEnd{ y + height };
+		const unsigned firstTileRow{ y / TileSide };
+		pool.ParallelFor( (yEnd - 1) / TileSide - firstTileRow + 1, [&]( uint32_t index, unsigned ) {
+			const unsigned tileRow{ firstTileRow + index };
+			const Tile* tiles{ m_tiles.data() + static_cast<size_t>(tileRow) * m_tilesX };
+			for ( unsigned row{ std::max( y, tileRow * TileSide ) }; row < std::min( yEnd, (tileRow + 1) * TileSide ); ++row ) {
+				uint32_t* destination{ reinterpret_cast<uint32_t*>(image + row * rowPitch) };
+				unsigned column{ x };
+				// Pixels before the first whole tile row.
+				for ( ; column < xEnd && column % TileSide != 0; ++column )
+					destination[column] = tiles[column / TileSide].pixels[row % TileSide][column % TileSide];
+				// Whole tile rows, 32 bytes aligned in the tile.
+				for ( ; column + TileSide <= xEnd; column += TileSide ) {
+					const __m128i* source{ reinterpret_cast<const __m128i*>(tiles[column / TileSide].pixels[row % TileSide]) };
+					_mm_storeu_si128( reinterpret_cast<__m128i*>(destination + column), _mm_load_si128( source ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i*>(destination + column + 4), _mm_load_si128( source + 1 ) );
+				}
+				if ( column < xEnd )
+					std::memcpy( destination + column, tiles[column / TileSide].pixels[row % TileSide],
+						(xEnd - column) * sizeof( uint32_t ) );
+			}
+		} );
+	}
+}
@@ -0,0 +1,310 @@
+#include "WideBVH.hpp" // WideBVH, WideNode, TriangleBlock
+
+#include <algorithm> // min
+#include <cfloat> // FLT_MAX
+#include <intrin.h> // __cpuid, _xgetbv
+
+
+namespace CPU {
+	namespace {
+		/// Every child of a wide node is at least one binary level below it, so a path has at most MaxBVHDepth
+		/// nodes, each leaving at most 7 of its children on the stack, and the root.
+		constexpr unsigned MaxStackSize{ (MaxBVHDepth - 1) * 7 + 1 };
+
+		/// Triangle range [first, first + count) of every binary node's sub-tree.
+		/// Leaf triangles of a sub-tree are contiguous, because the builder partitions in place.
+		struct Range {
+			uint32_t first;
+			uint32_t count;
+		};
+
+		std::vector<Range> ComputeSubtreeRanges( std::span<const BVHNode> nodes ) {
+			std::vector<Range> ranges( nodes.size() );
+			// Children are always stored after their parent, so a reverse sweep is bottom-up.
+			for ( size_t i{ nodes.size() }; i-- > 0; ) {
+				const BVHNode& node{ nodes[i] };
+				if ( node.IsLeaf() )
+					ranges[i] = { node.leftFirst, node.triCount };
+				else
+					ranges[i] = { ranges[node.leftFirst].first,
+						ranges[node.leftFirst].count + ranges[node.leftFirst + 1].count };
+			}
+			return ranges;
+		}
+
+		template <unsigned W>
+		WideNode<W> MakeEmptyNode() {
+			WideNode<W> node{};
+			for ( unsigned i{}; i < W; ++i ) {
+				node.minX[i] = node.minY[i] = node.minZ[i] = FLT_MAX;
+				node.maxX[i] = node.maxY[i] = node.maxZ[i] = FLT_MAX;
+				node.child[i] = EmptyChild;
+				node.blockCount[i] = 0;
+			}
+			return node;
+		}
+
+		/// Packs a range of leaf-ordered triangles into blocks of W. Returns the first block index.
+		template <unsigned W>
+		uint32_t EmitBlocks( std::span<const Triangle> triangles, Range range,
+			std::vector<TriangleBlock<W>>& blocks, uint32_t& blockCount ) {
+			const uint32_t firstBlock{ static_cast<uint32_t>(blocks.size()) };
+			blockCount = (range.count + W - 1) / W;
+			for ( uint32_t b{}; b < blockCount; ++b ) {
+				TriangleBlock<W> block{};
+				for ( unsigned lane{}; lane < W; ++lane ) {
+					const uint32_t triIdx{ b * W + lane };
+					if ( triIdx >= range.count ) {
+						block.primIdx[lane] = NoHit;
+						block.instanceIdx[lane] = NoHit;
+						continue;
+					}
+					const Triangle& tri{ triangles[range.first + triIdx] };
+					block.v0x[lane] = tri.v0.x;
+					block.v0y[lane] = tri.v0.y;
+					block.v0z[lane] = tri.v0.z;
+					block.e1x[lane] = tri.edge1.x;
+					block.e1y[lane] = tri.edge1.y;
+					block.e1z[lane] = tri.edge1.z;
+					block.e2x[lane] = tri.edge2.x;
+					block.e2y[lane] = tri.edge2.y;
+					block.e2z[lane] = tri.edge2.z;
+					block.primIdx[lane] = tri.primIdx;
+					block.instanceIdx[lane] = tri.instanceIdx;
+				}
+				blocks.push_back( block );
+			}
+			return firstBlock;
+		}
+
+		/// Collapses the binary BVH: every wide node repeatedly opens its largest inner child
+		/// until it has W children. Sub-trees with at most W triangles become one leaf block.
+		template <unsigned W>
+		void Collapse( const BVH& bvh, WideStorage<W>& out ) {
+			out.nodes.clear();
+			out.blocks.clear();
+
+			const std::span<const BVHNode> nodes{ bvh.GetNodes() };
+			const std::span<const Triangle> triangles{ bvh.GetTriangles() };
+			if ( nodes.empty() )
+				return;
+
+			const std::vector<Range> ranges{ ComputeSubtreeRanges( nodes ) };
+			auto isWideLeaf = [&]( uint32_t nodeIdx ) {
+				return nodes[nodeIdx].IsLeaf() || ranges[nodeIdx].count <= W;
+			};
+
+			struct Pending {
+				uint32_t binaryNode;
+				uint32_t wideNode;
+			};
+			std::vector<Pending> queue;
+
+			out.nodes.push_back( MakeEmptyNode<W>() );
+			queue.push_back( { 0, 0 } );
+
+			for ( size_t q{}; q < queue.size(); ++q ) {
+				const Pending pending{ queue[q] };
+
+				uint32_t children[W];
+				unsigned childCount{};
+				if ( isWideLeaf( pending.binaryNode ) ) {
+					// Only possible for the root of a tiny scene.
+					children[childCount++] = pending.binaryNode;
+				} else {
+					children[childCount++] = nodes[pending.binaryNode].leftFirst;
+					children[childCount++] = nodes[pending.binaryNode].leftFirst + 1;
+				}
+
+				while ( childCount < W ) {
+					int best{ -1 };
+					float bestArea{ -1.f };
+					for ( unsigned i{}; i < childCount; ++i ) {
+						if ( isWideLeaf( children[i] ) )
+							continue;
+						const float area{ nodes[children[i]].bounds.HalfArea() };
+						if ( area > bestArea ) {
+							bestArea = area;
+							best = static_cast<int>(i);
+						}
+					}
+					if ( best < 0 )
+						break;
+
+					const uint32_t opened{ children[best] };
+					children[best] = nodes[opened].leftFirst;
+					children[childCount++] = nodes[opened].leftFirst + 1;
+				}
+
+				WideNode<W> wide{ MakeEmptyNode<W>() };
+				for ( unsigned i{}; i < childCount; ++i ) {
+					const uint32_t c{ children[i] };
+					const AABB& box{ nodes[c].bounds };
+					wide.minX[i] = box.min.x;
+					wide.minY[i] = box.min.y;
+					wide.minZ[i] = box.min.z;
+					wide.maxX[i] = box.max.x;
+					wide.maxY[i] = box.max.y;
+					wide.maxZ[i] = box.max.z;
+
+					if ( isWideLeaf( c ) ) {
+						wide.child[i] = EmitBlocks<W>( triangles, ranges[c], out.blocks, wide.blockCount[i] );
+					} else {
+						wide.child[i] = static_cast<uint32_t>(out.nodes.size());
+						out.nodes.push_back( MakeEmptyNode<W>() );
+						queue.push_back( { c, wide.child[i] } );
+					}
+				}
+				out.nodes[pending.wideNode] = wide;
+			}
+		}
+
+		/// AnyHit returns at the first hit and skips sorting the children by distance.
+		template <unsigned W, bool AnyHit>
+		bool IntersectWide( const WideStorage<W>& bvh, const Ray& ray, Hit& hit ) {
+			using S = Simd<W>;
+			using Reg = typename S::Reg;
+
+			if ( bvh.nodes.empty() )
+				return false;
+
+			hit.t = std::min( hit.t, ray.tMax );
+			const Reg ox{ S::Set1( ray.origin.x ) };
+			const Reg oy{ S::Set1( ray.origin.y ) };
+			const Reg oz{ S::Set1( ray.origin.z ) };
+			const Reg rdx{ S::Set1( SafeRcp( ray.direction.x ) ) };
+			const Reg rdy{ S::Set1( SafeRcp( ray.direction.y ) ) };
+			const Reg rdz{ S::Set1( SafeRcp( ray.direction.z ) ) };
+			const Reg tMin{ S::Set1( ray.tMin ) };
+
+			struct Entry {
+				uint32_t index; ///< Wide node or first triangle block.
+				uint32_t blockCount; ///< Zero for inner nodes.
+				float dist; ///< Entry distance into the child's box.
+			};
+			Entry stack[MaxStackSize];
+			uint32_t stackSize{};
+			stack[stackSize++] = { 0, 0, ray.tMin };
+
+			bool found{ false };
+			while ( stackSize > 0 ) {
+				const Entry entry{ stack[--stackSize] };
+				if ( entry.dist > hit.t )
+					continue;
+
+				if ( entry.blockCount > 0 ) {
+					for ( uint32_t b{}; b < entry.blockCount; ++b ) {
+						if ( IntersectBlock( bvh.blocks[entry.index + b], ray, hit ) ) {
+							if constexpr ( AnyHit )
+								return true;
+							found = true;
+						}
+					}
+					continue;
+				}
+
+				const WideNode<W>& node{ bvh.nodes[entry.index] };
+				const Reg tx1{ S::Mul( S::Sub( S::Load( node.minX ), ox ), rdx ) };
+				const Reg tx2{ S::Mul( S::Sub( S::Load( node.maxX ), ox ), rdx ) };
+				const Reg ty1{ S::Mul( S::Sub( S::Load( node.minY ), oy ), rdy ) };
+				const Reg ty2{ S::Mul( S::Sub( S::Load( node.maxY ), oy ), rdy ) };
+				const Reg tz1{ S::Mul( S::Sub( S::Load( node.minZ ), oz ), rdz ) };
+				const Reg tz2{ S::Mul( S::Sub( S::Load( node.maxZ ), oz ), rdz ) };
+
+				Reg tNear{ S::Max( S::Min( tx1, tx2 ), tMin ) };
+				tNear = S::Max( tNear, S::Min( ty1, ty2 ) );
+				tNear = S::Max( tNear, S::Min( tz1, tz2 ) );
+				Reg tFar{ S::Min( S::Max( tx1, tx2 ), S::Set1( hit.t ) ) };
+				tFar = S::Min( tFar, S::Max( ty1, ty2 ) );
+				tFar = S::Min( tFar, S::Max( tz1, tz2 ) );
+
+				const int mask{ S::Mask( S::Le( tNear, tFar ) ) };
+				if ( mask == 0 )
+					continue;
+
+				alignas(32) float dists[W];
+				S::Store( dists, tNear );
+
+				// Push hit children far to near, so the nearest child is traversed first.
+				// Insertion into the stack top keeps it sorted, cheaper than a sort for W <= 8 entries.
+				const uint32_t base{ stackSize };
+				for ( unsigned i{}; i < W; ++i ) {
+					if ( !((mask >> i) & 1) )
+						continue;
+					const Entry child{ node.child[i], node.blockCount[i], dists[i] };
+					if constexpr ( AnyHit ) {
+						stack[stackSize++] = child;
+						continue;
+					}
+					uint32_t pos{ stackSize++ };
+					while ( pos > base && stack[pos - 1].dist < child.dist ) {
+						stack[pos] = stack[pos - 1];
+						--pos;
+					}
+					stack[pos] = child;
+				}
+			}
+			return found;
+		}
+	}
+
+	unsigned DetectSIMDWidth() {
+		int info[4]{};
+		__cpuid( info, 1 );
+		const bool osxsave{ (info[2] & (1 << 27)) != 0 };
+		const bool avx{ (info[2] & (1 << 28)) != 0 };
+
+		// The OS must also save the YMM registers on context switches.
+		if ( osxsave && avx && (_xgetbv( 0 ) & 0x6) == 0x6 )
+			return 8;
+		return 4;
+	}
+
+	void WideBVH::Build( const BVH& bvh, unsigned width ) {
+		m_width = width == 4 || width == 8 ? width : DetectSIMDWidth();
+		m_bvh4 = {};
+		m_bvh8 = {};
+		if ( m_width == 8 )
+			Collapse( bvh, m_bvh8 );
+		else
+			Collapse( bvh, m_bvh4 );
+	}
+
+	bool WideBVH::Intersect( const Ray& ray, Hit& hit ) const {
+		if ( m_width == 8 )
+			return IntersectWide<8, false>( m_bvh8, ray, hit );
+		return IntersectWide<4, false>( m_bvh4, ray, hit );
+	}
+
+	bool WideBVH::IntersectAny( const Ray& ray, Hit& hit ) const {
+		if ( m_width == 8 )
+			return IntersectWide<8, true>( m_bvh8, ray, hit );
+		return IntersectWide<4, true>( m_bvh4, ray, hit );
+	}
+
+	unsigned WideBVH::GetWidth() const {
+		return m_width;
+	}
+
+	size_t WideBVH::GetNodeCount() const {
+		return m_width == 8 ? m_bvh8.nodes.size() : m_bvh4.nodes.size();
+	}
+
+	size_t WideBVH::GetNodeMemoryUsage() const {
+		return m_width == 8 ? m_bvh8.nodes.size() * sizeof( WideNode<8> ) : m_bvh4.nodes.size() * sizeof( WideNode<4> );
+	}
+
+	size_t WideBVH::GetMemoryUsage() const {
+		if ( m_width == 8 )
+			return m_bvh8.nodes.size() * sizeof( WideNode<8> ) + m_bvh8.blocks.size() * sizeof( TriangleBlock<8> );
+		return m_bvh4.nodes.size() * sizeof( WideNode<4> ) + m_bvh4.blocks.size() * sizeof( TriangleBlock<4> );
+	}
+
+	const WideStorage<4>& WideBVH::GetBVH4() const {
+		return m_bvh4;
+	}
+
+	const WideStorage<8>& WideBVH::GetBVH8() const {
+		return m_bvh8;
+	}
+}